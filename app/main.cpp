@@ -1,15 +1,33 @@
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
 
 #include <../include/app/Engine.hpp>
 #include <../include/app/SandboxApp.hpp>
 #include <../include/core/Log.hpp>
 
-int main()
+int main(int argc, char** argv)
 {
     try
     {
-        glfwInit();
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        // --headless [frames]: render offscreen without a window
+        bool headless = false;
+        uint64_t headlessFrames = 0;
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--headless") == 0)
+            {
+                headless = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                    headlessFrames = std::strtoull(argv[++i], nullptr, 10);
+            }
+        }
+
+        if (!headless)
+        {
+            glfwInit();
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        }
 
         // Logging
         vks::Log::Init();
@@ -21,6 +39,8 @@ int main()
         config.appName = "Vulkan Sandbox";
         config.engineName = "VKS Engine";
         config.enableValidation = true;
+        config.headless = headless;
+        config.headlessFrames = headlessFrames;
 
         // Create engine + app
         vks::Engine engine(config);
@@ -30,7 +50,8 @@ int main()
         engine.run(app);
 
         vks::Log::Shutdown();
-        glfwTerminate();
+        if (!headless)
+            glfwTerminate();
     }
     catch (const std::exception& e)
     {
@@ -6,7 +6,16 @@ layout(location = 2) in vec3 vCamPos;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform GridMaterialUBO {
+struct Sphere {
+    vec3 center;
+    float radius;
+    float mass;
+};
+
+const int MAX_SPHERES = 32;
+
+// Declared in full, as the array stride depends on it; must match grid.vert
+struct GridMaterial {
     vec4  baseColor;
     float spacing;
     int   dimension;
@@ -15,7 +24,27 @@ layout(set = 1, binding = 0) uniform GridMaterialUBO {
     float nearFade;
     float farFade;
     float time;
-} mat;
+
+    Sphere spheres[MAX_SPHERES];
+    int sphereCount;
+    float softening;
+    float curvatureK;
+
+    int lineVertexCount;
+    int integratorSteps;
+};
+
+// Parameters of every grid material, indexed by the material's slot
+layout(std430, set = 1, binding = 0) readonly buffer MaterialTable {
+    GridMaterial materials[];
+};
+
+layout(push_constant) uniform MaterialPush {
+    uint materialIndex;
+} push;
+
+// Read in place rather than copying the whole block out of the table
+#define mat materials[push.materialIndex]
 
 void main() {
     float dist = length(vWorldPos - vCamPos);
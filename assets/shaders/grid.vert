@@ -15,7 +15,7 @@ struct Sphere {
 
 const int MAX_SPHERES = 32;
 
-layout(set = 1, binding = 0) uniform GridMaterialUBO {
+struct GridMaterial {
     vec4  baseColor;
 
     float spacing;
@@ -37,7 +37,21 @@ layout(set = 1, binding = 0) uniform GridMaterialUBO {
     // ---- NEW FIELDS ----
     int lineVertexCount;   // number of vertices per line (must be >= 2)
     int integratorSteps;   // steps the integrator will take per-vertex
-} mat;
+};
+
+// Parameters of every grid material, indexed by the material's slot
+layout(std430, set = 1, binding = 0) readonly buffer MaterialTable {
+    GridMaterial materials[];
+};
+
+// Grids draw one material per draw and are never GPU-driven (they aren't
+// instanced), so the index comes with the draw
+layout(push_constant) uniform MaterialPush {
+    uint materialIndex;
+} push;
+
+// Read in place rather than copying the sphere array out of the table
+#define mat materials[push.materialIndex]
 
 layout(location = 0) out vec4 vColor;
 layout(location = 1) out vec3 vWorldPos;
@@ -4,10 +4,17 @@
 layout(location = 0) in vec3 fragNormal;
 layout(location = 1) in vec3 fragPos;
 layout(location = 2) in vec2 fragUV;
+layout(location = 3) flat in uint fragMaterialIndex;
 
-layout(set = 1, binding = 0) uniform MaterialUBO {
+struct MaterialParams {
     vec4 baseColorFactor;
-} matUBO;
+};
+
+// Parameters of every material of this type, indexed by the material's slot,
+// which the vertex shader looks up per instance
+layout(std430, set = 1, binding = 0) readonly buffer MaterialTable {
+    MaterialParams materials[];
+};
 
 layout(location = 0) out vec4 outColor;
 
@@ -22,6 +29,6 @@ void main() {
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * lightColor;
 
-    vec3 result = (ambient + diffuse) * matUBO.baseColorFactor.rgb;
+    vec3 result = (ambient + diffuse) * materials[fragMaterialIndex].baseColorFactor.rgb;
     outColor = vec4(result, 1.0);
 }
\ No newline at end of file
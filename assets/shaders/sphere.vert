@@ -7,9 +7,21 @@ layout(binding = 0) uniform UniformBufferObject {
     vec3 camPos;
 } ubo;
 
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-} pushConst;
+// Per-instance transforms written by the geometry pass. gl_InstanceIndex
+// includes the draw's firstInstance, so it indexes the whole frame's buffer.
+layout(std430, set = 2, binding = 0) readonly buffer InstanceBuffer {
+    mat4 models[];
+} instances;
+
+// Material of each instance, indexed the same way. GPU-driven draws index both
+// by GpuScene slot, so one draw covers every material of the type.
+layout(std430, set = 2, binding = 1) readonly buffer InstanceMaterials {
+    uint materialIndices[];
+};
+
+// Set for geometry::VertexFormat::Packed: positions arrive in [-1, 1] and the
+// model matrix dequantizes them, normals are octahedral-encoded in xy
+layout(constant_id = 0) const bool PACKED_VERTICES = false;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
@@ -18,11 +30,23 @@ layout(location = 2) in vec2 inUV;
 layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec3 fragPos;
 layout(location = 2) out vec2 fragUV;
+layout(location = 3) flat out uint fragMaterialIndex;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main() {
-    vec4 worldPos = pushConst.model * vec4(inPosition, 1.0);
+    mat4 model = instances.models[gl_InstanceIndex];
+
+    vec4 worldPos = model * vec4(inPosition, 1.0);
     gl_Position = ubo.proj * ubo.view * worldPos;
 
-    fragPos = vec3(pushConst.model * vec4(inPosition, 1.0));
-    fragNormal = mat3(transpose(inverse(pushConst.model))) * inNormal;
+    fragPos = vec3(worldPos);
+    vec3 normal = PACKED_VERTICES ? octDecode(inNormal.xy) : inNormal;
+    fragNormal = mat3(transpose(inverse(model))) * normal;
+    fragMaterialIndex = materialIndices[gl_InstanceIndex];
 }
@@ -16,11 +16,11 @@ layout(set = 0, binding = 0) uniform CameraUBO
     vec3 cameraPos;
 } camera;
 
-// Push Constants
-layout(push_constant) uniform Push
+// Per-instance transforms (Set 2), indexed with the draw's firstInstance included
+layout(std430, set = 2, binding = 0) readonly buffer InstanceBuffer
 {
-    mat4 model;
-} push;
+    mat4 models[];
+} instances;
 
 void main()
 {
@@ -29,6 +29,6 @@ void main()
     gl_Position =
         camera.proj *
         camera.view *
-        push.model *
+        instances.models[gl_InstanceIndex] *
         vec4(inPosition, 1.0);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <typeindex>
 
 #include <gfx/Instance.hpp>
 #include <gfx/DebugUtilsMessenger.hpp>
@@ -10,10 +11,18 @@
 #include <gfx/CommandPool.hpp>
 #include <assets/AssetManager.hpp>
 #include <scene/Camera.hpp>
+#include <scene/GeometryPool.hpp>
 #include <gfx/Descriptors.hpp>
+#include <materials/MaterialTable.hpp>
 #include <scene/Scene.hpp>
 #include <render/RenderGraph.hpp>
+#include <render/TransientAttachmentPool.hpp>
 #include <gfx/Buffer.hpp>
+#include <render/passes/FrameReadbackPass.hpp>
+#include <render/passes/DrawCommandPass.hpp>
+#include <render/passes/GeometryPass.hpp>
+#include <render/DepthPyramid.hpp>
+#include <render/GpuScene.hpp>
 #include <editor/UI/EngineEditor.hpp>
 
 #include "scene/PhysicsSystem.hpp"
@@ -28,6 +37,23 @@ namespace vks
         const char* appName = "Vulkan Engine";
         const char* engineName = "VKS";
         bool enableValidation = true;
+        // Frames in flight, present mode and input timing; can be changed at runtime
+        FramePacing framePacing = FramePacing::Balanced;
+
+        // Render offscreen without a window, swapchain or editor. Needs no
+        // display or surface extensions, so it runs on CI and software drivers.
+        bool headless = false;
+        // Frames to render before run() returns (0 = until Window::requestClose())
+        uint64_t headlessFrames = 0;
+        // Copy every headless frame back to host memory, see readbackFrame()
+        bool headlessReadback = true;
+
+        // Draw opaque meshes from GPU-built indirect commands (see GpuScene).
+        // Ignored when the device lacks drawIndirectCount; can be toggled at runtime.
+        bool gpuDrivenDraws = false;
+        // Skip GPU-driven draws hidden behind the depth of earlier draws (see
+        // DepthPyramid). Only applies with gpuDrivenDraws; can be toggled at runtime.
+        bool occlusionCulling = true;
     };
 
     class Application;
@@ -48,6 +74,7 @@ namespace vks
         Scene& scene() { return m_scene; }
         EngineEditor& editor() { return m_editor; }
         AssetManager& assets() { return m_assets; }
+        GeometryPool& geometry() { return m_geometry; }
         PhysicsSystem& physics() { return m_physicsSystem; }
 
         Camera& camera() { return m_camera; }
@@ -61,17 +88,38 @@ namespace vks
         VkDescriptorSet cameraDescriptorSet() const { return m_cameraDescriptorSet; }
 
         // --- Extension Points ---
-        void registerRenderPass(Ref<IRenderPass> pass);
+        void registerRenderPass(Ref<IGraphPass> pass);
+
+        // Applied at the start of the next frame
+        void setFramePacing(FramePacing pacing);
+        FramePacing framePacing() const { return m_framePacing; }
         Ref<DescriptorSetLayout> getDescriptorSetLayout(const std::string& name) const;
+        // Parameter table shared by materials whose parameters are 'paramsType'
+        Ref<MaterialTable> materialTable(std::type_index paramsType, VkDeviceSize paramsSize);
 
         Ref<RenderTarget> getRenderTarget() { return viewportTarget; }
 
+        // Added to every LOD selection; positive values pick coarser levels (see Model::selectLod)
+        float lodBias() const { return m_lodBias; }
+
+        bool headless() const { return m_headless; }
+        // Latest headless frame as tightly packed RGBA8 rows of the configured size.
+        // Returns false when not headless, readback is disabled or nothing was rendered yet.
+        bool readbackFrame(std::vector<uint8_t>& pixels, uint64_t* frameNumber = nullptr) const;
+
     private:
         void onInit();
         void drawFrame();
         void updateCameraUBO();
 
         void handleRecreate();
+        void applyFramePacing();
+        void applyGpuDrivenDraws();
+        void logRenderTargetMemory() const;
+
+        const bool m_headless;
+        const bool m_headlessReadback;
+        const uint64_t m_headlessFrames;
 
         // Core
         Instance m_instance;
@@ -79,6 +127,9 @@ namespace vks
         Window m_window;
         Device m_device;
         CommandPool m_commandPool;
+        TransientAttachmentPool m_transientAttachments;
+        // Vertex and index memory of every Model
+        GeometryPool m_geometry;
         Ref<SwapChain> m_swapChain;
         Ref<RenderTarget> viewportTarget;
 
@@ -92,15 +143,44 @@ namespace vks
         // Global GPU Resources
         Ref<DescriptorPool> m_globalDescriptorPool;
         std::unordered_map<std::string, Ref<DescriptorSetLayout>> m_descriptorSetLayouts;
+        // By parameter type; created by the first material of each type
+        std::unordered_map<std::type_index, Ref<MaterialTable>> m_materialTables;
         Ref<Buffer> m_cameraUboBuffer;
         VkDescriptorSet m_cameraDescriptorSet = VK_NULL_HANDLE;
 
+        Ref<FrameReadbackPass> m_frameReadback;
+
+        Ref<GeometryPass> m_geometryPass;
+        // Null when the device can't draw indirect with a count buffer
+        Ref<GpuScene> m_gpuScene;
+        Ref<DrawCommandPass> m_drawCommandPass;
+        Ref<DepthPyramid> m_depthPyramid;
+        // Debug panel mirrors, applied at the start of a frame
+        bool m_gpuDrivenDraws = false;
+        bool m_occlusionCulling = true;
+        float m_lodBias = 0.0f;
+        // Debug panel mirrors of DrawCommandPass::stats()
+        int m_drawnObjects = 0;
+        int m_frustumCulledObjects = 0;
+        int m_occludedObjects = 0;
+        // Material parameter bytes written for the last frame
+        int m_materialUploadBytes = 0;
+
         std::vector<Ref<RenderTarget>> viewportRenderTargets;
         bool m_dirtySwapChain = false;
         bool m_dirtyViewport = false;
         VkExtent2D m_newViewportExtent = {1, 1};
         VkExtent2D m_newWindowExtent = {1, 1};
 
+        FramePacing m_framePacing = FramePacing::Balanced;
+        FramePacing m_requestedFramePacing = FramePacing::Balanced;
+        bool m_dirtyFramePacing = false;
+        // Debug panel mirrors
+        int m_framePacingSetting = 0;
+        float m_inputLatencyMs = 0.0f;
+        // Set from the debug panel, cleared once the stats are written
+        bool m_dumpMemoryStats = false;
+
         // Editor Mode (Enables ImGui and other editor features)
         EngineEditor m_editor;
         PhysicsSystem m_physicsSystem;
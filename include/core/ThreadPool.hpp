@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <core/NonCopyable.hpp>
+
+namespace vks
+{
+    // Fixed set of worker threads draining a FIFO queue. Jobs receive the index
+    // of the worker running them so they can use per-thread resources.
+    class ThreadPool : public NonCopyable
+    {
+    public:
+        // Jobs must not throw
+        using Job = std::function<void(uint32_t worker)>;
+
+        // 0 picks one worker per hardware thread, minus the main thread
+        explicit ThreadPool(uint32_t workerCount = 0);
+        ~ThreadPool();
+
+        void submit(Job job);
+
+        // Blocks until the queue is empty and no job is running
+        void wait();
+
+        uint32_t workerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    private:
+        void workerLoop(uint32_t worker);
+
+        std::vector<std::thread> m_workers;
+        std::deque<Job> m_jobs;
+
+        std::mutex m_mutex;
+        std::condition_variable m_jobAvailable;
+        std::condition_variable m_idle;
+        uint32_t m_running = 0;
+        bool m_stopping = false;
+    };
+} // namespace vks
@@ -0,0 +1,15 @@
+#pragma once
+#include <editor/UI/IEditorPanel.hpp>
+
+namespace vks
+{
+    // Per-pass GPU times from the render graph's GpuProfiler
+    class GpuProfilerPanel : public IEditorPanel
+    {
+    public:
+        using IEditorPanel::IEditorPanel;
+
+        const char* getTitle() const override { return "GPU Profiler"; }
+        void onGui() override;
+    };
+}
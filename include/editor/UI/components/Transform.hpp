@@ -24,6 +24,7 @@ namespace vks
             if (dirty)
             {
                 t.updateTransform();
+                registry.patch<Transform>(entity);
             }
         }
     };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gfx/Device.hpp>
+#include <gfx/MemoryAllocator.hpp>
 #include <vulkan/vulkan.h>
 
 namespace vks {
@@ -8,11 +9,12 @@ namespace vks {
 class Buffer {
 public:
     /**
-     * @brief Creates a new buffer and allocates its memory.
+     * @brief Creates a new buffer and sub-allocates its memory from the device's allocator.
      * @param device The vks::Device object.
      * @param size The total size of the buffer in bytes.
      * @param usageFlags The VkBufferUsageFlags (e.g., VERTEX_BUFFER, UNIFORM_BUFFER).
      * @param memoryPropertyFlags The memory properties (e.g., HOST_VISIBLE, DEVICE_LOCAL).
+     *        Host-visible buffers are mapped for their whole life.
      */
     Buffer(
         const vks::Device& device,
@@ -27,15 +29,15 @@ public:
     Buffer& operator=(const Buffer&) = delete;
 
     /**
-     * @brief Maps the buffer's memory to a CPU-accessible pointer.
+     * @brief Exposes the buffer's persistently mapped memory through getMapped().
      * @param size The size of the memory to map (default: whole buffer).
      * @param offset The offset from the start of the buffer memory.
-     * @return VK_SUCCESS on success.
+     * @return VK_SUCCESS on success, VK_ERROR_MEMORY_MAP_FAILED if the memory isn't host-visible.
      */
     VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
     /**
-     * @brief Unmaps the buffer's memory.
+     * @brief Ends access through getMapped(); the memory itself stays mapped.
      */
     void unmap();
 
@@ -54,27 +56,23 @@ public:
      * @param offset The offset from the start of the buffer.
      * @return A VkDescriptorBufferInfo struct.
      */
-    VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+    VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const;
 
     // --- Getters ---
     VkBuffer getBuffer() const { return m_buffer; }
-    VkDeviceMemory getMemory() const { return m_memory; }
+    VmaAllocation getAllocation() const { return m_allocation; }
     VkDeviceSize getSize() const { return m_bufferSize; }
     void* getMapped() const { return m_mapped; }
 
 private:
-    /**
-     * @brief Finds a suitable memory type index on the physical device.
-     */
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-
     // Store a reference to the device, not a copy
     const vks::Device& m_device;
 
     VkBuffer m_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
 
     VkDeviceSize m_bufferSize;
+    void* m_persistent = nullptr; // Whole allocation, mapped by VMA; null unless host-visible
     void* m_mapped = nullptr; // Pointer to the mapped memory
 };
 
@@ -16,8 +16,9 @@ namespace vks
     class CommandBuffers : public NonCopyable
     {
     public:
+        // One buffer per image of 'target' (the swapchain, or the offscreen target when headless)
         CommandBuffers(const Device& device,
-                       const Ref<SwapChain>& swapChain,
+                       const Ref<IRenderTarget>& target,
                        const CommandPool& commandPool);
         ~CommandBuffers();
 
@@ -42,7 +43,7 @@ namespace vks
         std::vector<VkCommandBuffer> m_commandBuffers;
 
         const Device& m_device;
-        const Ref<SwapChain>& m_swapChain;
+        Ref<IRenderTarget> m_target;
         const CommandPool& m_commandPool;
 
         void createCommandBuffers(uint32_t count);
@@ -10,6 +10,9 @@ class Device;
 class CommandPool : public NonCopyable {
 public:
   CommandPool(const Device &device, const VkCommandPoolCreateFlags &flags);
+  // Pool for a queue family other than graphics, e.g. async compute
+  CommandPool(const Device &device, const VkCommandPoolCreateFlags &flags,
+              uint32_t queueFamily);
   ~CommandPool();
 
   inline const VkCommandPool &handle() const { return m_pool; };
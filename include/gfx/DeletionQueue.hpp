@@ -0,0 +1,53 @@
+#ifndef DELETIONQUEUE_HPP
+#define DELETIONQUEUE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include <core/NonCopyable.hpp>
+
+namespace vks {
+
+// Defers destruction of GPU objects until the frames that may still use them
+// have completed, so resizes and reloads don't have to drain the device.
+//
+// Entries are tagged with the current frame number (the timeline value the
+// frame being recorded will signal) and run by collect() once the GPU reports
+// that value as completed. The render graph drives both setFrame() and collect().
+class DeletionQueue : public NonCopyable {
+public:
+  using Deleter = std::function<void()>;
+
+  ~DeletionQueue();
+
+  // Destroys 'deleter's object after the current frame has completed
+  void push(Deleter &&deleter);
+
+  // Runs every entry whose frame is <= 'completedFrame'
+  void collect(uint64_t completedFrame);
+
+  // Runs everything. The caller must have waited for the device.
+  void flush();
+
+  void setFrame(uint64_t frame);
+  uint64_t frame() const;
+
+  size_t pending() const;
+
+private:
+  struct Entry {
+    uint64_t frame;
+    Deleter deleter;
+  };
+
+  mutable std::mutex m_mutex;
+  uint64_t m_frame = 1;
+  // Ordered by frame, since frame numbers only move forward
+  std::deque<Entry> m_entries;
+};
+
+} // namespace vks
+
+#endif // DELETIONQUEUE_HPP
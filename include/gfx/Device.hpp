@@ -1,16 +1,20 @@
 #ifndef DEVICE_HPP
 #define DEVICE_HPP
 
+#include <memory>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 #include <core/NonCopyable.hpp>
+#include <gfx/DeletionQueue.hpp>
+#include <gfx/MemoryAllocator.hpp>
 #include <gfx/QueueFamily.hpp>
 
 namespace vks
 {
     class Buffer;
     class Instance;
+    class UploadManager;
     class Window;
 
     class Device : public NonCopyable
@@ -31,10 +35,49 @@ namespace vks
         inline const VkQueue& graphicsQueue() const { return m_graphicsQueue; }
         inline const VkQueue& presentQueue() const { return m_presentQueue; }
 
+        // Falls back to the graphics queue when there is no dedicated compute family
+        inline const VkQueue& computeQueue() const { return m_computeQueue; }
+        inline uint32_t computeFamily() const
+        {
+            return m_indices.computeFamily.value_or(m_indices.graphicsFamily.value());
+        }
+        inline bool hasDedicatedCompute() const { return m_indices.computeFamily.has_value(); }
+
+        // Falls back to the graphics queue when there is no transfer-only family
+        inline const VkQueue& transferQueue() const { return m_transferQueue; }
+        inline uint32_t transferFamily() const
+        {
+            return m_indices.transferFamily.value_or(m_indices.graphicsFamily.value());
+        }
+        inline bool hasDedicatedTransfer() const { return m_indices.transferFamily.has_value(); }
+
+        // Objects retired here are destroyed once the frames using them are done
+        inline DeletionQueue& deletionQueue() const { return m_deletionQueue; }
+
+        // Where buffers and images get their memory
+        inline const MemoryAllocator& allocator() const { return *m_allocator; }
+        // Batched staging copies into device-local buffers and images
+        inline UploadManager& uploads() const { return *m_uploads; }
+
+        // drawIndirectCount and drawIndirectFirstInstance, needed by GPU-driven draws
+        inline bool supportsDrawIndirectCount() const { return m_drawIndirectCount; }
+        // VK_KHR_present_id + VK_KHR_present_wait: presents can be tagged and waited on
+        inline bool supportsPresentWait() const { return m_presentWait; }
+
         VkPhysicalDeviceProperties properties() const { return m_properties; }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
 
         // --- Image helpers ---
+        // Creates an image without memory; the caller binds it
+        VkImage createImage(
+            uint32_t width,
+            uint32_t height,
+            uint32_t mipLevels,
+            VkFormat format,
+            VkImageTiling tiling,
+            VkImageUsageFlags usage
+        ) const;
+
         void createImage(
             uint32_t width,
             uint32_t height,
@@ -44,7 +87,7 @@ namespace vks
             VkImageUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkImage& image,
-            VkDeviceMemory& imageMemory
+            VmaAllocation& allocation
         ) const;
 
         VkImageView createImageView(
@@ -54,21 +97,6 @@ namespace vks
             uint32_t mipLevels
         ) const;
 
-        void transitionImageLayout(
-            VkImage image,
-            VkFormat format,
-            VkImageLayout oldLayout,
-            VkImageLayout newLayout,
-            uint32_t mipLevels
-        ) const;
-
-        void copyBufferToImage(
-            VkBuffer buffer,
-            VkImage image,
-            uint32_t width,
-            uint32_t height
-        ) const;
-
         void copyImageToBuffer(
             VkCommandBuffer cmd,
             VkImage srcImage,
@@ -86,7 +114,10 @@ namespace vks
         ) const;
 
 
+        // Expects every level in TRANSFER_DST_OPTIMAL with level 0 filled in,
+        // and leaves them all in SHADER_READ_ONLY_OPTIMAL
         void generateMipmaps(
+            VkCommandBuffer cmd,
             VkImage image,
             VkFormat imageFormat,
             uint32_t width,
@@ -106,6 +137,15 @@ namespace vks
         QueueFamilyIndices m_indices;
         VkQueue m_graphicsQueue;
         VkQueue m_presentQueue;
+        VkQueue m_computeQueue;
+        VkQueue m_transferQueue;
+
+        mutable DeletionQueue m_deletionQueue;
+        std::unique_ptr<MemoryAllocator> m_allocator;
+        std::unique_ptr<UploadManager> m_uploads;
+
+        bool m_drawIndirectCount = false;
+        bool m_presentWait = false;
 
         static bool
         CheckDeviceExtensionSupport(const VkPhysicalDevice& device,
@@ -116,7 +156,8 @@ namespace vks
                            const std::vector<const char*>& requiredExtensions);
 
         static bool IsDeviceSuitable(const VkPhysicalDevice& device,
-                                     const VkSurfaceKHR& surface);
+                                     const VkSurfaceKHR& surface,
+                                     const std::vector<const char*>& requiredExtensions);
     };
 } // namespace vks
 
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+namespace vks
+{
+    /**
+     * @brief Byte ranges of a buffer written since it was last uploaded.
+     *
+     * Ranges are kept sorted by offset, and overlapping or touching ranges
+     * merge on insertion, so an upload walks each changed byte once and as
+     * few separate copies as the writes allow.
+     */
+    class DirtyRangeSet
+    {
+    public:
+        // Marks [offset, offset + size) as changed
+        void add(size_t offset, size_t size);
+        void clear();
+
+        bool empty() const { return m_ranges.empty(); }
+        // Sum of the range sizes
+        size_t bytes() const { return m_bytes; }
+
+        // Begin to end of every range, by offset
+        const std::map<size_t, size_t>& ranges() const { return m_ranges; }
+
+    private:
+        std::map<size_t, size_t> m_ranges;
+        size_t m_bytes = 0;
+    };
+} // namespace vks
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+namespace vks
+{
+    /**
+     * @brief Sub-allocates ranges of a fixed-size region in any order.
+     *
+     * Free space is kept as a list of blocks sorted by offset. Allocations take
+     * the smallest block that fits (best fit), and freed ranges merge with the
+     * blocks on either side, so the list stays as short as the fragmentation
+     * allows. Units are up to the caller, e.g. vertices or indices.
+     */
+    class FreeListAllocator
+    {
+    public:
+        explicit FreeListAllocator(uint32_t capacity);
+
+        // Offset of 'size' contiguous units, or nothing if no free block is large enough
+        std::optional<uint32_t> allocate(uint32_t size);
+        // 'offset' and 'size' must be those of an earlier allocation
+        void free(uint32_t offset, uint32_t size);
+
+        uint32_t capacity() const { return m_capacity; }
+        uint32_t used() const { return m_used; }
+        size_t freeBlocks() const { return m_free.size(); }
+
+    private:
+        uint32_t m_capacity;
+        uint32_t m_used = 0;
+        // Offset to size of every free block
+        std::map<uint32_t, uint32_t> m_free;
+    };
+} // namespace vks
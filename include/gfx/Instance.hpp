@@ -12,7 +12,9 @@ namespace vks {
 
 class Instance : public NonCopyable {
 public:
-  Instance(const char *appName, const char *engineName, bool validationLayers);
+  // A headless instance enables no surface extensions
+  Instance(const char *appName, const char *engineName, bool validationLayers,
+           bool headless = false);
   Instance() = delete;
   ~Instance();
 
@@ -23,6 +25,7 @@ public:
 
   static const std::vector<const char *> ValidationLayers;
   static const std::vector<const char *> DeviceExtensions;
+  static const std::vector<const char *> HeadlessDeviceExtensions;
 
 private:
   VkInstance m_instance;
@@ -30,7 +33,7 @@ private:
 
   static bool CheckValidationLayerSupport();
   static void GetRequiredExtensions(std::vector<const char *> &extensions,
-                                    bool validationLayers);
+                                    bool validationLayers, bool headless);
 };
 
 } // namespace vks
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <core/NonCopyable.hpp>
+
+namespace vks
+{
+    /**
+     * @brief Device memory for buffers and images, sub-allocated through VMA.
+     *
+     * Resources share a few large blocks instead of taking one driver
+     * allocation each, so content is no longer bounded by
+     * maxMemoryAllocationCount. VMA still gives a resource its own allocation
+     * when the driver prefers one, and attachments always get one.
+     */
+    class MemoryAllocator : public NonCopyable
+    {
+    public:
+        MemoryAllocator(VkInstance instance, VkPhysicalDevice physical, VkDevice device);
+        ~MemoryAllocator();
+
+        VmaAllocator handle() const { return m_allocator; }
+
+        /**
+         * @brief Where a buffer's memory comes from, chosen by how it is used.
+         *
+         * Device-local buffers prefer memory the host can't see. Host-visible
+         * ones stay mapped for their whole life, and buffers the GPU only
+         * copies into are treated as readback and prefer cached memory.
+         */
+        static VmaAllocationCreateInfo bufferAllocationInfo(VkBufferUsageFlags usage,
+                                                            VkMemoryPropertyFlags properties);
+
+        // Creates the image and binds memory with 'properties' to it
+        VkImage createImage(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties,
+                            VmaAllocation& allocation) const;
+        // Either may be null, e.g. for images bound to memory from elsewhere
+        void destroyImage(VkImage image, VmaAllocation allocation) const;
+
+        // Allocations, blocks and bytes per heap, to the log
+        void logStatistics() const;
+        // VMA's detailed statistics as JSON, listing every allocation
+        void dumpStatistics(const std::string& path) const;
+
+    private:
+        VmaAllocator m_allocator = VK_NULL_HANDLE;
+    };
+} // namespace vks
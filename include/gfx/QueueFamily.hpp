@@ -10,6 +10,10 @@ struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   // Support for drawing to surface
   std::optional<uint32_t> presentFamily;
+  // Compute-capable family without graphics support (async compute), if any
+  std::optional<uint32_t> computeFamily;
+  // Transfer-only family (the copy engine on discrete GPUs), if any
+  std::optional<uint32_t> transferFamily;
 
   inline bool isComplete() {
     return graphicsFamily.has_value() && presentFamily.has_value();
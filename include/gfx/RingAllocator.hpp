@@ -0,0 +1,37 @@
+#pragma once
+
+#include <optional>
+#include <vulkan/vulkan.h>
+
+namespace vks
+{
+    /**
+     * @brief Hands out ranges of a fixed-size buffer in FIFO order.
+     *
+     * Positions only ever grow; the offset into the buffer is the position
+     * modulo the capacity. A range never wraps around the end, the space up to
+     * the end is skipped instead. Ranges are freed in the order they were
+     * allocated by releasing everything before a position taken from head().
+     */
+    class RingAllocator
+    {
+    public:
+        RingAllocator(VkDeviceSize capacity, VkDeviceSize alignment);
+
+        // Offset of 'size' contiguous bytes, or nothing until older ranges are released
+        std::optional<VkDeviceSize> allocate(VkDeviceSize size);
+        // Frees everything allocated before head() returned 'position'
+        void release(VkDeviceSize position);
+
+        VkDeviceSize head() const { return m_head; }
+        VkDeviceSize capacity() const { return m_capacity; }
+        // Bytes between the oldest unreleased range and the head, skipped space included
+        VkDeviceSize used() const { return m_head - m_tail; }
+
+    private:
+        VkDeviceSize m_capacity;
+        VkDeviceSize m_alignment;
+        VkDeviceSize m_head = 0;
+        VkDeviceSize m_tail = 0;
+    };
+} // namespace vks
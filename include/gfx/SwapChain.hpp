@@ -2,6 +2,7 @@
 #define SWAPCHAIN_HPP
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 
 #include <core/NonCopyable.hpp>
 #include <vector>
@@ -23,12 +24,21 @@ namespace vks
     class SwapChain : public IRenderTarget, NonCopyable
     {
     public:
-        explicit SwapChain(const Device& device, const Window& window);
+        // 'minImageCount' raises the image count above minImageCount + 1, e.g. so
+        // every frame in flight can own an image of per-frame targets
+        explicit SwapChain(const Device& device, const Window& window, uint32_t minImageCount = 0);
         ~SwapChain() override;
 
         auto recreate() -> void;
         auto cleanupOld() -> void;
 
+        // Tried in order on the next recreate(); FIFO is the fallback
+        void setPreferredPresentModes(const std::vector<VkPresentModeKHR>& modes)
+        {
+            m_preferredPresentModes = modes;
+        }
+        VkPresentModeKHR presentMode() const { return m_presentMode; }
+
         const VkSwapchainKHR& handle() const { return m_swapChain; }
         VkFormat colorFormat() const override { return m_imageFormat; }
         VkFormat depthFormat() const override { return m_depthFormat; }
@@ -82,13 +92,17 @@ namespace vks
 
         std::vector<VkImage> m_depthImages;
         std::vector<VkImageView> m_depthViews;
-        std::vector<VkDeviceMemory> m_depthImageMemories;
+        std::vector<VmaAllocation> m_depthAllocations;
 
         VkFormat m_imageFormat;
         VkFormat m_depthFormat;
 
         VkExtent2D m_extent;
 
+        uint32_t m_minImageCount = 0;
+        std::vector<VkPresentModeKHR> m_preferredPresentModes{VK_PRESENT_MODE_MAILBOX_KHR};
+        VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
         void createSwapChain();
         void createImageViews();
         void createDepthViews();
@@ -100,7 +114,8 @@ namespace vks
             const std::vector<VkSurfaceFormatKHR>& availableFormats);
         static VkFormat ChooseSwapDepthFormat(VkPhysicalDevice device);
         static VkPresentModeKHR ChooseSwapPresentMode(
-            const std::vector<VkPresentModeKHR>& availablePresentModes);
+            const std::vector<VkPresentModeKHR>& availablePresentModes,
+            const std::vector<VkPresentModeKHR>& preferredPresentModes);
     };
 } // namespace vks
 
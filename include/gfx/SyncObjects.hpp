@@ -1,6 +1,7 @@
 #ifndef SYNCOBJECTS_HPP
 #define SYNCOBJECTS_HPP
 
+#include <cstdint>
 #include <vector>
 #include <vulkan/vulkan.h>
 #include <core/NonCopyable.hpp>
@@ -8,24 +9,42 @@
 namespace vks {
 class Device;
 
+// Frame synchronization built on one timeline semaphore. Every submitted frame
+// signals the next value of a monotonically increasing counter, so "has the GPU
+// finished frame N?" is a counter read instead of a fence per frame.
+//
+// Swapchain acquire/present still require binary semaphores: imageAvailable is
+// per frame-in-flight slot, renderFinished per swapchain image.
 class SyncObjects : public NonCopyable {
 public:
   SyncObjects(const Device &device, uint32_t numImages,
               uint32_t maxFramesInFlight);
   ~SyncObjects();
 
-  inline VkSemaphore &imageAvailable(uint32_t index) {
-    return m_imageAvailable[index];
+  inline VkSemaphore &imageAvailable(uint32_t frame) {
+    return m_imageAvailable[frame];
   }
-  inline VkSemaphore &renderFinished(uint32_t index) {
-    return m_renderFinished[index];
-  }
-  inline VkFence &inFlightFence(uint32_t index) {
-    return m_inFlightFences[index];
-  }
-  inline VkFence &imageInFlight(uint32_t index) {
-    return m_imagesInFlight[index];
+  inline VkSemaphore &renderFinished(uint32_t image) {
+    return m_renderFinished[image];
   }
+  inline VkSemaphore timeline() const { return m_timeline; }
+
+  // Value the frame currently being recorded signals on submit. Starts at 1.
+  inline uint64_t frameValue() const { return m_frameValue; }
+
+  // Last value signaled by the GPU
+  uint64_t completedValue() const;
+  bool isComplete(uint64_t value) const;
+  void wait(uint64_t value) const;
+
+  // Blocks until the previous user of the slot (and, once known, of the
+  // swapchain image) is done with it
+  void waitForFrameSlot(uint32_t frame) const;
+  void waitForImage(uint32_t image) const;
+
+  // Records that the current frame uses 'frame'/'image' and moves frameValue()
+  // on. Call after the frame's last submission.
+  void advance(uint32_t frame, uint32_t image);
 
   void recreate(uint32_t numImages);
 
@@ -34,10 +53,18 @@ private:
 
   uint32_t m_numImages, m_maxFramesInFlight;
 
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  uint64_t m_frameValue = 1;
+
   std::vector<VkSemaphore> m_imageAvailable;
   std::vector<VkSemaphore> m_renderFinished;
-  std::vector<VkFence> m_inFlightFences;
-  std::vector<VkFence> m_imagesInFlight;
+
+  // Timeline value of the last frame that used each slot/image
+  std::vector<uint64_t> m_slotValues;
+  std::vector<uint64_t> m_imageValues;
+
+  void createImageSemaphores();
+  void destroyImageSemaphores();
 };
 
 } // namespace vks
@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 
 #include <gfx/Device.hpp>
+#include <gfx/UploadManager.hpp>
 
 namespace vks {
 
@@ -26,6 +27,8 @@ namespace vks {
         VkDescriptorImageInfo descriptorInfo() const;
 
         uint32_t mipLevels() const { return m_mipLevels; }
+        // Completes when the pixels and mipmaps are on the GPU
+        const UploadFuture& uploaded() const { return m_uploaded; }
 
         const std::string path;
     private:
@@ -38,13 +41,14 @@ namespace vks {
         const Device& m_device;
 
         VkImage m_image = VK_NULL_HANDLE;
-        VkDeviceMemory m_imageMemory = VK_NULL_HANDLE;
+        VmaAllocation m_allocation = VK_NULL_HANDLE;
         VkImageView m_imageView = VK_NULL_HANDLE;
         VkSampler m_sampler = VK_NULL_HANDLE;
 
         uint32_t m_width = 0;
         uint32_t m_height = 0;
         uint32_t m_mipLevels = 1;
+        UploadFuture m_uploaded;
     };
 
 } // namespace vks
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <core/NonCopyable.hpp>
+#include <gfx/Buffer.hpp>
+#include <gfx/CommandPool.hpp>
+#include <gfx/RingAllocator.hpp>
+
+namespace vks
+{
+    class Device;
+    class UploadManager;
+
+    /**
+     * @brief Completion of an upload, checked without blocking.
+     *
+     * A default-constructed future is already complete.
+     */
+    class UploadFuture
+    {
+    public:
+        UploadFuture() = default;
+
+        bool ready() const;
+        // Submits the upload if it is still pending, then blocks until it is done
+        void wait() const;
+
+        uint64_t value() const { return m_value; }
+
+    private:
+        friend class UploadManager;
+        UploadFuture(UploadManager* manager, uint64_t value) : m_manager(manager), m_value(value) {}
+
+        UploadManager* m_manager = nullptr;
+        uint64_t m_value = 0;
+    };
+
+    /**
+     * @brief Copies data into device-local buffers and images in batches.
+     *
+     * Data is staged in a persistently mapped ring buffer, and the copies
+     * queued since the last flush() go out together as one batch, on the
+     * transfer-only queue when the device has one. Each batch signals the next
+     * value of a timeline semaphore, which is what UploadFuture checks.
+     *
+     * Engine flushes before submitting every frame, and the batch ends in a
+     * barrier on the graphics queue, so anything uploaded before a frame is
+     * recorded can be drawn by that frame without waiting for the future.
+     * Destinations have to stay alive until their upload has completed.
+     * Not thread-safe; uploads are queued from the main thread.
+     */
+    class UploadManager : public NonCopyable
+    {
+    public:
+        static constexpr VkDeviceSize STAGING_SIZE = 32 * 1024 * 1024;
+        // Uploads larger than this get their own staging buffer instead of
+        // draining the ring
+        static constexpr VkDeviceSize MAX_RING_UPLOAD = STAGING_SIZE / 4;
+
+        explicit UploadManager(const Device& device);
+        ~UploadManager();
+
+        // Writes 'size' bytes to 'dst' at 'dstOffset'
+        UploadFuture upload(const Buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+        // Fills level 0 of a 2D colour image from tightly packed 'pixels' and
+        // generates the other levels. The image must be new (UNDEFINED layout)
+        // and is left in SHADER_READ_ONLY_OPTIMAL.
+        UploadFuture upload(VkImage image, VkFormat format, VkExtent2D extent, uint32_t mipLevels,
+                            const void* pixels, VkDeviceSize size);
+
+        // Submits the copies queued since the last flush, and frees staging
+        // space of batches that have completed
+        void flush();
+
+        bool isComplete(uint64_t value) const;
+        void wait(uint64_t value);
+
+    private:
+        struct BufferCopy
+        {
+            VkBuffer src;
+            VkBuffer dst;
+            VkBufferCopy region;
+        };
+
+        struct ImageCopy
+        {
+            VkBuffer src;
+            VkDeviceSize srcOffset;
+            VkImage image;
+            VkFormat format;
+            VkExtent2D extent;
+            uint32_t mipLevels;
+        };
+
+        struct Batch
+        {
+            uint64_t value = 0;
+            // Ring position to release once the batch has completed
+            VkDeviceSize stagingEnd = 0;
+            std::vector<BufferCopy> buffers;
+            std::vector<ImageCopy> images;
+            // For uploads too large for the ring
+            std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+            VkCommandBuffer transfer = VK_NULL_HANDLE;
+            VkCommandBuffer graphics = VK_NULL_HANDLE;
+
+            bool empty() const { return buffers.empty() && images.empty(); }
+        };
+
+        // Staging memory for 'size' bytes, as a buffer and an offset into it
+        std::pair<VkBuffer, VkDeviceSize> stage(const void* data, VkDeviceSize size);
+        void submit();
+        // Frees completed batches, oldest first
+        void retire();
+
+        VkCommandBuffer beginCommands(const CommandPool& pool) const;
+        void recordTransfer(VkCommandBuffer cmd, const Batch& batch) const;
+        void recordGraphics(VkCommandBuffer cmd, const Batch& batch) const;
+
+        const Device& m_device;
+        // Copies run on a different family, so ownership of the destinations
+        // is handed over to graphics at the end of every batch
+        const bool m_dedicatedTransfer;
+
+        Buffer m_staging;
+        RingAllocator m_ring;
+
+        CommandPool m_graphicsPool;
+        std::unique_ptr<CommandPool> m_transferPool;
+
+        // Signaled by the graphics submission of each batch, and by the
+        // transfer submission before it when there is a transfer queue
+        VkSemaphore m_timeline = VK_NULL_HANDLE;
+        VkSemaphore m_transferTimeline = VK_NULL_HANDLE;
+
+        Batch m_pending;
+        std::deque<Batch> m_inFlight;
+        uint64_t m_nextValue = 1;
+    };
+} // namespace vks
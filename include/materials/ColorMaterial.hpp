@@ -16,8 +16,8 @@ namespace vks
 
         void drawImguiEditor() override;
 
-        void draw(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet lastSet,
-                  const Model* model, const glm::mat4& transform) override;
+        void draw(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet& lastSet,
+                  const Model* model, uint32_t firstInstance, uint32_t instanceCount, uint32_t lod) override;
 
         std::shared_ptr<Material> clone() const override;
     };
@@ -99,22 +99,20 @@ namespace vks
             ImGui::DragInt("Thickness", &thickness, 1, 1, 10);
         }
 
-        void draw(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet lastSet,
-                  const vks::Model* model, const glm::mat4& transform) override
+        // Procedural: one instance per grid line, generated from gl_InstanceIndex.
+        // The pass's model, instance range and LOD don't apply.
+        void draw(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet& lastSet,
+                  const vks::Model*, uint32_t /*firstInstance*/, uint32_t /*instanceCount*/,
+                  uint32_t /*lod*/) override
         {
-            if (m_materialDescriptorSet != lastSet)
-            {
-                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                        layout, 1, 1, &m_materialDescriptorSet, 0, nullptr);
-                lastSet = m_materialDescriptorSet;
-            }
+            bind(cmd, layout, lastSet);
 
             vkCmdSetLineWidth(cmd, thickness);
 
             int S = 2 * uboData.dimension + 1;
-            int instanceCount = 3 * S * S;
+            int lineInstances = 3 * S * S;
 
-            vkCmdDraw(cmd, samplesPerLine, instanceCount, 0, 0);
+            vkCmdDraw(cmd, samplesPerLine, lineInstances, 0, 0);
         }
 
     private:
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <gfx/Buffer.hpp>
+#include <materials/MaterialTable.hpp>
+#include <render/PipelineManager.hpp>
 
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
@@ -8,6 +9,7 @@
 
 #include <string>
 #include <memory>
+#include <typeindex>
 
 #include "scene/Model.hpp"
 
@@ -20,7 +22,7 @@ namespace vks
     class Material
     {
     public:
-        virtual ~Material() = default;
+        virtual ~Material();
 
         // Delete Copy (Materials own Vulkan Resources)
         Material(const Material&) = delete;
@@ -28,7 +30,7 @@ namespace vks
 
         // Allow Move
         Material(Material&&) = default;
-        Material& operator=(Material&&) = default;
+        Material& operator=(Material&& other) noexcept;
 
         virtual void update()
         {
@@ -44,18 +46,31 @@ namespace vks
          * @param cmd The recording command buffer.
          * @param layout The current pipeline layout.
          * @param lastSet Reference to the last bound descriptor set (for optimization).
-         * @param model Pointer to the model (can be nullptr for procedural).
-         * @param transform The object's transform matrix.
-         * @param camera The scene camera (needed for grid calculations).
+         * @param model Pointer to the model (can be nullptr for procedural). The pass
+         *        has bound its vertex and index buffers.
+         * @param firstInstance First entry of the pass's instance buffer (set 2) to draw.
+         * @param instanceCount Number of consecutive instances sharing this model and material.
+         * @param lod Level of detail of the model to draw (see Model::lod).
          */
         virtual void draw(
             VkCommandBuffer cmd,
             VkPipelineLayout layout,
-            VkDescriptorSet lastSet,
+            VkDescriptorSet& lastSet,
             const Model* model,
-            const glm::mat4& transform
+            uint32_t firstInstance,
+            uint32_t instanceCount,
+            uint32_t lod
         ) = 0;
 
+        /**
+         * @brief Binds the material's descriptor set (set 1) without drawing.
+         * Indirect draws take their commands from the GPU and only need the state.
+         * Also pushes the material index, which pipelines drawing materials take
+         * as a uint push constant at offset 0 (vertex and fragment stages).
+         * @param lastSet Reference to the last bound descriptor set (for optimization).
+         */
+        virtual void bind(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet& lastSet);
+
         /**
          * @brief Type-safe helper to cast base material to derived type.
          * Usage: if (auto* colorMat = mat->getAs<ColorMaterial>()) { ... }
@@ -69,39 +84,53 @@ namespace vks
         virtual std::shared_ptr<Material> clone() const = 0;
 
         const std::string& getPipelineName() const { return m_pipelineName; }
-        VkDescriptorSet getDescriptorSet() const { return m_materialDescriptorSet; }
+        // Resolved from the name at construction, for per-draw lookups
+        PipelineHandle getPipeline() const { return m_pipeline; }
+        // Shared by every material with the same parameter type
+        virtual VkDescriptorSet getDescriptorSet() const { return m_table->descriptorSet(); }
+        // Equal for materials whose getDescriptorSet() is the same every frame,
+        // which can then share draws that index them by getMaterialIndex()
+        virtual const void* descriptorSetKey() const { return m_table.get(); }
+        // Slot of the material's parameters in its table
+        uint32_t getMaterialIndex() const { return m_materialIndex; }
 
         int layer_priority = 0;
 
     protected:
-        // Protected Constructor: Only derived classes can instantiate
+        // Protected Constructor: Only derived classes can instantiate.
+        // Materials with the same 'paramsType' share a MaterialTable.
         Material(
             const std::string& pipelineName,
-            VkDeviceSize uboSize
+            std::type_index paramsType,
+            VkDeviceSize paramsSize
         );
 
         // Helper to upload data to the GPU
-        void writeToBuffer(const void* data, VkDeviceSize size);
+        void writeToBuffer(const void* data);
 
         std::string m_pipelineName;
-        VkDescriptorSet m_materialDescriptorSet;
+        PipelineHandle m_pipeline;
 
-        // The Material owns this buffer
-        std::unique_ptr<Buffer> m_uboBuffer;
+        // The Material owns a slot of this table
+        Ref<MaterialTable> m_table;
+        uint32_t m_materialIndex = 0;
     };
 
     // TEMPLATE WRAPPER
     template <typename UBOStruct>
     class TypedMaterial : public Material
     {
+        // Shaders read the blocks as a std430 array, whose stride is a multiple
+        // of the block's vec4 alignment
+        static_assert(sizeof(UBOStruct) % 16 == 0, "Material parameters must be 16-byte aligned");
+
     public:
         UBOStruct uboData;
-        using Material::Material; // Use parent constructors
 
         TypedMaterial(
             const std::string& pipelineName,
             UBOStruct initialData
-        ) : Material(pipelineName, sizeof(UBOStruct))
+        ) : Material(pipelineName, typeid(UBOStruct), sizeof(UBOStruct))
         {
             uboData = initialData;
             flush();
@@ -110,7 +139,7 @@ namespace vks
         std::shared_ptr<Material> clone() const override
         {
             // Create a new object of the same Derived type
-            // This triggers the constructor which allocates a NEW UBO and Descriptor Set
+            // This triggers the constructor which takes a NEW slot of the table
             auto instance = std::make_shared<TypedMaterial>(
                 this->m_pipelineName,
                 this->uboData
@@ -120,17 +149,20 @@ namespace vks
             return instance;
         }
 
+        // Cheap to call every frame: only the bytes that changed reach the GPU,
+        // at the start of the next frame
         void flush()
         {
-            uint32_t size = sizeof(UBOStruct);
-            writeToBuffer(&uboData, size);
+            writeToBuffer(&uboData);
         }
 
         void draw(VkCommandBuffer cmd,
                   VkPipelineLayout layout,
-                  VkDescriptorSet lastSet,
+                  VkDescriptorSet& lastSet,
                   const Model* model,
-                  const glm::mat4& transform) override
+                  uint32_t firstInstance,
+                  uint32_t instanceCount,
+                  uint32_t lod) override
         {}
     };
 
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <core/NonCopyable.hpp>
+#include <core/types.hpp>
+#include <gfx/Buffer.hpp>
+#include <gfx/Descriptors.hpp>
+#include <gfx/DirtyRangeSet.hpp>
+
+namespace vks
+{
+    class Device;
+
+    /**
+     * @brief Parameter blocks of every material of one type, in one buffer.
+     *
+     * Each material owns a slot of a host-visible storage buffer that the
+     * shaders declare as an array (set 1, binding 0) and index with the
+     * material index push constant. All materials of the type share the
+     * table's descriptor set, so switching between them only changes the
+     * push constant.
+     *
+     * Writes land in a CPU copy of the table, and only the bytes that differ
+     * are marked dirty. The GPU side has a buffer per frame slot; flush()
+     * copies the bytes changed since that slot's last frame into its buffer,
+     * once the frame that last read it has completed. Frames in flight never
+     * see a block change under them, and unchanged blocks cost nothing.
+     *
+     * The table doubles when it runs out of slots. The previous buffers and
+     * sets are kept until the frames in flight are done with them.
+     */
+    class MaterialTable : public NonCopyable, public std::enable_shared_from_this<MaterialTable>
+    {
+    public:
+        static constexpr uint32_t INITIAL_CAPACITY = 64;
+
+        // 'stride' is the size of one parameter block, as laid out by std430.
+        // 'frameSlots' is the most frames the renderer keeps in flight.
+        MaterialTable(const Device& device, Ref<DescriptorSetLayout> layout, Ref<DescriptorPool> pool,
+                      VkDeviceSize stride, uint32_t frameSlots);
+        ~MaterialTable();
+
+        uint32_t allocate();
+        // Returns the slot once the frames in flight are done with it
+        void release(uint32_t index);
+
+        // Writes one parameter block ('stride' bytes) to the slot. Reaches the
+        // GPU with the next flush().
+        void write(uint32_t index, const void* data);
+
+        // Brings the buffer of 'frameSlot' up to date and makes it the one
+        // descriptorSet() returns. The slot's previous frame must have
+        // completed. Returns the bytes copied.
+        VkDeviceSize flush(uint32_t frameSlot);
+
+        // Set of the slot passed to the last flush()
+        VkDescriptorSet descriptorSet() const { return m_frames[m_currentFrame].set; }
+        VkDeviceSize stride() const { return m_stride; }
+        uint32_t capacity() const { return m_capacity; }
+        uint32_t size() const { return m_capacity - static_cast<uint32_t>(m_freeSlots.size()); }
+
+    private:
+        struct FrameCopy
+        {
+            // Shared with the deferred free after a resize
+            std::shared_ptr<Buffer> buffer;
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            // Written since this copy was last flushed
+            DirtyRangeSet dirty;
+        };
+
+        void grow(uint32_t capacity);
+
+        const Device& m_device;
+        Ref<DescriptorSetLayout> m_layout;
+        Ref<DescriptorPool> m_pool;
+        const VkDeviceSize m_stride;
+
+        // What the GPU copies converge to
+        std::vector<std::byte> m_blocks;
+        std::vector<FrameCopy> m_frames;
+        uint32_t m_currentFrame = 0;
+        uint32_t m_capacity = 0;
+        // Taken from the back; new slots are pushed highest first so the
+        // buffer fills from the start
+        std::vector<uint32_t> m_freeSlots;
+    };
+} // namespace vks
@@ -20,9 +20,11 @@ namespace vks {
         void draw(
             VkCommandBuffer cmd,
             VkPipelineLayout layout,
-            VkDescriptorSet lastSet,
+            VkDescriptorSet& lastSet,
             const vks::Model* model,
-            const glm::mat4& transform
+            uint32_t firstInstance,
+            uint32_t instanceCount,
+            uint32_t lod
         ) override;
 
         void drawImguiEditor() override;
@@ -31,7 +33,12 @@ namespace vks {
 
         void setTexture(const std::shared_ptr<Texture>& newTexture);
 
+        // Sprites bind their texture, so each keeps a set of its own
+        VkDescriptorSet getDescriptorSet() const override { return m_textureSet; }
+        const void* descriptorSetKey() const override { return this; }
+
     private:
         std::shared_ptr<Texture> m_texture;
+        VkDescriptorSet m_textureSet = VK_NULL_HANDLE;
     };
 }
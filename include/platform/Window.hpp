@@ -21,13 +21,23 @@ class Window : public NonCopyable {
 public:
   using DrawFrameFunc = std::function<void(float deltaTime)>;
 
+  // A headless window creates no GLFW window and no surface; mainLoop() then
+  // runs until requestClose() or 'maxFrames' frames (0 = unlimited)
   Window(const glm::ivec2 &dimensions, const std::string &title,
-         const vks::Instance &instance);
+         const vks::Instance &instance, bool headless = false);
   Window() = delete;
   ~Window();
   void mainLoop();
+  // Extra poll inside a frame, for sampling input as late as possible
+  inline void pollEvents() {
+    if (!headless()) glfwPollEvents();
+  }
 
   inline const glm::ivec2 &dimensions() const { return m_dimensions; }
+  inline bool headless() const { return m_window == nullptr; }
+
+  void requestClose();
+  inline void setMaxFrames(uint64_t frames) { m_maxFrames = frames; }
 
   inline const GLFWwindow *window() const { return m_window; }
   inline GLFWwindow *window() { return m_window; }
@@ -35,6 +45,10 @@ public:
   inline const VkSurfaceKHR &surface() const { return m_surface; }
 
   inline void framebufferSize(glm::ivec2 &size) const {
+    if (headless()) {
+      size = m_dimensions;
+      return;
+    }
     glfwGetFramebufferSize(m_window, &size[0], &size[1]);
   }
 
@@ -48,7 +62,9 @@ public:
 
 private:
   inline static Window* m_windowInstance = nullptr;
-  GLFWwindow *m_window;
+  GLFWwindow *m_window = nullptr;
+  bool m_closeRequested = false;
+  uint64_t m_maxFrames = 0;
   Input m_input{};
 
   glm::ivec2 m_dimensions;
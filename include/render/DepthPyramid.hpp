@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <core/NonCopyable.hpp>
+#include <render/IRenderTarget.hpp>
+#include <render/PipelineManager.hpp>
+
+#include "core/types.hpp"
+
+namespace vks
+{
+    class DescriptorPool;
+    class DescriptorSetLayout;
+    class Device;
+
+    /**
+     * @brief Hierarchical depth (Hi-Z) buffer built from a render target's depth.
+     *
+     * Level 0 is a copy of the depth image; every further level halves the size
+     * and keeps the farthest depth of the texels it covers (rows and columns left
+     * over by odd sizes fold into the last texel). A box whose nearest depth lies
+     * behind the pyramid texel covering it is hidden, so occlusion tests sample
+     * the level where the box spans at most 2x2 texels.
+     *
+     * The image stays in VK_IMAGE_LAYOUT_GENERAL and persists across frames, so
+     * the next frame can test against it. Samplers see it through view().
+     */
+    class DepthPyramid : public NonCopyable
+    {
+    public:
+        DepthPyramid(const Device& device, const Ref<IRenderTarget>& source);
+        ~DepthPyramid();
+
+        // Follows the source's size and images. Runs once per frame, before the
+        // graph executes; recreating the pyramid bumps generation().
+        void sync();
+
+        // Records the reduction of the source's depth image 'index'. The depth image
+        // must be in DEPTH_STENCIL_ATTACHMENT_OPTIMAL with its writes done; it is
+        // back in that layout afterwards and the pyramid is readable by compute.
+        void build(VkCommandBuffer cmd, uint32_t index, const glm::mat4& viewProj);
+
+        VkImageView view() const { return m_view; }
+        VkSampler sampler() const { return m_sampler; }
+        VkExtent2D extent() const { return m_extent; }
+        uint32_t levels() const { return static_cast<uint32_t>(m_mipViews.size()); }
+
+        // Whether build() ran since the pyramid was created, i.e. it holds a depth image
+        bool valid() const { return m_valid; }
+        // Camera of the frame the pyramid was built from
+        const glm::mat4& viewProj() const { return m_viewProj; }
+
+        // Bumped when the image is replaced; descriptor sets over it must be rebuilt
+        uint64_t generation() const { return m_generation; }
+
+    private:
+        // Objects of a replaced image, destroyed once no frame uses them
+        struct Retired
+        {
+            VkImage image = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            std::vector<VkImageView> mipViews;
+            std::vector<VkDescriptorSet> sets;
+        };
+
+        void create();
+        Retired collect();
+        static void destroy(const Device& device, const DescriptorPool& pool, Retired retired);
+        // Like destroy(), but through the device's deletion queue
+        void retire();
+
+        static constexpr uint32_t LOCAL_SIZE = 8;
+
+        const Device& m_device;
+        Ref<IRenderTarget> m_source;
+        PipelineManager m_pipelines;
+        PipelineHandle m_pipeline;
+        Ref<DescriptorSetLayout> m_setLayout;
+        VkSampler m_sampler = VK_NULL_HANDLE;
+
+        VkExtent2D m_extent{};
+        VkImage m_image = VK_NULL_HANDLE;
+        VmaAllocation m_allocation = VK_NULL_HANDLE;
+        VkImageView m_view = VK_NULL_HANDLE;
+        std::vector<VkImageView> m_mipViews;
+
+        // Level 0 reads one of the source's depth images, every other level the one above it
+        std::vector<VkImageView> m_sourceViews;
+        std::vector<VkDescriptorSet> m_sourceSets;
+        std::vector<VkDescriptorSet> m_mipSets;
+
+        bool m_initialized = false; // image moved to GENERAL
+        bool m_valid = false;
+        glm::mat4 m_viewProj{1.0f};
+        uint64_t m_generation = 0;
+    };
+} // namespace vks
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace vks
+{
+    /**
+     * @brief One draw of a pass, ordered by a packed 64-bit sort key.
+     *
+     * Key layout, most significant bits first:
+     *
+     *   opaque:      | layer:8 | 0 | pipeline:10 | material:14 | mesh:12 | depth:19 |
+     *   transparent: | layer:8 | 1 | ~depth:24   | pipeline:10 | material:14 | mesh:7 |
+     *
+     * Layer comes from Material::layer_priority, so it overrides everything else.
+     * Opaque draws are grouped by state and drawn front-to-back within a group;
+     * transparent draws follow all opaque ones of their layer, back-to-front.
+     * Pipeline, material and mesh are small per-frame IDs, not handles. An ID
+     * too large for its field would wrap in the packed key, so sortDrawPackets()
+     * checks for that and sorts on the unpacked keys instead.
+     */
+    struct DrawPacket
+    {
+        uint64_t key;
+        uint32_t index; // into the pass's own per-draw data
+    };
+
+    struct DrawKey
+    {
+        int layer = 0; // clamped to [-128, 127]
+        bool transparent = false;
+        uint32_t pipeline = 0;
+        uint32_t material = 0;
+        uint32_t mesh = 0;
+        float depth = 0.0f; // view depth normalized to [0, 1]
+    };
+
+    uint64_t packDrawKey(const DrawKey& key);
+    // Whether every ID fits its field, i.e. packDrawKey() keeps the key's order
+    bool drawKeyFits(const DrawKey& key);
+    // The order packDrawKey() gives to keys that fit, compared field by field
+    bool drawKeyLess(const DrawKey& a, const DrawKey& b);
+
+    // Stable LSD radix sort on DrawPacket::key, 8 bits per pass. Passes in which
+    // every key has the same digit are skipped, so keys that only differ in a
+    // few fields cost a few passes. 'scratch' is reused between frames.
+    void radixSort(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch);
+
+    // Sorts a draw list, 'keys' indexed by DrawPacket::index. Radix sorts the
+    // packed keys when they all fit; otherwise stable sorts on the unpacked
+    // keys and returns false.
+    bool sortDrawPackets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch,
+                         const std::vector<DrawKey>& keys);
+} // namespace vks
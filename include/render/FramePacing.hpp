@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vulkan/vulkan.h>
+
+#include <core/NonCopyable.hpp>
+
+namespace vks
+{
+    class Device;
+
+    enum class FramePacing
+    {
+        Balanced,   // 2 frames in flight, mailbox if available
+        LowLatency, // 1 frame in flight, mailbox/immediate, input sampled right before recording
+        Throughput  // 3 frames in flight, immediate/mailbox
+    };
+
+    struct FramePacingProfile
+    {
+        uint32_t framesInFlight;
+        // Tried in order; FIFO is always the final fallback
+        VkPresentModeKHR presentModes[2];
+        // Wait for the frame slot before polling input, so the wait isn't added to the latency
+        bool lateInputSampling;
+    };
+
+    FramePacingProfile framePacingProfile(FramePacing pacing);
+    const char* toString(FramePacing pacing);
+
+    /**
+     * @brief Measures input-to-present latency per frame.
+     *
+     * Each frame records when its input was sampled, tagged with the frame's
+     * timeline value. A watcher thread waits for the frame to finish and takes
+     * the difference, so the measurement isn't quantized to the render loop.
+     *
+     * With VK_KHR_present_wait the frame's present carries its timeline value
+     * as the present ID, and the measurement ends when that present completes.
+     * Otherwise (or headless) it ends at GPU completion of the frame, which
+     * leaves out the time the image waits in the swapchain. endPoint() says
+     * which one the stats are showing.
+     */
+    class FrameLatencyTracker : public NonCopyable
+    {
+    public:
+        struct Stats
+        {
+            uint64_t frames = 0;
+            double averageMs = 0.0;
+            double minMs = 0.0;
+            double maxMs = 0.0;
+            double lastMs = 0.0;
+            double framesPerSecond = 0.0;
+        };
+
+        // 'presentWait' ends the measurement at present; presents must then
+        // be reported through markPresented()
+        FrameLatencyTracker(const Device& device, VkSemaphore timeline, bool presentWait);
+        ~FrameLatencyTracker();
+
+        void markInputSampled(uint64_t frame);
+        // 'frame' was queued for present on 'swapChain' with its value as the
+        // present ID. A null swapchain means the present failed; the sample is
+        // dropped.
+        void markPresented(uint64_t frame, VkSwapchainKHR swapChain);
+        // 'frame' was abandoned before submit (e.g. swapchain out of date at
+        // acquire); its sample must not time the retry
+        void discard(uint64_t frame);
+        // Drops samples presented to 'swapChain' and waits out any present
+        // wait on it, so it can be destroyed
+        void retireSwapChain(VkSwapchainKHR swapChain);
+
+        bool measuresPresent() const { return m_presentWait; }
+        const char* endPoint() const { return m_presentWait ? "present" : "GPU completion"; }
+
+        Stats stats() const;
+        void reset();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Sample
+        {
+            uint64_t frame;
+            Clock::time_point sampled;
+            // Set by markPresented()
+            bool presented = false;
+            VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+        };
+
+        void watch();
+        // Waits for the front sample's end point. Called unlocked.
+        VkResult waitForFrame(uint64_t frame, VkSwapchainKHR swapChain);
+        void retire(uint64_t frame, Clock::time_point finished);
+
+        const Device& m_device;
+        VkSemaphore m_timeline;
+        bool m_presentWait;
+        PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
+
+        // Held across vkWaitForPresentKHR so a swapchain isn't destroyed under
+        // the wait. Taken before m_mutex.
+        std::mutex m_presentWaitMutex;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_sampleAvailable;
+        std::deque<Sample> m_pending;
+        bool m_stopping = false;
+
+        // Accumulated since the last reset()
+        Stats m_stats;
+        double m_totalMs = 0.0;
+        Clock::time_point m_firstCompletion{};
+        Clock::time_point m_lastCompletion{};
+
+        std::thread m_watcher;
+    };
+} // namespace vks
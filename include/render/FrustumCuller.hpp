@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <scene/Bounds.hpp>
+
+namespace vks
+{
+    /**
+     * @brief Batch sphere-vs-frustum test over structure-of-arrays bounds.
+     *
+     * Callers add one world-space sphere per candidate, in the order they will
+     * query it, then run cull() once. The centres and radii are stored as
+     * separate float arrays so the AVX2 path tests eight spheres per plane
+     * with one FMA chain; without AVX2 the same test runs one sphere at a time.
+     */
+    class FrustumCuller
+    {
+    public:
+        void clear();
+        void reserve(size_t count);
+
+        // Returns the index to pass to visible()
+        size_t add(const BoundingSphere& sphere);
+        // For candidates without bounds; never culled
+        size_t addAlwaysVisible();
+
+        // Tests every sphere added since clear(), returns how many are visible
+        size_t cull(const Frustum& frustum);
+
+        bool visible(size_t index) const { return m_visible[index] != 0; }
+        size_t size() const { return m_radius.size(); }
+
+    private:
+        std::vector<float> m_x;
+        std::vector<float> m_y;
+        std::vector<float> m_z;
+        std::vector<float> m_radius;
+        std::vector<uint8_t> m_visible;
+    };
+} // namespace vks
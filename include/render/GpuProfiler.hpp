@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <core/NonCopyable.hpp>
+
+namespace vks
+{
+    class Device;
+
+    /**
+     * @brief Timestamp-query profiler for GPU work, one query pool per frame slot.
+     *
+     * The render graph brackets every pass with a scope; passes can add named
+     * sub-scopes with GpuProfiler::Scope. A slot's results are read in
+     * beginFrame(), after the frame that last used the slot has retired, so
+     * reading never waits on the GPU.
+     *
+     * Timestamps can't be written inside a render pass instance that executes
+     * secondary command buffers; open sub-scopes outside of it there.
+     */
+    class GpuProfiler : public NonCopyable
+    {
+    public:
+        static constexpr uint32_t MAX_SCOPES_PER_FRAME = 128;
+        // Window for the rolling average and min/max
+        static constexpr uint32_t HISTORY_FRAMES = 120;
+
+        struct Timing
+        {
+            std::string name;
+            uint32_t depth = 0;
+            double lastMs = 0.0;
+            double averageMs = 0.0;
+            double minMs = 0.0;
+            double maxMs = 0.0;
+
+            std::vector<double> history; // ring of HISTORY_FRAMES samples
+            uint32_t next = 0;
+            uint64_t lastFrame = 0;
+        };
+
+        // RAII helper for sub-scopes
+        class Scope
+        {
+        public:
+            Scope(GpuProfiler& profiler, VkCommandBuffer cmd, const char* name)
+                : m_profiler(profiler), m_cmd(cmd), m_id(profiler.beginScope(cmd, name))
+            {
+            }
+
+            ~Scope() { m_profiler.endScope(m_cmd, m_id); }
+
+        private:
+            GpuProfiler& m_profiler;
+            VkCommandBuffer m_cmd;
+            uint32_t m_id;
+        };
+
+        GpuProfiler(const Device& device, uint32_t frameSlots);
+        ~GpuProfiler();
+
+        // Collects the slot's previous results and resets its queries
+        void beginFrame(uint32_t frameSlot);
+
+        // Returns an id for endScope(). Scopes past the per-frame capacity are dropped.
+        uint32_t beginScope(VkCommandBuffer cmd, const char* name);
+        void endScope(VkCommandBuffer cmd, uint32_t scope);
+
+        // Whether scopes may be recorded into async compute command buffers
+        bool computeTimestamps() const { return m_computeTimestamps; }
+
+        bool enabled() const { return m_enabled; }
+        void setEnabled(bool enabled) { m_enabled = enabled && m_supported; }
+
+        // In order of first appearance; scopes not seen for a while are kept
+        const std::vector<Timing>& timings() const { return m_timings; }
+        // Sum of the top-level scopes of the last resolved frame
+        double frameMs() const { return m_frameMs; }
+
+    private:
+        static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+
+        struct ScopeRecord
+        {
+            const char* name;
+            uint32_t depth;
+        };
+
+        struct Slot
+        {
+            VkQueryPool pool = VK_NULL_HANDLE;
+            std::vector<ScopeRecord> scopes;
+        };
+
+        void resolve(Slot& slot);
+        void addSample(const ScopeRecord& scope, double ms);
+
+        const Device& m_device;
+        bool m_supported = false;
+        bool m_computeTimestamps = false;
+        bool m_enabled = false;
+        double m_timestampPeriodNs = 1.0;
+        uint64_t m_timestampMask = ~0ull;
+
+        std::vector<Slot> m_slots;
+        Slot* m_current = nullptr;
+        uint32_t m_depth = 0;
+        uint64_t m_resolvedFrames = 0;
+
+        std::vector<Timing> m_timings;
+        std::unordered_map<std::string, size_t> m_timingIndex;
+        double m_frameMs = 0.0;
+    };
+} // namespace vks
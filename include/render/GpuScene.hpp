@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <render/PipelineManager.hpp>
+#include <render/passes/IGraphPass.hpp>
+#include <scene/Model.hpp>
+#include <scene/Scene.hpp>
+
+#include "core/types.hpp"
+
+namespace vks
+{
+    class Buffer;
+    class Device;
+    class Material;
+
+    /**
+     * @brief Persistent GPU copy of the scene's renderables, for GPU-driven draws.
+     *
+     * Every accepted Renderable owns a slot in the object buffers holding its
+     * transform, mesh range and draw group. Slots are kept current from EnTT
+     * signals (Renderable construct/update/destroy, Transform update), so the
+     * per-frame CPU work follows what changed, not the size of the scene.
+     * Transforms edited in place must be followed by Scene::patch<Transform>().
+     *
+     * Objects are grouped by what the draw binds: the pipeline, the material
+     * descriptor set and the geometry pages. Models are ranges of the shared
+     * pages and materials of one type share their set, so this is usually one
+     * group per pipeline. Each group owns a range of the command buffer that
+     * DrawCommandPass fills and the geometry pass consumes with one
+     * vkCmdDrawIndexedIndirectCount. The shaders find each object's material
+     * through materialIndices(), by slot.
+     *
+     * As a graph pass it uploads the frame's changes and clears the draw counts.
+     */
+    class GpuScene : public IGraphPass
+    {
+    public:
+        // std430 layout of one object record, see draw_commands.comp
+        struct ObjectData
+        {
+            uint32_t lodCount = 0;    // 0 marks a free slot
+            uint32_t group = 0;       // draw group, i.e. pipeline, material set and geometry pages
+            int32_t vertexOffset = 0; // Model::vertexOffset()
+            uint32_t materialIndex = 0; // Material::getMaterialIndex()
+            glm::vec4 sphere{0.0f}; // model-space bounding sphere (xyz centre, w radius)
+            glm::uvec2 lods[Model::MAX_LODS] = {}; // firstIndex and indexCount per Model::Lod
+        };
+
+        struct DrawGroup
+        {
+            PipelineHandle pipeline;
+            // One of the group's materials; they all bind the same set
+            Ref<Material> material;
+            GeometryBinding geometry;
+            uint32_t commandOffset = 0; // first command of the group's range
+            uint32_t objectCount = 0;   // size of that range; 0 for unused groups
+        };
+
+        // Whether a material's objects are drawn from the GPU; the rest go to fallback()
+        using Filter = std::function<bool(const Material&)>;
+
+        GpuScene(const Device& device, Scene& scene, Filter filter);
+        ~GpuScene() override;
+
+        RenderPassType type() const override { return RenderPassType::Transfer; }
+        const char* name() const override { return "GpuSceneUpload"; }
+
+        void setup(RenderGraphBuilder& builder) override;
+        void update(float dt, uint32_t currentImage) override {}
+        void prepare(ParallelCommandRecorder& recorder, uint32_t currentImage) override;
+        void record(VkCommandBuffer cmd, uint32_t currentImage) override;
+
+        // Applies the scene changes seen since the last call. Runs once per frame,
+        // before the graph executes: growing the buffers replaces them, which
+        // makes the graph recompile.
+        void sync();
+
+        const std::vector<DrawGroup>& groups() const { return m_groups; }
+        // Renderables the filter rejected, left to the CPU draw path
+        const std::vector<Entity>& fallback() const { return m_fallback; }
+        // Slots in use, including freed ones below the highest live slot
+        uint32_t slotCount() const { return static_cast<uint32_t>(m_objects.size()); }
+
+        const Buffer& transforms() const { return *m_transforms; }
+        const Buffer& objects() const { return *m_objectBuffer; }
+        const Buffer& groupOffsets() const { return *m_groupOffsets; }
+        const Buffer& commands() const { return *m_commands; }
+        const Buffer& counts() const { return *m_counts; }
+        // Occlusion culling: per-slot result of the early test, and the commands
+        // of objects that only the late test against this frame's depth found visible
+        const Buffer& cullFlags() const { return *m_cullFlags; }
+        const Buffer& lateCommands() const { return *m_lateCommands; }
+        const Buffer& lateCounts() const { return *m_lateCounts; }
+        // Material index of every drawn object, by slot. Written by DrawCommandPass
+        // from the object records, for the vertex shaders.
+        const Buffer& materialIndices() const { return *m_materialIndices; }
+
+        // "instances" set over the transforms and material indices, indexed by slot
+        VkDescriptorSet instanceSet() const { return m_instanceSet; }
+
+        // Bumped when the buffers are replaced; descriptor sets over them must be rebuilt
+        uint64_t generation() const { return m_generation; }
+
+    private:
+        struct Entry
+        {
+            bool gpu;       // slot in the object buffers, otherwise index into m_fallback
+            uint32_t index;
+        };
+
+        struct GroupKey
+        {
+            uint32_t pipeline;
+            const void* materialSet; // Material::descriptorSetKey()
+            GeometryBinding geometry;
+            bool operator==(const GroupKey&) const = default;
+        };
+
+        struct GroupKeyHash
+        {
+            size_t operator()(const GroupKey& key) const
+            {
+                size_t hash = std::hash<uint32_t>()(key.pipeline);
+                hash = hash * 31 + std::hash<const void*>()(key.materialSet);
+                hash = hash * 31 + std::hash<VkBuffer>()(key.geometry.vertexBuffer);
+                hash = hash * 31 + std::hash<VkBuffer>()(key.geometry.indexBuffer);
+                return hash * 31 + static_cast<size_t>(key.geometry.indexType);
+            }
+        };
+
+        struct Staging
+        {
+            std::unique_ptr<Buffer> buffer;
+            VkDeviceSize capacity = 0;
+        };
+
+        void onConstruct(entt::registry& registry, entt::entity entity);
+        void onDestroy(entt::registry& registry, entt::entity entity);
+        void onTransform(entt::registry& registry, entt::entity entity);
+
+        void insert(Entity entity);
+        void release(Entity entity);
+        uint32_t acquireGroup(const Ref<Model>& model, const Ref<Material>& material);
+        void releaseGroup(uint32_t group);
+        void markDirty(uint32_t slot);
+
+        void reserve(size_t objects, size_t groups);
+        Staging& reserveStaging(uint32_t frameIndex, VkDeviceSize size);
+
+        // Below these the buffers are never created smaller
+        static constexpr size_t MIN_OBJECT_CAPACITY = 1024;
+        static constexpr size_t MIN_GROUP_CAPACITY = 64;
+
+        const Device& m_device;
+        Scene& m_scene;
+        Filter m_filter;
+
+        // Signals only queue entities; sync() applies them
+        std::vector<Entity> m_added;
+        std::vector<Entity> m_removed;
+
+        std::unordered_map<Entity, Entry> m_entries;
+        std::vector<Entity> m_fallback;
+
+        // CPU mirror of the object buffer, by slot
+        std::vector<ObjectData> m_objects;
+        std::vector<Entity> m_slotEntities;
+        std::vector<uint32_t> m_freeSlots;
+        std::vector<uint32_t> m_dirtySlots;
+        std::vector<uint8_t> m_slotDirty;
+
+        std::vector<DrawGroup> m_groups;
+        std::vector<uint32_t> m_freeGroups;
+        std::unordered_map<GroupKey, uint32_t, GroupKeyHash> m_groupIds;
+        bool m_groupsDirty = false;
+
+        size_t m_objectCapacity = 0;
+        size_t m_groupCapacity = 0;
+        uint64_t m_generation = 0;
+
+        std::unique_ptr<Buffer> m_transforms;
+        std::unique_ptr<Buffer> m_objectBuffer;
+        std::unique_ptr<Buffer> m_groupOffsets;
+        std::unique_ptr<Buffer> m_commands;
+        std::unique_ptr<Buffer> m_counts;
+        std::unique_ptr<Buffer> m_cullFlags;
+        std::unique_ptr<Buffer> m_lateCommands;
+        std::unique_ptr<Buffer> m_lateCounts;
+        std::unique_ptr<Buffer> m_materialIndices;
+        VkDescriptorSet m_instanceSet = VK_NULL_HANDLE;
+
+        // Per frame in flight, filled by prepare() and copied by record()
+        std::vector<Staging> m_staging;
+        std::vector<VkBufferCopy> m_transformCopies;
+        std::vector<VkBufferCopy> m_objectCopies;
+        VkBufferCopy m_groupCopy{};
+    };
+} // namespace vks
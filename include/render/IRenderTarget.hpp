@@ -19,5 +19,13 @@ namespace vks
 
         virtual VkImage colorImage(uint32_t index) const = 0;
         virtual VkImage depthImage(uint32_t index) const = 0;
+
+        // True if the depth images share memory with other attachments
+        virtual bool transientDepth() const { return false; }
+
+        // Transient depth only: targets in the same alias group share memory.
+        // Assigned by the render graph from its schedule. Returns true if the
+        // depth images were recreated, which invalidates views of them.
+        virtual bool setAliasGroup(const void* group) { return false; }
     };
 }
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <core/NonCopyable.hpp>
+#include <core/ThreadPool.hpp>
+#include <gfx/CommandPool.hpp>
+
+#include "core/types.hpp"
+
+namespace vks
+{
+    class Device;
+
+    /**
+     * @brief Records secondary command buffers on worker threads.
+     *
+     * Every worker owns one CommandPool per frame in flight, so recording never
+     * contends on a pool and a frame slot's buffers can be recycled with a single
+     * vkResetCommandPool once its frame has retired.
+     *
+     * Passes start their recordings in IGraphPass::prepare(), which the graph
+     * calls for every live pass before recording any of them, so independent
+     * passes are recorded concurrently. record() then stitches the results into
+     * the primary command buffer with Recording::execute().
+     */
+    class ParallelCommandRecorder : public NonCopyable
+    {
+    public:
+        // Records items [begin, end) into a secondary command buffer. Secondary
+        // buffers inherit no state: viewport, scissor, pipeline and descriptor
+        // sets must be set again in every chunk.
+        using RecordFn = std::function<void(VkCommandBuffer cmd, size_t begin, size_t end)>;
+
+        class Recording
+        {
+        public:
+            // Waits for all chunks and executes them, in order, into 'primary'.
+            // The render pass must have been begun with
+            // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+            void execute(VkCommandBuffer primary);
+
+        private:
+            friend class ParallelCommandRecorder;
+
+            std::vector<VkCommandBuffer> m_buffers;
+            std::atomic<uint32_t> m_pending{0};
+            std::exception_ptr m_error;
+            std::mutex m_errorMutex;
+        };
+
+        ParallelCommandRecorder(const Device& device, uint32_t framesInFlight, uint32_t workerCount = 0);
+        ~ParallelCommandRecorder();
+
+        // Recycles the buffers of this frame slot. Its previous frame must have retired.
+        void beginFrame(uint32_t frameIndex);
+
+        /**
+         * @brief Splits [0, count) into chunks and records them asynchronously.
+         * @param renderPass / framebuffer The render pass instance the buffers execute in.
+         * @param minChunk Smallest number of items worth a separate command buffer.
+         */
+        Ref<Recording> record(VkRenderPass renderPass, VkFramebuffer framebuffer,
+                              size_t count, size_t minChunk, RecordFn fn);
+
+        uint32_t workerCount() const { return m_threads.workerCount(); }
+
+    private:
+        struct ThreadFrame
+        {
+            std::unique_ptr<CommandPool> pool;
+            std::vector<VkCommandBuffer> buffers;
+            size_t used = 0;
+        };
+
+        VkCommandBuffer acquire(uint32_t worker);
+
+        const Device& m_device;
+        uint32_t m_framesInFlight;
+        uint32_t m_frameIndex = 0;
+
+        // Indexed [worker * framesInFlight + frame]
+        std::vector<ThreadFrame> m_threadFrames;
+
+        // Declared last so workers are joined before the pools are destroyed
+        ThreadPool m_threads;
+    };
+} // namespace vks
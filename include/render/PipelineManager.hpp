@@ -1,7 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <vulkan/vulkan.h>
 #include <render/pipelines/PipelineDesc.hpp>
 
@@ -9,12 +10,34 @@ namespace vks
 {
     class Device;
 
+    /**
+     * @brief Dense ID of a pipeline name.
+     *
+     * Names are interned once, process-wide, so a handle means the same name in
+     * every PipelineManager and stays valid when createOrReplace() rebuilds the
+     * pipeline. Resolve handles up front (materials do at construction) and
+     * look pipelines up by handle on the draw path: an array index, no hashing.
+     */
+    struct PipelineHandle
+    {
+        static constexpr uint32_t INVALID = UINT32_MAX;
+
+        uint32_t id = INVALID;
+
+        bool valid() const { return id != INVALID; }
+        bool operator==(const PipelineHandle&) const = default;
+
+        // Interns 'name'; thread-safe, but hashes, so keep it off hot paths
+        static PipelineHandle fromName(const std::string& name);
+        std::string name() const;
+    };
+
     class PipelineManager
     {
     public:
         PipelineManager(const vks::Device& device);
 
-        void createOrReplace(
+        PipelineHandle createOrReplace(
             const std::string& name,
             const PipelineDesc& desc
         );
@@ -23,8 +46,19 @@ namespace vks
         void recreate(const std::string& name);
         void recreateAll();
 
-        VkPipeline getPipeline(const std::string& name) const;
-        VkPipelineLayout getLayout(const std::string& name) const;
+        bool contains(PipelineHandle handle) const;
+
+        VkPipeline getPipeline(PipelineHandle handle) const { return entry(handle).pipeline; }
+        VkPipelineLayout getLayout(PipelineHandle handle) const { return entry(handle).layout; }
+        const PipelineDesc& getDesc(PipelineHandle handle) const { return entry(handle).desc; }
+        // Whether a graphics pipeline blends, i.e. its draws must go back-to-front
+        bool isBlended(PipelineHandle handle) const;
+
+        // By name, for setup code; these intern the name first
+        VkPipeline getPipeline(const std::string& name) const { return getPipeline(PipelineHandle::fromName(name)); }
+        VkPipelineLayout getLayout(const std::string& name) const { return getLayout(PipelineHandle::fromName(name)); }
+        const PipelineDesc& getDesc(const std::string& name) const { return getDesc(PipelineHandle::fromName(name)); }
+        bool isBlended(const std::string& name) const { return isBlended(PipelineHandle::fromName(name)); }
 
     private:
         struct Entry
@@ -32,13 +66,21 @@ namespace vks
             PipelineDesc desc;
             VkPipeline pipeline = VK_NULL_HANDLE;
             VkPipelineLayout layout = VK_NULL_HANDLE;
+            bool live = false;
         };
 
+        // Throws if this manager has no pipeline under the handle
+        const Entry& entry(PipelineHandle handle) const;
+        Entry& entry(PipelineHandle handle);
+
         void buildPipeline(Entry& entry);
+        // Destroys the entry's Vulkan objects once in-flight frames are done with them
+        void retire(Entry& entry);
 
         const vks::Device& m_device;
         VkPipelineCache m_cache = VK_NULL_HANDLE;
 
-        std::unordered_map<std::string, Entry> m_pipelines;
+        // Indexed by PipelineHandle::id
+        std::vector<Entry> m_pipelines;
     };
 }
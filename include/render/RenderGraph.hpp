@@ -4,31 +4,41 @@
 #include <gfx/SwapChain.hpp>
 #include <gfx/SyncObjects.hpp>
 #include <gfx/CommandBuffers.hpp>
+#include <render/RenderGraphResources.hpp>
+#include <render/ParallelCommandRecorder.hpp>
+#include <render/FramePacing.hpp>
+#include <render/GpuProfiler.hpp>
 #include <render/passes/IRenderPass.hpp>
 
 
 namespace vks
 {
-    constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    // Upper bound for RenderGraph::setFramesInFlight(). Per-frame resources are
+    // allocated for this many slots; fewer frames in flight just cycle fewer of them.
+    constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
     class RenderGraph
     {
     public:
+        // With a null swapChain the graph runs headless: it renders into
+        // 'headlessOutput' and never acquires or presents
         RenderGraph(const Device& device,
                     const Ref<SwapChain>& swapChain,
-                    const CommandPool& commandPool);
+                    const CommandPool& commandPool,
+                    const Ref<IRenderTarget>& headlessOutput = nullptr);
 
-        ~RenderGraph()
-        {
-            clear();
-        }
+        ~RenderGraph();
 
-        // Add a pass to the end of the pipeline
-        void addPass(Ref<IRenderPass> pass)
+        // Passes may be added in any order; execution order comes from their declared resources
+        void addPass(Ref<IGraphPass> pass)
         {
             m_passes.push_back(pass);
+            m_dirty = true;
         }
 
+        // Recompiles before the next frame, e.g. after a pass replaced a buffer it declares
+        void invalidate() { m_dirty = true; }
+
         template<typename T> Ref<T> getPass(RenderPassType type) const
         {
             for (const auto& pass : m_passes)
@@ -39,35 +49,164 @@ namespace vks
             return nullptr;
         }
 
-        // Execute all passes in order
+        // Makes a render target's color and depth images known to the graph
+        void importTarget(const Ref<IRenderTarget>& target, ResourceIndexing indexing);
+
+        // Execute all passes that contribute to an exported resource
         void execute();
 
+        // Blocks until the slot the next frame records into is free. execute() does
+        // this itself; calling it earlier lets input be sampled after the wait.
+        void waitForFrameSlot() const { syncObjects.waitForFrameSlot(currentFrame); }
+
+        // 1..MAX_FRAMES_IN_FLIGHT. Drains the GPU.
+        void setFramesInFlight(uint32_t count);
+        uint32_t framesInFlight() const { return m_framesInFlight; }
+
+        FrameLatencyTracker& latency() { return m_latency; }
+        GpuProfiler& profiler() { return m_profiler; }
+
         void recreatePasses();
         void recreate();
 
         // Cleanup
-        void clear() { m_passes.clear(); }
+        void clear()
+        {
+            m_passes.clear();
+            m_steps.clear();
+            m_dirty = true;
+        }
 
+        // Null when headless
         Ref<SwapChain> getSwapChain() const { return swapChain; }
+        // The swapchain, or the offscreen target when headless
+        Ref<IRenderTarget> output() const { return m_output; }
+        bool headless() const { return swapChain == nullptr; }
 
         uint32_t getCurrentFrameIndex() const { return currentFrame; }
         uint32_t getCurrentImageIndex() const { return currentFrame; }
 
+        // GPU frame counter. The frame being recorded signals frameNumber() when it
+        // completes; anything tagged with that number may be reclaimed once
+        // isFrameComplete() returns true for it.
+        uint64_t frameNumber() const { return syncObjects.frameValue(); }
+        uint64_t completedFrame() const { return syncObjects.completedValue(); }
+        bool isFrameComplete(uint64_t frame) const { return syncObjects.isComplete(frame); }
+        void waitForFrame(uint64_t frame) const { syncObjects.wait(frame); }
+
+        // Passes that survived culling, in execution order
+        size_t activePassCount() const { return m_steps.size(); }
+
     private:
+        friend class RenderGraphBuilder;
+
+        struct GraphResource
+        {
+            // Exactly one of target/buffer is set
+            IRenderTarget* target = nullptr;
+            ImageAspect aspect = ImageAspect::Color;
+            const Buffer* buffer = nullptr;
+
+            ResourceIndexing indexing = ResourceIndexing::PerImage;
+
+            // Memory is shared with other images (see TransientAttachmentPool).
+            // Refreshed on every compile, the target can change it.
+            bool aliased = false;
+
+            bool exported = false;
+            ResourceUsage exportUsage = ResourceUsage::Present;
+        };
+
+        struct PlannedBarrier
+        {
+            ResourceId resource;
+            ResourceState src;
+            ResourceState dst;
+
+            // Set for queue family ownership transfers (release/acquire pairs)
+            uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED;
+            uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED;
+
+            // First use of an aliased image: the last use of the alias that
+            // held the memory before it
+            ResourceState aliasSrc{};
+        };
+
+        struct CompiledStep
+        {
+            IGraphPass* pass;
+            std::vector<PlannedBarrier> barriers;
+            bool async = false; // runs on the compute queue
+        };
+
+        ResourceId findTarget(const IRenderTarget* target, ImageAspect aspect) const;
+        ResourceId findOrAddBuffer(const Buffer* buffer);
+
+        void compile();
+        std::vector<size_t> sortPasses(const std::vector<std::vector<ResourceAccess>>& accesses) const;
+        // Groups aliased images by the steps they are used in. Returns true if
+        // a target had to recreate its images.
+        bool planAliasing(const std::vector<size_t>& firstUse, const std::vector<size_t>& lastUse,
+                          const std::vector<ResourceState>& lastState);
+        void emitBarriers(VkCommandBuffer cmd, const std::vector<PlannedBarrier>& barriers) const;
+
+        void beginCommands(VkCommandBuffer cmd) const;
+        void endCommands(VkCommandBuffer cmd) const;
+        void recordSteps(VkCommandBuffer cmd, bool async, size_t begin, size_t end);
+
+        void createAsyncResources();
+        void destroyAsyncResources();
+        void drainGraphicsDone();
+
         void submit(VkCommandBuffer cmd);
-        void present(uint32_t imageIndex);
+        void submitAsync(VkCommandBuffer compute, VkCommandBuffer head, VkCommandBuffer tail);
+        // 'frame' is the timeline value the frame signalled
+        void present(uint32_t imageIndex, uint64_t frame);
         void update(float dt, uint32_t imageIndex);
-        
+
         uint32_t currentFrame = 0;
         uint32_t imageIndex = 0;
+        uint32_t m_framesInFlight = 2;
 
         const Device& device;
         const Ref<SwapChain> swapChain;
+        const Ref<IRenderTarget> m_output;
+
+        std::vector<Ref<IGraphPass>> m_passes;
+        std::vector<GraphResource> m_resources;
+
+        // Result of compile(), rebuilt whenever the pass list changes
+        std::vector<CompiledStep> m_steps;
+        std::vector<PlannedBarrier> m_finalBarriers;
+        bool m_dirty = true;
+
+        // Async compute schedule. Compute steps go into one submission on the compute
+        // queue. Graphics steps before the first one consuming compute output form the
+        // "head" submission, which overlaps the compute work; the rest form the "tail",
+        // which waits on it. Without async steps everything goes through 'head'.
+        bool m_asyncActive = false;
+        size_t m_graphicsSplit = 0;
+        bool m_acquireInTail = false;
+        VkPipelineStageFlags m_computeWaitStages = 0;
+        std::vector<PlannedBarrier> m_computeReleases;
+        std::vector<PlannedBarrier> m_computeFinalBarriers;
+
+        std::unique_ptr<CommandPool> m_computePool;
+        std::vector<VkCommandBuffer> m_computeCommands;
+        std::vector<VkCommandBuffer> m_tailCommands;
+        std::vector<VkSemaphore> m_computeFinished;
+        // Signaled by a frame's graphics work, waited by the next frame's compute
+        // work so it can't overwrite data the previous frame is still reading
+        std::vector<VkSemaphore> m_graphicsDone;
+        VkSemaphore m_pendingGraphicsDone = VK_NULL_HANDLE;
+        const CommandPool& m_commandPool;
 
-        std::vector<Ref<IRenderPass>> m_passes;
         CommandBuffers commandBuffers;
+        ParallelCommandRecorder m_recorder;
 
         SyncObjects syncObjects;
+        FrameLatencyTracker m_latency;
+        GpuProfiler m_profiler;
     };
 
 }
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <core/types.hpp>
+#include <render/IRenderTarget.hpp>
+
+namespace vks
+{
+    class Buffer;
+    class RenderGraph;
+
+    // How a pass touches a resource. Every usage maps to one fixed
+    // layout/stage/access triple, see usageState().
+    enum class ResourceUsage
+    {
+        ColorAttachment,
+        DepthAttachment,
+        SampledRead,  // sampled from a fragment shader
+        TransferSrc,
+        TransferDst,
+        StorageRead,  // storage buffer/image read from a compute shader
+        StorageWrite, // storage buffer/image written (and possibly read) by a compute shader
+        VertexStorageRead, // storage buffer read from a vertex shader
+        IndirectRead, // indirect draw/dispatch arguments
+        HostRead,
+        Present
+    };
+
+    enum class ImageAspect
+    {
+        Color,
+        Depth
+    };
+
+    // Which copy of a multi-buffered target belongs to the current frame
+    enum class ResourceIndexing
+    {
+        PerFrame, // indexed by the frame-in-flight slot
+        PerImage  // indexed by the acquired swapchain image
+    };
+
+    using ResourceId = uint32_t;
+
+    struct ResourceState
+    {
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool write = false;
+    };
+
+    ResourceState usageState(ResourceUsage usage);
+
+    struct ResourceAccess
+    {
+        ResourceId resource;
+        ResourceUsage usage;
+    };
+
+    /**
+     * @brief Handed to IGraphPass::setup() to collect the pass's declarations.
+     *
+     * Render targets must have been imported into the graph first (so it knows how
+     * to index them); buffers are registered on first use.
+     */
+    class RenderGraphBuilder
+    {
+    public:
+        RenderGraphBuilder(RenderGraph& graph, std::vector<ResourceAccess>& accesses)
+            : m_graph(graph), m_accesses(accesses)
+        {
+        }
+
+        RenderGraphBuilder& read(const Ref<IRenderTarget>& target, ImageAspect aspect, ResourceUsage usage);
+        RenderGraphBuilder& write(const Ref<IRenderTarget>& target, ImageAspect aspect, ResourceUsage usage);
+
+        RenderGraphBuilder& read(const Buffer& buffer, ResourceUsage usage);
+        RenderGraphBuilder& write(const Buffer& buffer, ResourceUsage usage);
+
+        // Marks the buffer as consumed outside the graph; keeps its writers alive
+        RenderGraphBuilder& exportBuffer(const Buffer& buffer, ResourceUsage finalUsage);
+
+    private:
+        RenderGraph& m_graph;
+        std::vector<ResourceAccess>& m_accesses;
+    };
+} // namespace vks
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 #include <vector>
 #include <cstdint>
 
@@ -9,10 +10,12 @@
 namespace vks
 {
     class Device;
+    class TransientAttachmentPool;
 
     class RenderTarget : public IRenderTarget
     {
     public:
+        // A depthFormat of VK_FORMAT_UNDEFINED creates a color-only target
         RenderTarget(
             const Device& device,
             VkExtent2D extent,
@@ -20,7 +23,8 @@ namespace vks
             VkFormat colorFormat,
             VkFormat depthFormat,
             VkImageUsageFlags additionalUsage = 0,
-            bool sampled = true
+            bool sampled = true,
+            TransientAttachmentPool* transientDepth = nullptr
         );
 
         ~RenderTarget() override;
@@ -35,14 +39,33 @@ namespace vks
 
         // Per-frame access
         VkImageView colorView(uint32_t index) const override { return m_colorViews[index]; }
-        VkImageView depthView(uint32_t index) const override { return m_depthViews[index]; }
+        VkImageView depthView(uint32_t index) const override
+        {
+            return m_depthViews.empty() ? VK_NULL_HANDLE : m_depthViews[index];
+        }
         VkSampler imageSampler() const { return m_sampler; }
 
         VkImage colorImage(uint32_t index) const override { return m_colorImages[index]; }
-        VkImage depthImage(uint32_t index) const override { return m_depthImages[index]; }
+        VkImage depthImage(uint32_t index) const override
+        {
+            return m_depthImages.empty() ? VK_NULL_HANDLE : m_depthImages[index];
+        }
 
         VkDescriptorSet renderTargetImage(uint32_t index);
 
+        // Depth images live in the shared transient pool and alias other attachments
+        bool transientDepth() const override { return m_transientPool != nullptr; }
+        bool setAliasGroup(const void* group) override;
+        // Moves the depth images into 'pool', or out of the transient pool for
+        // null. Returns whether that changed anything; passes rendering to the
+        // target then need recreating.
+        bool setTransientDepth(TransientAttachmentPool* pool);
+
+        // Memory committed for this target's own allocations, excluding the transient pool
+        VkDeviceSize dedicatedBytes() const { return m_dedicatedBytes; }
+        // Memory all images would need with one allocation each
+        VkDeviceSize requestedBytes() const { return m_requestedBytes; }
+
         // Viewport descriptor sets
         std::vector<VkDescriptorSet> m_viewportDescriptors{};
         void createDescriptors();
@@ -50,7 +73,11 @@ namespace vks
         void createImages();
         void createImageViews();
         void createSampler();
+        // Replaces the images, e.g. at a new size
+        void rebuild();
         void destroy();
+        // Like destroy(), but through the device's deletion queue
+        void retire();
 
         const Device& m_device;
 
@@ -61,13 +88,19 @@ namespace vks
         VkFormat m_depthFormat{};
         bool m_sampled{true};
         VkImageUsageFlags m_additionalUsage;
+        TransientAttachmentPool* m_transientPool = nullptr;
+        // Key of the pool block the depth images are bound to
+        const void* m_aliasGroup = this;
+
+        VkDeviceSize m_dedicatedBytes = 0;
+        VkDeviceSize m_requestedBytes = 0;
 
         std::vector<VkImage> m_colorImages;
-        std::vector<VkDeviceMemory> m_colorMemory;
+        std::vector<VmaAllocation> m_colorAllocations;
         std::vector<VkImageView> m_colorViews;
 
         std::vector<VkImage> m_depthImages;
-        std::vector<VkDeviceMemory> m_depthMemory;
+        std::vector<VmaAllocation> m_depthAllocations; // null for transient depth
         std::vector<VkImageView> m_depthViews;
 
         VkSampler m_sampler{};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <core/NonCopyable.hpp>
+
+namespace vks
+{
+    class Device;
+
+    /**
+     * @brief Shared backing memory for attachments that never outlive a single pass.
+     *
+     * Images are bound at offset 0 of a block per alias group, so the images of
+     * one group alias each other. The render graph assigns the groups from its
+     * schedule (see RenderGraph::planAliasing): images whose uses don't overlap
+     * share a group, and each one's first use waits on the last use of the one
+     * before it. That is only valid for images whose contents are discarded
+     * between uses (loadOp CLEAR/DONT_CARE, storeOp DONT_CARE). Images should be
+     * created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT so lazily-allocated
+     * memory can be used on devices that offer it (tile-based GPUs).
+     */
+    class TransientAttachmentPool : public NonCopyable
+    {
+    public:
+        explicit TransientAttachmentPool(const Device& device);
+        ~TransientAttachmentPool();
+
+        // 'group' is an opaque key; images with the same key share a block
+        void bind(VkImage image, const void* group);
+        // Must be called before the image is destroyed
+        void release(VkImage image);
+
+        // Memory actually allocated by the pool
+        VkDeviceSize allocatedBytes() const;
+        size_t blockCount() const { return m_blocks.size(); }
+        // What the bound images would cost with dedicated allocations
+        VkDeviceSize requestedBytes() const;
+
+    private:
+        struct Block
+        {
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            const void* group = nullptr;
+            VkDeviceSize size = 0;
+            uint32_t memoryType = 0;
+            uint32_t users = 0;
+        };
+
+        struct Binding
+        {
+            VmaAllocation allocation;
+            VkDeviceSize size;
+        };
+
+        static VmaAllocationCreateInfo allocationInfo(uint32_t typeBits);
+
+        const Device& m_device;
+        std::vector<Block> m_blocks;
+        std::unordered_map<VkImage, Binding> m_bindings;
+    };
+} // namespace vks
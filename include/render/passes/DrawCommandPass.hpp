@@ -0,0 +1,112 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <render/passes/IComputePass.hpp>
+#include <scene/Bounds.hpp>
+
+#include "core/types.hpp"
+
+namespace vks
+{
+    class DepthPyramid;
+    class DescriptorSetLayout;
+    class GpuScene;
+
+    // Writes one VkDrawIndexedIndirectCommand per live GpuScene object inside
+    // the camera frustum into its group's range of the command buffer and
+    // counts them per group. The geometry pass draws each group with
+    // vkCmdDrawIndexedIndirectCount.
+    //
+    // With occlusion culling on, objects hidden by the previous frame's depth
+    // pyramid are deferred. The geometry pass draws the rest, rebuilds the
+    // pyramid and calls recordLate(), which draws whatever the new pyramid
+    // shows into GpuScene's late commands.
+    class DrawCommandPass : public IComputePass
+    {
+    public:
+        // Per-frame counts of GpuScene objects
+        struct CullStats
+        {
+            uint32_t drawn = 0;
+            uint32_t frustumCulled = 0;
+            uint32_t occluded = 0; // hidden by the depth pyramid in both phases
+        };
+
+        DrawCommandPass(const Device& device, const Ref<GpuScene>& scene, const Ref<DepthPyramid>& pyramid);
+        ~DrawCommandPass() override;
+
+        const char* name() const override { return "DrawCommands"; }
+
+        void setup(RenderGraphBuilder& builder) override;
+        void prepare(ParallelCommandRecorder& recorder, uint32_t currentImage) override;
+        void record(VkCommandBuffer cmd, uint32_t currentImage) override;
+
+        // Late phase, recorded by the geometry pass once the pyramid holds this
+        // frame's early draws. Leaves the late commands and counts written by compute.
+        void recordLate(VkCommandBuffer cmd);
+
+        // The render graph must be invalidated after switching
+        void setOcclusionCulling(bool enabled) { m_occlusionCulling = enabled; }
+        bool occlusionCulling() const { return m_occlusionCulling; }
+
+        // Read back from the GPU, so a few frames old
+        const CullStats& stats() const { return m_stats; }
+
+    private:
+        static constexpr uint32_t LOCAL_SIZE = 64;
+
+        enum Phase : uint32_t
+        {
+            EARLY = 0,
+            LATE = 1
+        };
+
+        enum Flags : uint32_t
+        {
+            OCCLUSION = 1 << 0,
+            PYRAMID_VALID = 1 << 1
+        };
+
+        // std140 uniform block of draw_commands.comp
+        struct CullParams
+        {
+            glm::vec4 planes[Frustum::Count];
+            glm::mat4 viewProj;
+            glm::mat4 pyramidViewProj;
+            glm::vec4 eye; // camera position, w the projection's y scale
+            uint32_t flags;
+            float lodBias;
+            uint32_t padding[2];
+        };
+
+        // Push constants of draw_commands.comp
+        struct Push
+        {
+            uint32_t slotCount;
+            uint32_t phase;
+        };
+
+        void writeSets();
+
+        Ref<GpuScene> m_scene;
+        Ref<DepthPyramid> m_pyramid;
+        PipelineHandle m_pipeline;
+        Ref<DescriptorSetLayout> m_setLayout;
+        // Over the commands and counts, and over their late counterparts
+        VkDescriptorSet m_set = VK_NULL_HANDLE;
+        VkDescriptorSet m_lateSet = VK_NULL_HANDLE;
+        // GpuScene::generation() and DepthPyramid::generation() the sets were written for
+        uint64_t m_generation = 0;
+        uint64_t m_pyramidGeneration = 0;
+
+        std::unique_ptr<Buffer> m_params;
+        std::unique_ptr<Buffer> m_statsBuffer;
+        // Host-visible copies of the counters, per frame in flight
+        std::vector<std::unique_ptr<Buffer>> m_readbacks;
+        CullStats m_stats;
+
+        bool m_occlusionCulling = true;
+    };
+} // namespace vks
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <render/passes/IGraphPass.hpp>
+#include <render/IRenderTarget.hpp>
+
+#include "core/types.hpp"
+
+namespace vks
+{
+    class Buffer;
+    class Device;
+
+    // Copies the whole color image of a render target into a host-visible buffer
+    // every frame, one region per image. Used by headless mode to get rendered
+    // frames back to the CPU; the source must be a 4 byte per texel format and
+    // keep its size.
+    class FrameReadbackPass : public IGraphPass
+    {
+    public:
+        FrameReadbackPass(const Device& device, const Ref<IRenderTarget>& source);
+        ~FrameReadbackPass() override;
+
+        RenderPassType type() const override { return RenderPassType::Transfer; }
+        const char* name() const override { return "FrameReadback"; }
+
+        void setup(RenderGraphBuilder& builder) override;
+        void update(float dt, uint32_t currentImage) override {}
+        void record(VkCommandBuffer cmd, uint32_t currentImage) override;
+
+        // Copies the most recently recorded frame into 'pixels' (tightly packed
+        // rows), waiting for the GPU to finish it. Returns false before the first frame.
+        bool readLatest(std::vector<uint8_t>& pixels, uint64_t* frameNumber = nullptr) const;
+
+        VkExtent2D extent() const { return m_extent; }
+
+    private:
+        const Device& m_device;
+        Ref<IRenderTarget> m_source;
+        std::unique_ptr<Buffer> m_buffer;
+
+        VkExtent2D m_extent{};
+        VkDeviceSize m_frameBytes = 0;
+
+        // Frame number and image of the last recorded copy
+        uint64_t m_lastFrame = 0;
+        uint32_t m_lastImage = 0;
+    };
+} // namespace vks
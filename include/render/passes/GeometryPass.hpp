@@ -4,24 +4,164 @@
 #include <core/FileWatcher.hpp>
 #include <assets/ShaderCompiler.hpp>
 #include <render/passes/IRenderPass.hpp>
+#include <render/ParallelCommandRecorder.hpp>
+#include <render/DrawList.hpp>
+#include <render/FrustumCuller.hpp>
+#include <render/GpuScene.hpp>
+#include <scene/Scene.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
 
 
 namespace vks
 {
+    class DepthPyramid;
+    class DrawCommandPass;
+
     class GeometryPass : public IRenderPass
     {
     public:
         GeometryPass(const Device& device, const Ref<IRenderTarget>& swapChain);
+        ~GeometryPass() override;
 
+        void setup(RenderGraphBuilder& builder) override;
         void update(float dt, uint32_t currentImage) override;
+        void prepare(ParallelCommandRecorder& recorder, uint32_t currentImage) override;
         void record(VkCommandBuffer cmd, uint32_t currentImage) override;
         void recreate() override;
 
         RenderPassType type() const override { return RenderPassType::Geometry; }
+
+        // GPU-driven mode: objects the scene accepted are drawn from the command
+        // buffers DrawCommandPass fills, one vkCmdDrawIndexedIndirectCount per
+        // group, before the sorted CPU list of the rest. Null switches back to
+        // the CPU path. The render graph must be invalidated afterwards.
+        void setGpuScene(const Ref<GpuScene>& scene) { m_gpuScene = scene; }
+        const Ref<GpuScene>& gpuScene() const { return m_gpuScene; }
+
+        // Two-phase occlusion culling of the GPU-driven draws, while 'drawCommands'
+        // has it enabled: the early draws are followed by a rebuild of 'pyramid'
+        // from their depth, DrawCommandPass's late phase, and the late draws in a
+        // second render pass that loads the attachments. The late phase has to
+        // live here, as a separate graph pass would read and write the depth
+        // between two of this pass's writes. The render target's depth must not
+        // be transient.
+        void setOcclusion(const Ref<DrawCommandPass>& drawCommands, const Ref<DepthPyramid>& pyramid);
+
+        // Opaque, instanced pipelines can be drawn indirectly. Blended draws
+        // need the CPU's back-to-front order.
+        bool drawsIndirect(const Material& material) const;
     private:
         void createRenderPass() override;
         void createFrameBuffers() override;
 
+        void setViewportAndScissor(VkCommandBuffer cmd) const;
+        bool twoPhase() const;
+        // Secondary buffers drawing each GpuScene group from the given commands and counts
+        Ref<ParallelCommandRecorder::Recording> recordIndirect(
+            ParallelCommandRecorder& recorder, VkFramebuffer framebuffer,
+            VkBuffer commands, VkBuffer counts);
+        void beginRenderPass(VkCommandBuffer cmd, VkRenderPass renderPass, uint32_t frameIndex) const;
+
+        struct PipelineState
+        {
+            VkPipeline pipeline = VK_NULL_HANDLE;
+            VkPipelineLayout layout = VK_NULL_HANDLE;
+            bool blended = false;
+            bool instanced = false; // reads transforms from the instance buffer
+            geometry::VertexFormat vertexFormat = geometry::VertexFormat::Packed;
+        };
+
+        struct DrawItem
+        {
+            Model* model;
+            Material* material;
+            const glm::mat4* transform;
+            VkPipeline pipeline;
+            VkPipelineLayout layout;
+            bool instanced;
+            uint32_t lod; // of the model, from its projected size
+        };
+
+        // Consecutive sorted draws of one model, LOD and material, drawn as one
+        // instanced call. Non-instanced pipelines always get single-draw batches.
+        struct DrawBatch
+        {
+            uint32_t item;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+        };
+
+        // One indirect draw per GpuScene group
+        struct IndirectDraw
+        {
+            uint32_t group;
+            VkPipeline pipeline;
+            VkPipelineLayout layout;
+        };
+
+        // Host-visible transforms for one frame in flight, grown on demand
+        struct InstanceBuffer
+        {
+            std::unique_ptr<Buffer> buffer;
+            std::unique_ptr<Buffer> materials; // material index per instance
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            size_t capacity = 0;
+        };
+
+        // Cached per frame; pipelines may be rebuilt in between
+        const PipelineState& pipelineState(PipelineHandle handle);
+        // Whether the pipeline reads transforms from the instance set
+        bool isInstanced(PipelineHandle handle) const;
+
+        // Fills m_drawItems and m_drawPackets from the entities in view, sorted for
+        // drawing. 'cull' frustum culls them first, for lists not already culled.
+        template<typename View, typename Entities>
+        void buildDrawList(const View& renderObjects, const Entities& entities, bool cull);
+        void buildIndirectDraws();
+        // Merges the sorted packets into m_batches and writes their transforms
+        void buildBatches(uint32_t frameIndex);
+        InstanceBuffer& reserveInstances(uint32_t frameIndex, size_t count);
+
+        // Dense per-frame ID for a pipeline/material/mesh, for the sort key
+        static uint32_t sortId(std::unordered_map<const void*, uint32_t>& ids, const void* object);
+
+        // Below this many draws a chunk isn't worth a separate secondary command buffer
+        static constexpr size_t DRAWS_PER_CHUNK = 256;
+        static constexpr size_t MIN_INSTANCE_CAPACITY = 1024;
+        // Descriptor set index of the instance buffer ("instances" layout)
+        static constexpr uint32_t INSTANCE_SET = 2;
+
+        std::vector<DrawItem> m_drawItems;
+        std::vector<DrawKey> m_drawKeys; // indexed like m_drawItems
+        std::vector<DrawPacket> m_drawPackets;
+        std::vector<DrawPacket> m_sortScratch;
+        std::vector<DrawBatch> m_batches;
+        FrustumCuller m_culler; // indexed like m_drawItems
+        std::vector<Entity> m_visibleEntities; // from the scene BVH, without a GpuScene
+        std::vector<InstanceBuffer> m_instanceBuffers; // per frame in flight
+        std::vector<IndirectDraw> m_indirectDraws;
+        Ref<GpuScene> m_gpuScene;
+        Ref<DrawCommandPass> m_drawCommands;
+        Ref<DepthPyramid> m_pyramid;
+        // Compatible with m_renderPass, but keeps what the first one drew
+        VkRenderPass m_resumeRenderPass = VK_NULL_HANDLE;
+        std::vector<PipelineState> m_pipelineStates; // by PipelineHandle::id, null pipeline when not cached
+        std::unordered_map<const void*, uint32_t> m_pipelineIds;
+        std::unordered_map<const void*, uint32_t> m_materialIds;
+        std::unordered_map<const void*, uint32_t> m_meshIds;
+        // Last frame's keys didn't fit; logged once per overflow
+        bool m_drawKeysOverflowed = false;
+
+        std::vector<Entity> m_outlineList;
+        PipelineHandle m_outlinePipeline = PipelineHandle::fromName("outline");
+        Ref<ParallelCommandRecorder::Recording> m_indirectRecording;
+        Ref<ParallelCommandRecorder::Recording> m_lateRecording;
+        Ref<ParallelCommandRecorder::Recording> m_drawRecording;
+        Ref<ParallelCommandRecorder::Recording> m_outlineRecording;
+
         FileWatcher m_fileWatcher;
         Ref<ShaderCompiler> m_shaderCompiler;
         int m_selectedObject = 0;
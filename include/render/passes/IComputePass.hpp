@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <render/PipelineManager.hpp>
+#include <render/passes/IGraphPass.hpp>
+
+namespace vks
+{
+    class Device;
+    class Buffer;
+
+    // Base for passes that only dispatch compute work. There is no render pass or
+    // framebuffer; storage resources are declared in setup() like any other pass
+    // (StorageRead/StorageWrite/IndirectRead) and the graph inserts the barriers.
+    class IComputePass : public IGraphPass
+    {
+    public:
+        explicit IComputePass(const Device& device);
+        ~IComputePass() override = default;
+
+        RenderPassType type() const override { return RenderPassType::Compute; }
+
+        void update(float dt, uint32_t currentImage) override {}
+        void recreate() override;
+
+        // On by default. The graph still runs the pass on the graphics queue when the
+        // device has no dedicated compute family or the pass depends on graphics work
+        // from the same frame. Graph ownership transfers only cover a single frame:
+        // buffers whose contents must survive into the next frame should be created
+        // with VK_SHARING_MODE_CONCURRENT across the graphics and compute families.
+        bool asyncCompute() const override { return m_asyncCompute; }
+        void setAsyncCompute(bool async) { m_asyncCompute = async; }
+
+        PipelineManager& pipelines() { return m_pipelineManager; }
+        const PipelineManager& pipelines() const { return m_pipelineManager; }
+
+        // Number of workgroups needed to cover 'items' invocations
+        static uint32_t groupCount(uint32_t items, uint32_t localSize)
+        {
+            return (items + localSize - 1) / localSize;
+        }
+
+    protected:
+        // Binds the pipeline and remembers it for the helpers below
+        void bindPipeline(VkCommandBuffer cmd, PipelineHandle pipeline);
+        void bindPipeline(VkCommandBuffer cmd, const std::string& name)
+        {
+            bindPipeline(cmd, PipelineHandle::fromName(name));
+        }
+        void bindDescriptorSets(VkCommandBuffer cmd, uint32_t firstSet,
+                                const std::vector<VkDescriptorSet>& sets) const;
+        void pushConstants(VkCommandBuffer cmd, const void* data, uint32_t size, uint32_t offset = 0) const;
+
+        void dispatch(VkCommandBuffer cmd, uint32_t groupsX, uint32_t groupsY = 1, uint32_t groupsZ = 1) const;
+        // One invocation per item, 1D
+        void dispatchItems(VkCommandBuffer cmd, uint32_t items, uint32_t localSize) const;
+        // Reads a VkDispatchIndirectCommand from 'args' at 'offset'
+        void dispatchIndirect(VkCommandBuffer cmd, const Buffer& args, VkDeviceSize offset = 0) const;
+
+        const Device& m_device;
+        PipelineManager m_pipelineManager;
+
+    private:
+        VkPipelineLayout m_boundLayout = VK_NULL_HANDLE;
+        bool m_asyncCompute = true;
+    };
+} // namespace vks
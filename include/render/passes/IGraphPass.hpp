@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include <core/NonCopyable.hpp>
+
+namespace vks
+{
+    class RenderGraphBuilder;
+    class ParallelCommandRecorder;
+
+    enum class RenderPassType
+    {
+        Geometry,
+        Shadow,
+        Lighting,
+        PostProcess,
+        ImGui,
+        Editor,
+        Compute,
+        Transfer,
+        Custom
+    };
+
+    const char* toString(RenderPassType type);
+
+    // Anything the RenderGraph can schedule. Passes declare the resources they
+    // touch in setup(); the graph uses those declarations to order, cull and
+    // synchronize them, so record() must not add its own inter-pass barriers.
+    class IGraphPass : public NonCopyable
+    {
+    public:
+        virtual ~IGraphPass() = default;
+
+        virtual RenderPassType type() const = 0;
+
+        // Label for profiling and logs
+        virtual const char* name() const { return toString(type()); }
+
+        // Called by the graph whenever it (re)compiles
+        virtual void setup(RenderGraphBuilder& builder) = 0;
+
+        virtual void update(float dt, uint32_t currentImage) = 0;
+
+        // Called for every live pass before any of them records. Passes with large
+        // draw lists start their secondary command buffers here and execute them
+        // in record(), so the graph's passes are recorded concurrently.
+        virtual void prepare(ParallelCommandRecorder& recorder, uint32_t currentImage) {}
+        virtual void record(VkCommandBuffer cmd, uint32_t currentImage) = 0;
+
+        virtual void recreate() {}
+
+        // Whether the graph may run this pass on the async compute queue
+        virtual bool asyncCompute() const { return false; }
+    };
+} // namespace vks
@@ -7,6 +7,8 @@
 
 #include <render/PipelineManager.hpp>
 #include <render/IRenderTarget.hpp>
+#include <render/RenderGraphResources.hpp>
+#include <render/passes/IGraphPass.hpp>
 
 #include "core/types.hpp"
 
@@ -15,22 +17,11 @@ namespace vks
     class Device;
     class SwapChain;
 
-    enum class RenderPassType
-    {
-        Geometry,
-        Shadow,
-        Lighting,
-        PostProcess,
-        ImGui,
-        Editor,
-        Custom
-    };
-
-    class IRenderPass : public NonCopyable
+    class IRenderPass : public IGraphPass
     {
     public:
         IRenderPass(const Device& device, const Ref<IRenderTarget>& renderTarget);
-        ~IRenderPass();
+        ~IRenderPass() override;
 
         inline const VkRenderPass& handle() const { return m_renderPass; }
 
@@ -41,12 +32,7 @@ namespace vks
 
         inline size_t size() const { return m_frameBuffers.size(); }
 
-        virtual RenderPassType type() const = 0;
-
-        virtual void update(float dt, uint32_t currentImage) = 0;
-        virtual void record(VkCommandBuffer cmd, uint32_t currentImage) = 0;
-
-        virtual void recreate();
+        void recreate() override;
         void cleanupOld();
 
         PipelineManager& pipelines() { return m_pipelineManager; }
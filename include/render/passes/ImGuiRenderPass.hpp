@@ -9,6 +9,7 @@ namespace vks
     {
     public:
         ImGuiRenderPass(const Device& device, const Ref<IRenderTarget>& renderTarget);
+        void setup(RenderGraphBuilder& builder) override;
         void update(float dt, uint32_t currentImage) override;
         void record(VkCommandBuffer cmd, uint32_t currentImage) override;
 
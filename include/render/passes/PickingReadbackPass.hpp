@@ -0,0 +1,31 @@
+#pragma once
+
+#include <render/passes/IGraphPass.hpp>
+#include <render/IRenderTarget.hpp>
+
+#include "core/types.hpp"
+
+namespace vks
+{
+    class Buffer;
+
+    // Copies the object ID under the mouse from the picking target into a
+    // host-visible buffer. Split from UIPass so the graph can place the
+    // TRANSFER_SRC transition and the host-visibility barrier itself.
+    class PickingReadbackPass : public IGraphPass
+    {
+    public:
+        PickingReadbackPass(const Ref<IRenderTarget>& source, Buffer& destination);
+
+        RenderPassType type() const override { return RenderPassType::Transfer; }
+        const char* name() const override { return "PickingReadback"; }
+
+        void setup(RenderGraphBuilder& builder) override;
+        void update(float dt, uint32_t currentImage) override {}
+        void record(VkCommandBuffer cmd, uint32_t currentImage) override;
+
+    private:
+        Ref<IRenderTarget> m_source;
+        Buffer& m_destination;
+    };
+} // namespace vks
@@ -1,5 +1,6 @@
 #pragma once
 #include <render/passes/IRenderPass.hpp>
+#include <render/ParallelCommandRecorder.hpp>
 
 #include "app/Engine.hpp"
 #include "scene/Scene.hpp"
@@ -14,12 +15,18 @@ namespace vks
         UIPass(const Device& device, const Ref<IRenderTarget>& renderTarget);
         void entitySelection(Engine& ce, vks::Input& input);
 
+        void setup(RenderGraphBuilder& builder) override;
         void update(float dt, uint32_t imageIndex) override;
+        void prepare(ParallelCommandRecorder& recorder, uint32_t imageIndex) override;
         void record(VkCommandBuffer cmd, uint32_t imageIndex) override;
 
         void recreate() override;
 
         RenderPassType type() const override { return RenderPassType::Editor; }
+        const char* name() const override { return "ObjectPicking"; }
+
+        // Holds the entity ID under the mouse, filled by PickingReadbackPass
+        Buffer& pixelBuffer() const { return *m_pixelBuffer; }
 
     private:
         std::unique_ptr<Buffer> m_pixelBuffer;
@@ -27,7 +34,11 @@ namespace vks
         void createRenderPass() override;
         void createFrameBuffers() override;
 
-        void capturePixelID(VkCommandBuffer cmd, VkImage srcImage, glm::vec2 mousePos);
+        static constexpr size_t DRAWS_PER_CHUNK = 256;
+
+        std::vector<Entity> m_drawList;
+        PipelineHandle m_pickerPipeline = PipelineHandle::fromName("ObjectPicker");
+        Ref<ParallelCommandRecorder::Recording> m_drawRecording;
 
         Entity selectedEntityID;
     };
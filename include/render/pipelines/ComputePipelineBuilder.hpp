@@ -0,0 +1,25 @@
+#pragma once
+
+#include <render/pipelines/PipelineBuilder.hpp>
+#include <render/pipelines/PipelineDesc.hpp>
+#include <gfx/Device.hpp>
+
+#include <vulkan/vulkan.h>
+
+namespace vks
+{
+    class ComputePipelineBuilder final : public IPipelineBuilder
+    {
+    public:
+        ComputePipelineBuilder(
+            const Device& device,
+            const ComputePipelineDesc& desc
+        ) : m_device(device), m_desc(desc) {}
+
+        VkPipeline build(VkPipelineLayout layout, VkPipelineCache cache) override;
+
+    private:
+        const Device& m_device;
+        const ComputePipelineDesc& m_desc;
+    };
+}
@@ -24,10 +24,6 @@ namespace vks
     private:
         const Device& m_device;
         const GraphicsPipelineDesc& m_desc;
-
-        static std::vector<uint32_t> loadSpirv(const std::string& path);
-
-        VkShaderModule createShaderModuleFromFile(const std::string& path) const;
     };
 
 }
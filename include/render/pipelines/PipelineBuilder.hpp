@@ -1,9 +1,13 @@
 #pragma once
 
+#include <string>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace vks
 {
+    class Device;
+
     class IPipelineBuilder
     {
     public:
@@ -13,5 +17,9 @@ namespace vks
             VkPipelineLayout layout,
             VkPipelineCache cache
         ) = 0;
+
+    protected:
+        static std::vector<uint32_t> loadSpirv(const std::string& path);
+        static VkShaderModule createShaderModuleFromFile(const Device& device, const std::string& path);
     };
 }
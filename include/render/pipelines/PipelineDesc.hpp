@@ -3,6 +3,7 @@
 #include <string>
 #include <variant>
 #include <vulkan/vulkan.h>
+#include <scene/Geometry.hpp>
 
 namespace vks
 {
@@ -38,6 +39,14 @@ namespace vks
         bool depthWrite = true;
         bool alphaBlending = false;
         bool isVertexInput = true; // Whether pipeline has vertex input (for procedural pipelines)
+        // Layout of the vertex buffers; must match Model::vertexFormat() of every mesh drawn
+        geometry::VertexFormat vertexFormat = geometry::VertexFormat::Packed;
+    };
+
+    struct ComputePipelineDesc
+    {
+        std::string computeShader;
+        std::string entryPoint = "main";
     };
 
     struct PipelineDesc
@@ -48,7 +57,8 @@ namespace vks
         std::vector<VkPushConstantRange> pushConstants;
 
         std::variant<
-            GraphicsPipelineDesc
+            GraphicsPipelineDesc,
+            ComputePipelineDesc
         > payload;
     };
 }
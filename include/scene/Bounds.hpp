@@ -0,0 +1,86 @@
+#pragma once
+
+#include <limits>
+
+#include <glm/glm.hpp>
+
+namespace vks
+{
+    struct AABB
+    {
+        glm::vec3 min{0.0f};
+        glm::vec3 max{0.0f};
+
+        glm::vec3 center() const { return (min + max) * 0.5f; }
+        glm::vec3 halfExtent() const { return (max - min) * 0.5f; }
+
+        float surfaceArea() const
+        {
+            const glm::vec3 d = max - min;
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        bool overlaps(const AABB& other) const
+        {
+            return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+        }
+
+        bool contains(const AABB& other) const
+        {
+            return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::lessThanEqual(other.max, max));
+        }
+
+        // Smallest box around both
+        static AABB merge(const AABB& a, const AABB& b) { return {glm::min(a.min, b.min), glm::max(a.max, b.max)}; }
+
+        // Box around this one after an affine transform
+        AABB transformed(const glm::mat4& transform) const;
+    };
+
+    struct BoundingSphere
+    {
+        glm::vec3 center{0.0f};
+        float radius = 0.0f;
+
+        // Conservative under non-uniform scale: the radius grows by the largest axis scale
+        BoundingSphere transformed(const glm::mat4& transform) const;
+
+        bool intersects(const AABB& box) const;
+    };
+
+    struct Ray
+    {
+        glm::vec3 origin{0.0f};
+        glm::vec3 direction{0.0f, 0.0f, -1.0f}; // normalized
+        float maxDistance = std::numeric_limits<float>::infinity();
+
+        // Slab test. 'distance' is where the ray enters the box, 0 when it starts inside.
+        bool intersects(const AABB& box, float& distance) const;
+        bool intersects(const AABB& box) const
+        {
+            float distance;
+            return intersects(box, distance);
+        }
+    };
+
+    // View volume as six inward-facing planes (xyz normal, w distance), normalized
+    struct Frustum
+    {
+        enum Plane { Left, Right, Bottom, Top, Near, Far, Count };
+
+        glm::vec4 planes[Count];
+
+        // From a projection * view matrix, for either depth range convention
+        static Frustum fromMatrix(const glm::mat4& viewProj);
+
+        // Both tests may report shapes just outside a corner as intersecting
+        bool intersects(const BoundingSphere& sphere) const;
+        bool intersects(const AABB& box) const;
+    };
+
+    // Shape against box, for code generic over the query shape (see DynamicAABBTree)
+    inline bool intersects(const AABB& shape, const AABB& box) { return shape.overlaps(box); }
+    inline bool intersects(const BoundingSphere& shape, const AABB& box) { return shape.intersects(box); }
+    inline bool intersects(const Frustum& shape, const AABB& box) { return shape.intersects(box); }
+    inline bool intersects(const Ray& shape, const AABB& box) { return shape.intersects(box); }
+} // namespace vks
@@ -1,8 +1,12 @@
 #pragma once
+#include <cmath>
+#include <limits>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <platform/Input.hpp>
+#include <scene/Bounds.hpp>
 
 #include <platform/events/EventManager.hpp>
 #include <platform/events/Events.hpp>
@@ -89,10 +93,39 @@ public:
     // --------------------------------------------------------------------
     const glm::mat4& view() const { return m_view; }
     const glm::mat4& proj() const { return m_proj; }
+    Frustum frustum() const { return Frustum::fromMatrix(m_proj * m_view); }
+
+    // Diameter of a world-space sphere on screen over the viewport height, for
+    // LOD selection (see Model::selectLod). Unbounded with the eye inside it.
+    float projectedSize(const BoundingSphere& sphere) const
+    {
+        const float distance = glm::length(sphere.center - position);
+        if (distance <= sphere.radius)
+            return std::numeric_limits<float>::max();
+        return sphere.radius * std::abs(m_proj[1][1]) / distance;
+    }
+
+    // World-space ray from the eye through a point in normalized device
+    // coordinates (x right, y down, both in [-1, 1]), up to the far plane
+    Ray ray(const glm::vec2& ndc) const
+    {
+        // z = 1 is the far plane in either depth range convention
+        glm::vec4 farPoint = glm::inverse(m_proj * m_view) * glm::vec4(ndc, 1.0f, 1.0f);
+        glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+
+        Ray result;
+        result.origin = position;
+        result.direction = glm::normalize(target - position);
+        result.maxDistance = glm::length(target - position);
+        return result;
+    }
 
     const glm::vec3 getPosition() const { return position; }
     const glm::vec3 getDirection() const { return forward(); }
 
+    float nearPlane() const { return m_near; }
+    float farPlane() const { return m_far; }
+
     void setAspect(float aspect)
     {
         m_aspectRatio = aspect;
@@ -114,6 +147,8 @@ private:
 
     Input* m_input = nullptr;
     float m_aspectRatio = 1.0f;
+    float m_near = 1.0f;
+    float m_far = 1000.0f;
 
     glm::mat4 m_view{1.0f};
     glm::mat4 m_proj{1.0f};
@@ -168,8 +203,8 @@ inline glm::mat4 Camera::getProjectionMatrix() const
     return glm::perspective(
         glm::radians(45.0f),
         m_aspectRatio,
-        1.0f,
-        1000.0f
+        m_near,
+        m_far
     );
 }
 } // namespace vks
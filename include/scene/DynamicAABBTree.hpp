@@ -0,0 +1,229 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <scene/Bounds.hpp>
+
+namespace vks
+{
+    /**
+     * @brief Dynamic bounding volume hierarchy over axis-aligned boxes.
+     *
+     * Every proxy is a leaf holding its box enlarged by a margin, so small moves
+     * don't touch the tree at all. A proxy that leaves its enlarged box is
+     * reinserted: removing the leaf and inserting it again refits and
+     * rebalances only the ancestors on its way, O(log n) per moved proxy.
+     * Insertion picks the sibling with the lowest surface area cost; tree
+     * rotations keep the height logarithmic.
+     *
+     * Queries report every proxy whose enlarged box intersects the shape, so
+     * callers wanting exact answers test their own bounds on top.
+     */
+    class DynamicAABBTree
+    {
+    public:
+        static constexpr uint32_t NULL_NODE = UINT32_MAX;
+
+        explicit DynamicAABBTree(float margin = 0.1f);
+
+        // Returns the proxy id, stable until destroyProxy()
+        uint32_t createProxy(const AABB& box, uint32_t userData);
+        void destroyProxy(uint32_t proxy);
+        // True if the proxy was reinserted, false if its enlarged box still holds 'box'
+        bool moveProxy(uint32_t proxy, const AABB& box);
+
+        uint32_t userData(uint32_t proxy) const { return m_nodes[proxy].userData; }
+        const AABB& fatBox(uint32_t proxy) const { return m_nodes[proxy].box; }
+
+        void clear();
+        uint32_t proxyCount() const { return m_proxyCount; }
+        // One past the largest proxy id handed out so far
+        uint32_t capacity() const { return static_cast<uint32_t>(m_nodes.size()); }
+        // 0 for a single leaf, -1 when empty
+        int32_t height() const { return m_root == NULL_NODE ? -1 : m_nodes[m_root].height; }
+
+        // Checks parent links, heights and boxes; for tests
+        bool validate() const;
+
+        // Calls callback(proxy) for every proxy whose box intersects 'shape'.
+        // Shape is anything with intersects(shape, AABB): AABB, BoundingSphere, Frustum, Ray.
+        // Returning false from the callback stops the query.
+        template<typename Shape, typename Callback>
+        void query(const Shape& shape, Callback&& callback) const;
+
+        // One traversal for many shapes: callback(shapeIndex, proxy) for every hit.
+        // Subtrees are skipped as soon as no shape in the batch reaches them.
+        template<typename Shape, typename Callback>
+        void queryBatch(std::span<const Shape> shapes, Callback&& callback) const;
+
+        // Walks the proxies front to back along the ray as far as its current
+        // length: callback(proxy, ray) returns the new maximum distance, e.g.
+        // the hit distance to find the nearest hit, or ray.maxDistance to go on.
+        template<typename Callback>
+        void raycast(Ray ray, Callback&& callback) const;
+
+    private:
+        struct Node
+        {
+            AABB box;
+            uint32_t parent = NULL_NODE; // next free node while on the free list
+            uint32_t child1 = NULL_NODE;
+            uint32_t child2 = NULL_NODE;
+            int32_t height = -1;         // 0 for leaves, -1 for free nodes
+            uint32_t userData = 0;
+
+            bool isLeaf() const { return child1 == NULL_NODE; }
+        };
+
+        // Depth-first traversal stack; the balanced tree's height stays far below this
+        static constexpr size_t MAX_DEPTH = 256;
+        using Stack = std::array<uint32_t, MAX_DEPTH>;
+
+        uint32_t allocateNode();
+        void freeNode(uint32_t node);
+
+        void insertLeaf(uint32_t leaf);
+        void removeLeaf(uint32_t leaf);
+        // Refits boxes and heights from 'node' to the root, rotating where unbalanced
+        void refit(uint32_t node);
+        uint32_t balance(uint32_t node);
+
+        float m_margin;
+        std::vector<Node> m_nodes;
+        uint32_t m_root = NULL_NODE;
+        uint32_t m_freeList = NULL_NODE;
+        uint32_t m_proxyCount = 0;
+    };
+
+    template<typename Shape, typename Callback>
+    void DynamicAABBTree::query(const Shape& shape, Callback&& callback) const
+    {
+        if (m_root == NULL_NODE)
+            return;
+
+        Stack stack;
+        size_t size = 0;
+        stack[size++] = m_root;
+
+        while (size > 0)
+        {
+            const Node& node = m_nodes[stack[--size]];
+            if (!intersects(shape, node.box))
+                continue;
+
+            if (node.isLeaf())
+            {
+                if (!callback(static_cast<uint32_t>(&node - m_nodes.data())))
+                    return;
+            }
+            else
+            {
+                stack[size++] = node.child1;
+                stack[size++] = node.child2;
+            }
+        }
+    }
+
+    template<typename Shape, typename Callback>
+    void DynamicAABBTree::queryBatch(std::span<const Shape> shapes, Callback&& callback) const
+    {
+        if (m_root == NULL_NODE)
+            return;
+
+        // 64 shapes per traversal, one bit each
+        for (size_t first = 0; first < shapes.size(); first += 64)
+        {
+            const size_t count = std::min<size_t>(64, shapes.size() - first);
+
+            std::array<uint32_t, MAX_DEPTH> nodes;
+            std::array<uint64_t, MAX_DEPTH> masks;
+            size_t size = 0;
+            nodes[size] = m_root;
+            masks[size++] = count == 64 ? ~0ull : (1ull << count) - 1;
+
+            while (size > 0)
+            {
+                --size;
+                const Node& node = m_nodes[nodes[size]];
+
+                // Only the shapes that reached the parent can reach this node
+                uint64_t mask = 0;
+                for (uint64_t bits = masks[size]; bits != 0; bits &= bits - 1)
+                {
+                    const int bit = std::countr_zero(bits);
+                    if (intersects(shapes[first + bit], node.box))
+                        mask |= 1ull << bit;
+                }
+                if (mask == 0)
+                    continue;
+
+                if (node.isLeaf())
+                {
+                    const uint32_t proxy = static_cast<uint32_t>(&node - m_nodes.data());
+                    for (uint64_t bits = mask; bits != 0; bits &= bits - 1)
+                        callback(static_cast<uint32_t>(first + std::countr_zero(bits)), proxy);
+                }
+                else
+                {
+                    nodes[size] = node.child1;
+                    masks[size++] = mask;
+                    nodes[size] = node.child2;
+                    masks[size++] = mask;
+                }
+            }
+        }
+    }
+
+    template<typename Callback>
+    void DynamicAABBTree::raycast(Ray ray, Callback&& callback) const
+    {
+        if (m_root == NULL_NODE)
+            return;
+
+        Stack stack;
+        size_t size = 0;
+        stack[size++] = m_root;
+
+        while (size > 0)
+        {
+            const Node& node = m_nodes[stack[--size]];
+
+            // The ray shortens as hits come in, pruning everything behind them
+            float distance;
+            if (!ray.intersects(node.box, distance))
+                continue;
+
+            if (node.isLeaf())
+            {
+                ray.maxDistance = callback(static_cast<uint32_t>(&node - m_nodes.data()), ray);
+                if (ray.maxDistance <= 0.0f)
+                    return;
+                continue;
+            }
+
+            // Nearer child on top, so its hits shorten the ray before the other is tested
+            float distance1, distance2;
+            const bool hit1 = ray.intersects(m_nodes[node.child1].box, distance1);
+            const bool hit2 = ray.intersects(m_nodes[node.child2].box, distance2);
+            if (hit1 && hit2)
+            {
+                const bool firstNearer = distance1 <= distance2;
+                stack[size++] = firstNearer ? node.child2 : node.child1;
+                stack[size++] = firstNearer ? node.child1 : node.child2;
+            }
+            else if (hit1)
+            {
+                stack[size++] = node.child1;
+            }
+            else if (hit2)
+            {
+                stack[size++] = node.child2;
+            }
+        }
+    }
+} // namespace vks
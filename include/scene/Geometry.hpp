@@ -1,6 +1,8 @@
 #ifndef GEOMETRY_HPP
 #define GEOMETRY_HPP
 
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <glm/glm.hpp>
 
@@ -14,17 +16,50 @@ struct Vertex
     float pos[3]; // layout(location = 0)
     float normal[3]; // layout(location = 1)
     float uv[2]; // layout(location = 2)
+};
 
-    // Helper function to tell Vulkan about this struct's memory layout
-    static VkVertexInputBindingDescription getBindingDescription();
+// 16 bytes instead of 32. Positions are snorm16 within the mesh's bounding
+// cube and dequantized by the transform packVertices() returns; normals are
+// octahedral-encoded snorm16 (decoded in the shader when PACKED_VERTICES is
+// set); UVs are unorm16, so they must lie in [0, 1].
+struct PackedVertex
+{
+    int16_t pos[4]; // layout(location = 0), w unused
+    int16_t normal[2]; // layout(location = 1)
+    uint16_t uv[2]; // layout(location = 2)
+};
+
+// How a mesh stores its vertices; pipelines are built for one format and only
+// draw meshes uploaded in it
+enum class VertexFormat : uint8_t
+{
+    Float, // Vertex
+    Packed // PackedVertex
+};
 
-    // Helper function to tell Vulkan about each member
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+struct VertexInputDescription
+{
+    VkVertexInputBindingDescription binding;
+    std::array<VkVertexInputAttributeDescription, 3> attributes;
 };
 
+VertexInputDescription vertexInputDescription(VertexFormat format);
+uint32_t vertexStride(VertexFormat format);
+
+// Returns the matrix taking packed positions back to model space: a uniform
+// scale and a translation, so it leaves normal directions alone
+glm::mat4 packVertices(const std::vector<Vertex>& vertices, std::vector<PackedVertex>& packed);
+Vertex unpackVertex(const PackedVertex& vertex, const glm::mat4& dequantization);
+
     void createSphere(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float radius, uint32_t sectors,
                       uint32_t stacks);
     void createQuad(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Vertex clustering: snaps the vertices to the finest uniform grid that
+    // leaves at most targetIndexCount indices, keeps one vertex per cell and
+    // drops the triangles that collapse. The result indexes the same vertices.
+    void simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                  size_t targetIndexCount, std::vector<uint32_t>& result);
 } // namespace geometry
 } // namespace vks
 
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include <core/NonCopyable.hpp>
+#include <gfx/Buffer.hpp>
+#include <gfx/FreeListAllocator.hpp>
+#include <scene/Geometry.hpp>
+
+namespace vks
+{
+    class Device;
+
+    // Buffers a command buffer has bound, so draws from the same pool pages
+    // skip the rebind. Also names the pages a model draws from.
+    struct GeometryBinding
+    {
+        VkBuffer vertexBuffer = VK_NULL_HANDLE;
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+
+        bool operator==(const GeometryBinding&) const = default;
+
+        // Binds the buffers of 'geometry' that differ from these, and takes them over
+        void bind(VkCommandBuffer cmd, const GeometryBinding& geometry);
+    };
+
+    /**
+     * @brief Vertex and index memory shared by every Model.
+     *
+     * Vertices of each format and indices of each type live in large
+     * device-local pages, sub-allocated with a free list. Models are ranges of
+     * those pages and draw with their offsets, so consecutive draws of
+     * different models bind nothing in between. A new page is only added once
+     * the existing ones are full, which the default size makes rare.
+     */
+    class GeometryPool : public NonCopyable
+    {
+    public:
+        static constexpr VkDeviceSize PAGE_SIZE = 32 * 1024 * 1024;
+
+        struct Page
+        {
+            const Device& device;
+            Buffer buffer;
+            FreeListAllocator allocator;
+        };
+
+        /**
+         * @brief A range of one page, in vertices or indices.
+         *
+         * Returned to the page once the frames in flight are done with it, so
+         * a Model can be destroyed while it is still being drawn.
+         */
+        class Range
+        {
+        public:
+            Range() = default;
+            ~Range();
+
+            Range(const Range&) = delete;
+            Range& operator=(const Range&) = delete;
+            Range(Range&& other) noexcept;
+            Range& operator=(Range&& other) noexcept;
+
+            explicit operator bool() const { return m_page != nullptr; }
+            const Buffer& buffer() const { return m_page->buffer; }
+            uint32_t offset() const { return m_offset; }
+            uint32_t count() const { return m_count; }
+
+        private:
+            friend class GeometryPool;
+            Range(std::shared_ptr<Page> page, uint32_t offset, uint32_t count);
+            void reset();
+
+            // Shared with deferred frees, which may outlive the pool
+            std::shared_ptr<Page> m_page;
+            uint32_t m_offset = 0;
+            uint32_t m_count = 0;
+        };
+
+        explicit GeometryPool(const Device& device);
+
+        Range allocateVertices(geometry::VertexFormat format, uint32_t count);
+        Range allocateIndices(VkIndexType type, uint32_t count);
+
+        // Bytes in use by models, and bytes allocated for pages
+        VkDeviceSize usedBytes() const;
+        VkDeviceSize allocatedBytes() const;
+
+    private:
+        using Pages = std::vector<std::shared_ptr<Page>>;
+
+        Range allocate(Pages& pages, VkDeviceSize elementSize, VkBufferUsageFlags usage, uint32_t count);
+
+        const Device& m_device;
+        // By geometry::VertexFormat
+        std::array<Pages, 2> m_vertexPages;
+        // 16-bit, then 32-bit
+        std::array<Pages, 2> m_indexPages;
+    };
+} // namespace vks
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <scene/Geometry.hpp>
+
+namespace vks::geometry
+{
+    // Post-transform vertex cache behaviour of an index list
+    struct VertexCacheStats
+    {
+        float acmr = 0.0f; // average cache misses per triangle: 0.5 is ideal for large grids, 3 is worst
+        float atvr = 0.0f; // vertices transformed per referenced vertex: 1 is ideal
+    };
+
+    // Simulates a FIFO cache of 'cacheSize' entries, the model most GPUs come closest to
+    VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+                                        uint32_t cacheSize = 16);
+
+    // Reorders triangles so consecutive ones share vertices (Forsyth's linear-speed
+    // algorithm). Keeps every triangle and its winding.
+    void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+
+    // Reorders runs of triangles, as left by optimizeVertexCache, so the ones
+    // facing outward from the mesh centre come first and hide what is drawn
+    // after them. Runs are cut only where restarting the cache costs about 5%
+    // of ACMR or less, and the order within them is kept.
+    void optimizeOverdraw(std::span<uint32_t> indices, const std::vector<Vertex>& vertices);
+
+    // Renumbers the vertices in order of first use, so vertex fetches walk the
+    // buffer forwards, and drops unreferenced ones. Run it last, over every
+    // index range that shares the vertices.
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices);
+} // namespace vks::geometry
@@ -1,7 +1,9 @@
 #pragma once
 
-#include <gfx/Buffer.hpp>
+#include <gfx/UploadManager.hpp>
+#include <scene/Bounds.hpp>
 #include <scene/Geometry.hpp>
+#include <scene/GeometryPool.hpp>
 #include <vulkan/vulkan.h>
 #include <memory>
 #include <vector>
@@ -11,6 +13,21 @@ namespace vks
     class Model
     {
     public:
+        // One level of detail: a range of the pool's index buffer. The indices
+        // are relative to the model's vertices, so every level draws with
+        // vertexOffset().
+        struct Lod
+        {
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+        };
+
+        static constexpr uint32_t MAX_LODS = 4;
+        // Projected size (see Camera::projectedSize) below which LOD 0 gives way
+        // to LOD 1; every further level takes over at half the previous size.
+        // Each level halves the tessellation, so triangles keep their size on screen.
+        static constexpr float LOD_SCREEN_SIZE = 0.5f;
+
         Model() = default;
         ~Model() = default;
 
@@ -20,14 +37,59 @@ namespace vks
         Model(Model&&) = default;
         Model& operator=(Model&&) = default;
 
+        // LOD n is tessellated with sectors >> n and stacks >> n, down to 8 by 4
         void createSphere(float radius, uint32_t sectors, uint32_t stacks);
         void createQuad();
+        // Arbitrary meshes, e.g. imported ones; coarser levels come from geometry::simplify
+        void createMesh(const std::vector<geometry::Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+        // Reorder triangles and vertices for the post-transform cache, overdraw
+        // and vertex fetch (see MeshOptimizer.hpp) in the create*() calls that
+        // follow. On by default; off keeps the generated or imported order.
+        void setOptimizeOnUpload(bool optimize) { m_optimizeOnUpload = optimize; }
+        // Vertex layout of the create*() calls that follow; Packed by default.
+        // Only pipelines built for the same format can draw the model.
+        void setVertexFormat(geometry::VertexFormat format) { m_vertexFormat = format; }
 
         // --- Getters for the Render Loop ---
-        VkBuffer getVertexBuffer() const { return m_vertexBuffer->getBuffer(); }
-        VkBuffer getIndexBuffer()  const { return m_indexBuffer->getBuffer(); }
-        uint32_t getIndexCount()   const { return m_indexCount; }
+        // Pages of the GeometryPool, shared with other models
+        VkBuffer getVertexBuffer() const { return m_vertices.buffer().getBuffer(); }
+        VkBuffer getIndexBuffer()  const { return m_indices.buffer().getBuffer(); }
+        // First vertex of the model in the vertex buffer
+        int32_t vertexOffset() const { return static_cast<int32_t>(m_vertices.offset()); }
+        // Of LOD 0
+        uint32_t getIndexCount()   const { return m_lods.empty() ? 0 : m_lods[0].indexCount; }
+        // 16-bit whenever the vertices fit
+        VkIndexType getIndexType() const { return m_indexType; }
+        // The pages and index type, e.g. to group models that draw without a rebind
+        GeometryBinding geometry() const { return {getVertexBuffer(), getIndexBuffer(), m_indexType}; }
+        geometry::VertexFormat vertexFormat() const { return m_vertexFormat; }
+        // Takes the vertex buffer's positions to model space: identity for float
+        // vertices, the dequantization for packed ones. Whatever hands the vertex
+        // shader its model matrix multiplies this in on the right.
+        const glm::mat4& vertexTransform() const { return m_vertexTransform; }
+        // Completes when the GPU copies of the vertex and index data are done.
+        // Frames recorded after create*() can draw the model either way.
+        const UploadFuture& uploaded() const { return m_uploaded; }
+        // Binds the buffers and draws one instance of LOD 0
         void bind(VkCommandBuffer cmd) const;
+        // Binds the vertex and index buffers only, for draws whose commands come from a buffer
+        void bindBuffers(VkCommandBuffer cmd) const;
+        // Binds them only if 'bound' holds other buffers, and updates it
+        void bindBuffers(VkCommandBuffer cmd, GeometryBinding& bound) const;
+        // Draws instances [firstInstance, firstInstance + instanceCount) from the bound buffers
+        void draw(VkCommandBuffer cmd, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod = 0) const;
+
+        // --- Levels of detail, finest first ---
+        uint32_t lodCount() const { return static_cast<uint32_t>(m_lods.size()); }
+        const Lod& lod(uint32_t level) const { return m_lods[level]; }
+        uint32_t selectLod(float screenSize, float bias) const { return selectLod(screenSize, bias, lodCount()); }
+        // Level for an object of the given projected size; a positive bias picks coarser levels
+        static uint32_t selectLod(float screenSize, float bias, uint32_t lodCount);
+
+        // --- Model-space bounds, computed at upload ---
+        const AABB& localBounds() const { return m_localBounds; }
+        const BoundingSphere& boundingSphere() const { return m_boundingSphere; }
 
         // --- CPU-side geometry (used by PhysicsSystem for mesh colliders) ---
         // These are kept in RAM after upload so the physics system can read them
@@ -37,23 +99,33 @@ namespace vks
         bool hasCPUGeometry() const { return !m_cpuVertices.empty(); }
 
     private:
+        // 'indices' holds every level back to back as described by 'lods'. LOD 0
+        // must come first and use only the first 'baseVertexCount' vertices.
         void upload(
-            const std::vector<geometry::Vertex>& vertices,
-            const std::vector<uint32_t>& indices);
+            std::vector<geometry::Vertex> vertices,
+            std::vector<uint32_t> indices,
+            std::vector<Lod> lods,
+            size_t baseVertexCount);
+
+        void computeBounds(const std::vector<geometry::Vertex>& vertices);
 
-        void createBufferFromData(
-            void* data,
-            VkDeviceSize size,
-            VkBufferUsageFlags usage,
-            std::unique_ptr<vks::Buffer>& outBuffer);
+        void uploadRange(const GeometryPool::Range& range, const void* data, VkDeviceSize elementSize);
 
-        std::unique_ptr<vks::Buffer> m_vertexBuffer;
-        std::unique_ptr<vks::Buffer> m_indexBuffer;
+        GeometryPool::Range m_vertices;
+        GeometryPool::Range m_indices;
+        UploadFuture m_uploaded;
 
         uint32_t m_vertexCount = 0;
-        uint32_t m_indexCount  = 0;
+        std::vector<Lod> m_lods;
+        bool m_optimizeOnUpload = true;
+        geometry::VertexFormat m_vertexFormat = geometry::VertexFormat::Packed;
+        VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
+        glm::mat4 m_vertexTransform{1.0f};
+
+        AABB m_localBounds;
+        BoundingSphere m_boundingSphere;
 
-        // CPU mirror — retained for physics/raycasting
+        // CPU mirror of LOD 0 — retained for physics/raycasting
         std::vector<geometry::Vertex> m_cpuVertices;
         std::vector<uint32_t>         m_cpuIndices;
     };
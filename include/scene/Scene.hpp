@@ -3,6 +3,7 @@
 #include <string>
 #include <entt/entt.hpp>
 #include <scene/Components.hpp>
+#include <scene/SceneBVH.hpp>
 
 namespace vks
 {
@@ -39,6 +40,14 @@ namespace vks
             return m_registry.get<Component>(e);
         }
 
+        // Call after editing a component in place, so on_update listeners (the
+        // GPU scene mirror and the BVH, for two) see the change
+        template <typename Component>
+        void patch(entt::entity e)
+        {
+            m_registry.patch<Component>(e);
+        }
+
         template <typename... Components>
         auto view()
         {
@@ -64,7 +73,12 @@ namespace vks
             return m_registry.valid(entity);
         }
 
+        // Bounds of the renderables, for culling, picking and gameplay queries
+        SceneBVH& spatial() { return m_spatial; }
+
     private:
         entt::registry m_registry;
+        // Connects to the registry's signals, so it is declared after it
+        SceneBVH m_spatial{m_registry};
     };
 }
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include <core/NonCopyable.hpp>
+#include <scene/Bounds.hpp>
+#include <scene/DynamicAABBTree.hpp>
+
+namespace vks
+{
+    using Entity = entt::entity;
+
+    /**
+     * @brief World-space bounds of the scene's renderables in a DynamicAABBTree.
+     *
+     * Kept current from EnTT signals (Renderable construct/update/destroy,
+     * Transform update) like GpuScene: signals only queue entities and the next
+     * query applies them, so a frame's refit work is proportional to what moved.
+     * Transforms edited in place must be followed by Scene::patch<Transform>().
+     *
+     * Queries test the tree with the enlarged boxes, then each candidate's
+     * exact world box, and report entities in no particular order.
+     */
+    class SceneBVH : public NonCopyable
+    {
+    public:
+        struct RayHit
+        {
+            Entity entity = entt::null;
+            float distance = 0.0f; // along the ray to the entity's box
+        };
+
+        explicit SceneBVH(entt::registry& registry);
+        ~SceneBVH();
+
+        // Applies the changes seen since the last call. Queries call it first.
+        void sync();
+
+        // Appends every entity whose bounds intersect 'shape' to 'out'.
+        // Shape is an AABB, BoundingSphere, Frustum or Ray.
+        template<typename Shape>
+        void query(const Shape& shape, std::vector<Entity>& out);
+
+        // One tree traversal for the whole batch; out[i] receives the hits of shapes[i]
+        template<typename Shape>
+        void query(std::span<const Shape> shapes, std::vector<std::vector<Entity>>& out);
+
+        // Nearest entity along the ray, if any within ray.maxDistance
+        std::optional<RayHit> raycast(const Ray& ray);
+        void raycast(std::span<const Ray> rays, std::vector<std::optional<RayHit>>& out);
+
+        // Renderables without a model, hence without bounds; no query reports them
+        const std::vector<Entity>& unbounded() const { return m_unbounded; }
+
+        const DynamicAABBTree& tree() const { return m_tree; }
+
+    private:
+        struct Item
+        {
+            Entity entity = entt::null;
+            AABB bounds;        // exact world box
+            bool moved = false; // queued in m_moved
+        };
+
+        void onConstruct(entt::registry& registry, entt::entity entity);
+        void onDestroy(entt::registry& registry, entt::entity entity);
+        void onTransform(entt::registry& registry, entt::entity entity);
+
+        void insert(Entity entity);
+        void release(Entity entity);
+        AABB worldBounds(Entity entity) const;
+
+        entt::registry& m_registry;
+        DynamicAABBTree m_tree;
+
+        // Signals only queue entities; sync() applies them
+        std::vector<Entity> m_added;
+        std::vector<Entity> m_removed;
+        std::vector<uint32_t> m_moved; // proxies
+
+        std::unordered_map<Entity, uint32_t> m_proxies;
+        std::vector<Item> m_items; // by proxy
+        std::vector<Entity> m_unbounded;
+    };
+
+    template<typename Shape>
+    void SceneBVH::query(const Shape& shape, std::vector<Entity>& out)
+    {
+        sync();
+        m_tree.query(shape, [&](uint32_t proxy)
+        {
+            const Item& item = m_items[proxy];
+            if (intersects(shape, item.bounds))
+                out.push_back(item.entity);
+            return true;
+        });
+    }
+
+    template<typename Shape>
+    void SceneBVH::query(std::span<const Shape> shapes, std::vector<std::vector<Entity>>& out)
+    {
+        sync();
+        out.resize(shapes.size());
+        m_tree.queryBatch(shapes, [&](uint32_t shape, uint32_t proxy)
+        {
+            const Item& item = m_items[proxy];
+            if (intersects(shapes[shape], item.bounds))
+                out[shape].push_back(item.entity);
+        });
+    }
+} // namespace vks
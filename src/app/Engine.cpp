@@ -8,40 +8,77 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <algorithm>
+
 #include <app/EngineContext.hpp>
 #include <render/passes/ImGuiRenderPass.hpp>
 #include <render/passes/GeometryPass.hpp>
 #include <render/passes/UIPass.hpp>
+#include <render/passes/PickingReadbackPass.hpp>
+#include <render/passes/FrameReadbackPass.hpp>
+#include <render/passes/DrawCommandPass.hpp>
 
 #include "core/Log.hpp"
 #include "editor/DebugRegistry.hpp"
+#include "gfx/UploadManager.hpp"
 #include "platform/events/EventManager.hpp"
 #include "platform/events/Events.hpp"
 
 namespace vks
 {
     Engine::Engine(const EngineConfig& config)
-        : m_instance(config.appName, config.engineName, config.enableValidation),
+        : m_headless(config.headless),
+          m_headlessReadback(config.headlessReadback),
+          m_headlessFrames(config.headlessFrames),
+          m_instance(config.appName, config.engineName, config.enableValidation, config.headless),
           m_debugMessenger(m_instance),
           m_newWindowExtent({config.width, config.height}),
-          m_window({config.width, config.height}, config.appName, m_instance),
-          m_device(m_instance, m_window, Instance::DeviceExtensions),
-          m_swapChain(std::make_shared<SwapChain>(m_device, m_window)),
+          m_window({config.width, config.height}, config.appName, m_instance, config.headless),
+          m_device(m_instance, m_window,
+                   config.headless ? Instance::HeadlessDeviceExtensions : Instance::DeviceExtensions),
+          m_swapChain(config.headless ? nullptr : std::make_shared<SwapChain>(m_device, m_window, MAX_FRAMES_IN_FLIGHT)),
           m_commandPool(m_device, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT),
-          m_renderGraph(m_device, m_swapChain, m_commandPool),
+          m_transientAttachments(m_device),
+          m_geometry(m_device),
+          // Headless: the viewport target is the graph's output, with one image per frame slot
+          viewportTarget(config.headless
+                             ? std::make_shared<RenderTarget>(
+                                 m_device,
+                                 VkExtent2D{config.width, config.height},
+                                 MAX_FRAMES_IN_FLIGHT,
+                                 VK_FORMAT_R8G8B8A8_UNORM,
+                                 VK_FORMAT_D32_SFLOAT,
+                                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                 false,
+                                 // Occlusion culling builds its depth pyramid from the depth
+                                 config.gpuDrivenDraws && config.occlusionCulling &&
+                                 m_device.supportsDrawIndirectCount()
+                                     ? nullptr
+                                     : &m_transientAttachments)
+                             : nullptr),
+          m_renderGraph(m_device, m_swapChain, m_commandPool, viewportTarget),
           m_editor(*this)
 
     {
+        // Applied with the first frame, together with the initial resize
+        m_requestedFramePacing = config.framePacing;
+        m_dirtyFramePacing = true;
+        m_gpuDrivenDraws = config.gpuDrivenDraws;
+        m_occlusionCulling = config.occlusionCulling;
+
         // Camera
+        const VkExtent2D outputExtent = m_renderGraph.output()->extent();
         m_camera.init(
             &m_window.input(),
-            m_swapChain->extent().width / float(m_swapChain->extent().height)
+            outputExtent.width / float(outputExtent.height)
         );
 
         // Global Descriptor Pool
         m_globalDescriptorPool = DescriptorPool::Builder(m_device)
                                  .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000)
                                  .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000)
+                                 .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000)
+                                 .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 100)
                                  .setMaxSets(1000)
                                  .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
                                  .build();
@@ -70,13 +107,17 @@ namespace vks
 
     Engine::~Engine()
     {
+        // Retired objects may need ImGui, which goes away with the passes
+        vkDeviceWaitIdle(m_device.logical());
+        m_device.deletionQueue().flush();
+
         scene().clear();
         m_renderGraph.clear();
         m_assets.clearAll();
         m_physicsSystem.shutdown();
     }
 
-    void Engine::registerRenderPass(Ref<IRenderPass> pass)
+    void Engine::registerRenderPass(Ref<IGraphPass> pass)
     {
         m_renderGraph.addPass(pass);
     }
@@ -86,6 +127,79 @@ namespace vks
         return m_descriptorSetLayouts.at(name);
     }
 
+    Ref<MaterialTable> Engine::materialTable(std::type_index paramsType, VkDeviceSize paramsSize)
+    {
+        Ref<MaterialTable>& table = m_materialTables[paramsType];
+        if (!table)
+        {
+            table = std::make_shared<MaterialTable>(m_device, m_descriptorSetLayouts.at("material"),
+                                                    m_globalDescriptorPool, paramsSize, MAX_FRAMES_IN_FLIGHT);
+        }
+        return table;
+    }
+
+    void Engine::setFramePacing(FramePacing pacing)
+    {
+        m_requestedFramePacing = pacing;
+        m_dirtyFramePacing = pacing != m_framePacing;
+    }
+
+    void Engine::applyFramePacing()
+    {
+        vkDeviceWaitIdle(m_device.logical());
+
+        auto stats = m_renderGraph.latency().stats();
+        if (stats.frames > 0)
+        {
+            LOG_INFO("Frame pacing '{}': input to {} {:.2f} ms avg ({:.2f}-{:.2f} ms), {:.1f} fps over {} frames",
+                     toString(m_framePacing), m_renderGraph.latency().endPoint(), stats.averageMs,
+                     stats.minMs, stats.maxMs, stats.framesPerSecond, stats.frames);
+        }
+
+        m_framePacing = m_requestedFramePacing;
+        m_framePacingSetting = static_cast<int>(m_framePacing);
+        m_dirtyFramePacing = false;
+
+        const FramePacingProfile profile = framePacingProfile(m_framePacing);
+        m_renderGraph.setFramesInFlight(profile.framesInFlight);
+        if (m_swapChain)
+        {
+            m_swapChain->setPreferredPresentModes({profile.presentModes[0], profile.presentModes[1]});
+            m_dirtySwapChain = true;
+        }
+
+        m_renderGraph.latency().reset();
+        LOG_INFO("Frame pacing '{}': {} frame(s) in flight", toString(m_framePacing), profile.framesInFlight);
+    }
+
+    void Engine::applyGpuDrivenDraws()
+    {
+        if (!m_gpuScene)
+            m_gpuDrivenDraws = false;
+
+        const Ref<GpuScene> scene = m_gpuDrivenDraws ? m_gpuScene : nullptr;
+        const bool occlusionCulling = m_gpuDrivenDraws && m_occlusionCulling;
+        if (m_geometryPass->gpuScene() == scene &&
+            (!m_drawCommandPass || m_drawCommandPass->occlusionCulling() == occlusionCulling))
+            return;
+
+        // The geometry pass declares different resources in each mode
+        if (m_geometryPass->gpuScene() != scene)
+            LOG_INFO("GPU-driven draws {}", m_gpuDrivenDraws ? "enabled" : "disabled");
+        m_geometryPass->setGpuScene(scene);
+        if (m_drawCommandPass)
+            m_drawCommandPass->setOcclusionCulling(occlusionCulling);
+
+        // The depth pyramid samples the viewport depth. Without it the depth
+        // never leaves the pass and goes back to the transient pool.
+        if (viewportTarget->setTransientDepth(occlusionCulling ? nullptr : &m_transientAttachments))
+        {
+            renderer().recreatePasses();
+            logRenderTargetMemory();
+        }
+        m_renderGraph.invalidate();
+    }
+
     void Engine::updateCameraUBO()
     {
         CameraUBO ubo{};
@@ -98,7 +212,39 @@ namespace vks
 
     void Engine::drawFrame()
     {
+        // Scene changes since the last frame, editor edits included
+        m_scene.spatial().sync();
+        if (m_gpuScene)
+            m_gpuScene->sync();
+        if (m_depthPyramid)
+            m_depthPyramid->sync();
+
+        // Models and textures created since the last frame; the batch is
+        // submitted ahead of the frame on the graphics queue
+        m_device.uploads().flush();
+
+        // Material edits since this slot's last frame, written to the slot's
+        // copy of each table once that frame has stopped reading it
+        m_renderGraph.waitForFrameSlot();
+        VkDeviceSize materialBytes = 0;
+        for (auto& [type, table] : m_materialTables)
+            materialBytes += table->flush(m_renderGraph.getCurrentFrameIndex());
+        m_materialUploadBytes = static_cast<int>(materialBytes);
+
         m_renderGraph.execute();
+
+        if (m_drawCommandPass)
+        {
+            const DrawCommandPass::CullStats& stats = m_drawCommandPass->stats();
+            m_drawnObjects = static_cast<int>(stats.drawn);
+            m_frustumCulledObjects = static_cast<int>(stats.frustumCulled);
+            m_occludedObjects = static_cast<int>(stats.occluded);
+        }
+    }
+
+    bool Engine::readbackFrame(std::vector<uint8_t>& pixels, uint64_t* frameNumber) const
+    {
+        return m_frameReadback && m_frameReadback->readLatest(pixels, frameNumber);
     }
 
     void Engine::onInit()
@@ -110,56 +256,112 @@ namespace vks
                                                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
                                            .build();
 
-        // "material" layout (Set 1) for material UBO
-        // Matches: layout(set = 1, binding = 0) uniform MaterialUBO
+        // "material" layout (Set 1) for the material parameter table
+        // Matches: layout(set = 1, binding = 0) readonly buffer MaterialTable,
+        // indexed with the material index push constant
         m_descriptorSetLayouts["material"] = vks::DescriptorSetLayout::Builder(m_device)
-                                             .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                             .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
                                                          VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_VERTEX_BIT)
                                              .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                                                          VK_SHADER_STAGE_FRAGMENT_BIT)
                                              .build();
 
-        // render target for ui pass
-        auto objectPickingTarget = std::make_shared<RenderTarget>(
-            device(),
-            renderer().getSwapChain()->extent(),
-            renderer().getSwapChain()->numImages(),
-            VK_FORMAT_R32_UINT,
-            VK_FORMAT_D32_SFLOAT,
-            VK_IMAGE_USAGE_TRANSFER_SRC_BIT
-        );
-
-        viewportTarget = std::make_shared<RenderTarget>(
-            device(),
-            renderer().getSwapChain()->extent(),
-            renderer().getSwapChain()->numImages(),
-            renderer().getSwapChain()->colorFormat(),
-            renderer().getSwapChain()->depthFormat(),
-            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
-        );
-
-        viewportRenderTargets.push_back(objectPickingTarget);
-        viewportRenderTargets.push_back(viewportTarget);
-
-        // Create passes
-        auto geometryPass = std::make_shared<GeometryPass>(
-            device(),
-            viewportTarget
-        );
-
-        auto imguiPass = std::make_shared<ImGuiRenderPass>(
-            device(),
-            renderer().getSwapChain()
-        );
-
-        auto uiPass = std::make_shared<UIPass>(
-            device(),
-            objectPickingTarget
-        );
-
-        registerRenderPass(geometryPass);
-        registerRenderPass(imguiPass);
-        registerRenderPass(uiPass);
+        // "instances" layout (Set 2) for the geometry pass's per-frame transforms
+        // and material indices
+        // Matches: layout(set = 2, binding = 0) readonly buffer InstanceBuffer
+        //          layout(set = 2, binding = 1) readonly buffer InstanceMaterials
+        m_descriptorSetLayouts["instances"] = vks::DescriptorSetLayout::Builder(m_device)
+                                              .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                          VK_SHADER_STAGE_VERTEX_BIT)
+                                              .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                          VK_SHADER_STAGE_VERTEX_BIT)
+                                              .build();
+
+        const VkExtent2D outputExtent = renderer().output()->extent();
+        Ref<UIPass> uiPass;
+        Ref<GeometryPass> geometryPass;
+
+        if (m_headless)
+        {
+            // The scene renders straight into the graph's output (imported by the
+            // graph itself); there is no editor, ImGui or picking to feed. Nothing
+            // emits resize events, so the target keeps its configured size.
+            viewportRenderTargets.push_back(viewportTarget);
+            logRenderTargetMemory();
+
+            geometryPass = std::make_shared<GeometryPass>(
+                device(),
+                viewportTarget
+            );
+
+            if (m_headlessReadback)
+            {
+                m_frameReadback = std::make_shared<FrameReadbackPass>(device(), viewportTarget);
+                registerRenderPass(m_frameReadback);
+            }
+        }
+        else
+        {
+            // render target for ui pass. Color only: the picking pass draws
+            // without a depth attachment.
+            auto objectPickingTarget = std::make_shared<RenderTarget>(
+                device(),
+                outputExtent,
+                renderer().output()->numImages(),
+                VK_FORMAT_R32_UINT,
+                VK_FORMAT_UNDEFINED,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                true
+            );
+
+            viewportTarget = std::make_shared<RenderTarget>(
+                device(),
+                outputExtent,
+                renderer().output()->numImages(),
+                renderer().output()->colorFormat(),
+                renderer().output()->depthFormat(),
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                true,
+                // Occlusion culling builds its depth pyramid from the depth
+                m_gpuDrivenDraws && m_occlusionCulling && m_device.supportsDrawIndirectCount()
+                    ? nullptr
+                    : &m_transientAttachments
+            );
+
+            viewportRenderTargets.push_back(objectPickingTarget);
+            viewportRenderTargets.push_back(viewportTarget);
+            logRenderTargetMemory();
+
+            // Create passes
+            geometryPass = std::make_shared<GeometryPass>(
+                device(),
+                viewportTarget
+            );
+
+            auto imguiPass = std::make_shared<ImGuiRenderPass>(
+                device(),
+                renderer().getSwapChain()
+            );
+
+            uiPass = std::make_shared<UIPass>(
+                device(),
+                objectPickingTarget
+            );
+
+            auto pickingReadbackPass = std::make_shared<PickingReadbackPass>(
+                objectPickingTarget,
+                uiPass->pixelBuffer()
+            );
+
+            // The viewport texture is sampled by ImGui with the frame index, the picking
+            // target is rendered and read back with the swapchain image index
+            m_renderGraph.importTarget(viewportTarget, ResourceIndexing::PerFrame);
+            m_renderGraph.importTarget(objectPickingTarget, ResourceIndexing::PerImage);
+
+            registerRenderPass(imguiPass);
+            registerRenderPass(uiPass);
+            registerRenderPass(pickingReadbackPass);
+        }
 
         // Create pipelines
 
@@ -176,7 +378,7 @@ namespace vks
         gridPipelineDesc.depthTest = true;
         gridPipelineDesc.depthWrite = true;
         gridPipelineDesc.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        gridPipelineDesc.viewportExtent = renderer().getSwapChain()->extent();
+        gridPipelineDesc.viewportExtent = outputExtent;
         gridPipelineDesc.dynamicStates.push_back(VK_DYNAMIC_STATE_LINE_WIDTH);
 
         // Sphere pipeline
@@ -190,7 +392,7 @@ namespace vks
         spherePipelineDesc.depthTest = true;
         spherePipelineDesc.depthWrite = true;
         spherePipelineDesc.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        spherePipelineDesc.viewportExtent = renderer().getSwapChain()->extent();
+        spherePipelineDesc.viewportExtent = outputExtent;
 
         // Sprite pipeline
         GraphicsPipelineDesc spritePipelineDesc{};
@@ -203,7 +405,7 @@ namespace vks
         spritePipelineDesc.depthTest = true;
         spritePipelineDesc.depthWrite = true;
         spritePipelineDesc.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        spritePipelineDesc.viewportExtent = renderer().getSwapChain()->extent();
+        spritePipelineDesc.viewportExtent = outputExtent;
 
         PipelineDesc gridPipelineDesc_{};
         gridPipelineDesc_.type = PipelineType::Graphics;
@@ -212,26 +414,21 @@ namespace vks
             m_descriptorSetLayouts["camera"]->getDescriptorSetLayout(),
             m_descriptorSetLayouts["material"]->getDescriptorSetLayout()
         };
-
-        PipelineDesc spherePipelineDesc_{gridPipelineDesc_};
-        spherePipelineDesc_.payload = spherePipelineDesc;
-        spherePipelineDesc_.pushConstants = {
+        gridPipelineDesc_.pushConstants = {
             VkPushConstantRange{
-                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
                 .offset = 0,
-                .size = sizeof(glm::mat4)
+                .size = sizeof(uint32_t) // material index (see Material::bind)
             }
         };
 
-        PipelineDesc spritePipelineDesc_{gridPipelineDesc_};
+        // Instanced: model matrices come from the instance buffer
+        PipelineDesc spherePipelineDesc_{gridPipelineDesc_};
+        spherePipelineDesc_.payload = spherePipelineDesc;
+        spherePipelineDesc_.setLayouts.push_back(m_descriptorSetLayouts["instances"]->getDescriptorSetLayout());
+
+        PipelineDesc spritePipelineDesc_{spherePipelineDesc_};
         spritePipelineDesc_.payload = spritePipelineDesc;
-        spritePipelineDesc_.pushConstants = {
-            VkPushConstantRange{
-                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-                .offset = 0,
-                .size = sizeof(glm::mat4)
-            }
-        };
 
         GraphicsPipelineDesc outlinePipelineDesc = spherePipelineDesc;
         outlinePipelineDesc.vertexShader = "assets/shaders/outline.vert.spv";
@@ -255,6 +452,34 @@ namespace vks
         geometryPass->pipelines().createOrReplace("sprite", spritePipelineDesc_);
         geometryPass->pipelines().createOrReplace("outline", outlinePipelineDesc_);
 
+        m_geometryPass = geometryPass;
+        if (m_device.supportsDrawIndirectCount())
+        {
+            // Both are culled by the graph while the geometry pass doesn't read their output
+            m_gpuScene = std::make_shared<GpuScene>(
+                m_device, m_scene,
+                [pass = geometryPass.get()](const Material& material) { return pass->drawsIndirect(material); });
+            m_depthPyramid = std::make_shared<DepthPyramid>(m_device, viewportTarget);
+            m_drawCommandPass = std::make_shared<DrawCommandPass>(m_device, m_gpuScene, m_depthPyramid);
+            geometryPass->setOcclusion(m_drawCommandPass, m_depthPyramid);
+
+            registerRenderPass(m_gpuScene);
+            registerRenderPass(m_drawCommandPass);
+        }
+        else if (m_gpuDrivenDraws)
+        {
+            LOG_WARN("GPU-driven draws need drawIndirectCount and drawIndirectFirstInstance; using CPU draws");
+        }
+        // Registered after the GPU scene's passes: it writes the late draw commands
+        // and counts after them, and the graph runs writers in registration order
+        registerRenderPass(geometryPass);
+        applyGpuDrivenDraws();
+
+        m_physicsSystem.onInit(2048, 0, glm::vec3{0.0f, 0.0f, -0.81f});
+
+        if (m_headless)
+            return;
+
         GraphicsPipelineDesc uiPipelineDesc{};
         uiPipelineDesc.renderPass = uiPass->handle();
         uiPipelineDesc.vertexShader = "assets/shaders/objectPicking.vert.spv";
@@ -262,10 +487,11 @@ namespace vks
         uiPipelineDesc.alphaBlending = false;
         uiPipelineDesc.cull = VK_CULL_MODE_NONE;
         uiPipelineDesc.depthCompare = VK_COMPARE_OP_LESS;
-        uiPipelineDesc.depthTest = true;
-        uiPipelineDesc.depthWrite = false; // Important for UI
+        // The render pass has no depth attachment
+        uiPipelineDesc.depthTest = false;
+        uiPipelineDesc.depthWrite = false;
         uiPipelineDesc.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        uiPipelineDesc.viewportExtent = renderer().getSwapChain()->extent();
+        uiPipelineDesc.viewportExtent = outputExtent;
 
         PipelineDesc uiPipelineDesc_{};
         uiPipelineDesc_.type = PipelineType::Graphics;
@@ -284,7 +510,6 @@ namespace vks
         uiPass->pipelines().createOrReplace("ObjectPicker", uiPipelineDesc_);
 
         m_editor.onInit();
-        m_physicsSystem.onInit(2048, 0, glm::vec3{0.0f, 0.0f, -0.81f});
     }
 
     void Engine::run(Application& app)
@@ -298,58 +523,106 @@ namespace vks
 
         bool enablePyhsics = true;
         DebugRegistry::get().add("Enable Physics", enablePyhsics);
+        // 0 balanced, 1 low latency, 2 throughput
+        DebugRegistry::get().add("Renderer/Frame Pacing", m_framePacingSetting);
+        // Labelled with the end point: present when the device can wait for it
+        DebugRegistry::get().add(m_renderGraph.latency().measuresPresent()
+                                     ? "Renderer/Input Latency to Present (ms)"
+                                     : "Renderer/Input Latency to GPU Completion (ms)",
+                                 m_inputLatencyMs);
+        DebugRegistry::get().add("Renderer/LOD Bias", m_lodBias);
+        DebugRegistry::get().add("Renderer/Dump Memory Stats", m_dumpMemoryStats);
+        DebugRegistry::get().add("Renderer/Material Upload (bytes)", m_materialUploadBytes);
+        if (m_gpuScene)
+        {
+            DebugRegistry::get().add("Renderer/GPU-Driven Draws", m_gpuDrivenDraws);
+            DebugRegistry::get().add("Renderer/Occlusion Culling", m_occlusionCulling);
+            DebugRegistry::get().add("Renderer/Drawn Objects", m_drawnObjects);
+            DebugRegistry::get().add("Renderer/Frustum Culled", m_frustumCulledObjects);
+            DebugRegistry::get().add("Renderer/Occlusion Culled", m_occludedObjects);
+        }
 
         m_window.setDrawFrameFunc([this, &app, &enablePyhsics](float dt)
         {
+            if (m_framePacingSetting != static_cast<int>(m_framePacing))
+                setFramePacing(static_cast<FramePacing>(std::clamp(m_framePacingSetting, 0, 2)));
+            applyGpuDrivenDraws();
+
+            if (m_dumpMemoryStats)
+            {
+                m_device.allocator().logStatistics();
+                m_device.allocator().dumpStatistics("vma_stats.json");
+                m_dumpMemoryStats = false;
+            }
+
             handleRecreate();
 
+            // Low latency: block on the GPU first, then sample input, so the
+            // sample isn't held back by the wait
+            if (framePacingProfile(m_framePacing).lateInputSampling)
+            {
+                m_renderGraph.waitForFrameSlot();
+                m_window.pollEvents();
+            }
+            m_renderGraph.latency().markInputSampled(m_renderGraph.frameNumber());
+            m_inputLatencyMs = static_cast<float>(m_renderGraph.latency().stats().averageMs);
+
             // App logic
             app.tick();
 
-            updateCameraUBO();
-
-            // UI
-            ImGui_ImplVulkan_NewFrame();
-            ImGui_ImplGlfw_NewFrame();
-            ImGui::NewFrame();
+            if (m_headless)
+            {
+                m_camera.update(dt, false);
+            }
+            else
+            {
+                // UI
+                ImGui_ImplVulkan_NewFrame();
+                ImGui_ImplGlfw_NewFrame();
+                ImGui::NewFrame();
 
-            auto flags = ImGuiDockNodeFlags_PassthruCentralNode;
-            ImGui::DockSpaceOverViewport(nullptr, flags);
+                auto flags = ImGuiDockNodeFlags_PassthruCentralNode;
+                ImGui::DockSpaceOverViewport(nullptr, flags);
 
-            m_editor.onGui();
+                m_editor.onGui();
 
-            app.onImGui();
+                app.onImGui();
 
-            m_camera.update(dt, m_editor.isViewportInputAllowed());
+                m_camera.update(dt, m_editor.isViewportInputAllowed());
 
-            ImGui::Render();
+                ImGui::Render();
+            }
 
-            // Render
+            // Render. The UBO follows this frame's camera update, which the
+            // culling passes read directly.
+            updateCameraUBO();
             drawFrame();
 
             if (enablePyhsics)
                 m_physicsSystem.update(scene(), dt, 1);
         });
 
+        if (m_headless)
+            m_window.setMaxFrames(m_headlessFrames);
+
         m_window.mainLoop();
         vkDeviceWaitIdle(m_device.logical());
     }
 
     void Engine::handleRecreate()
     {
-        bool needRecreate = false;
-        if (m_dirtySwapChain || m_dirtyViewport)
-        {
-            vkDeviceWaitIdle(m_device.logical());
-            needRecreate = true;
-        }
+        if (m_dirtyFramePacing)
+            applyFramePacing();
 
-        if (needRecreate)
+        // Replaced images, framebuffers and pipelines are retired through the
+        // device's deletion queue, so this doesn't wait for the GPU
+        if (m_dirtySwapChain || m_dirtyViewport)
         {
             for (auto& target : viewportRenderTargets)
                 target->resize(m_newViewportExtent);
             renderer().recreatePasses();
             m_dirtyViewport = false;
+            logRenderTargetMemory();
         }
 
         if (m_dirtySwapChain)
@@ -358,4 +631,23 @@ namespace vks
             m_dirtySwapChain = false;
         }
     }
+
+    void Engine::logRenderTargetMemory() const
+    {
+        VkDeviceSize requested = 0;
+        VkDeviceSize allocated = m_transientAttachments.allocatedBytes();
+        for (const auto& target : viewportRenderTargets)
+        {
+            requested += target->requestedBytes();
+            allocated += target->dedicatedBytes();
+        }
+
+        // Only the committed figures come from VMA; the unaliased total is the
+        // sum of the images' memory requirements, not a measured allocation
+        constexpr double MiB = 1024.0 * 1024.0;
+        LOG_INFO("Render target memory: {:.1f} MiB committed, {:.1f} MiB of it in {} transient block(s) "
+                 "(~{:.1f} MiB estimated without transient aliasing)",
+                 allocated / MiB, m_transientAttachments.allocatedBytes() / MiB,
+                 m_transientAttachments.blockCount(), requested / MiB);
+    }
 }
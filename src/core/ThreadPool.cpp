@@ -0,0 +1,74 @@
+#include <core/ThreadPool.hpp>
+
+#include <algorithm>
+
+namespace vks
+{
+    ThreadPool::ThreadPool(uint32_t workerCount)
+    {
+        if (workerCount == 0)
+        {
+            const uint32_t hwThreads = std::thread::hardware_concurrency();
+            workerCount = std::max(hwThreads, 2u) - 1;
+        }
+
+        m_workers.reserve(workerCount);
+        for (uint32_t i = 0; i < workerCount; i++)
+            m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_jobAvailable.notify_all();
+
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    void ThreadPool::submit(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_jobAvailable.notify_one();
+    }
+
+    void ThreadPool::wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_jobs.empty() && m_running == 0; });
+    }
+
+    void ThreadPool::workerLoop(uint32_t worker)
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+                if (m_stopping && m_jobs.empty())
+                    return;
+
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                m_running++;
+            }
+
+            job(worker);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running--;
+                if (m_jobs.empty() && m_running == 0)
+                    m_idle.notify_all();
+            }
+        }
+    }
+} // namespace vks
@@ -24,7 +24,7 @@ void EditorGizmo::onGui(ImVec2 imageScreenPos, ImVec2 imageSize)
     if (entities.size() != 1) return;
 
     auto& transform = m_engine.scene().getComponent<Transform>(*entities.begin());
-    glm::mat4 modelMatrix = transform.transform; if (m_snap) { static auto translationSnap = new float[3]{1.0f, 1.0f, 1.0f}; static auto rotationSnap = new float[3]{15.0f, 15.0f, 15.0f}; float* snapValue = nullptr; switch (m_operation) { case ImGuizmo::ROTATE: snapValue = rotationSnap; break; case ImGuizmo::TRANSLATE: case ImGuizmo::SCALE: snapValue = translationSnap; break; default: break; } ImGuizmo::Manipulate( glm::value_ptr(view), glm::value_ptr(proj), m_operation, m_mode, glm::value_ptr(modelMatrix), nullptr, snapValue ); } else { ImGuizmo::Manipulate( glm::value_ptr(view), glm::value_ptr(proj), m_operation, m_mode, glm::value_ptr(modelMatrix) ); } m_usingGizmo = ImGuizmo::IsUsing(); if (m_usingGizmo) writeBackTransform(transform, modelMatrix); } void EditorGizmo::handleShortcuts() { if (ImGui::IsKeyPressed(ImGuiKey_W)) m_operation = ImGuizmo::TRANSLATE; if (ImGui::IsKeyPressed(ImGuiKey_E)) m_operation = ImGuizmo::ROTATE; if (ImGui::IsKeyPressed(ImGuiKey_R)) m_operation = ImGuizmo::SCALE; if (ImGui::IsKeyPressed(ImGuiKey_Q)) m_mode = (m_mode == ImGuizmo::LOCAL) ? ImGuizmo::WORLD : ImGuizmo::LOCAL; if (ImGui::IsKeyDown(ImGuiKey_LeftShift))
+    glm::mat4 modelMatrix = transform.transform; if (m_snap) { static auto translationSnap = new float[3]{1.0f, 1.0f, 1.0f}; static auto rotationSnap = new float[3]{15.0f, 15.0f, 15.0f}; float* snapValue = nullptr; switch (m_operation) { case ImGuizmo::ROTATE: snapValue = rotationSnap; break; case ImGuizmo::TRANSLATE: case ImGuizmo::SCALE: snapValue = translationSnap; break; default: break; } ImGuizmo::Manipulate( glm::value_ptr(view), glm::value_ptr(proj), m_operation, m_mode, glm::value_ptr(modelMatrix), nullptr, snapValue ); } else { ImGuizmo::Manipulate( glm::value_ptr(view), glm::value_ptr(proj), m_operation, m_mode, glm::value_ptr(modelMatrix) ); } m_usingGizmo = ImGuizmo::IsUsing(); if (m_usingGizmo) { writeBackTransform(transform, modelMatrix); m_engine.scene().patch<Transform>(*entities.begin()); } } void EditorGizmo::handleShortcuts() { if (ImGui::IsKeyPressed(ImGuiKey_W)) m_operation = ImGuizmo::TRANSLATE; if (ImGui::IsKeyPressed(ImGuiKey_E)) m_operation = ImGuizmo::ROTATE; if (ImGui::IsKeyPressed(ImGuiKey_R)) m_operation = ImGuizmo::SCALE; if (ImGui::IsKeyPressed(ImGuiKey_Q)) m_mode = (m_mode == ImGuizmo::LOCAL) ? ImGuizmo::WORLD : ImGuizmo::LOCAL; if (ImGui::IsKeyDown(ImGuiKey_LeftShift))
         m_snap = true;
     else if (m_snap)
         m_snap = false; // Disable snap when shift is released
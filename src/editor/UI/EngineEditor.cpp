@@ -8,6 +8,7 @@
 #include <editor/UI/SceneHierarchyPanel.hpp>
 #include <editor/UI/ViewportPanel.hpp>
 #include <editor/UI/DebugPanel.hpp>
+#include <editor/UI/GpuProfilerPanel.hpp>
 
 namespace vks
 {
@@ -23,6 +24,7 @@ namespace vks
         addPanel<InspectorPanel>();
         addPanel<ViewportPanel>();
         addPanel<DebugPanel>();
+        addPanel<GpuProfilerPanel>();
 
         resourceManager = std::make_shared<EditorResourceManager>(m_engine.device());
     }
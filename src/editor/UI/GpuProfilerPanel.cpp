@@ -0,0 +1,66 @@
+#include <editor/UI/GpuProfilerPanel.hpp>
+#include <imgui.h>
+
+#include <app/Engine.hpp>
+
+namespace vks
+{
+    void GpuProfilerPanel::onGui()
+    {
+        if (!isOpen) return;
+
+        ImGui::Begin(getTitle(), &isOpen);
+
+        auto& profiler = m_engine.renderer().profiler();
+
+        bool enabled = profiler.enabled();
+        if (ImGui::Checkbox("Enabled", &enabled))
+            profiler.setEnabled(enabled);
+
+        const auto& timings = profiler.timings();
+        if (timings.empty())
+        {
+            ImGui::TextDisabled("No GPU timings (timestamps unsupported or profiler disabled).");
+            ImGui::End();
+            return;
+        }
+
+        ImGui::Text("GPU frame: %.3f ms", profiler.frameMs());
+        ImGui::TextDisabled("Rolling window: %u frames", GpuProfiler::HISTORY_FRAMES);
+
+        const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+            ImGuiTableFlags_SizingStretchProp;
+        if (ImGui::BeginTable("##gpuTimings", 5, flags))
+        {
+            ImGui::TableSetupColumn("Pass");
+            ImGui::TableSetupColumn("Last (ms)");
+            ImGui::TableSetupColumn("Avg (ms)");
+            ImGui::TableSetupColumn("Min (ms)");
+            ImGui::TableSetupColumn("Max (ms)");
+            ImGui::TableHeadersRow();
+
+            for (const auto& timing : timings)
+            {
+                ImGui::TableNextRow();
+
+                ImGui::TableSetColumnIndex(0);
+                // Indent(0) would use the default width
+                if (timing.depth > 0) ImGui::Indent(12.f * timing.depth);
+                ImGui::TextUnformatted(timing.name.c_str());
+                if (timing.depth > 0) ImGui::Unindent(12.f * timing.depth);
+
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.3f", timing.lastMs);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.3f", timing.averageMs);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.3f", timing.minMs);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%.3f", timing.maxMs);
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+    }
+}
@@ -12,71 +12,40 @@ Buffer::Buffer(
     VkMemoryPropertyFlags memoryPropertyFlags)
     : m_device(device), m_bufferSize(size)
 {
-    // 1. Create the VkBuffer handle
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = m_bufferSize;
     bufferInfo.usage = usageFlags;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // Or CONCURRENT if needed
 
-    if (vkCreateBuffer(m_device.logical(), &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS) {
+    // Creates the buffer, sub-allocates memory for it and binds the two
+    const VmaAllocationCreateInfo allocInfo = MemoryAllocator::bufferAllocationInfo(usageFlags, memoryPropertyFlags);
+    VmaAllocationInfo allocation{};
+    if (vmaCreateBuffer(m_device.allocator().handle(), &bufferInfo, &allocInfo, &m_buffer, &m_allocation,
+                        &allocation) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create VkBuffer!");
     }
 
-    // 2. Get the memory requirements for this buffer
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(m_device.logical(), m_buffer, &memRequirements);
-
-    // 3. Allocate the VkDeviceMemory
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, memoryPropertyFlags);
-
-    if (vkAllocateMemory(m_device.logical(), &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate buffer memory!");
-    }
-
-    // 4. Bind the memory to the buffer
-    if (vkBindBufferMemory(m_device.logical(), m_buffer, m_memory, 0) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to bind buffer memory!");
-    }
+    m_persistent = allocation.pMappedData;
 }
 
 Buffer::~Buffer() {
-    // Unmap if it's still mapped
-    if (m_mapped) {
-        unmap();
-    }
-    // These calls are safe even if the handles are VK_NULL_HANDLE
-    vkDestroyBuffer(m_device.logical(), m_buffer, nullptr);
-    vkFreeMemory(m_device.logical(), m_memory, nullptr);
-}
-
-uint32_t Buffer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_device.physical(), &memProperties);
-
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        // Check if the memory type's bit is set in the typeFilter
-        if ((typeFilter & (1 << i)) &&
-            // Check if all required property flags are set for this memory type
-            (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("Failed to find suitable memory type!");
+    // Frees the memory too, unmapping it if it was mapped
+    vmaDestroyBuffer(m_device.allocator().handle(), m_buffer, m_allocation);
 }
 
 VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset) {
     assert(!m_mapped && "Buffer is already mapped!");
-    return vkMapMemory(m_device.logical(), m_memory, offset, size, 0, &m_mapped);
+    if (!m_persistent) {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+
+    m_mapped = static_cast<char*>(m_persistent) + offset;
+    return VK_SUCCESS;
 }
 
 void Buffer::unmap() {
     assert(m_mapped && "Buffer is not mapped!");
-    vkUnmapMemory(m_device.logical(), m_memory);
     m_mapped = nullptr;
 }
 
@@ -92,7 +61,7 @@ void Buffer::writeToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset) {
     memcpy(mem_offset, data, (size_t)size);
 }
 
-VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize size, VkDeviceSize offset) {
+VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize size, VkDeviceSize offset) const {
     return VkDescriptorBufferInfo{
         m_buffer,
         offset,
@@ -9,12 +9,12 @@
 using namespace vks;
 
 CommandBuffers::CommandBuffers(const Device &device,
-                               const Ref<SwapChain> &swapChain,
+                               const Ref<IRenderTarget> &target,
                                const CommandPool &commandPool)
-    : m_device(device), m_swapChain(swapChain),
+    : m_device(device), m_target(target),
       m_commandPool(commandPool)
 {
-    createCommandBuffers(swapChain->numImages());
+    createCommandBuffers(target->numImages());
 }
 
 CommandBuffers::~CommandBuffers() { destroyCommandBuffers(); }
@@ -110,6 +110,6 @@ void CommandBuffers::stopRecording(uint32_t index)
 
 void CommandBuffers::recreate() {
     destroyCommandBuffers();
-    createCommandBuffers(m_swapChain->numImages());
+    createCommandBuffers(m_target->numImages());
 }
 
@@ -7,11 +7,16 @@ using namespace vks;
 
 CommandPool::CommandPool(const Device &device,
                          const VkCommandPoolCreateFlags &flags)
+    : CommandPool(device, flags,
+                  device.queueFamilyIndices().graphicsFamily.value()) {}
+
+CommandPool::CommandPool(const Device &device,
+                         const VkCommandPoolCreateFlags &flags,
+                         uint32_t queueFamily)
     : m_device(device), m_flags(flags) {
   VkCommandPoolCreateInfo poolInfo = {};
   poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-  poolInfo.queueFamilyIndex =
-      m_device.queueFamilyIndices().graphicsFamily.value();
+  poolInfo.queueFamilyIndex = queueFamily;
   poolInfo.flags = flags;
 
   if (vkCreateCommandPool(m_device.logical(), &poolInfo, nullptr, &m_pool) !=
@@ -0,0 +1,53 @@
+#include <gfx/DeletionQueue.hpp>
+
+#include <vector>
+
+using namespace vks;
+
+DeletionQueue::~DeletionQueue() { flush(); }
+
+void DeletionQueue::push(Deleter &&deleter) {
+  std::lock_guard lock(m_mutex);
+  m_entries.push_back({m_frame, std::move(deleter)});
+}
+
+void DeletionQueue::collect(uint64_t completedFrame) {
+  // Deleters run outside the lock; they may retire further objects
+  std::vector<Deleter> ready;
+  {
+    std::lock_guard lock(m_mutex);
+    while (!m_entries.empty() && m_entries.front().frame <= completedFrame) {
+      ready.push_back(std::move(m_entries.front().deleter));
+      m_entries.pop_front();
+    }
+  }
+
+  for (auto &deleter : ready)
+    deleter();
+}
+
+void DeletionQueue::flush() {
+  std::deque<Entry> entries;
+  {
+    std::lock_guard lock(m_mutex);
+    entries.swap(m_entries);
+  }
+
+  for (auto &entry : entries)
+    entry.deleter();
+}
+
+void DeletionQueue::setFrame(uint64_t frame) {
+  std::lock_guard lock(m_mutex);
+  m_frame = frame;
+}
+
+uint64_t DeletionQueue::frame() const {
+  std::lock_guard lock(m_mutex);
+  return m_frame;
+}
+
+size_t DeletionQueue::pending() const {
+  std::lock_guard lock(m_mutex);
+  return m_entries.size();
+}
@@ -2,10 +2,12 @@
 #include <gfx/Instance.hpp>
 #include <gfx/SwapChain.hpp>
 #include <gfx/QueueFamily.hpp>
-#include <gfx/CommandBuffers.hpp>
+#include <gfx/UploadManager.hpp>
 
 #include <platform/Window.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <set>
 #include <stdexcept>
 #include <vector>
@@ -19,7 +21,8 @@ Device::Device(const Instance& instance, const Window& window,
                const std::vector<const char*>& extensions)
     : m_physical(VK_NULL_HANDLE), m_logical(VK_NULL_HANDLE), m_window(window),
       m_instance(instance), m_graphicsQueue(VK_NULL_HANDLE),
-      m_presentQueue(VK_NULL_HANDLE)
+      m_presentQueue(VK_NULL_HANDLE), m_computeQueue(VK_NULL_HANDLE),
+      m_transferQueue(VK_NULL_HANDLE)
 {
     m_physical =
         PickPhysicalDevice(m_instance.handle(), m_window.surface(), extensions);
@@ -30,6 +33,10 @@ Device::Device(const Instance& instance, const Window& window,
         m_indices.graphicsFamily.value(),
         m_indices.presentFamily.value()
     };
+    if (m_indices.computeFamily.has_value())
+        uniqueQueueFamilies.insert(m_indices.computeFamily.value());
+    if (m_indices.transferFamily.has_value())
+        uniqueQueueFamilies.insert(m_indices.transferFamily.value());
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
     float priority = 1.0f;
@@ -43,13 +50,75 @@ Device::Device(const Instance& instance, const Window& window,
         queueCreateInfos.push_back(createInfo);
     }
 
+    // Optional features, enabled when present
+    VkPhysicalDeviceVulkan12Features supported12 = {};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supported = {};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supported.pNext = &supported12;
+
+    // Present wait: lets the latency tracker end its measurement at present
+    // instead of GPU completion. Only with a swapchain.
+    const std::vector<const char*> presentWaitExtensions = {
+        VK_KHR_PRESENT_ID_EXTENSION_NAME, VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+    };
+    const bool presentWaitExtensionsSupported =
+        std::find_if(extensions.begin(), extensions.end(), [](const char* name)
+        {
+            return std::strcmp(name, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0;
+        }) != extensions.end() &&
+        CheckDeviceExtensionSupport(m_physical, presentWaitExtensions);
+
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId = {};
+    supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait = {};
+    supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (presentWaitExtensionsSupported)
+    {
+        supported12.pNext = &supportedPresentId;
+        supportedPresentId.pNext = &supportedPresentWait;
+    }
+    vkGetPhysicalDeviceFeatures2(m_physical, &supported);
+
+    m_presentWait = presentWaitExtensionsSupported &&
+        supportedPresentId.presentId == VK_TRUE &&
+        supportedPresentWait.presentWait == VK_TRUE;
+
+    // GPU-driven draws: instance indices carry object slots, counts come from a buffer
+    m_drawIndirectCount = supported.features.drawIndirectFirstInstance == VK_TRUE &&
+        supported12.drawIndirectCount == VK_TRUE;
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.wideLines = VK_TRUE;
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.drawIndirectFirstInstance = m_drawIndirectCount ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    vulkan12Features.hostQueryReset = VK_TRUE; // GpuProfiler
+    vulkan12Features.drawIndirectCount = m_drawIndirectCount ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.presentId = VK_TRUE;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = VK_TRUE;
+    presentIdFeatures.pNext = &presentWaitFeatures;
+
+    std::vector<const char*> enabledExtensions = extensions;
+    if (m_presentWait)
+    {
+        vulkan12Features.pNext = &presentIdFeatures;
+        enabledExtensions.insert(enabledExtensions.end(),
+                                 presentWaitExtensions.begin(), presentWaitExtensions.end());
+    }
 
     // Setup logical device
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &vulkan12Features;
 
     createInfo.queueCreateInfoCount =
         static_cast<uint32_t>(queueCreateInfos.size());
@@ -57,8 +126,8 @@ Device::Device(const Instance& instance, const Window& window,
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-    createInfo.ppEnabledExtensionNames = extensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     if (m_instance.validationLayersEnabled())
     {
@@ -82,11 +151,25 @@ Device::Device(const Instance& instance, const Window& window,
                      &m_graphicsQueue);
     vkGetDeviceQueue(m_logical, m_indices.presentFamily.value(), 0,
                      &m_presentQueue);
+    vkGetDeviceQueue(m_logical, computeFamily(), 0, &m_computeQueue);
+    vkGetDeviceQueue(m_logical, transferFamily(), 0, &m_transferQueue);
 
     vkGetPhysicalDeviceProperties(m_physical, &m_properties);
+
+    m_allocator = std::make_unique<MemoryAllocator>(m_instance.handle(), m_physical, m_logical);
+    m_uploads = std::make_unique<UploadManager>(*this);
 }
 
-Device::~Device() { vkDestroyDevice(m_logical, nullptr); }
+Device::~Device()
+{
+    // Anything still retired is destroyed before the device goes away
+    vkDeviceWaitIdle(m_logical);
+    m_deletionQueue.flush();
+
+    m_uploads.reset();
+    m_allocator.reset();
+    vkDestroyDevice(m_logical, nullptr);
+}
 
 uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
 {
@@ -157,7 +240,7 @@ VkPhysicalDevice Device::PickPhysicalDevice(
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     for (const auto& device : devices)
     {
-        if (IsDeviceSuitable(device, surface))
+        if (IsDeviceSuitable(device, surface, requiredExtensions))
         {
             physicalDevice = device;
             break;
@@ -173,15 +256,17 @@ VkPhysicalDevice Device::PickPhysicalDevice(
 }
 
 bool Device::IsDeviceSuitable(const VkPhysicalDevice& device,
-                              const VkSurfaceKHR& surface)
+                              const VkSurfaceKHR& surface,
+                              const std::vector<const char*>& requiredExtensions)
 {
     QueueFamilyIndices indices = QueueFamily::FindQueueFamilies(device, surface);
 
     bool extensionsSupported =
-        CheckDeviceExtensionSupport(device, Instance::DeviceExtensions);
+        CheckDeviceExtensionSupport(device, requiredExtensions);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported)
+    // Headless devices have no surface to present to
+    bool swapChainAdequate = surface == VK_NULL_HANDLE;
+    if (extensionsSupported && !swapChainAdequate)
     {
         SwapChainSupportDetails swapChainSupport =
             SwapChain::QuerySwapChainSupport(device, surface);
@@ -189,54 +274,83 @@ bool Device::IsDeviceSuitable(const VkPhysicalDevice& device,
             !swapChainSupport.presentModes.empty();
     }
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate;
+    // Frame synchronization is built on timeline semaphores, the GPU profiler
+    // resets its queries from the host
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+
+    bool timelineSupported = false;
+    if (properties.apiVersion >= VK_API_VERSION_1_2)
+    {
+        vkGetPhysicalDeviceFeatures2(device, &features);
+        timelineSupported = vulkan12Features.timelineSemaphore == VK_TRUE &&
+            vulkan12Features.hostQueryReset == VK_TRUE;
+    }
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && timelineSupported;
 }
 
-void vks::Device::createImage(
+namespace
+{
+    VkImageCreateInfo imageCreateInfo(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+                                      VkImageTiling tiling, VkImageUsageFlags usage)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = width;
+        imageInfo.extent.height = height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = tiling;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        return imageInfo;
+    }
+} // namespace
+
+VkImage vks::Device::createImage(
     uint32_t width,
     uint32_t height,
     uint32_t mipLevels,
     VkFormat format,
     VkImageTiling tiling,
-    VkImageUsageFlags usage,
-    VkMemoryPropertyFlags properties,
-    VkImage& image,
-    VkDeviceMemory& imageMemory
+    VkImageUsageFlags usage
 ) const
 {
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = width;
-    imageInfo.extent.height = height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = mipLevels;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = format;
-    imageInfo.tiling = tiling;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = usage;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    const VkImageCreateInfo imageInfo = imageCreateInfo(width, height, mipLevels, format, tiling, usage);
 
+    VkImage image;
     if (vkCreateImage(logical(), &imageInfo, nullptr, &image) != VK_SUCCESS)
         throw std::runtime_error("Failed to create image");
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(logical(), image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        memRequirements.memoryTypeBits,
-        properties
-    );
-
-    if (vkAllocateMemory(logical(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate image memory");
+    return image;
+}
 
-    vkBindImageMemory(logical(), image, imageMemory, 0);
+void vks::Device::createImage(
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipLevels,
+    VkFormat format,
+    VkImageTiling tiling,
+    VkImageUsageFlags usage,
+    VkMemoryPropertyFlags properties,
+    VkImage& image,
+    VmaAllocation& allocation
+) const
+{
+    const VkImageCreateInfo imageInfo = imageCreateInfo(width, height, mipLevels, format, tiling, usage);
+    image = m_allocator->createImage(imageInfo, properties, allocation);
 }
 
 VkImageView vks::Device::createImageView(
@@ -265,100 +379,6 @@ VkImageView vks::Device::createImageView(
     return imageView;
 }
 
-void vks::Device::transitionImageLayout(
-    VkImage image,
-    VkFormat format,
-    VkImageLayout oldLayout,
-    VkImageLayout newLayout,
-    uint32_t mipLevels
-) const
-{
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED &&
-        newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-        newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-    {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else
-    {
-        throw std::runtime_error("Unsupported image layout transition");
-    }
-
-    CommandBuffers::SingleTimeCommands(*this, [&](const VkCommandBuffer& cmd)
-    {
-        vkCmdPipelineBarrier(
-            cmd,
-            sourceStage, destinationStage,
-            0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier
-        );
-    });
-}
-
-void vks::Device::copyBufferToImage(
-    VkBuffer buffer,
-    VkImage image,
-    uint32_t width,
-    uint32_t height
-) const
-{
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
-
-    CommandBuffers::SingleTimeCommands(*this, [&](const VkCommandBuffer& cmd)
-    {
-        vkCmdCopyBufferToImage(
-            cmd,
-            buffer,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region
-        );
-    });
-}
-
 void Device::copyImageToBuffer(VkCommandBuffer cmd, VkImage srcImage, VkImageLayout srcImageLayout, VkBuffer dstBuffer,
     VkExtent2D imageExtent) const
 {
@@ -463,8 +483,8 @@ void Device::copyImageRegionToBuffer(VkCommandBuffer cmd, VkImage srcImage, VkIm
 }
 
 
-void Device::generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t width, uint32_t height,
-                             uint32_t mipLevels) const
+void Device::generateMipmaps(VkCommandBuffer cmd, VkImage image, VkFormat imageFormat, uint32_t width,
+                             uint32_t height, uint32_t mipLevels) const
 {
     // Check format support
     VkFormatProperties props;
@@ -491,80 +511,57 @@ void Device::generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t width
     int32_t mipWidth = width;
     int32_t mipHeight = height;
 
-    CommandBuffers::SingleTimeCommands(*this, [&](const VkCommandBuffer& cmd)
+    for (uint32_t i = 1; i < mipLevels; i++)
     {
-        for (uint32_t i = 1; i < mipLevels; i++)
-        {
-            // Transition previous level to SRC
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-            vkCmdPipelineBarrier(
-                cmd,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier
-            );
-
-            // Blit
-            VkImageBlit blit{};
-            blit.srcOffsets[0] = {0, 0, 0};
-            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel = i - 1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount = 1;
-
-            blit.dstOffsets[0] = {0, 0, 0};
-            blit.dstOffsets[1] = {
-                mipWidth > 1 ? mipWidth / 2 : 1,
-                mipHeight > 1 ? mipHeight / 2 : 1,
-                1
-            };
-            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount = 1;
-
-            vkCmdBlitImage(
-                cmd,
-                image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1, &blit,
-                VK_FILTER_LINEAR
-            );
-
-            // Transition previous level to SHADER_READ
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            vkCmdPipelineBarrier(
-                cmd,
-                VK_PIPELINE_STAGE_TRANSFER_BIT,
-                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier
-            );
-
-            mipWidth = std::max(mipWidth / 2, 1);
-            mipHeight = std::max(mipHeight / 2, 1);
-        }
-
-        // Transition last mip level
-        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        // Transition previous level to SRC
+        barrier.subresourceRange.baseMipLevel = i - 1;
         barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            cmd,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+
+        // Blit
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = i - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {
+            mipWidth > 1 ? mipWidth / 2 : 1,
+            mipHeight > 1 ? mipHeight / 2 : 1,
+            1
+        };
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = i;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(
+            cmd,
+            image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &blit,
+            VK_FILTER_LINEAR
+        );
+
+        // Transition previous level to SHADER_READ
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
         vkCmdPipelineBarrier(
@@ -576,5 +573,25 @@ void Device::generateMipmaps(VkImage image, VkFormat imageFormat, uint32_t width
             0, nullptr,
             1, &barrier
         );
-    });
+
+        mipWidth = std::max(mipWidth / 2, 1);
+        mipHeight = std::max(mipHeight / 2, 1);
+    }
+
+    // Transition last mip level
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(
+        cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier
+    );
 }
@@ -0,0 +1,39 @@
+#include <gfx/DirtyRangeSet.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace vks
+{
+    void DirtyRangeSet::add(size_t offset, size_t size)
+    {
+        if (size == 0)
+            return;
+
+        size_t begin = offset;
+        size_t end = offset + size;
+
+        // Absorb the range before, if it reaches 'begin', and every range
+        // starting at or before 'end'
+        auto it = m_ranges.upper_bound(begin);
+        if (it != m_ranges.begin() && std::prev(it)->second >= begin)
+            --it;
+
+        while (it != m_ranges.end() && it->first <= end)
+        {
+            begin = std::min(begin, it->first);
+            end = std::max(end, it->second);
+            m_bytes -= it->second - it->first;
+            it = m_ranges.erase(it);
+        }
+
+        m_ranges.emplace(begin, end);
+        m_bytes += end - begin;
+    }
+
+    void DirtyRangeSet::clear()
+    {
+        m_ranges.clear();
+        m_bytes = 0;
+    }
+} // namespace vks
@@ -0,0 +1,65 @@
+#include <gfx/FreeListAllocator.hpp>
+
+#include <cassert>
+
+namespace vks
+{
+    FreeListAllocator::FreeListAllocator(uint32_t capacity)
+        : m_capacity(capacity)
+    {
+        if (capacity > 0)
+            m_free.emplace(0, capacity);
+    }
+
+    std::optional<uint32_t> FreeListAllocator::allocate(uint32_t size)
+    {
+        if (size == 0)
+            return std::nullopt;
+
+        auto best = m_free.end();
+        for (auto it = m_free.begin(); it != m_free.end(); ++it)
+        {
+            if (it->second >= size && (best == m_free.end() || it->second < best->second))
+                best = it;
+        }
+        if (best == m_free.end())
+            return std::nullopt;
+
+        // Taken from the front of the block; the rest stays free
+        const auto [offset, blockSize] = *best;
+        m_free.erase(best);
+        if (blockSize > size)
+            m_free.emplace(offset + size, blockSize - size);
+
+        m_used += size;
+        return offset;
+    }
+
+    void FreeListAllocator::free(uint32_t offset, uint32_t size)
+    {
+        assert(size <= m_used && offset + size <= m_capacity);
+        m_used -= size;
+
+        // Merge with the free blocks right after and right before the range
+        auto next = m_free.lower_bound(offset);
+        assert(next == m_free.end() || offset + size <= next->first);
+        if (next != m_free.end() && next->first == offset + size)
+        {
+            size += next->second;
+            next = m_free.erase(next);
+        }
+
+        if (next != m_free.begin())
+        {
+            auto previous = std::prev(next);
+            assert(previous->first + previous->second <= offset);
+            if (previous->first + previous->second == offset)
+            {
+                previous->second += size;
+                return;
+            }
+        }
+
+        m_free.emplace_hint(next, offset, size);
+    }
+} // namespace vks
@@ -11,9 +11,10 @@ const std::vector<const char *> Instance::ValidationLayers = {
     "VK_LAYER_KHRONOS_validation"};
 const std::vector<const char *> Instance::DeviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+const std::vector<const char *> Instance::HeadlessDeviceExtensions = {};
 
 Instance::Instance(const char *appName, const char *engineName,
-                   bool validationLayers)
+                   bool validationLayers, bool headless)
     : m_instance(VK_NULL_HANDLE), m_enableValidationLayers(validationLayers) {
   if (validationLayers && !CheckValidationLayerSupport()) {
     throw std::runtime_error("validation layers requested, but not available!");
@@ -25,14 +26,15 @@ Instance::Instance(const char *appName, const char *engineName,
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = engineName;
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // 1.2 for core timeline semaphores (frame scheduling in SyncObjects)
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
   createInfo.pApplicationInfo = &appInfo;
 
   std::vector<const char *> extensions;
-  GetRequiredExtensions(extensions, validationLayers);
+  GetRequiredExtensions(extensions, validationLayers, headless);
   createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
   createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -83,8 +85,11 @@ bool Instance::CheckValidationLayerSupport() {
 }
 
 void Instance::GetRequiredExtensions(std::vector<const char *> &extensions,
-                                     bool validationLayers) {
-  Window::GetRequiredExtensions(extensions);
+                                     bool validationLayers, bool headless) {
+  // Headless runs may not have a display (or an initialized GLFW) at all
+  if (!headless) {
+    Window::GetRequiredExtensions(extensions);
+  }
 
   if (validationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
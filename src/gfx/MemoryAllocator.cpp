@@ -0,0 +1,123 @@
+#define VMA_IMPLEMENTATION
+#include <gfx/MemoryAllocator.hpp>
+
+#include <fstream>
+#include <stdexcept>
+
+#include <core/Log.hpp>
+
+namespace vks
+{
+    MemoryAllocator::MemoryAllocator(VkInstance instance, VkPhysicalDevice physical, VkDevice device)
+    {
+        VmaAllocatorCreateInfo createInfo{};
+        createInfo.vulkanApiVersion = VK_API_VERSION_1_2;
+        createInfo.instance = instance;
+        createInfo.physicalDevice = physical;
+        createInfo.device = device;
+
+        if (vmaCreateAllocator(&createInfo, &m_allocator) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create memory allocator");
+    }
+
+    MemoryAllocator::~MemoryAllocator()
+    {
+        vmaDestroyAllocator(m_allocator);
+    }
+
+    VmaAllocationCreateInfo MemoryAllocator::bufferAllocationInfo(VkBufferUsageFlags usage,
+                                                                  VkMemoryPropertyFlags properties)
+    {
+        VmaAllocationCreateInfo info{};
+        info.requiredFlags = properties;
+
+        if (!(properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+        {
+            info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+            return info;
+        }
+
+        // Mapped once here and unmapped when freed; Buffer::map() only hands out the pointer
+        info.usage = VMA_MEMORY_USAGE_AUTO;
+        info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        // The GPU copies into readback buffers and the CPU reads them, which is
+        // slow from write-combined memory
+        const bool readback = usage == VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        info.flags |= readback ? VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+                               : VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        return info;
+    }
+
+    VkImage MemoryAllocator::createImage(const VkImageCreateInfo& info, VkMemoryPropertyFlags properties,
+                                         VmaAllocation& allocation) const
+    {
+        VmaAllocationCreateInfo allocationInfo{};
+        allocationInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        allocationInfo.requiredFlags = properties;
+
+        // Attachments are large and replaced on every resize; sharing a block with
+        // them would leave holes that long-lived resources can't fill
+        constexpr VkImageUsageFlags attachment =
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (info.usage & attachment)
+            allocationInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+        VkImage image;
+        if (vmaCreateImage(m_allocator, &info, &allocationInfo, &image, &allocation, nullptr) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create image");
+
+        return image;
+    }
+
+    void MemoryAllocator::destroyImage(VkImage image, VmaAllocation allocation) const
+    {
+        vmaDestroyImage(m_allocator, image, allocation);
+    }
+
+    void MemoryAllocator::logStatistics() const
+    {
+        const VkPhysicalDeviceMemoryProperties* memory;
+        vmaGetMemoryProperties(m_allocator, &memory);
+
+        VmaTotalStatistics stats;
+        vmaCalculateStatistics(m_allocator, &stats);
+
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets(m_allocator, budgets);
+
+        constexpr double MiB = 1024.0 * 1024.0;
+        const VmaStatistics& total = stats.total.statistics;
+        LOG_INFO("GPU memory: {} allocations in {} blocks, {:.1f} of {:.1f} MiB used",
+                 total.allocationCount, total.blockCount, total.allocationBytes / MiB, total.blockBytes / MiB);
+
+        for (uint32_t heap = 0; heap < memory->memoryHeapCount; ++heap)
+        {
+            const VmaStatistics& heapStats = stats.memoryHeap[heap].statistics;
+            if (heapStats.blockCount == 0)
+                continue;
+
+            const bool deviceLocal = memory->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+            LOG_INFO("  heap {} ({}): {} allocations in {} blocks, {:.1f} of {:.1f} MiB used, budget {:.1f} MiB",
+                     heap, deviceLocal ? "device" : "host", heapStats.allocationCount, heapStats.blockCount,
+                     heapStats.allocationBytes / MiB, heapStats.blockBytes / MiB, budgets[heap].budget / MiB);
+        }
+    }
+
+    void MemoryAllocator::dumpStatistics(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            LOG_WARN("Couldn't write memory statistics to {}", path);
+            return;
+        }
+
+        char* json = nullptr;
+        vmaBuildStatsString(m_allocator, &json, VK_TRUE);
+        file << json;
+        vmaFreeStatsString(m_allocator, json);
+
+        LOG_INFO("Memory statistics written to {}", path);
+    }
+} // namespace vks
@@ -28,14 +28,40 @@ QueueFamily::FindQueueFamilies(const VkPhysicalDevice &device,
     }
 
     // Check for surface presentation support
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-    if (presentSupport) {
-      indices.presentFamily = i;
+    if (surface == VK_NULL_HANDLE) {
+      // Headless: nothing is presented, the graphics family stands in
+      indices.presentFamily = indices.graphicsFamily;
+    } else {
+      VkBool32 presentSupport = false;
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+      if (presentSupport) {
+        indices.presentFamily = i;
+      }
     }
 
     found = indices.isComplete();
   }
 
+  // A family that can't do graphics runs on separate hardware queues on most
+  // desktop GPUs, which is what lets compute overlap rasterization
+  for (int i = 0; i < families.size(); ++i) {
+    const auto &flags = families[i].queueFlags;
+    if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+      indices.computeFamily = i;
+      break;
+    }
+  }
+
+  // Likewise, copies on a family with neither graphics nor compute go through
+  // the DMA engine and don't take time from rendering
+  for (int i = 0; i < families.size(); ++i) {
+    const auto &flags = families[i].queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      indices.transferFamily = i;
+      break;
+    }
+  }
+
   return indices;
 }
@@ -0,0 +1,39 @@
+#include <gfx/RingAllocator.hpp>
+
+#include <algorithm>
+
+namespace vks
+{
+    RingAllocator::RingAllocator(VkDeviceSize capacity, VkDeviceSize alignment)
+        : m_capacity(capacity), m_alignment(alignment)
+    {
+    }
+
+    std::optional<VkDeviceSize> RingAllocator::allocate(VkDeviceSize size)
+    {
+        size = (size + m_alignment - 1) / m_alignment * m_alignment;
+        if (size > m_capacity)
+            return std::nullopt;
+
+        // Skip to the start when the range would run past the end
+        const VkDeviceSize offset = m_head % m_capacity;
+        const VkDeviceSize skip = offset + size > m_capacity ? m_capacity - offset : 0;
+
+        // With nothing in use the skipped space is free too
+        if (m_head == m_tail)
+            m_tail += skip;
+
+        if (m_head + skip + size - m_tail > m_capacity)
+            return std::nullopt;
+
+        m_head += skip;
+        const VkDeviceSize start = m_head % m_capacity;
+        m_head += size;
+        return start;
+    }
+
+    void RingAllocator::release(VkDeviceSize position)
+    {
+        m_tail = std::clamp(position, m_tail, m_head);
+    }
+} // namespace vks
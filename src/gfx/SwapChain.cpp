@@ -3,13 +3,14 @@
 #include <../include/gfx/Device.hpp>
 #include <../include/platform/Window.hpp>
 
+#include <algorithm>
 #include <iostream>
 
 using namespace vks;
 
-SwapChain::SwapChain(const Device& device, const Window& window)
+SwapChain::SwapChain(const Device& device, const Window& window, uint32_t minImageCount)
   : m_swapChain(VK_NULL_HANDLE), m_oldSwapChain(VK_NULL_HANDLE), m_extent(),
-    m_imageFormat(), m_device(device), m_window(window)
+    m_imageFormat(), m_device(device), m_window(window), m_minImageCount(minImageCount)
 {
   createSwapChain();
   createImageViews();
@@ -48,7 +49,8 @@ void SwapChain::createSwapChain()
     ChooseSwapSurfaceFormat(m_supportDetails.formats);
   VkFormat depthFormat = ChooseSwapDepthFormat(m_device.physical());
   VkPresentModeKHR presentMode =
-    ChooseSwapPresentMode(m_supportDetails.presentModes);
+    ChooseSwapPresentMode(m_supportDetails.presentModes, m_preferredPresentModes);
+  m_presentMode = presentMode;
 
   m_imageFormat = surfaceFormat.format;
   m_depthFormat = depthFormat;
@@ -56,7 +58,7 @@ void SwapChain::createSwapChain()
   // How many images should be in the swap chain
   // One more than the minimum helps with wait times before another image is
   // available from driver
-  uint32_t imageCount = m_supportDetails.capabilities.minImageCount + 1;
+  uint32_t imageCount = std::max(m_supportDetails.capabilities.minImageCount + 1, m_minImageCount);
 
   // Make sure image count doesn't exceed maximum
   // A max image count of 0 indicates that there is no maximum
@@ -171,17 +173,21 @@ VkFormat SwapChain::ChooseSwapDepthFormat(VkPhysicalDevice device)
 }
 
 VkPresentModeKHR SwapChain::ChooseSwapPresentMode(
-  const std::vector<VkPresentModeKHR>& availablePresentModes)
+  const std::vector<VkPresentModeKHR>& availablePresentModes,
+  const std::vector<VkPresentModeKHR>& preferredPresentModes)
 {
-  // Try to find support for Mailbox
+  // Take the first preferred mode the surface supports.
   // MAILBOX (triple buffering) uses a queue to present images,
   // and if the queue is full already queued images are overwritten with newer
-  // images
-  for (const auto& availablePresentMode : availablePresentModes)
+  // images. IMMEDIATE doesn't wait for vblank at all and may tear.
+  for (const auto& preferred : preferredPresentModes)
   {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+    for (const auto& availablePresentMode : availablePresentModes)
     {
-      return availablePresentMode;
+      if (availablePresentMode == preferred)
+      {
+        return availablePresentMode;
+      }
     }
   }
 
@@ -235,7 +241,7 @@ void SwapChain::createDepthViews()
   // Resize vectors to match the number of color images (usually 2 or 3)
   m_depthImages.resize(numImages());
   m_depthViews.resize(numImages());
-  m_depthImageMemories.resize(numImages());
+  m_depthAllocations.resize(numImages());
 
   for (int i = 0; i < m_depthImages.size(); i++)
   {
@@ -255,26 +261,8 @@ void SwapChain::createDepthViews()
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
 
-    if (vkCreateImage(m_device.logical(), &imageInfo, nullptr, &m_depthImages[i]) != VK_SUCCESS)
-    {
-      throw std::runtime_error("failed to create depth image!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_device.logical(), m_depthImages[i], &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = m_device.findMemoryType(memRequirements.memoryTypeBits,
-                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    if (vkAllocateMemory(m_device.logical(), &allocInfo, nullptr, &m_depthImageMemories[i]) != VK_SUCCESS)
-    {
-      throw std::runtime_error("failed to allocate depth image memory!");
-    }
-
-    vkBindImageMemory(m_device.logical(), m_depthImages[i], m_depthImageMemories[i], 0);
+    m_depthImages[i] = m_device.allocator().createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                        m_depthAllocations[i]);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -304,8 +292,7 @@ void SwapChain::destroyImages()
   for (size_t i = 0; i < m_depthImages.size(); i++)
   {
     vkDestroyImageView(m_device.logical(), m_depthViews[i], nullptr);
-    vkDestroyImage(m_device.logical(), m_depthImages[i], nullptr);
-    vkFreeMemory(m_device.logical(), m_depthImageMemories[i], nullptr);
+    m_device.allocator().destroyImage(m_depthImages[i], m_depthAllocations[i]);
   }
 }
 
@@ -13,45 +13,46 @@ static VkSemaphoreCreateInfo makeSemaphoreCreateInfo() {
     return semaphoreInfo;
 }
 
-static VkFenceCreateInfo makeFenceCreateInfo() {
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    // Initialize fence to already signaled so it doesn't hang on first frame
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-    return fenceInfo;
-}
-
 SyncObjects::SyncObjects(const Device& device, uint32_t numImages,
     uint32_t maxFramesInFlight)
     : m_device(device),
     m_numImages(numImages),
     m_maxFramesInFlight(maxFramesInFlight),
-    // per-frame imageAvailable semaphores and per-frame fences:
+    // per-frame imageAvailable semaphores:
     m_imageAvailable(maxFramesInFlight),
-    m_inFlightFences(maxFramesInFlight),
     // renderFinished will be allocated per-swapchain-image:
     m_renderFinished(),
-    m_imagesInFlight() {
-    // initialize per-image tracking
-    m_imagesInFlight.resize(m_numImages);
-    for (auto& f : m_imagesInFlight) {
-        f = VK_NULL_HANDLE;
+    // 0 is the timeline's initial value, so unused slots never block
+    m_slotValues(maxFramesInFlight, 0),
+    m_imageValues(numImages, 0) {
+    VkSemaphoreTypeCreateInfo typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo timelineInfo = makeSemaphoreCreateInfo();
+    timelineInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(m_device.logical(), &timelineInfo, nullptr,
+        &m_timeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame timeline semaphore!");
     }
 
     VkSemaphoreCreateInfo semaphoreInfo = makeSemaphoreCreateInfo();
-    VkFenceCreateInfo fenceInfo = makeFenceCreateInfo();
 
-    // Create per-frame semaphores and fences
+    // Create per-frame semaphores
     for (size_t i = 0; i < m_maxFramesInFlight; ++i) {
         if (vkCreateSemaphore(m_device.logical(), &semaphoreInfo, nullptr,
-            &m_imageAvailable[i]) != VK_SUCCESS ||
-            vkCreateFence(m_device.logical(), &fenceInfo, nullptr,
-                &m_inFlightFences[i]) != VK_SUCCESS) {
+            &m_imageAvailable[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create per-frame synchronization objects!");
         }
     }
 
-    // Create per-image renderFinished semaphores
+    createImageSemaphores();
+}
+
+void SyncObjects::createImageSemaphores() {
+    VkSemaphoreCreateInfo semaphoreInfo = makeSemaphoreCreateInfo();
+
     m_renderFinished.resize(m_numImages);
     for (size_t i = 0; i < m_numImages; ++i) {
         if (vkCreateSemaphore(m_device.logical(), &semaphoreInfo, nullptr,
@@ -61,41 +62,75 @@ SyncObjects::SyncObjects(const Device& device, uint32_t numImages,
     }
 }
 
-void SyncObjects::recreate(uint32_t numImages) {
-    // destroy old per-image semaphores
+void SyncObjects::destroyImageSemaphores() {
     for (size_t i = 0; i < m_renderFinished.size(); ++i) {
         vkDestroySemaphore(m_device.logical(), m_renderFinished[i], nullptr);
     }
-
-    // resize tracking to new number of images
-    m_numImages = numImages;
     m_renderFinished.clear();
-    m_renderFinished.resize(m_numImages);
+}
 
-    m_imagesInFlight.clear();
-    m_imagesInFlight.resize(m_numImages);
-    for (auto& f : m_imagesInFlight) {
-        f = VK_NULL_HANDLE;
+uint64_t SyncObjects::completedValue() const {
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(m_device.logical(), m_timeline, &value) != VK_SUCCESS) {
+        throw std::runtime_error("failed to read frame timeline semaphore!");
     }
+    return value;
+}
 
-    VkSemaphoreCreateInfo semaphoreInfo = makeSemaphoreCreateInfo();
-    for (size_t i = 0; i < m_numImages; ++i) {
-        if (vkCreateSemaphore(m_device.logical(), &semaphoreInfo, nullptr,
-            &m_renderFinished[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to recreate per-image renderFinished semaphores!");
-        }
+bool SyncObjects::isComplete(uint64_t value) const {
+    return completedValue() >= value;
+}
+
+void SyncObjects::wait(uint64_t value) const {
+    // Skip the driver call when the frame already retired
+    if (value == 0 || isComplete(value)) {
+        return;
     }
+
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_timeline;
+    waitInfo.pValues = &value;
+
+    if (vkWaitSemaphores(m_device.logical(), &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait on frame timeline semaphore!");
+    }
+}
+
+void SyncObjects::waitForFrameSlot(uint32_t frame) const {
+    wait(m_slotValues[frame]);
+}
+
+void SyncObjects::waitForImage(uint32_t image) const {
+    wait(m_imageValues[image]);
+}
+
+void SyncObjects::advance(uint32_t frame, uint32_t image) {
+    m_slotValues[frame] = m_frameValue;
+    m_imageValues[image] = m_frameValue;
+    ++m_frameValue;
+}
+
+void SyncObjects::recreate(uint32_t numImages) {
+    // destroy old per-image semaphores
+    destroyImageSemaphores();
+
+    // resize tracking to new number of images; the caller waited for the
+    // device, so nothing recorded against the old images is pending
+    m_numImages = numImages;
+    m_imageValues.assign(m_numImages, 0);
+
+    createImageSemaphores();
 }
 
 SyncObjects::~SyncObjects() {
     // Destroy per-image renderFinished semaphores
-    for (size_t i = 0; i < m_renderFinished.size(); ++i) {
-        vkDestroySemaphore(m_device.logical(), m_renderFinished[i], nullptr);
-    }
+    destroyImageSemaphores();
 
-    // Destroy per-frame semaphores and fences
+    // Destroy per-frame semaphores
     for (size_t i = 0; i < m_maxFramesInFlight; ++i) {
         vkDestroySemaphore(m_device.logical(), m_imageAvailable[i], nullptr);
-        vkDestroyFence(m_device.logical(), m_inFlightFences[i], nullptr);
     }
+    vkDestroySemaphore(m_device.logical(), m_timeline, nullptr);
 }
@@ -6,7 +6,7 @@
 #include <stdexcept>
 #include <cmath>
 
-#include <../include/gfx/Buffer.hpp>
+#include <../include/gfx/UploadManager.hpp>
 
 namespace vks
 {
@@ -29,8 +29,7 @@ namespace vks
 
         if (m_sampler) vkDestroySampler(device, m_sampler, nullptr);
         if (m_imageView) vkDestroyImageView(device, m_imageView, nullptr);
-        if (m_image) vkDestroyImage(device, m_image, nullptr);
-        if (m_imageMemory) vkFreeMemory(device, m_imageMemory, nullptr);
+        m_device.allocator().destroyImage(m_image, m_allocation);
     }
 
     void Texture::createTextureImage(const std::string& filepath)
@@ -58,19 +57,6 @@ namespace vks
 
         VkDeviceSize imageSize = m_width * m_height * 4;
 
-        Buffer stagingBuffer(
-            m_device,
-            imageSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        );
-
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer(pixels);
-        stagingBuffer.unmap();
-
-        stbi_image_free(pixels);
-
         m_device.createImage(
             m_width,
             m_height,
@@ -80,31 +66,21 @@ namespace vks
             VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             m_image,
-            m_imageMemory
+            m_allocation
         );
 
-        m_device.transitionImageLayout(
+        // Staged right away, so the pixels can be freed; the copy and the
+        // mipmaps are recorded with the next batch of uploads
+        m_uploaded = m_device.uploads().upload(
             m_image,
             VK_FORMAT_R8G8B8A8_SRGB,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            m_mipLevels
-        );
-
-        m_device.copyBufferToImage(
-            stagingBuffer.getBuffer(),
-            m_image,
-            m_width,
-            m_height
+            {m_width, m_height},
+            m_mipLevels,
+            pixels,
+            imageSize
         );
 
-        m_device.generateMipmaps(
-            m_image,
-            VK_FORMAT_R8G8B8A8_SRGB,
-            m_width,
-            m_height,
-            m_mipLevels
-        );
+        stbi_image_free(pixels);
     }
 
     void Texture::createImageView()
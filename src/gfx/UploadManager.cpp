@@ -0,0 +1,390 @@
+#include <gfx/UploadManager.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <core/Log.hpp>
+#include <gfx/Device.hpp>
+
+namespace vks
+{
+    namespace
+    {
+        // Offsets of buffer-to-image copies have to be a multiple of the texel
+        // size, which this covers for every uncompressed format
+        constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+        VkSemaphore createTimeline(VkDevice device)
+        {
+            VkSemaphoreTypeCreateInfo typeInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+            typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            typeInfo.initialValue = 0;
+
+            VkSemaphoreCreateInfo info{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+            info.pNext = &typeInfo;
+
+            VkSemaphore semaphore;
+            if (vkCreateSemaphore(device, &info, nullptr, &semaphore) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create upload timeline semaphore");
+            return semaphore;
+        }
+
+        VkImageSubresourceRange allLevels(uint32_t mipLevels)
+        {
+            return {VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1};
+        }
+    } // namespace
+
+    bool UploadFuture::ready() const
+    {
+        return !m_manager || m_manager->isComplete(m_value);
+    }
+
+    void UploadFuture::wait() const
+    {
+        if (m_manager)
+            m_manager->wait(m_value);
+    }
+
+    UploadManager::UploadManager(const Device& device)
+        : m_device(device),
+          m_dedicatedTransfer(device.hasDedicatedTransfer()),
+          m_staging(device, STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+          m_ring(STAGING_SIZE, STAGING_ALIGNMENT),
+          m_graphicsPool(device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT)
+    {
+        m_staging.map();
+        m_timeline = createTimeline(device.logical());
+
+        if (m_dedicatedTransfer)
+        {
+            m_transferPool = std::make_unique<CommandPool>(device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                                                           device.transferFamily());
+            m_transferTimeline = createTimeline(device.logical());
+        }
+    }
+
+    UploadManager::~UploadManager()
+    {
+        if (!m_pending.empty())
+            LOG_WARN("UploadManager destroyed with {} uploads never submitted",
+                     m_pending.buffers.size() + m_pending.images.size());
+
+        // The device is idle by now
+        retire();
+
+        vkDestroySemaphore(m_device.logical(), m_timeline, nullptr);
+        if (m_transferTimeline != VK_NULL_HANDLE)
+            vkDestroySemaphore(m_device.logical(), m_transferTimeline, nullptr);
+    }
+
+    UploadFuture UploadManager::upload(const Buffer& dst, const void* data, VkDeviceSize size,
+                                       VkDeviceSize dstOffset)
+    {
+        if (size == 0)
+            return {};
+
+        const auto [src, srcOffset] = stage(data, size);
+        m_pending.buffers.push_back({src, dst.getBuffer(), {srcOffset, dstOffset, size}});
+        return {this, m_nextValue};
+    }
+
+    UploadFuture UploadManager::upload(VkImage image, VkFormat format, VkExtent2D extent, uint32_t mipLevels,
+                                       const void* pixels, VkDeviceSize size)
+    {
+        const auto [src, srcOffset] = stage(pixels, size);
+        m_pending.images.push_back({src, srcOffset, image, format, extent, mipLevels});
+        return {this, m_nextValue};
+    }
+
+    std::pair<VkBuffer, VkDeviceSize> UploadManager::stage(const void* data, VkDeviceSize size)
+    {
+        if (size > MAX_RING_UPLOAD)
+        {
+            auto buffer = std::make_unique<Buffer>(
+                m_device, size,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            buffer->map();
+            std::memcpy(buffer->getMapped(), data, size);
+
+            const VkBuffer handle = buffer->getBuffer();
+            m_pending.stagingBuffers.push_back(std::move(buffer));
+            return {handle, 0};
+        }
+
+        // Out of space: the oldest batches have to finish first, and they
+        // may include the one being queued
+        std::optional<VkDeviceSize> offset = m_ring.allocate(size);
+        while (!offset)
+        {
+            if (m_inFlight.empty())
+                submit();
+            wait(m_inFlight.front().value);
+            offset = m_ring.allocate(size);
+        }
+
+        std::memcpy(static_cast<char*>(m_staging.getMapped()) + *offset, data, size);
+        return {m_staging.getBuffer(), *offset};
+    }
+
+    void UploadManager::flush()
+    {
+        if (!m_pending.empty())
+            submit();
+        retire();
+    }
+
+    bool UploadManager::isComplete(uint64_t value) const
+    {
+        if (value >= m_nextValue)
+            return false;
+
+        uint64_t completed = 0;
+        if (vkGetSemaphoreCounterValue(m_device.logical(), m_timeline, &completed) != VK_SUCCESS)
+            throw std::runtime_error("Failed to read upload timeline semaphore");
+        return completed >= value;
+    }
+
+    void UploadManager::wait(uint64_t value)
+    {
+        if (value >= m_nextValue)
+            submit();
+
+        if (!isComplete(value))
+        {
+            VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &m_timeline;
+            waitInfo.pValues = &value;
+
+            if (vkWaitSemaphores(m_device.logical(), &waitInfo, UINT64_MAX) != VK_SUCCESS)
+                throw std::runtime_error("Failed to wait on upload timeline semaphore");
+        }
+
+        retire();
+    }
+
+    void UploadManager::submit()
+    {
+        Batch batch = std::move(m_pending);
+        m_pending = {};
+        batch.value = m_nextValue++;
+        batch.stagingEnd = m_ring.head();
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkTimelineSemaphoreSubmitInfo transferTimeline{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        VkTimelineSemaphoreSubmitInfo graphicsTimeline{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        graphicsTimeline.signalSemaphoreValueCount = 1;
+        graphicsTimeline.pSignalSemaphoreValues = &batch.value;
+
+        VkSubmitInfo graphicsSubmit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        graphicsSubmit.pNext = &graphicsTimeline;
+        graphicsSubmit.signalSemaphoreCount = 1;
+        graphicsSubmit.pSignalSemaphores = &m_timeline;
+
+        batch.graphics = beginCommands(m_graphicsPool);
+        if (m_dedicatedTransfer)
+        {
+            batch.transfer = beginCommands(*m_transferPool);
+            recordTransfer(batch.transfer, batch);
+            if (vkEndCommandBuffer(batch.transfer) != VK_SUCCESS)
+                throw std::runtime_error("Failed to record upload commands");
+
+            transferTimeline.signalSemaphoreValueCount = 1;
+            transferTimeline.pSignalSemaphoreValues = &batch.value;
+
+            VkSubmitInfo transferSubmit{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            transferSubmit.pNext = &transferTimeline;
+            transferSubmit.commandBufferCount = 1;
+            transferSubmit.pCommandBuffers = &batch.transfer;
+            transferSubmit.signalSemaphoreCount = 1;
+            transferSubmit.pSignalSemaphores = &m_transferTimeline;
+
+            if (vkQueueSubmit(m_device.transferQueue(), 1, &transferSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+                throw std::runtime_error("Failed to submit uploads to the transfer queue");
+
+            // Graphics takes ownership and generates mipmaps once the copies are done
+            graphicsTimeline.waitSemaphoreValueCount = 1;
+            graphicsTimeline.pWaitSemaphoreValues = &batch.value;
+            graphicsSubmit.waitSemaphoreCount = 1;
+            graphicsSubmit.pWaitSemaphores = &m_transferTimeline;
+            graphicsSubmit.pWaitDstStageMask = &waitStage;
+        }
+        else
+        {
+            recordTransfer(batch.graphics, batch);
+        }
+
+        recordGraphics(batch.graphics, batch);
+        if (vkEndCommandBuffer(batch.graphics) != VK_SUCCESS)
+            throw std::runtime_error("Failed to record upload commands");
+
+        graphicsSubmit.commandBufferCount = 1;
+        graphicsSubmit.pCommandBuffers = &batch.graphics;
+        if (vkQueueSubmit(m_device.graphicsQueue(), 1, &graphicsSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("Failed to submit uploads to the graphics queue");
+
+        m_inFlight.push_back(std::move(batch));
+    }
+
+    void UploadManager::retire()
+    {
+        uint64_t completed = 0;
+        if (!m_inFlight.empty())
+            vkGetSemaphoreCounterValue(m_device.logical(), m_timeline, &completed);
+
+        while (!m_inFlight.empty() && m_inFlight.front().value <= completed)
+        {
+            Batch& batch = m_inFlight.front();
+            m_ring.release(batch.stagingEnd);
+
+            vkFreeCommandBuffers(m_device.logical(), m_graphicsPool.handle(), 1, &batch.graphics);
+            if (batch.transfer != VK_NULL_HANDLE)
+                vkFreeCommandBuffers(m_device.logical(), m_transferPool->handle(), 1, &batch.transfer);
+
+            m_inFlight.pop_front();
+        }
+    }
+
+    VkCommandBuffer UploadManager::beginCommands(const CommandPool& pool) const
+    {
+        VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocInfo.commandPool = pool.handle();
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer cmd;
+        if (vkAllocateCommandBuffers(m_device.logical(), &allocInfo, &cmd) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate upload command buffer");
+
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("Failed to begin upload command buffer");
+
+        return cmd;
+    }
+
+    void UploadManager::recordTransfer(VkCommandBuffer cmd, const Batch& batch) const
+    {
+        // Every level goes to TRANSFER_DST; the copy fills level 0 and the
+        // blits in recordGraphics() the rest
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        for (const ImageCopy& copy : batch.images)
+        {
+            VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = copy.image;
+            barrier.subresourceRange = allLevels(copy.mipLevels);
+            imageBarriers.push_back(barrier);
+        }
+        if (!imageBarriers.empty())
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 0, nullptr, 0, nullptr,
+                                 static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+        for (const BufferCopy& copy : batch.buffers)
+            vkCmdCopyBuffer(cmd, copy.src, copy.dst, 1, &copy.region);
+
+        for (const ImageCopy& copy : batch.images)
+        {
+            VkBufferImageCopy region{};
+            region.bufferOffset = copy.srcOffset;
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            region.imageExtent = {copy.extent.width, copy.extent.height, 1};
+            vkCmdCopyBufferToImage(cmd, copy.src, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        }
+
+        if (!m_dedicatedTransfer)
+            return;
+
+        // Release to the graphics family; the matching acquire is at the
+        // start of recordGraphics()
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        for (const BufferCopy& copy : batch.buffers)
+        {
+            VkBufferMemoryBarrier barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = m_device.transferFamily();
+            barrier.dstQueueFamilyIndex = m_device.queueFamilyIndices().graphicsFamily.value();
+            barrier.buffer = copy.dst;
+            barrier.offset = copy.region.dstOffset;
+            barrier.size = copy.region.size;
+            bufferBarriers.push_back(barrier);
+        }
+        for (VkImageMemoryBarrier& barrier : imageBarriers)
+        {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = m_device.transferFamily();
+            barrier.dstQueueFamilyIndex = m_device.queueFamilyIndices().graphicsFamily.value();
+        }
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                             0, nullptr,
+                             static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                             static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    void UploadManager::recordGraphics(VkCommandBuffer cmd, const Batch& batch) const
+    {
+        if (m_dedicatedTransfer)
+        {
+            // Acquire what the transfer queue released. Buffers are ready for
+            // any read from here on; images for the mipmap blits.
+            std::vector<VkBufferMemoryBarrier> bufferBarriers;
+            for (const BufferCopy& copy : batch.buffers)
+            {
+                VkBufferMemoryBarrier barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+                barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+                barrier.srcQueueFamilyIndex = m_device.transferFamily();
+                barrier.dstQueueFamilyIndex = m_device.queueFamilyIndices().graphicsFamily.value();
+                barrier.buffer = copy.dst;
+                barrier.offset = copy.region.dstOffset;
+                barrier.size = copy.region.size;
+                bufferBarriers.push_back(barrier);
+            }
+
+            std::vector<VkImageMemoryBarrier> imageBarriers;
+            for (const ImageCopy& copy : batch.images)
+            {
+                VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.srcQueueFamilyIndex = m_device.transferFamily();
+                barrier.dstQueueFamilyIndex = m_device.queueFamilyIndices().graphicsFamily.value();
+                barrier.image = copy.image;
+                barrier.subresourceRange = allLevels(copy.mipLevels);
+                imageBarriers.push_back(barrier);
+            }
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                                 static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+        }
+        else if (!batch.buffers.empty())
+        {
+            // Later submissions on this queue, i.e. the next frame, see the copies
+            VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                                 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        // Blits need a graphics queue. They leave every level shader-readable.
+        for (const ImageCopy& copy : batch.images)
+            m_device.generateMipmaps(cmd, copy.image, copy.format, copy.extent.width, copy.extent.height,
+                                     copy.mipLevels);
+    }
+} // namespace vks
@@ -6,30 +6,16 @@ void vks::ColorMaterial::drawImguiEditor()
     if (ImGui::ColorEdit4("Base Color", &uboData.color[0])) flush();
 }
 
-void vks::ColorMaterial::draw(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet lastSet,
-    const Model* model, const glm::mat4& transform)
+void vks::ColorMaterial::draw(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet& lastSet,
+    const Model* model, uint32_t firstInstance, uint32_t instanceCount, uint32_t lod)
 {
     // 1. Bind Descriptor Set (Optimized)
-    if (m_materialDescriptorSet != lastSet)
-    {
-        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                layout, 1, 1, &m_materialDescriptorSet, 0, nullptr);
-        lastSet = m_materialDescriptorSet;
-    }
+    bind(cmd, layout, lastSet);
 
     if (model)
     {
-        // 2. Push Constants (Model Matrix + Color)
-        struct PushConstant
-        {
-            glm::mat4 model;
-        } push{};
-        push.model = transform;
-
-        vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT,
-                           0, sizeof(PushConstant), &push);
-
-        model->bind(cmd);
+        // 2. Model matrices come from the instance buffer
+        model->draw(cmd, instanceCount, firstInstance, lod);
     }
 }
 
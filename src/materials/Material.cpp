@@ -5,39 +5,54 @@ namespace vks {
 
     Material::Material(
         const std::string& pipelineName,
-        VkDeviceSize uboSize
+        std::type_index paramsType,
+        VkDeviceSize paramsSize
     ) : m_pipelineName(pipelineName),
-        m_materialDescriptorSet(VK_NULL_HANDLE)
+        m_pipeline(PipelineHandle::fromName(pipelineName)),
+        m_table(EngineContext::get().materialTable(paramsType, paramsSize)),
+        m_materialIndex(m_table->allocate())
     {
-        auto& ec = EngineContext::get();
-        auto descriptorPool = ec.globalDescriptorPool();
-        auto materialLayout = ec.getDescriptorSetLayout("material");
-
-        // 2. Create the Uniform Buffer
-        m_uboBuffer = std::make_unique<vks::Buffer>(
-            ec.device(),
-            uboSize,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        );
-
-        // Map the buffer persistently
-        m_uboBuffer->map();
-
-        // 3. Allocate and Write the Descriptor Set
-        auto bufferInfo = m_uboBuffer->descriptorInfo();
-    
-        DescriptorWriter writer(materialLayout, descriptorPool);
-        writer.writeBuffer(0, &bufferInfo); // Binds the UBO to Binding 0
-
-        if (!writer.build(m_materialDescriptorSet)) {
-            throw std::runtime_error("Failed to build descriptor set for material: " + pipelineName);
+    }
+
+    Material::~Material()
+    {
+        // Moved-from materials no longer own a slot
+        if (m_table)
+            m_table->release(m_materialIndex);
+    }
+
+    Material& Material::operator=(Material&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_table)
+                m_table->release(m_materialIndex);
+
+            layer_priority = other.layer_priority;
+            m_pipelineName = std::move(other.m_pipelineName);
+            m_pipeline = other.m_pipeline;
+            m_table = std::move(other.m_table);
+            m_materialIndex = other.m_materialIndex;
         }
+        return *this;
+    }
+
+    void Material::bind(VkCommandBuffer cmd, VkPipelineLayout layout, VkDescriptorSet& lastSet)
+    {
+        VkDescriptorSet set = getDescriptorSet();
+        if (set != lastSet)
+        {
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    layout, 1, 1, &set, 0, nullptr);
+            lastSet = set;
+        }
+
+        vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0, sizeof(m_materialIndex), &m_materialIndex);
     }
 
-    void Material::writeToBuffer(const void* data, VkDeviceSize size) {
-        // Relies on the buffer already being mapped in the constructor
-        m_uboBuffer->writeToBuffer(const_cast<void*>(data), size);
+    void Material::writeToBuffer(const void* data) {
+        m_table->write(m_materialIndex, data);
     }
 
-} // namespace vks
\ No newline at end of file
+} // namespace vks
@@ -0,0 +1,131 @@
+#include <materials/MaterialTable.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <core/Log.hpp>
+#include <gfx/Device.hpp>
+
+namespace vks
+{
+    MaterialTable::MaterialTable(const Device& device, Ref<DescriptorSetLayout> layout, Ref<DescriptorPool> pool,
+                                 VkDeviceSize stride, uint32_t frameSlots)
+        : m_device(device), m_layout(std::move(layout)), m_pool(std::move(pool)), m_stride(stride),
+          m_frames(frameSlots)
+    {
+        grow(INITIAL_CAPACITY);
+    }
+
+    MaterialTable::~MaterialTable()
+    {
+        // Every slot has been released through the deletion queue by now
+        std::vector<VkDescriptorSet> sets;
+        for (const FrameCopy& frame : m_frames)
+            sets.push_back(frame.set);
+        m_pool->freeDescriptors(sets);
+    }
+
+    uint32_t MaterialTable::allocate()
+    {
+        if (m_freeSlots.empty())
+            grow(m_capacity * 2);
+
+        const uint32_t index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        return index;
+    }
+
+    void MaterialTable::release(uint32_t index)
+    {
+        // Draws recorded for frames in flight may still read the slot
+        m_device.deletionQueue().push([table = shared_from_this(), index]
+        {
+            table->m_freeSlots.push_back(index);
+        });
+    }
+
+    void MaterialTable::write(uint32_t index, const void* data)
+    {
+        std::byte* block = m_blocks.data() + index * m_stride;
+        const auto* bytes = static_cast<const std::byte*>(data);
+
+        // Only the span that actually changed, e.g. a colour inside a block
+        // rewritten every frame
+        size_t first = 0;
+        while (first < m_stride && block[first] == bytes[first])
+            ++first;
+        if (first == m_stride)
+            return;
+
+        size_t last = m_stride;
+        while (block[last - 1] == bytes[last - 1])
+            --last;
+
+        std::memcpy(block + first, bytes + first, last - first);
+        for (FrameCopy& frame : m_frames)
+            frame.dirty.add(index * m_stride + first, last - first);
+    }
+
+    VkDeviceSize MaterialTable::flush(uint32_t frameSlot)
+    {
+        FrameCopy& frame = m_frames[frameSlot];
+        m_currentFrame = frameSlot;
+
+        const VkDeviceSize bytes = frame.dirty.bytes();
+        auto* mapped = static_cast<std::byte*>(frame.buffer->getMapped());
+        for (const auto& [begin, end] : frame.dirty.ranges())
+            std::memcpy(mapped + begin, m_blocks.data() + begin, end - begin);
+        frame.dirty.clear();
+
+        return bytes;
+    }
+
+    void MaterialTable::grow(uint32_t capacity)
+    {
+        if (m_capacity > 0)
+            LOG_INFO("Material table of {}-byte blocks grew to {} slots", m_stride, capacity);
+
+        m_blocks.resize(capacity * m_stride);
+
+        for (FrameCopy& frame : m_frames)
+        {
+            auto buffer = std::make_shared<Buffer>(
+                m_device,
+                capacity * m_stride,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            buffer->map();
+            // Starts out current; nothing is written to the new slots yet
+            std::memcpy(buffer->getMapped(), m_blocks.data(), m_blocks.size());
+
+            // A new set rather than an overwrite: the old one may be bound by
+            // command buffers still in flight
+            auto bufferInfo = buffer->descriptorInfo();
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            DescriptorWriter writer(m_layout, m_pool);
+            writer.writeBuffer(0, &bufferInfo);
+            if (!writer.build(set))
+                throw std::runtime_error("Failed to allocate a material table descriptor set");
+
+            if (frame.buffer)
+            {
+                m_device.deletionQueue().push([pool = m_pool, set = frame.set, old = frame.buffer]() mutable
+                {
+                    std::vector<VkDescriptorSet> sets{set};
+                    pool->freeDescriptors(sets);
+                    old.reset();
+                });
+            }
+
+            frame.buffer = std::move(buffer);
+            frame.set = set;
+            frame.dirty.clear();
+        }
+
+        for (uint32_t i = capacity; i > m_capacity; --i)
+            m_freeSlots.push_back(i - 1);
+
+        m_capacity = capacity;
+    }
+} // namespace vks
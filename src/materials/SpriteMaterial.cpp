@@ -9,7 +9,7 @@ namespace vks
         const std::string& pipelineName,
         SpriteMaterialUBO initialData
     )
-        : TypedMaterial(pipelineName, sizeof(SpriteMaterialUBO)),
+        : TypedMaterial(pipelineName, initialData),
           m_texture(texture)
     {
         buildDescriptorSet();
@@ -18,36 +18,18 @@ namespace vks
     void SpriteMaterial::draw(
         VkCommandBuffer cmd,
         VkPipelineLayout layout,
-        VkDescriptorSet lastSet,
+        VkDescriptorSet& lastSet,
         const vks::Model* model,
-        const glm::mat4& transform
+        uint32_t firstInstance,
+        uint32_t instanceCount,
+        uint32_t lod
     )
     {
-        if (m_materialDescriptorSet != lastSet)
-        {
-            vkCmdBindDescriptorSets(
-                cmd,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                layout,
-                1, 1,
-                &m_materialDescriptorSet,
-                0, nullptr
-            );
-            lastSet = m_materialDescriptorSet;
-        }
-
-        vkCmdPushConstants(
-            cmd,
-            layout,
-            VK_SHADER_STAGE_VERTEX_BIT,
-            0,
-            sizeof(glm::mat4),
-            &transform
-        );
+        bind(cmd, layout, lastSet);
 
         if (model)
         {
-            model->bind(cmd);
+            model->draw(cmd, instanceCount, firstInstance, lod);
         }
     }
 
@@ -153,9 +135,11 @@ namespace vks
         imageInfo.imageView = m_texture->getImageView();
         imageInfo.sampler = m_texture->getSampler();
 
+        // sprite.frag only samples the texture, so binding 0 (the tint's
+        // table) is left unwritten
         writer.writeImage(1, &imageInfo);
 
-        if (!writer.build(m_materialDescriptorSet))
+        if (!writer.build(m_textureSet))
         {
             throw std::runtime_error("Failed to build sprite material descriptor set");
         }
@@ -2,6 +2,7 @@
 #include <platform/events/EventManager.hpp>
 #include <platform/events/Events.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <gfx/Instance.hpp>
 
@@ -9,12 +10,16 @@
 using namespace vks;
 
 Window::Window(const glm::ivec2& dimensions, const std::string& title,
-    const Instance& instance)
+    const Instance& instance, bool headless)
     : m_dimensions(dimensions), m_title(title), m_instance(instance),
     m_surface(VK_NULL_HANDLE),
     m_drawFrameFunc([](float) {}) {
 
     m_windowInstance = this;
+
+    if (headless) {
+        return;
+    }
     
     m_window = glfwCreateWindow(dimensions.x, dimensions.y, title.c_str(),
         nullptr, nullptr);
@@ -36,11 +41,38 @@ Window::~Window() {
         glfwSetWindowUserPointer(m_window, nullptr);
     }
 
-    vkDestroySurfaceKHR(m_instance.handle(), m_surface, nullptr);
-    glfwDestroyWindow(m_window);
+    if (m_surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(m_instance.handle(), m_surface, nullptr);
+    }
+    if (m_window) {
+        glfwDestroyWindow(m_window);
+    }
+}
+
+void Window::requestClose() {
+    m_closeRequested = true;
+    if (m_window) {
+        glfwSetWindowShouldClose(m_window, GLFW_TRUE);
+    }
 }
 
 void Window::mainLoop() {
+    if (headless()) {
+        // No GLFW (and possibly no display): time with the standard clock and
+        // skip the resize event, the offscreen target already has its size
+        using Clock = std::chrono::steady_clock;
+        auto last = Clock::now();
+        for (uint64_t frame = 0; !m_closeRequested && (m_maxFrames == 0 || frame < m_maxFrames); ++frame) {
+            auto now = Clock::now();
+            float deltaTime = std::chrono::duration<float>(now - last).count();
+            last = now;
+
+            m_drawFrameFunc(deltaTime);
+            m_input.update();
+        }
+        return;
+    }
+
     float lastTime = static_cast<float>(glfwGetTime());
     // Emit the initial resize event to ensure everything is sized correctly from the start
     glm::ivec2 initialSize;
@@ -0,0 +1,295 @@
+#include <render/DepthPyramid.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <stdexcept>
+
+#include "app/EngineContext.hpp"
+#include "gfx/Descriptors.hpp"
+#include "gfx/Device.hpp"
+
+namespace vks
+{
+    namespace
+    {
+        struct ReduceParams
+        {
+            glm::ivec2 sourceSize;
+            glm::ivec2 targetSize;
+        };
+
+        VkExtent2D mipExtent(VkExtent2D extent, uint32_t level)
+        {
+            return {std::max(1u, extent.width >> level), std::max(1u, extent.height >> level)};
+        }
+    }
+
+    DepthPyramid::DepthPyramid(const Device& device, const Ref<IRenderTarget>& source)
+        : m_device(device), m_source(source), m_pipelines(device)
+    {
+        m_setLayout = DescriptorSetLayout::Builder(device)
+                      .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .build();
+
+        ComputePipelineDesc compute{};
+        compute.computeShader = "assets/shaders/depth_pyramid.comp.spv";
+
+        PipelineDesc desc{};
+        desc.type = PipelineType::Compute;
+        desc.payload = compute;
+        desc.setLayouts = {m_setLayout->getDescriptorSetLayout()};
+        desc.pushConstants = {
+            VkPushConstantRange{
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(ReduceParams)
+            }
+        };
+        m_pipeline = m_pipelines.createOrReplace("depth_pyramid", desc);
+
+        // Both the reduction and the occlusion test read with texelFetch; the
+        // sampler only has to exist for the combined image sampler bindings
+        VkSamplerCreateInfo samplerInfo{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(m_device.logical(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create the depth pyramid sampler");
+
+        create();
+    }
+
+    DepthPyramid::~DepthPyramid()
+    {
+        // Owned by the engine, which drains the device before its members go
+        destroy(m_device, *EngineContext::get().globalDescriptorPool(), collect());
+        vkDestroySampler(m_device.logical(), m_sampler, nullptr);
+    }
+
+    void DepthPyramid::sync()
+    {
+        const VkExtent2D extent = m_source->extent();
+        bool changed = extent.width != m_extent.width || extent.height != m_extent.height ||
+            m_sourceViews.size() != m_source->numImages();
+
+        for (uint32_t i = 0; !changed && i < m_sourceViews.size(); ++i)
+            changed = m_sourceViews[i] != m_source->depthView(i);
+
+        if (!changed)
+            return;
+
+        // Frames in flight may still sample the old image
+        retire();
+        create();
+    }
+
+    void DepthPyramid::create()
+    {
+        m_extent = m_source->extent();
+        if (m_extent.width == 0 || m_extent.height == 0)
+            return;
+
+        // Down to 1x1
+        const uint32_t levels = std::bit_width(std::max(m_extent.width, m_extent.height));
+
+        m_device.createImage(
+            m_extent.width,
+            m_extent.height,
+            levels,
+            VK_FORMAT_R32_SFLOAT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            m_image,
+            m_allocation
+        );
+        m_view = m_device.createImageView(m_image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, levels);
+
+        m_mipViews.resize(levels);
+        for (uint32_t level = 0; level < levels; ++level)
+        {
+            VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            viewInfo.image = m_image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = VK_FORMAT_R32_SFLOAT;
+            viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+            if (vkCreateImageView(m_device.logical(), &viewInfo, nullptr, &m_mipViews[level]) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create a depth pyramid level view");
+        }
+
+        auto pool = EngineContext::get().globalDescriptorPool();
+        auto writeSet = [&](VkImageView source, VkImageLayout sourceLayout, VkImageView target)
+        {
+            VkDescriptorImageInfo sourceInfo{m_sampler, source, sourceLayout};
+            VkDescriptorImageInfo targetInfo{VK_NULL_HANDLE, target, VK_IMAGE_LAYOUT_GENERAL};
+
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            DescriptorWriter writer(m_setLayout, pool);
+            writer.writeImage(0, &sourceInfo)
+                  .writeImage(1, &targetInfo);
+            if (!writer.build(set))
+                throw std::runtime_error("Failed to allocate a depth pyramid descriptor set");
+            return set;
+        };
+
+        // Transient depth can't be sampled. The source only has it while
+        // occlusion culling is off, and with it nothing builds the pyramid; its
+        // views change when that switches, which recreates the pyramid.
+        const bool sampled = !m_source->transientDepth();
+        m_sourceViews.resize(m_source->numImages());
+        m_sourceSets.assign(m_source->numImages(), VK_NULL_HANDLE);
+        for (uint32_t i = 0; i < m_sourceViews.size(); ++i)
+        {
+            m_sourceViews[i] = m_source->depthView(i);
+            if (sampled)
+                m_sourceSets[i] = writeSet(m_sourceViews[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_mipViews[0]);
+        }
+
+        m_mipSets.resize(levels);
+        for (uint32_t level = 1; level < levels; ++level)
+            m_mipSets[level] = writeSet(m_mipViews[level - 1], VK_IMAGE_LAYOUT_GENERAL, m_mipViews[level]);
+
+        m_initialized = false;
+        m_valid = false;
+        m_generation++;
+    }
+
+    DepthPyramid::Retired DepthPyramid::collect()
+    {
+        Retired retired{m_image, m_allocation, m_view, std::move(m_mipViews), std::move(m_sourceSets)};
+        if (!m_mipSets.empty())
+            retired.sets.insert(retired.sets.end(), m_mipSets.begin() + 1, m_mipSets.end());
+
+        m_image = VK_NULL_HANDLE;
+        m_allocation = VK_NULL_HANDLE;
+        m_view = VK_NULL_HANDLE;
+        m_mipViews.clear();
+        m_sourceViews.clear();
+        m_sourceSets.clear();
+        m_mipSets.clear();
+        return retired;
+    }
+
+    void DepthPyramid::destroy(const Device& device, const DescriptorPool& pool, Retired retired)
+    {
+        if (retired.image == VK_NULL_HANDLE)
+            return;
+
+        pool.freeDescriptors(retired.sets);
+        for (VkImageView mipView : retired.mipViews)
+            vkDestroyImageView(device.logical(), mipView, nullptr);
+        vkDestroyImageView(device.logical(), retired.view, nullptr);
+        device.allocator().destroyImage(retired.image, retired.allocation);
+    }
+
+    void DepthPyramid::retire()
+    {
+        auto retired = std::make_shared<Retired>(collect());
+        m_device.deletionQueue().push(
+            [&device = m_device, pool = EngineContext::get().globalDescriptorPool(), retired]
+            {
+                destroy(device, *pool, std::move(*retired));
+            });
+    }
+
+    void DepthPyramid::build(VkCommandBuffer cmd, uint32_t index, const glm::mat4& viewProj)
+    {
+        if (m_image == VK_NULL_HANDLE || m_sourceSets[index] == VK_NULL_HANDLE)
+            return;
+
+        const VkImage depth = m_source->depthImage(index);
+
+        // Depth: attachment writes -> sampled reads. Pyramid: its last readers (this
+        // frame's early culling) must finish before it is overwritten; on first use
+        // it leaves UNDEFINED for good.
+        VkImageMemoryBarrier before[2]{};
+        before[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        before[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        before[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        before[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        before[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        before[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        before[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        before[0].image = depth;
+        before[0].subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+
+        before[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        before[1].srcAccessMask = 0;
+        before[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        before[1].oldLayout = m_initialized ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        before[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        before[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        before[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        before[1].image = m_image;
+        before[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels(), 0, 1};
+
+        vkCmdPipelineBarrier(
+            cmd,
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 2, before);
+        m_initialized = true;
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines.getPipeline(m_pipeline));
+        const VkPipelineLayout layout = m_pipelines.getLayout(m_pipeline);
+
+        for (uint32_t level = 0; level < levels(); ++level)
+        {
+            const VkExtent2D source = level == 0 ? m_extent : mipExtent(m_extent, level - 1);
+            const VkExtent2D target = mipExtent(m_extent, level);
+
+            VkDescriptorSet set = level == 0 ? m_sourceSets[index] : m_mipSets[level];
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &set, 0, nullptr);
+
+            ReduceParams params{
+                {static_cast<int>(source.width), static_cast<int>(source.height)},
+                {static_cast<int>(target.width), static_cast<int>(target.height)}
+            };
+            vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+            vkCmdDispatch(cmd, (target.width + LOCAL_SIZE - 1) / LOCAL_SIZE, (target.height + LOCAL_SIZE - 1) / LOCAL_SIZE, 1);
+
+            // The next level, and after the last one the occlusion test, reads this one
+            VkImageMemoryBarrier written{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            written.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            written.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            written.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            written.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            written.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            written.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            written.image = m_image;
+            written.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &written);
+        }
+
+        // Hand the depth image back to the render pass that continues drawing into it
+        VkImageMemoryBarrier after{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        after.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        after.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        after.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        after.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        after.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        after.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        after.image = depth;
+        after.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+
+        vkCmdPipelineBarrier(
+            cmd,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &after);
+
+        m_viewProj = viewProj;
+        m_valid = true;
+    }
+} // namespace vks
@@ -0,0 +1,144 @@
+#include <render/DrawList.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <tuple>
+
+namespace vks
+{
+    namespace
+    {
+        constexpr uint64_t field(uint64_t value, uint32_t bits, uint32_t shift)
+        {
+            return (value & ((uint64_t(1) << bits) - 1)) << shift;
+        }
+
+        constexpr uint32_t PIPELINE_BITS = 10;
+        constexpr uint32_t MATERIAL_BITS = 14;
+        constexpr uint32_t OPAQUE_MESH_BITS = 12;
+        constexpr uint32_t TRANSPARENT_MESH_BITS = 7;
+        constexpr uint32_t OPAQUE_DEPTH_BITS = 19;
+        constexpr uint32_t TRANSPARENT_DEPTH_BITS = 24;
+
+        uint64_t quantize(float value, uint32_t bits)
+        {
+            const uint64_t max = (uint64_t(1) << bits) - 1;
+            if (!(value > 0.0f)) // also catches NaN
+                return 0;
+            if (value >= 1.0f)
+                return max;
+            return static_cast<uint64_t>(std::lround(double(value) * double(max)));
+        }
+    }
+
+    uint64_t packDrawKey(const DrawKey& key)
+    {
+        // Biased so negative layers sort first
+        const uint64_t layer = static_cast<uint64_t>(std::clamp(key.layer, -128, 127) + 128);
+
+        uint64_t packed = field(layer, 8, 56);
+        if (!key.transparent)
+        {
+            packed |= field(key.pipeline, PIPELINE_BITS, 45);
+            packed |= field(key.material, MATERIAL_BITS, 31);
+            packed |= field(key.mesh, OPAQUE_MESH_BITS, 19);
+            packed |= field(quantize(key.depth, OPAQUE_DEPTH_BITS), OPAQUE_DEPTH_BITS, 0);
+        }
+        else
+        {
+            packed |= uint64_t(1) << 55;
+            packed |= field(~quantize(key.depth, TRANSPARENT_DEPTH_BITS), TRANSPARENT_DEPTH_BITS, 31);
+            packed |= field(key.pipeline, PIPELINE_BITS, 21);
+            packed |= field(key.material, MATERIAL_BITS, 7);
+            packed |= field(key.mesh, TRANSPARENT_MESH_BITS, 0);
+        }
+        return packed;
+    }
+
+    bool drawKeyFits(const DrawKey& key)
+    {
+        const uint32_t meshBits = key.transparent ? TRANSPARENT_MESH_BITS : OPAQUE_MESH_BITS;
+        return (key.pipeline >> PIPELINE_BITS) == 0 &&
+            (key.material >> MATERIAL_BITS) == 0 &&
+            (key.mesh >> meshBits) == 0;
+    }
+
+    bool drawKeyLess(const DrawKey& a, const DrawKey& b)
+    {
+        auto tuple = [](const DrawKey& key)
+        {
+            const int layer = std::clamp(key.layer, -128, 127);
+            // Quantized like the packed key, so draws it considers equal in depth stay in order
+            if (!key.transparent)
+                return std::make_tuple(layer, 0, uint64_t(0), key.pipeline, key.material, key.mesh,
+                                       quantize(key.depth, OPAQUE_DEPTH_BITS));
+            return std::make_tuple(layer, 1, ~quantize(key.depth, TRANSPARENT_DEPTH_BITS),
+                                   key.pipeline, key.material, key.mesh, uint64_t(0));
+        };
+        return tuple(a) < tuple(b);
+    }
+
+    void radixSort(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch)
+    {
+        const size_t count = packets.size();
+        if (count < 2)
+            return;
+
+        // All eight histograms in one read of the keys
+        std::array<std::array<uint32_t, 256>, 8> histograms{};
+        for (const DrawPacket& packet : packets)
+        {
+            for (uint32_t digit = 0; digit < 8; ++digit)
+                histograms[digit][(packet.key >> (digit * 8)) & 0xFF]++;
+        }
+
+        scratch.resize(count);
+        DrawPacket* src = packets.data();
+        DrawPacket* dst = scratch.data();
+
+        for (uint32_t digit = 0; digit < 8; ++digit)
+        {
+            auto& histogram = histograms[digit];
+            const uint32_t shift = digit * 8;
+
+            // Every key shares this digit: the pass wouldn't move anything
+            if (histogram[(src[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            uint32_t offset = 0;
+            for (uint32_t& bucket : histogram)
+            {
+                const uint32_t size = bucket;
+                bucket = offset;
+                offset += size;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+                dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+            std::swap(src, dst);
+        }
+
+        if (src != packets.data())
+            packets.swap(scratch);
+    }
+
+    bool sortDrawPackets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch,
+                         const std::vector<DrawKey>& keys)
+    {
+        const bool fits = std::all_of(packets.begin(), packets.end(),
+                                      [&keys](const DrawPacket& packet) { return drawKeyFits(keys[packet.index]); });
+        if (fits)
+        {
+            radixSort(packets, scratch);
+            return true;
+        }
+
+        std::stable_sort(packets.begin(), packets.end(), [&keys](const DrawPacket& a, const DrawPacket& b)
+        {
+            return drawKeyLess(keys[a.index], keys[b.index]);
+        });
+        return false;
+    }
+} // namespace vks
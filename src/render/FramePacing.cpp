@@ -0,0 +1,215 @@
+#include <render/FramePacing.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <gfx/Device.hpp>
+
+namespace vks
+{
+    FramePacingProfile framePacingProfile(FramePacing pacing)
+    {
+        switch (pacing)
+        {
+        case FramePacing::Balanced:
+            return {2, {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR}, false};
+        case FramePacing::LowLatency:
+            return {1, {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR}, true};
+        case FramePacing::Throughput:
+            return {3, {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR}, false};
+        }
+        throw std::runtime_error("Unknown frame pacing");
+    }
+
+    const char* toString(FramePacing pacing)
+    {
+        switch (pacing)
+        {
+        case FramePacing::Balanced: return "balanced";
+        case FramePacing::LowLatency: return "low latency";
+        case FramePacing::Throughput: return "throughput";
+        }
+        return "unknown";
+    }
+
+    FrameLatencyTracker::FrameLatencyTracker(const Device& device, VkSemaphore timeline, bool presentWait)
+        : m_device(device), m_timeline(timeline), m_presentWait(presentWait)
+    {
+        if (m_presentWait)
+        {
+            m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+                vkGetDeviceProcAddr(device.logical(), "vkWaitForPresentKHR"));
+            m_presentWait = m_waitForPresent != nullptr;
+        }
+        m_watcher = std::thread(&FrameLatencyTracker::watch, this);
+    }
+
+    FrameLatencyTracker::~FrameLatencyTracker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_sampleAvailable.notify_all();
+        m_watcher.join();
+    }
+
+    void FrameLatencyTracker::markInputSampled(uint64_t frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Samples are in frame order, so a re-sample can only match the
+            // back one; the newer sample wins
+            if (!m_pending.empty() && m_pending.back().frame == frame)
+                m_pending.back().sampled = Clock::now();
+            else
+                m_pending.push_back({frame, Clock::now()});
+        }
+        m_sampleAvailable.notify_one();
+    }
+
+    void FrameLatencyTracker::markPresented(uint64_t frame, VkSwapchainKHR swapChain)
+    {
+        if (swapChain == VK_NULL_HANDLE)
+        {
+            discard(frame);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = std::find_if(m_pending.begin(), m_pending.end(),
+                                   [frame](const Sample& sample) { return sample.frame == frame; });
+            if (it == m_pending.end())
+                return;
+
+            it->presented = true;
+            it->swapChain = swapChain;
+        }
+        m_sampleAvailable.notify_one();
+    }
+
+    void FrameLatencyTracker::discard(uint64_t frame)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::erase_if(m_pending, [frame](const Sample& sample) { return sample.frame == frame; });
+    }
+
+    void FrameLatencyTracker::retireSwapChain(VkSwapchainKHR swapChain)
+    {
+        std::lock_guard<std::mutex> waitLock(m_presentWaitMutex);
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Their present IDs belong to a swapchain that is going away
+        std::erase_if(m_pending, [swapChain](const Sample& sample)
+        {
+            return sample.presented && sample.swapChain == swapChain;
+        });
+    }
+
+    FrameLatencyTracker::Stats FrameLatencyTracker::stats() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    void FrameLatencyTracker::reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats = {};
+        m_totalMs = 0.0;
+    }
+
+    void FrameLatencyTracker::watch()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            // Measuring to present, the front frame also has to be queued for it
+            m_sampleAvailable.wait(lock, [this]
+            {
+                return m_stopping || (!m_pending.empty() && (!m_presentWait || m_pending.front().presented));
+            });
+            if (m_stopping)
+                return;
+
+            const uint64_t frame = m_pending.front().frame;
+            const VkSwapchainKHR swapChain = m_pending.front().swapChain;
+            lock.unlock();
+
+            VkResult result = waitForFrame(frame, swapChain);
+
+            const Clock::time_point finished = Clock::now();
+            lock.lock();
+
+            if (result == VK_TIMEOUT)
+                continue;
+
+            if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            {
+                // e.g. out of date: the frame won't reach the end point
+                if (!m_pending.empty() && m_pending.front().frame == frame)
+                    m_pending.pop_front();
+                continue;
+            }
+
+            retire(frame, finished);
+        }
+    }
+
+    VkResult FrameLatencyTracker::waitForFrame(uint64_t frame, VkSwapchainKHR swapChain)
+    {
+        // Short timeout so shutdown never hangs on a frame that won't be submitted
+        constexpr uint64_t timeoutNs = 50'000'000;
+
+        if (!m_presentWait)
+        {
+            VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &m_timeline;
+            waitInfo.pValues = &frame;
+            return vkWaitSemaphores(m_device.logical(), &waitInfo, timeoutNs);
+        }
+
+        std::lock_guard<std::mutex> waitLock(m_presentWaitMutex);
+        {
+            // The swapchain may have been retired before the wait lock was
+            // taken; look again
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_pending.empty() || m_pending.front().frame != frame)
+                return VK_TIMEOUT;
+        }
+        // The present ID is the frame's timeline value
+        return m_waitForPresent(m_device.logical(), swapChain, frame, timeoutNs);
+    }
+
+    void FrameLatencyTracker::retire(uint64_t frame, Clock::time_point finished)
+    {
+        // One GPU signal or present retires every sample up to its value
+        while (!m_pending.empty() && m_pending.front().frame <= frame)
+        {
+            const double ms = std::chrono::duration<double, std::milli>(
+                finished - m_pending.front().sampled).count();
+            m_pending.pop_front();
+
+            if (m_stats.frames == 0)
+            {
+                m_stats.minMs = m_stats.maxMs = ms;
+                m_firstCompletion = finished;
+            }
+            m_stats.frames++;
+            m_stats.lastMs = ms;
+            m_stats.minMs = std::min(m_stats.minMs, ms);
+            m_stats.maxMs = std::max(m_stats.maxMs, ms);
+            m_totalMs += ms;
+            m_stats.averageMs = m_totalMs / static_cast<double>(m_stats.frames);
+            m_lastCompletion = finished;
+        }
+
+        const double seconds = std::chrono::duration<double>(m_lastCompletion - m_firstCompletion).count();
+        if (m_stats.frames > 1 && seconds > 0.0)
+            m_stats.framesPerSecond = static_cast<double>(m_stats.frames - 1) / seconds;
+    }
+} // namespace vks
@@ -0,0 +1,101 @@
+#include <render/FrustumCuller.hpp>
+
+#include <bit>
+#include <limits>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace vks
+{
+    void FrustumCuller::clear()
+    {
+        m_x.clear();
+        m_y.clear();
+        m_z.clear();
+        m_radius.clear();
+        m_visible.clear();
+    }
+
+    void FrustumCuller::reserve(size_t count)
+    {
+        m_x.reserve(count);
+        m_y.reserve(count);
+        m_z.reserve(count);
+        m_radius.reserve(count);
+        m_visible.reserve(count);
+    }
+
+    size_t FrustumCuller::add(const BoundingSphere& sphere)
+    {
+        m_x.push_back(sphere.center.x);
+        m_y.push_back(sphere.center.y);
+        m_z.push_back(sphere.center.z);
+        m_radius.push_back(sphere.radius);
+        m_visible.push_back(0);
+        return m_radius.size() - 1;
+    }
+
+    size_t FrustumCuller::addAlwaysVisible()
+    {
+        return add({glm::vec3(0.0f), std::numeric_limits<float>::infinity()});
+    }
+
+    size_t FrustumCuller::cull(const Frustum& frustum)
+    {
+        const size_t count = m_radius.size();
+        size_t visibleCount = 0;
+        size_t i = 0;
+
+#if defined(__AVX2__) && defined(__FMA__)
+        __m256 nx[Frustum::Count], ny[Frustum::Count], nz[Frustum::Count], nw[Frustum::Count];
+        for (int p = 0; p < Frustum::Count; ++p)
+        {
+            nx[p] = _mm256_set1_ps(frustum.planes[p].x);
+            ny[p] = _mm256_set1_ps(frustum.planes[p].y);
+            nz[p] = _mm256_set1_ps(frustum.planes[p].z);
+            nw[p] = _mm256_set1_ps(frustum.planes[p].w);
+        }
+
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(m_x.data() + i);
+            const __m256 y = _mm256_loadu_ps(m_y.data() + i);
+            const __m256 z = _mm256_loadu_ps(m_z.data() + i);
+            const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(m_radius.data() + i));
+
+            // A sphere survives a plane when dot(n, c) + w >= -r
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < Frustum::Count; ++p)
+            {
+                __m256 d = _mm256_fmadd_ps(x, nx[p], nw[p]);
+                d = _mm256_fmadd_ps(y, ny[p], d);
+                d = _mm256_fmadd_ps(z, nz[p], d);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negRadius, _CMP_GE_OQ));
+            }
+
+            const int mask = _mm256_movemask_ps(inside);
+            for (int lane = 0; lane < 8; ++lane)
+                m_visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+            visibleCount += static_cast<size_t>(std::popcount(static_cast<unsigned>(mask)));
+        }
+#endif
+
+        // Remainder, or everything without AVX2. Same comparison as the vector
+        // path so both agree on spheres that touch a plane.
+        for (; i < count; ++i)
+        {
+            bool inside = true;
+            for (const auto& plane : frustum.planes)
+            {
+                const float d = m_x[i] * plane.x + m_y[i] * plane.y + m_z[i] * plane.z + plane.w;
+                inside = inside && d >= -m_radius[i];
+            }
+            m_visible[i] = inside ? 1 : 0;
+            visibleCount += inside ? 1 : 0;
+        }
+
+        return visibleCount;
+    }
+} // namespace vks
@@ -0,0 +1,177 @@
+#include <render/GpuProfiler.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <gfx/Device.hpp>
+
+namespace vks
+{
+    GpuProfiler::GpuProfiler(const Device& device, uint32_t frameSlots)
+        : m_device(device)
+    {
+        const VkPhysicalDeviceProperties properties = device.properties();
+        m_timestampPeriodNs = properties.limits.timestampPeriod;
+
+        // Timestamps are only meaningful if the graphics family writes them
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device.physical(), &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device.physical(), &familyCount, families.data());
+
+        const uint32_t validBits = families[device.queueFamilyIndices().graphicsFamily.value()].timestampValidBits;
+        m_supported = validBits != 0 && m_timestampPeriodNs > 0.0;
+        if (!m_supported)
+            return;
+
+        m_computeTimestamps = families[device.computeFamily()].timestampValidBits != 0;
+        m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+        m_enabled = true;
+
+        m_slots.resize(frameSlots);
+        for (auto& slot : m_slots)
+        {
+            VkQueryPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+            poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            poolInfo.queryCount = MAX_SCOPES_PER_FRAME * 2;
+
+            if (vkCreateQueryPool(device.logical(), &poolInfo, nullptr, &slot.pool) != VK_SUCCESS)
+                throw std::runtime_error("failed to create timestamp query pool!");
+
+            // Queries must be reset before their first use
+            vkResetQueryPool(device.logical(), slot.pool, 0, poolInfo.queryCount);
+        }
+    }
+
+    GpuProfiler::~GpuProfiler()
+    {
+        for (auto& slot : m_slots)
+            vkDestroyQueryPool(m_device.logical(), slot.pool, nullptr);
+    }
+
+    void GpuProfiler::beginFrame(uint32_t frameSlot)
+    {
+        m_current = nullptr;
+        m_depth = 0;
+        if (!m_supported)
+            return;
+
+        Slot& slot = m_slots[frameSlot];
+        resolve(slot);
+
+        // Host reset (core 1.2): no command buffer ordering to worry about, and
+        // scopes may then be written from any queue
+        if (!slot.scopes.empty())
+            vkResetQueryPool(m_device.logical(), slot.pool, 0, static_cast<uint32_t>(slot.scopes.size()) * 2);
+        slot.scopes.clear();
+
+        if (m_enabled)
+            m_current = &slot;
+    }
+
+    uint32_t GpuProfiler::beginScope(VkCommandBuffer cmd, const char* name)
+    {
+        if (!m_current || m_current->scopes.size() >= MAX_SCOPES_PER_FRAME)
+            return INVALID_SCOPE;
+
+        const auto id = static_cast<uint32_t>(m_current->scopes.size());
+        m_current->scopes.push_back({name, m_depth++});
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_current->pool, id * 2);
+        return id;
+    }
+
+    void GpuProfiler::endScope(VkCommandBuffer cmd, uint32_t scope)
+    {
+        if (!m_current || scope == INVALID_SCOPE)
+            return;
+
+        m_depth--;
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_current->pool, scope * 2 + 1);
+    }
+
+    void GpuProfiler::resolve(Slot& slot)
+    {
+        if (slot.scopes.empty())
+            return;
+
+        // [timestamp, availability] per query
+        const auto queryCount = static_cast<uint32_t>(slot.scopes.size()) * 2;
+        std::vector<uint64_t> results(queryCount * 2);
+
+        VkResult result = vkGetQueryPoolResults(
+            m_device.logical(), slot.pool, 0, queryCount,
+            results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        if (result != VK_SUCCESS && result != VK_NOT_READY)
+            return;
+
+        m_resolvedFrames++;
+        double frameMs = 0.0;
+        for (size_t i = 0; i < slot.scopes.size(); ++i)
+        {
+            const uint64_t* begin = &results[i * 4];
+            const uint64_t* end = &results[i * 4 + 2];
+
+            // Unavailable if the frame never got submitted
+            if (begin[1] == 0 || end[1] == 0)
+                continue;
+
+            const uint64_t ticks = ((end[0] & m_timestampMask) - (begin[0] & m_timestampMask)) & m_timestampMask;
+            const double ms = static_cast<double>(ticks) * m_timestampPeriodNs * 1e-6;
+
+            addSample(slot.scopes[i], ms);
+            if (slot.scopes[i].depth == 0)
+                frameMs += ms;
+        }
+        m_frameMs = frameMs;
+    }
+
+    void GpuProfiler::addSample(const ScopeRecord& scope, double ms)
+    {
+        auto [it, inserted] = m_timingIndex.try_emplace(scope.name, m_timings.size());
+        if (inserted)
+        {
+            Timing timing{};
+            timing.name = scope.name;
+            timing.history.reserve(HISTORY_FRAMES);
+            m_timings.push_back(std::move(timing));
+        }
+
+        Timing& timing = m_timings[it->second];
+        timing.depth = scope.depth;
+        timing.lastMs = ms;
+
+        // A scope recorded more than once per frame accumulates into one sample
+        if (timing.lastFrame == m_resolvedFrames && !timing.history.empty())
+        {
+            uint32_t last = (timing.next + HISTORY_FRAMES - 1) % HISTORY_FRAMES;
+            if (last < timing.history.size())
+            {
+                timing.history[last] += ms;
+                timing.lastMs = timing.history[last];
+            }
+        }
+        else if (timing.history.size() < HISTORY_FRAMES)
+        {
+            timing.history.push_back(ms);
+            timing.next = static_cast<uint32_t>(timing.history.size()) % HISTORY_FRAMES;
+        }
+        else
+        {
+            timing.history[timing.next] = ms;
+            timing.next = (timing.next + 1) % HISTORY_FRAMES;
+        }
+        timing.lastFrame = m_resolvedFrames;
+
+        double sum = 0.0;
+        timing.minMs = timing.maxMs = timing.history.front();
+        for (double sample : timing.history)
+        {
+            sum += sample;
+            timing.minMs = std::min(timing.minMs, sample);
+            timing.maxMs = std::max(timing.maxMs, sample);
+        }
+        timing.averageMs = sum / static_cast<double>(timing.history.size());
+    }
+} // namespace vks
@@ -0,0 +1,419 @@
+#include <render/GpuScene.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "app/EngineContext.hpp"
+#include "gfx/Buffer.hpp"
+#include "gfx/Descriptors.hpp"
+#include "materials/Material.hpp"
+#include "render/RenderGraph.hpp"
+#include "render/RenderGraphResources.hpp"
+#include "scene/Model.hpp"
+
+namespace vks
+{
+    static_assert(sizeof(GpuScene::ObjectData) == 64, "ObjectData must match the std430 struct in draw_commands.comp");
+
+    GpuScene::GpuScene(const Device& device, Scene& scene, Filter filter)
+        : m_device(device), m_scene(scene), m_filter(std::move(filter))
+    {
+        auto& registry = m_scene.getRegistry();
+        registry.on_construct<Renderable>().connect<&GpuScene::onConstruct>(this);
+        // A changed model or material moves the object to another group
+        registry.on_update<Renderable>().connect<&GpuScene::onConstruct>(this);
+        registry.on_destroy<Renderable>().connect<&GpuScene::onDestroy>(this);
+        registry.on_update<Transform>().connect<&GpuScene::onTransform>(this);
+
+        // Renderables created before us
+        for (auto entity : registry.view<Renderable>())
+            m_added.push_back(entity);
+
+        reserve(MIN_OBJECT_CAPACITY, MIN_GROUP_CAPACITY);
+    }
+
+    GpuScene::~GpuScene()
+    {
+        m_scene.getRegistry().on_construct<Renderable>().disconnect(this);
+        m_scene.getRegistry().on_update<Renderable>().disconnect(this);
+        m_scene.getRegistry().on_destroy<Renderable>().disconnect(this);
+        m_scene.getRegistry().on_update<Transform>().disconnect(this);
+    }
+
+    void GpuScene::onConstruct(entt::registry&, entt::entity entity)
+    {
+        // The component is usually filled in after emplace(), so look at it later
+        m_added.push_back(entity);
+    }
+
+    void GpuScene::onDestroy(entt::registry&, entt::entity entity)
+    {
+        m_removed.push_back(entity);
+    }
+
+    void GpuScene::onTransform(entt::registry&, entt::entity entity)
+    {
+        auto it = m_entries.find(entity);
+        if (it != m_entries.end() && it->second.gpu)
+            markDirty(it->second.index);
+    }
+
+    void GpuScene::sync()
+    {
+        auto& registry = m_scene.getRegistry();
+
+        // Removals first: an entity removed and added again since the last sync stays
+        for (Entity entity : m_removed)
+            release(entity);
+        m_removed.clear();
+
+        for (Entity entity : m_added)
+        {
+            release(entity);
+            if (registry.valid(entity) && registry.all_of<Renderable, Transform>(entity))
+                insert(entity);
+        }
+        m_added.clear();
+
+        reserve(m_objects.size(), m_groups.size());
+
+        if (m_groupsDirty)
+        {
+            uint32_t offset = 0;
+            for (auto& group : m_groups)
+            {
+                group.commandOffset = offset;
+                offset += group.objectCount;
+            }
+        }
+    }
+
+    void GpuScene::insert(Entity entity)
+    {
+        const Renderable& renderable = m_scene.getComponent<Renderable>(entity);
+        if (!renderable.model || !renderable.material || !m_filter(*renderable.material))
+        {
+            m_entries[entity] = {false, static_cast<uint32_t>(m_fallback.size())};
+            m_fallback.push_back(entity);
+            return;
+        }
+
+        uint32_t slot;
+        if (!m_freeSlots.empty())
+        {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<uint32_t>(m_objects.size());
+            m_objects.emplace_back();
+            m_slotEntities.push_back(entt::null);
+            m_slotDirty.push_back(0);
+        }
+
+        // Models are ranges of the geometry pool; the commands carry where
+        ObjectData& object = m_objects[slot];
+        const Model& model = *renderable.model;
+        object.lodCount = model.lodCount();
+        object.vertexOffset = model.vertexOffset();
+        for (uint32_t level = 0; level < model.lodCount(); ++level)
+            object.lods[level] = {model.lod(level).firstIndex, model.lod(level).indexCount};
+        object.group = acquireGroup(renderable.model, renderable.material);
+        object.materialIndex = renderable.material->getMaterialIndex();
+        // Transformed on the GPU, so moving the object only re-uploads its transform.
+        // That transform includes the vertex transform, so the sphere is expressed
+        // in the space of the vertex buffer; the vertex transform scales uniformly.
+        const BoundingSphere& sphere = renderable.model->boundingSphere();
+        const glm::mat4& vertexTransform = model.vertexTransform();
+        const glm::vec3 center = glm::vec3(glm::inverse(vertexTransform) * glm::vec4(sphere.center, 1.0f));
+        object.sphere = glm::vec4(center, sphere.radius / vertexTransform[0][0]);
+
+        m_slotEntities[slot] = entity;
+        m_entries[entity] = {true, slot};
+        markDirty(slot);
+    }
+
+    void GpuScene::release(Entity entity)
+    {
+        auto it = m_entries.find(entity);
+        if (it == m_entries.end())
+            return;
+
+        const Entry entry = it->second;
+        m_entries.erase(it);
+
+        if (!entry.gpu)
+        {
+            // Swap-remove, keeping the moved entity's index current
+            Entity moved = m_fallback.back();
+            m_fallback[entry.index] = moved;
+            m_fallback.pop_back();
+            if (moved != entity)
+                m_entries[moved].index = entry.index;
+            return;
+        }
+
+        releaseGroup(m_objects[entry.index].group);
+        m_objects[entry.index] = {};
+        m_slotEntities[entry.index] = entt::null;
+        m_freeSlots.push_back(entry.index);
+        markDirty(entry.index);
+    }
+
+    uint32_t GpuScene::acquireGroup(const Ref<Model>& model, const Ref<Material>& material)
+    {
+        m_groupsDirty = true;
+
+        const GroupKey key{material->getPipeline().id, material->descriptorSetKey(), model->geometry()};
+        auto it = m_groupIds.find(key);
+        if (it != m_groupIds.end())
+        {
+            m_groups[it->second].objectCount++;
+            return it->second;
+        }
+
+        uint32_t id;
+        if (!m_freeGroups.empty())
+        {
+            id = m_freeGroups.back();
+            m_freeGroups.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(m_groups.size());
+            m_groups.emplace_back();
+        }
+
+        m_groups[id] = {material->getPipeline(), material, model->geometry(), 0, 1};
+        m_groupIds.emplace(key, id);
+        return id;
+    }
+
+    void GpuScene::releaseGroup(uint32_t id)
+    {
+        m_groupsDirty = true;
+
+        DrawGroup& group = m_groups[id];
+        if (--group.objectCount > 0)
+            return;
+
+        // Keeping the reference would keep an unused material alive
+        m_groupIds.erase(GroupKey{group.pipeline.id, group.material->descriptorSetKey(), group.geometry});
+        group = {};
+        m_freeGroups.push_back(id);
+    }
+
+    void GpuScene::markDirty(uint32_t slot)
+    {
+        if (m_slotDirty[slot])
+            return;
+
+        m_slotDirty[slot] = 1;
+        m_dirtySlots.push_back(slot);
+    }
+
+    void GpuScene::reserve(size_t objects, size_t groups)
+    {
+        if (m_transforms && objects <= m_objectCapacity && groups <= m_groupCapacity)
+            return;
+
+        if (objects > m_objectCapacity)
+            m_objectCapacity = std::max({objects, m_objectCapacity * 2, MIN_OBJECT_CAPACITY});
+        if (groups > m_groupCapacity)
+            m_groupCapacity = std::max({groups, m_groupCapacity * 2, MIN_GROUP_CAPACITY});
+
+        // In-flight frames may still read the old buffers and set
+        auto& ec = EngineContext::get();
+        if (m_transforms)
+        {
+            m_device.deletionQueue().push(
+                [transforms = std::shared_ptr<Buffer>(std::move(m_transforms)),
+                    objectBuffer = std::shared_ptr<Buffer>(std::move(m_objectBuffer)),
+                    groupOffsets = std::shared_ptr<Buffer>(std::move(m_groupOffsets)),
+                    commands = std::shared_ptr<Buffer>(std::move(m_commands)),
+                    counts = std::shared_ptr<Buffer>(std::move(m_counts)),
+                    cullFlags = std::shared_ptr<Buffer>(std::move(m_cullFlags)),
+                    lateCommands = std::shared_ptr<Buffer>(std::move(m_lateCommands)),
+                    lateCounts = std::shared_ptr<Buffer>(std::move(m_lateCounts)),
+                    materialIndices = std::shared_ptr<Buffer>(std::move(m_materialIndices)),
+                    pool = ec.globalDescriptorPool(), set = m_instanceSet]
+                {
+                    std::vector<VkDescriptorSet> sets{set};
+                    pool->freeDescriptors(sets);
+                });
+            m_instanceSet = VK_NULL_HANDLE;
+        }
+
+        auto deviceBuffer = [&](VkDeviceSize size, VkBufferUsageFlags usage)
+        {
+            return std::make_unique<Buffer>(m_device, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        };
+
+        constexpr VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        constexpr VkBufferUsageFlags uploaded = storage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        m_transforms = deviceBuffer(m_objectCapacity * sizeof(glm::mat4), uploaded);
+        m_objectBuffer = deviceBuffer(m_objectCapacity * sizeof(ObjectData), uploaded);
+        m_groupOffsets = deviceBuffer(m_groupCapacity * sizeof(uint32_t), uploaded);
+        m_commands = deviceBuffer(m_objectCapacity * sizeof(VkDrawIndexedIndirectCommand),
+                                  storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        m_counts = deviceBuffer(m_groupCapacity * sizeof(uint32_t), uploaded | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        m_cullFlags = deviceBuffer(m_objectCapacity * sizeof(uint32_t), storage);
+        m_lateCommands = deviceBuffer(m_objectCapacity * sizeof(VkDrawIndexedIndirectCommand),
+                                      storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        m_lateCounts = deviceBuffer(m_groupCapacity * sizeof(uint32_t), uploaded | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        m_materialIndices = deviceBuffer(m_objectCapacity * sizeof(uint32_t), storage);
+
+        auto bufferInfo = m_transforms->descriptorInfo();
+        auto materialInfo = m_materialIndices->descriptorInfo();
+        DescriptorWriter writer(ec.getDescriptorSetLayout("instances"), ec.globalDescriptorPool());
+        writer.writeBuffer(0, &bufferInfo)
+              .writeBuffer(1, &materialInfo);
+        if (!writer.build(m_instanceSet))
+            throw std::runtime_error("Failed to allocate the GPU scene instance descriptor set");
+
+        // The new buffers start out empty
+        for (uint32_t slot = 0; slot < m_objects.size(); ++slot)
+            markDirty(slot);
+        m_groupsDirty = true;
+
+        m_generation++;
+        ec.renderer().invalidate();
+    }
+
+    GpuScene::Staging& GpuScene::reserveStaging(uint32_t frameIndex, VkDeviceSize size)
+    {
+        if (m_staging.size() <= frameIndex)
+            m_staging.resize(frameIndex + 1);
+
+        Staging& staging = m_staging[frameIndex];
+        if (staging.buffer && staging.capacity >= size)
+            return staging;
+
+        // This slot's previous frame has completed, so its buffer is free
+        staging.capacity = std::max(size, staging.capacity * 2);
+        staging.buffer = std::make_unique<Buffer>(
+            m_device,
+            staging.capacity,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        staging.buffer->map();
+        return staging;
+    }
+
+    void GpuScene::setup(RenderGraphBuilder& builder)
+    {
+        builder.write(*m_transforms, ResourceUsage::TransferDst)
+               .write(*m_objectBuffer, ResourceUsage::TransferDst)
+               .write(*m_groupOffsets, ResourceUsage::TransferDst)
+               .write(*m_counts, ResourceUsage::TransferDst)
+               .write(*m_lateCounts, ResourceUsage::TransferDst);
+    }
+
+    void GpuScene::prepare(ParallelCommandRecorder& recorder, uint32_t currentImage)
+    {
+        m_transformCopies.clear();
+        m_objectCopies.clear();
+        m_groupCopy.size = 0;
+
+        const VkDeviceSize groupBytes = m_groupsDirty ? m_groups.size() * sizeof(uint32_t) : 0;
+        if (m_dirtySlots.empty() && groupBytes == 0)
+            return;
+
+        const uint32_t frameIndex = EngineContext::get().renderer().getCurrentFrameIndex();
+        const VkDeviceSize transformBytes = m_dirtySlots.size() * sizeof(glm::mat4);
+        const VkDeviceSize objectBytes = m_dirtySlots.size() * sizeof(ObjectData);
+
+        Staging& staging = reserveStaging(frameIndex, transformBytes + objectBytes + groupBytes);
+        auto* mapped = static_cast<uint8_t*>(staging.buffer->getMapped());
+        auto* transforms = reinterpret_cast<glm::mat4*>(mapped);
+        auto* objects = reinterpret_cast<ObjectData*>(mapped + transformBytes);
+
+        // One region per run of consecutive slots; after a full re-upload that is one in total
+        auto append = [](std::vector<VkBufferCopy>& copies, VkDeviceSize src, VkDeviceSize dst, VkDeviceSize size)
+        {
+            if (!copies.empty())
+            {
+                VkBufferCopy& last = copies.back();
+                if (last.srcOffset + last.size == src && last.dstOffset + last.size == dst)
+                {
+                    last.size += size;
+                    return;
+                }
+            }
+            copies.push_back({src, dst, size});
+        };
+
+        auto& registry = m_scene.getRegistry();
+        uint32_t transformCount = 0;
+        for (uint32_t i = 0; i < m_dirtySlots.size(); ++i)
+        {
+            const uint32_t slot = m_dirtySlots[i];
+            m_slotDirty[slot] = 0;
+
+            objects[i] = m_objects[slot];
+            append(m_objectCopies, transformBytes + i * sizeof(ObjectData), slot * sizeof(ObjectData),
+                   sizeof(ObjectData));
+
+            // Freed slots only need their record cleared
+            const Entity entity = m_slotEntities[slot];
+            if (entity == entt::null)
+                continue;
+
+            const auto& [renderable, transform] = registry.get<Renderable, Transform>(entity);
+            transforms[transformCount] = transform.transform * renderable.model->vertexTransform();
+            append(m_transformCopies, transformCount * sizeof(glm::mat4), slot * sizeof(glm::mat4),
+                   sizeof(glm::mat4));
+            transformCount++;
+        }
+        m_dirtySlots.clear();
+
+        if (groupBytes > 0)
+        {
+            auto* offsets = reinterpret_cast<uint32_t*>(mapped + transformBytes + objectBytes);
+            for (size_t i = 0; i < m_groups.size(); ++i)
+                offsets[i] = m_groups[i].commandOffset;
+
+            m_groupCopy = {transformBytes + objectBytes, 0, groupBytes};
+            m_groupsDirty = false;
+        }
+    }
+
+    void GpuScene::record(VkCommandBuffer cmd, uint32_t currentImage)
+    {
+        // The graph orders accesses within a frame only. These buffers persist, so
+        // the previous frame's draws and command generation must finish reading
+        // them (and writing the commands) before this frame overwrites them.
+        VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            cmd,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        const uint32_t frameIndex = EngineContext::get().renderer().getCurrentFrameIndex();
+        if (frameIndex < m_staging.size() && m_staging[frameIndex].buffer)
+        {
+            VkBuffer staging = m_staging[frameIndex].buffer->getBuffer();
+            if (!m_transformCopies.empty())
+                vkCmdCopyBuffer(cmd, staging, m_transforms->getBuffer(),
+                                static_cast<uint32_t>(m_transformCopies.size()), m_transformCopies.data());
+            if (!m_objectCopies.empty())
+                vkCmdCopyBuffer(cmd, staging, m_objectBuffer->getBuffer(),
+                                static_cast<uint32_t>(m_objectCopies.size()), m_objectCopies.data());
+            if (m_groupCopy.size > 0)
+                vkCmdCopyBuffer(cmd, staging, m_groupOffsets->getBuffer(), 1, &m_groupCopy);
+        }
+
+        // DrawCommandPass appends to every group from zero
+        vkCmdFillBuffer(cmd, m_counts->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        vkCmdFillBuffer(cmd, m_lateCounts->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+    }
+} // namespace vks
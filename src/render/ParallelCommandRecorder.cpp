@@ -0,0 +1,146 @@
+#include <render/ParallelCommandRecorder.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <app/EngineContext.hpp>
+#include <gfx/Device.hpp>
+
+namespace vks
+{
+    void ParallelCommandRecorder::Recording::execute(VkCommandBuffer primary)
+    {
+        uint32_t pending;
+        while ((pending = m_pending.load()) != 0)
+            m_pending.wait(pending);
+
+        if (m_error)
+            std::rethrow_exception(m_error);
+
+        if (m_buffers.empty())
+            return;
+
+        vkCmdExecuteCommands(primary, static_cast<uint32_t>(m_buffers.size()), m_buffers.data());
+    }
+
+    ParallelCommandRecorder::ParallelCommandRecorder(const Device& device, uint32_t framesInFlight,
+                                                     uint32_t workerCount)
+        : m_device(device),
+          m_framesInFlight(framesInFlight),
+          m_threads(workerCount)
+    {
+        m_threadFrames.resize(m_threads.workerCount() * m_framesInFlight);
+        for (auto& threadFrame : m_threadFrames)
+            threadFrame.pool = std::make_unique<CommandPool>(device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
+
+    ParallelCommandRecorder::~ParallelCommandRecorder()
+    {
+        m_threads.wait();
+    }
+
+    void ParallelCommandRecorder::beginFrame(uint32_t frameIndex)
+    {
+        // Recordings nobody executed (e.g. a pass threw) must not still be
+        // writing into buffers we are about to reset
+        m_threads.wait();
+
+        m_frameIndex = frameIndex;
+        for (uint32_t worker = 0; worker < m_threads.workerCount(); worker++)
+        {
+            auto& threadFrame = m_threadFrames[worker * m_framesInFlight + frameIndex];
+            vkResetCommandPool(m_device.logical(), threadFrame.pool->handle(), 0);
+            threadFrame.used = 0;
+        }
+    }
+
+    VkCommandBuffer ParallelCommandRecorder::acquire(uint32_t worker)
+    {
+        auto& threadFrame = m_threadFrames[worker * m_framesInFlight + m_frameIndex];
+
+        if (threadFrame.used == threadFrame.buffers.size())
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = threadFrame.pool->handle();
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer buffer;
+            if (vkAllocateCommandBuffers(m_device.logical(), &allocInfo, &buffer) != VK_SUCCESS)
+                throw std::runtime_error("failed to allocate secondary command buffer!");
+
+            threadFrame.buffers.push_back(buffer);
+        }
+
+        return threadFrame.buffers[threadFrame.used++];
+    }
+
+    Ref<ParallelCommandRecorder::Recording> ParallelCommandRecorder::record(
+        VkRenderPass renderPass, VkFramebuffer framebuffer, size_t count, size_t minChunk, RecordFn fn)
+    {
+        auto recording = std::make_shared<Recording>();
+        if (count == 0)
+            return recording;
+
+        minChunk = std::max<size_t>(minChunk, 1);
+        size_t chunks = std::min<size_t>((count + minChunk - 1) / minChunk, m_threads.workerCount());
+        chunks = std::max<size_t>(chunks, 1);
+
+        recording->m_buffers.resize(chunks, VK_NULL_HANDLE);
+        recording->m_pending = static_cast<uint32_t>(chunks);
+
+        // Passes reach the engine through EngineContext, which is thread-local
+        Engine* engine = &EngineContext::get();
+        auto shared = std::make_shared<RecordFn>(std::move(fn));
+
+        for (size_t chunk = 0; chunk < chunks; chunk++)
+        {
+            size_t begin = count * chunk / chunks;
+            size_t end = count * (chunk + 1) / chunks;
+
+            m_threads.submit([=, this](uint32_t worker)
+            {
+                EngineContext::set(engine);
+
+                try
+                {
+                    VkCommandBuffer cmd = acquire(worker);
+
+                    VkCommandBufferInheritanceInfo inheritance{};
+                    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+                    inheritance.renderPass = renderPass;
+                    inheritance.subpass = 0;
+                    inheritance.framebuffer = framebuffer;
+
+                    VkCommandBufferBeginInfo beginInfo{};
+                    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT |
+                        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                    beginInfo.pInheritanceInfo = &inheritance;
+
+                    if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+                        throw std::runtime_error("failed to begin secondary command buffer!");
+
+                    (*shared)(cmd, begin, end);
+
+                    if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+                        throw std::runtime_error("failed to record secondary command buffer!");
+
+                    recording->m_buffers[chunk] = cmd;
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(recording->m_errorMutex);
+                    if (!recording->m_error)
+                        recording->m_error = std::current_exception();
+                }
+
+                if (recording->m_pending.fetch_sub(1) == 1)
+                    recording->m_pending.notify_all();
+            });
+        }
+
+        return recording;
+    }
+} // namespace vks
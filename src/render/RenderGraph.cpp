@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <optional>
+#include <queue>
 #include <stdexcept>
 #include <glm/vec2.hpp>
 
@@ -7,48 +12,815 @@
 #include <render/RenderGraph.hpp>
 
 #include "core/Log.hpp"
+#include "gfx/Buffer.hpp"
 
 namespace vks
 {
-    RenderGraph::RenderGraph(const Device& device, const Ref<SwapChain>& swapChain, const CommandPool& commandPool): device(device),
+    namespace
+    {
+        constexpr VkAccessFlags kWriteAccess =
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_TRANSFER_WRITE_BIT |
+            VK_ACCESS_SHADER_WRITE_BIT |
+            VK_ACCESS_HOST_WRITE_BIT |
+            VK_ACCESS_MEMORY_WRITE_BIT;
+
+        VkImageAspectFlags depthAspectMask(VkFormat format)
+        {
+            if (format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT)
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+    }
+
+    const char* toString(RenderPassType type)
+    {
+        switch (type)
+        {
+        case RenderPassType::Geometry: return "Geometry";
+        case RenderPassType::Shadow: return "Shadow";
+        case RenderPassType::Lighting: return "Lighting";
+        case RenderPassType::PostProcess: return "PostProcess";
+        case RenderPassType::ImGui: return "ImGui";
+        case RenderPassType::Editor: return "Editor";
+        case RenderPassType::Compute: return "Compute";
+        case RenderPassType::Transfer: return "Transfer";
+        case RenderPassType::Custom: return "Custom";
+        }
+        return "Unknown";
+    }
+
+    ResourceState usageState(ResourceUsage usage)
+    {
+        switch (usage)
+        {
+        case ResourceUsage::ColorAttachment:
+            return {
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true
+            };
+        case ResourceUsage::DepthAttachment:
+            return {
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true
+            };
+        case ResourceUsage::SampledRead:
+            return {
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false
+            };
+        case ResourceUsage::TransferSrc:
+            return {
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false
+            };
+        case ResourceUsage::TransferDst:
+            return {
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true
+            };
+        case ResourceUsage::StorageRead:
+            return {
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, false
+            };
+        case ResourceUsage::StorageWrite:
+            return {
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, true
+            };
+        case ResourceUsage::VertexStorageRead:
+            return {
+                VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                VK_IMAGE_LAYOUT_GENERAL, false
+            };
+        case ResourceUsage::IndirectRead:
+            return {
+                VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED, false
+            };
+        case ResourceUsage::HostRead:
+            return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case ResourceUsage::Present:
+            return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false};
+        }
+        throw std::runtime_error("Unknown resource usage");
+    }
+
+    // ============================================================
+    //  RenderGraphBuilder
+    // ============================================================
+
+    namespace
+    {
+        void appendAccess(std::vector<ResourceAccess>& accesses, ResourceId id, ResourceUsage usage, bool write)
+        {
+            if (usageState(usage).write != write)
+                throw std::runtime_error(write
+                                             ? "Render graph: write() declared with a read-only usage"
+                                             : "Render graph: read() declared with a writing usage");
+
+            for (const auto& access : accesses)
+            {
+                if (access.resource == id)
+                    throw std::runtime_error("Render graph: resource declared twice by the same pass");
+            }
+
+            accesses.push_back({id, usage});
+        }
+    }
+
+    RenderGraphBuilder& RenderGraphBuilder::read(const Ref<IRenderTarget>& target, ImageAspect aspect,
+                                                 ResourceUsage usage)
+    {
+        appendAccess(m_accesses, m_graph.findTarget(target.get(), aspect), usage, false);
+        return *this;
+    }
+
+    RenderGraphBuilder& RenderGraphBuilder::write(const Ref<IRenderTarget>& target, ImageAspect aspect,
+                                                  ResourceUsage usage)
+    {
+        appendAccess(m_accesses, m_graph.findTarget(target.get(), aspect), usage, true);
+        return *this;
+    }
+
+    RenderGraphBuilder& RenderGraphBuilder::read(const Buffer& buffer, ResourceUsage usage)
+    {
+        appendAccess(m_accesses, m_graph.findOrAddBuffer(&buffer), usage, false);
+        return *this;
+    }
+
+    RenderGraphBuilder& RenderGraphBuilder::write(const Buffer& buffer, ResourceUsage usage)
+    {
+        appendAccess(m_accesses, m_graph.findOrAddBuffer(&buffer), usage, true);
+        return *this;
+    }
+
+    RenderGraphBuilder& RenderGraphBuilder::exportBuffer(const Buffer& buffer, ResourceUsage finalUsage)
+    {
+        auto& resource = m_graph.m_resources[m_graph.findOrAddBuffer(&buffer)];
+        resource.exported = true;
+        resource.exportUsage = finalUsage;
+        return *this;
+    }
+
+    // ============================================================
+    //  RenderGraph
+    // ============================================================
+
+    RenderGraph::RenderGraph(const Device& device, const Ref<SwapChain>& swapChain, const CommandPool& commandPool,
+                             const Ref<IRenderTarget>& headlessOutput): device(device),
         swapChain(swapChain),
-        commandBuffers(device, swapChain, commandPool),
-        syncObjects(device, swapChain->numImages(), MAX_FRAMES_IN_FLIGHT)
+        m_output(swapChain ? Ref<IRenderTarget>(swapChain) : headlessOutput),
+        m_commandPool(commandPool),
+        commandBuffers(device, m_output, commandPool),
+        m_recorder(device, MAX_FRAMES_IN_FLIGHT),
+        syncObjects(device, m_output->numImages(), MAX_FRAMES_IN_FLIGHT),
+        m_latency(device, syncObjects.timeline(), swapChain && device.supportsPresentWait()),
+        m_profiler(device, MAX_FRAMES_IN_FLIGHT)
     {
+        // The output is the graph's root: whatever ends up presented keeps its producers
+        // alive. Headless output is left ready to be copied out.
+        importTarget(m_output, ResourceIndexing::PerImage);
+
+        auto& presented = m_resources[findTarget(m_output.get(), ImageAspect::Color)];
+        presented.exported = true;
+        presented.exportUsage = swapChain ? ResourceUsage::Present : ResourceUsage::TransferSrc;
+
+        if (device.hasDedicatedCompute())
+            createAsyncResources();
+
+        device.deletionQueue().setFrame(syncObjects.frameValue());
     }
 
-    void RenderGraph::execute()
+    RenderGraph::~RenderGraph()
     {
-        // Wait for the previous frame to finish using the 'currentFrame' slot
-        vkWaitForFences(device.logical(), 1, &syncObjects.inFlightFence(currentFrame),
-                        VK_TRUE, UINT64_MAX);
+        clear();
+        destroyAsyncResources();
+    }
 
-        // Acquire the next available image from the swapchain
-        VkResult result = vkAcquireNextImageKHR(
-            device.logical(), swapChain->handle(), UINT64_MAX,
-            syncObjects.imageAvailable(currentFrame), VK_NULL_HANDLE, &imageIndex);
-        
-        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    void RenderGraph::createAsyncResources()
+    {
+        m_computePool = std::make_unique<CommandPool>(device, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                                      device.computeFamily());
+
+        auto allocate = [&](VkCommandPool pool, std::vector<VkCommandBuffer>& out)
         {
-            recreate();
+            out.resize(MAX_FRAMES_IN_FLIGHT);
+
+            VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            allocInfo.commandPool = pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
+
+            if (vkAllocateCommandBuffers(device.logical(), &allocInfo, out.data()) != VK_SUCCESS)
+                throw std::runtime_error("failed to allocate command buffers!");
+        };
+        allocate(m_computePool->handle(), m_computeCommands);
+        allocate(m_commandPool.handle(), m_tailCommands);
+
+        VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        m_computeFinished.resize(MAX_FRAMES_IN_FLIGHT);
+        m_graphicsDone.resize(MAX_FRAMES_IN_FLIGHT);
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        {
+            if (vkCreateSemaphore(device.logical(), &semaphoreInfo, nullptr, &m_computeFinished[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(device.logical(), &semaphoreInfo, nullptr, &m_graphicsDone[i]) != VK_SUCCESS)
+                throw std::runtime_error("failed to create async compute semaphores!");
+        }
+    }
+
+    void RenderGraph::destroyAsyncResources()
+    {
+        if (!m_computePool)
             return;
+
+        vkDeviceWaitIdle(device.logical());
+
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        {
+            vkDestroySemaphore(device.logical(), m_computeFinished[i], nullptr);
+            vkDestroySemaphore(device.logical(), m_graphicsDone[i], nullptr);
+        }
+        m_computeFinished.clear();
+        m_graphicsDone.clear();
+        m_pendingGraphicsDone = VK_NULL_HANDLE;
+
+        vkFreeCommandBuffers(device.logical(), m_commandPool.handle(),
+                             static_cast<uint32_t>(m_tailCommands.size()), m_tailCommands.data());
+        m_tailCommands.clear();
+        m_computeCommands.clear();
+        m_computePool.reset();
+    }
+
+    void RenderGraph::importTarget(const Ref<IRenderTarget>& target, ResourceIndexing indexing)
+    {
+        for (ImageAspect aspect : {ImageAspect::Color, ImageAspect::Depth})
+        {
+            // Color-only targets, e.g. object picking
+            if (aspect == ImageAspect::Depth && target->depthFormat() == VK_FORMAT_UNDEFINED)
+                continue;
+
+            bool aliased = aspect == ImageAspect::Depth && target->transientDepth();
+
+            bool found = false;
+            for (auto& resource : m_resources)
+            {
+                if (resource.target == target.get() && resource.aspect == aspect)
+                {
+                    resource.indexing = indexing;
+                    resource.aliased = aliased;
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                GraphResource resource{};
+                resource.target = target.get();
+                resource.aspect = aspect;
+                resource.indexing = indexing;
+                resource.aliased = aliased;
+                m_resources.push_back(resource);
+            }
+        }
+        m_dirty = true;
+    }
+
+    ResourceId RenderGraph::findTarget(const IRenderTarget* target, ImageAspect aspect) const
+    {
+        for (ResourceId id = 0; id < m_resources.size(); ++id)
+        {
+            if (m_resources[id].target == target && m_resources[id].aspect == aspect)
+                return id;
+        }
+        throw std::runtime_error("Render target used by a pass was not imported into the render graph");
+    }
+
+    ResourceId RenderGraph::findOrAddBuffer(const Buffer* buffer)
+    {
+        for (ResourceId id = 0; id < m_resources.size(); ++id)
+        {
+            if (m_resources[id].buffer == buffer)
+                return id;
+        }
+
+        GraphResource resource{};
+        resource.buffer = buffer;
+        m_resources.push_back(resource);
+        return static_cast<ResourceId>(m_resources.size() - 1);
+    }
+
+    std::vector<size_t> RenderGraph::sortPasses(const std::vector<std::vector<ResourceAccess>>& accesses) const
+    {
+        const size_t count = accesses.size();
+        std::vector<std::vector<size_t>> edges(count);
+        std::vector<uint32_t> inDegree(count, 0);
+
+        // Per resource, writers run in the order they were added and every reader
+        // runs after the last writer, regardless of where it was added.
+        for (ResourceId id = 0; id < m_resources.size(); ++id)
+        {
+            std::vector<size_t> writers;
+            std::vector<size_t> readers;
+            for (size_t pass = 0; pass < count; ++pass)
+            {
+                for (const auto& access : accesses[pass])
+                {
+                    if (access.resource == id)
+                        (usageState(access.usage).write ? writers : readers).push_back(pass);
+                }
+            }
+
+            for (size_t i = 1; i < writers.size(); ++i)
+            {
+                edges[writers[i - 1]].push_back(writers[i]);
+                inDegree[writers[i]]++;
+            }
+
+            if (writers.empty())
+                continue;
+
+            for (size_t reader : readers)
+            {
+                edges[writers.back()].push_back(reader);
+                inDegree[reader]++;
+            }
+        }
+
+        // Kahn's algorithm; ties resolve to insertion order so the result is stable
+        std::priority_queue<size_t, std::vector<size_t>, std::greater<>> ready;
+        for (size_t pass = 0; pass < count; ++pass)
+        {
+            if (inDegree[pass] == 0)
+                ready.push(pass);
+        }
+
+        std::vector<size_t> order;
+        order.reserve(count);
+        while (!ready.empty())
+        {
+            size_t pass = ready.top();
+            ready.pop();
+            order.push_back(pass);
+
+            for (size_t next : edges[pass])
+            {
+                if (--inDegree[next] == 0)
+                    ready.push(next);
+            }
+        }
+
+        if (order.size() != count)
+            throw std::runtime_error("Render graph contains a dependency cycle");
+
+        return order;
+    }
+
+    void RenderGraph::compile()
+    {
+        for (auto& resource : m_resources)
+            resource.aliased = resource.target && resource.aspect == ImageAspect::Depth &&
+                resource.target->transientDepth();
+
+        // 1. Collect declarations
+        std::vector<std::vector<ResourceAccess>> accesses(m_passes.size());
+        for (size_t i = 0; i < m_passes.size(); ++i)
+        {
+            RenderGraphBuilder builder(*this, accesses[i]);
+            m_passes[i]->setup(builder);
+        }
+
+        std::vector<size_t> order = sortPasses(accesses);
+
+        // 2. Cull: walk backwards from the exported resources and keep only
+        //    passes that write something a live pass (or the outside) consumes
+        std::vector<bool> liveResource(m_resources.size());
+        for (ResourceId id = 0; id < m_resources.size(); ++id)
+            liveResource[id] = m_resources[id].exported;
+
+        std::vector<bool> livePass(m_passes.size(), false);
+        for (auto it = order.rbegin(); it != order.rend(); ++it)
+        {
+            bool contributes = false;
+            for (const auto& access : accesses[*it])
+                contributes |= usageState(access.usage).write && liveResource[access.resource];
+
+            if (!contributes)
+                continue;
+
+            livePass[*it] = true;
+            for (const auto& access : accesses[*it])
+                liveResource[access.resource] = true;
+        }
+
+        // 3. Pick a queue per pass. A pass only goes async if nothing it touches
+        //    was used by graphics earlier in the frame, so ownership only ever moves
+        //    compute -> graphics and compute never waits on same-frame graphics work.
+        std::vector<bool> asyncPass(m_passes.size(), false);
+        if (m_computePool)
+        {
+            std::vector<bool> graphicsTouched(m_resources.size(), false);
+            for (size_t pass : order)
+            {
+                if (!livePass[pass])
+                    continue;
+
+                bool async = m_passes[pass]->asyncCompute();
+                for (const auto& access : accesses[pass])
+                    async &= !graphicsTouched[access.resource];
+
+                if (m_passes[pass]->asyncCompute() && !async)
+                    LOG_INFO("Render graph: compute pass runs on the graphics queue, it depends on graphics work");
+
+                asyncPass[pass] = async;
+                if (!async)
+                {
+                    for (const auto& access : accesses[pass])
+                        graphicsTouched[access.resource] = true;
+                }
+            }
+        }
+
+        // 4. Simulate every resource's state through the live passes and record
+        //    only the transitions that resolve a hazard or change a layout
+        std::vector<ResourceState> states(m_resources.size());
+        std::vector<bool> computeOwned(m_resources.size(), false);
+
+        m_computeReleases.clear();
+        m_computeWaitStages = 0;
+
+        auto plan = [&](ResourceId id, const ResourceState& next, std::vector<PlannedBarrier>& out, bool async)
+        {
+            ResourceState& prev = states[id];
+            const bool isImage = m_resources[id].buffer == nullptr;
+
+            if (computeOwned[id] && !async)
+            {
+                // Queue family ownership transfer: the compute queue releases the
+                // resource after its last use, the graphics queue acquires it before
+                // its first one. The layout transition happens in both halves.
+                const uint32_t computeFamily = device.computeFamily();
+                const uint32_t graphicsFamily = device.queueFamilyIndices().graphicsFamily.value();
+
+                ResourceState released{VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, next.layout, false};
+                ResourceState acquiredFrom{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, prev.layout, false};
+                if (!isImage)
+                    released.layout = acquiredFrom.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+                m_computeReleases.push_back({id, prev, released, computeFamily, graphicsFamily});
+                out.push_back({id, acquiredFrom, next, computeFamily, graphicsFamily});
+
+                m_computeWaitStages |= next.stages;
+                computeOwned[id] = false;
+                prev = next;
+                return;
+            }
+            computeOwned[id] = async;
+
+            if (prev.stages == 0)
+            {
+                // First touch this frame. Earlier contents are never relied upon, so
+                // images start from UNDEFINED; waiting on our own stage chains the
+                // barrier onto the acquire semaphore / previous frame's timeline wait.
+                if (isImage)
+                {
+                    if (!next.write)
+                        throw std::runtime_error("Render graph: image is read before any pass writes it");
+
+                    out.push_back({id, ResourceState{next.stages, 0, VK_IMAGE_LAYOUT_UNDEFINED, false}, next});
+                }
+                prev = next;
+                return;
+            }
+
+            const bool layoutChange = isImage && prev.layout != next.layout;
+            if (!prev.write && !next.write && !layoutChange)
+            {
+                // Read after read: no barrier, just widen the set of readers a later writer waits on
+                prev.stages |= next.stages;
+                prev.access |= next.access;
+                return;
+            }
+
+            out.push_back({id, prev, next});
+            prev = next;
+        };
+
+        m_steps.clear();
+        m_finalBarriers.clear();
+        m_computeFinalBarriers.clear();
+
+        constexpr size_t unused = SIZE_MAX;
+        std::vector<size_t> firstUse(m_resources.size(), unused);
+        std::vector<size_t> lastUse(m_resources.size(), unused);
+
+        for (size_t pass : order)
+        {
+            if (!livePass[pass])
+                continue;
+
+            CompiledStep step{m_passes[pass].get(), {}, asyncPass[pass]};
+            for (const auto& access : accesses[pass])
+            {
+                plan(access.resource, usageState(access.usage), step.barriers, step.async);
+
+                if (firstUse[access.resource] == unused)
+                    firstUse[access.resource] = m_steps.size();
+                lastUse[access.resource] = m_steps.size();
+            }
+
+            m_steps.push_back(std::move(step));
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+
+        const ResourceId presented = findTarget(m_output.get(), ImageAspect::Color);
+        for (ResourceId id = 0; id < m_resources.size(); ++id)
         {
-            throw std::runtime_error("Failed to acquire swapchain image");
+            if (!m_resources[id].exported || states[id].stages == 0)
+                continue;
+
+            // Exports consumed by the host stay on whichever queue produced them last
+            if (computeOwned[id] && id != presented)
+                plan(id, usageState(m_resources[id].exportUsage), m_computeFinalBarriers, true);
+            else
+                plan(id, usageState(m_resources[id].exportUsage), m_finalBarriers, false);
         }
 
-        if (syncObjects.imageInFlight(imageIndex) != VK_NULL_HANDLE)
+        // 5. Split the graphics steps at the first acquire. Everything before it is
+        //    submitted without waiting on the compute queue.
+        m_asyncActive = false;
+        for (const auto& step : m_steps)
+            m_asyncActive |= step.async;
+
+        m_graphicsSplit = m_steps.size();
+        size_t firstPresentedUse = m_steps.size();
+        for (size_t i = 0; i < m_steps.size(); ++i)
         {
-            vkWaitForFences(device.logical(), 1,
-                            &syncObjects.imageInFlight(imageIndex), VK_TRUE,
-                            UINT64_MAX);
+            for (const auto& barrier : m_steps[i].barriers)
+            {
+                if (barrier.srcFamily != VK_QUEUE_FAMILY_IGNORED)
+                    m_graphicsSplit = std::min(m_graphicsSplit, i);
+                if (barrier.resource == presented)
+                    firstPresentedUse = std::min(firstPresentedUse, i);
+            }
         }
-        // Mark the image as now being in use by this frame
-        syncObjects.imageInFlight(imageIndex) = syncObjects.inFlightFence(currentFrame);
+        m_acquireInTail = m_asyncActive && firstPresentedUse >= m_graphicsSplit;
+
+        if (m_steps.size() != m_passes.size())
+            LOG_INFO("Render graph culled {} of {} passes", m_passes.size() - m_steps.size(), m_passes.size());
+
+        // 6. Share memory between aliased images that are never live at once.
+        //    Framebuffers hold views of the images, so they follow a rebind.
+        if (planAliasing(firstUse, lastUse, states))
+            recreatePasses();
+
+        m_dirty = false;
+    }
+
+    bool RenderGraph::planAliasing(const std::vector<size_t>& firstUse, const std::vector<size_t>& lastUse,
+                                   const std::vector<ResourceState>& lastState)
+    {
+        std::vector<ResourceId> aliased;
+        for (ResourceId id = 0; id < m_resources.size(); ++id)
+        {
+            if (m_resources[id].aliased && firstUse[id] != SIZE_MAX)
+                aliased.push_back(id);
+        }
+        std::sort(aliased.begin(), aliased.end(),
+                  [&](ResourceId a, ResourceId b) { return firstUse[a] < firstUse[b]; });
+
+        // Greedy interval partitioning: an image joins the first group whose
+        // last member is done with the memory before the image's first use
+        std::vector<std::vector<ResourceId>> groups;
+        for (ResourceId id : aliased)
+        {
+            auto group = std::find_if(groups.begin(), groups.end(), [&](const std::vector<ResourceId>& members)
+            {
+                return lastUse[members.back()] < firstUse[id];
+            });
+            if (group == groups.end())
+                groups.push_back({id});
+            else
+                group->push_back(id);
+        }
+
+        bool recreated = false;
+        for (const auto& members : groups)
+        {
+            // Keyed by the first member's target, which outlives the plan
+            const void* key = m_resources[members.front()].target;
+
+            for (size_t i = 0; i < members.size(); ++i)
+            {
+                const ResourceId id = members[i];
+                recreated |= m_resources[id].target->setAliasGroup(key);
+
+                // Every frame slot's images share the group's memory, so the first
+                // member follows the last member of the previous frame
+                const ResourceId previous = members[i == 0 ? members.size() - 1 : i - 1];
+                for (auto& barrier : m_steps[firstUse[id]].barriers)
+                {
+                    if (barrier.resource == id && barrier.src.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+                        barrier.aliasSrc = lastState[previous];
+                }
+            }
+        }
+
+        if (!groups.empty())
+            LOG_INFO("Render graph: {} aliased image(s) in {} memory group(s)", aliased.size(), groups.size());
+
+        return recreated;
+    }
+
+    void RenderGraph::emitBarriers(VkCommandBuffer cmd, const std::vector<PlannedBarrier>& barriers) const
+    {
+        if (barriers.empty())
+            return;
+
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<VkMemoryBarrier> memoryBarriers;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+        for (const auto& planned : barriers)
+        {
+            const GraphResource& resource = m_resources[planned.resource];
+            srcStages |= planned.src.stages;
+            dstStages |= planned.dst.stages;
+
+            // Only writes need to be made available; WAR hazards are execution-only
+            VkAccessFlags srcAccess = planned.src.write ? planned.src.access & kWriteAccess : 0;
+
+            if (resource.buffer)
+            {
+                VkBufferMemoryBarrier barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+                barrier.srcAccessMask = srcAccess;
+                barrier.dstAccessMask = planned.dst.access;
+                barrier.srcQueueFamilyIndex = planned.srcFamily;
+                barrier.dstQueueFamilyIndex = planned.dstFamily;
+                barrier.buffer = resource.buffer->getBuffer();
+                barrier.offset = 0;
+                barrier.size = VK_WHOLE_SIZE;
+                bufferBarriers.push_back(barrier);
+                continue;
+            }
+
+            if (planned.aliasSrc.stages != 0)
+            {
+                // An image barrier only covers its own image. The alias that used
+                // the memory last (see planAliasing()) is waited on at the stages
+                // of its last use.
+                VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+                barrier.srcAccessMask = planned.aliasSrc.write ? planned.aliasSrc.access & kWriteAccess : 0;
+                barrier.dstAccessMask = planned.dst.access;
+                memoryBarriers.push_back(barrier);
+
+                srcStages |= planned.aliasSrc.stages;
+            }
+
+            uint32_t index = resource.indexing == ResourceIndexing::PerFrame ? currentFrame : imageIndex;
+            bool color = resource.aspect == ImageAspect::Color;
+
+            VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = planned.dst.access;
+            barrier.oldLayout = planned.src.layout;
+            barrier.newLayout = planned.dst.layout;
+            barrier.srcQueueFamilyIndex = planned.srcFamily;
+            barrier.dstQueueFamilyIndex = planned.dstFamily;
+            barrier.image = color ? resource.target->colorImage(index) : resource.target->depthImage(index);
+            barrier.subresourceRange.aspectMask = color
+                                                      ? VK_IMAGE_ASPECT_COLOR_BIT
+                                                      : depthAspectMask(resource.target->depthFormat());
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            imageBarriers.push_back(barrier);
+        }
+
+        vkCmdPipelineBarrier(
+            cmd,
+            srcStages, dstStages,
+            0,
+            static_cast<uint32_t>(memoryBarriers.size()), memoryBarriers.data(),
+            static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+        );
+    }
+
+    void RenderGraph::execute()
+    {
+        if (m_dirty)
+            compile();
+
+        // Wait for the previous frame to finish using the 'currentFrame' slot
+        syncObjects.waitForFrameSlot(currentFrame);
+
+        // Destroy whatever the completed frames were the last users of
+        device.deletionQueue().collect(syncObjects.completedValue());
+
+        if (swapChain)
+        {
+            // Acquire the next available image from the swapchain
+            VkResult result = vkAcquireNextImageKHR(
+                device.logical(), swapChain->handle(), UINT64_MAX,
+                syncObjects.imageAvailable(currentFrame), VK_NULL_HANDLE, &imageIndex);
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                // The frame is retried under the same value after a fresh
+                // input sample
+                m_latency.discard(syncObjects.frameValue());
+                recreate();
+                return;
+            }
+            else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            {
+                throw std::runtime_error("Failed to acquire swapchain image");
+            }
+        }
+        else
+        {
+            // Headless: the output has an image per frame slot
+            imageIndex = currentFrame;
+        }
+
+        // Usually retired already, in which case this is a counter read, not a wait
+        syncObjects.waitForImage(imageIndex);
+
+        // The slot's frame has retired, so its secondary buffers can be reused.
+        // Kick off worker recording for all passes before serial recording starts.
+        m_recorder.beginFrame(currentFrame);
+        m_profiler.beginFrame(currentFrame);
+        for (auto& step : m_steps)
+            step.pass->prepare(m_recorder, imageIndex);
 
         VkCommandBuffer cmd = commandBuffers.command(currentFrame);
 
+        if (m_asyncActive)
+        {
+            VkCommandBuffer compute = m_computeCommands[currentFrame];
+            beginCommands(compute);
+            recordSteps(compute, true, 0, m_steps.size());
+            emitBarriers(compute, m_computeReleases);
+            emitBarriers(compute, m_computeFinalBarriers);
+            endCommands(compute);
+
+            beginCommands(cmd);
+            recordSteps(cmd, false, 0, m_graphicsSplit);
+            endCommands(cmd);
+
+            VkCommandBuffer tail = m_tailCommands[currentFrame];
+            beginCommands(tail);
+            recordSteps(tail, false, m_graphicsSplit, m_steps.size());
+            emitBarriers(tail, m_finalBarriers);
+            endCommands(tail);
+
+            submitAsync(compute, cmd, tail);
+        }
+        else
+        {
+            beginCommands(cmd);
+            recordSteps(cmd, false, 0, m_steps.size());
+
+            // Hand exported resources over in the layout/visibility their consumers expect
+            emitBarriers(cmd, m_finalBarriers);
+            endCommands(cmd);
+
+            drainGraphicsDone();
+            submit(cmd);
+        }
+
+        const uint64_t frame = syncObjects.frameValue();
+        syncObjects.advance(currentFrame, imageIndex);
+        device.deletionQueue().setFrame(syncObjects.frameValue());
+        if (swapChain)
+            present(imageIndex, frame);
+        update(Time::getDeltaTime(), imageIndex);
+        
+        // 6. Advance Frame
+        currentFrame = (currentFrame + 1) % m_framesInFlight;
+    }
+
+    void RenderGraph::setFramesInFlight(uint32_t count)
+    {
+        count = std::clamp<uint32_t>(count, 1, MAX_FRAMES_IN_FLIGHT);
+        if (count == m_framesInFlight)
+            return;
+
+        // Slots above the new count may still be referenced by submitted work
+        vkDeviceWaitIdle(device.logical());
+        m_framesInFlight = count;
+        currentFrame = 0;
+    }
+
+    void RenderGraph::beginCommands(VkCommandBuffer cmd) const
+    {
         // Reset the command buffer to clear old commands
         vkResetCommandBuffer(cmd, 0);
 
@@ -58,25 +830,126 @@ namespace vks
         if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
+    }
 
-        // Run all render passes
-        for (auto& pass : m_passes)
+    void RenderGraph::endCommands(VkCommandBuffer cmd) const
+    {
+        if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+
+    void RenderGraph::recordSteps(VkCommandBuffer cmd, bool async, size_t begin, size_t end)
+    {
+        // Run the live passes in dependency order, each preceded by its batched barriers
+        for (size_t i = begin; i < end; ++i)
         {
+            auto& step = m_steps[i];
+            if (step.async != async)
+                continue;
+
+            emitBarriers(cmd, step.barriers);
+
             // We pass 'imageIndex' so the RenderPass knows which Framebuffer/Image to draw into.
             // But we write into 'cmd' which belongs to 'currentFrame'.
-            pass->record(cmd, imageIndex);
+            std::optional<GpuProfiler::Scope> scope;
+            if (!async || m_profiler.computeTimestamps())
+                scope.emplace(m_profiler, cmd, step.pass->name());
+
+            step.pass->record(cmd, imageIndex);
         }
+    }
 
-        if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+    void RenderGraph::drainGraphicsDone()
+    {
+        // The schedule dropped its async passes after a frame signaled graphicsDone.
+        // A signaled semaphore nobody waits on can't be signaled again, so consume it.
+        if (m_pendingGraphicsDone == VK_NULL_HANDLE)
+            return;
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &m_pendingGraphicsDone;
+        submitInfo.pWaitDstStageMask = &waitStage;
+
+        if (vkQueueSubmit(device.computeQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("failed to submit compute queue wait!");
+
+        m_pendingGraphicsDone = VK_NULL_HANDLE;
+    }
+
+    void RenderGraph::submitAsync(VkCommandBuffer compute, VkCommandBuffer head, VkCommandBuffer tail)
+    {
+        // Compute: waits for the previous frame's graphics work, overlaps with 'head'
+        {
+            VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            if (m_pendingGraphicsDone != VK_NULL_HANDLE)
+            {
+                submitInfo.waitSemaphoreCount = 1;
+                submitInfo.pWaitSemaphores = &m_pendingGraphicsDone;
+                submitInfo.pWaitDstStageMask = &waitStage;
+            }
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &compute;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &m_computeFinished[currentFrame];
+
+            if (vkQueueSubmit(device.computeQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+                throw std::runtime_error("failed to submit compute command buffer!");
         }
-        
-        submit(cmd);
-        present(imageIndex);
-        update(Time::getDeltaTime(), imageIndex);
-        
-        // 6. Advance Frame
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+
+        // Graphics: 'head' and 'tail' as two batches of one submission
+        std::vector<VkSemaphore> headWaits, tailWaits;
+        std::vector<VkPipelineStageFlags> headStages, tailStages;
+
+        if (swapChain)
+        {
+            (m_acquireInTail ? tailWaits : headWaits).push_back(syncObjects.imageAvailable(currentFrame));
+            (m_acquireInTail ? tailStages : headStages).push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        }
+
+        tailWaits.push_back(m_computeFinished[currentFrame]);
+        tailStages.push_back(m_computeWaitStages ? m_computeWaitStages : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        // Binary semaphores ignore their value entry
+        std::vector<VkSemaphore> signals = {m_graphicsDone[currentFrame], syncObjects.timeline()};
+        std::vector<uint64_t> signalValues = {0, syncObjects.frameValue()};
+        if (swapChain)
+        {
+            signals.push_back(syncObjects.renderFinished(imageIndex));
+            signalValues.push_back(0);
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo batches[2]{};
+        batches[0].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        batches[0].waitSemaphoreCount = static_cast<uint32_t>(headWaits.size());
+        batches[0].pWaitSemaphores = headWaits.data();
+        batches[0].pWaitDstStageMask = headStages.data();
+        batches[0].commandBufferCount = 1;
+        batches[0].pCommandBuffers = &head;
+
+        batches[1].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        batches[1].pNext = &timelineInfo;
+        batches[1].waitSemaphoreCount = static_cast<uint32_t>(tailWaits.size());
+        batches[1].pWaitSemaphores = tailWaits.data();
+        batches[1].pWaitDstStageMask = tailStages.data();
+        batches[1].commandBufferCount = 1;
+        batches[1].pCommandBuffers = &tail;
+        batches[1].signalSemaphoreCount = static_cast<uint32_t>(signals.size());
+        batches[1].pSignalSemaphores = signals.data();
+
+        if (vkQueueSubmit(device.graphicsQueue(), 2, batches, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+
+        m_pendingGraphicsDone = m_graphicsDone[currentFrame];
     }
 
     void RenderGraph::submit(VkCommandBuffer cmd)
@@ -87,7 +960,7 @@ namespace vks
         // Wait for image to be available
         VkSemaphore waitSemaphores[] = {syncObjects.imageAvailable(currentFrame)};
         VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.waitSemaphoreCount = swapChain ? 1 : 0;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
 
@@ -95,24 +968,27 @@ namespace vks
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &cmd;
 
-        // Signal that rendering is finished
-        VkSemaphore signalSemaphores[] = {syncObjects.renderFinished(currentFrame)};
-        submitInfo.signalSemaphoreCount = 1;
+        // Advance the timeline to this frame's value, and signal that rendering is
+        // finished for present (headless: nothing to present)
+        VkSemaphore signalSemaphores[] = {syncObjects.timeline(), syncObjects.renderFinished(imageIndex)};
+        uint64_t signalValues[] = {syncObjects.frameValue(), 0};
+        submitInfo.signalSemaphoreCount = swapChain ? 2 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
-        vkResetFences(device.logical(), 1, &syncObjects.inFlightFence(currentFrame));
-        
-        // Signal the fence when GPU completes this frame
-        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo,
-                          syncObjects.inFlightFence(currentFrame)) != VK_SUCCESS)
+        VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+        timelineInfo.pSignalSemaphoreValues = signalValues;
+        submitInfo.pNext = &timelineInfo;
+
+        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
     }
 
-    void RenderGraph::present(uint32_t imageIndex)
+    void RenderGraph::present(uint32_t imageIndex, uint64_t frame)
     {
-        VkSemaphore signalSemaphores[] = {syncObjects.renderFinished(currentFrame)};
+        VkSemaphore signalSemaphores[] = {syncObjects.renderFinished(imageIndex)};
             
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -126,12 +1002,25 @@ namespace vks
 
         presentInfo.pImageIndices = &imageIndex;
 
+        // Tagged with the frame's timeline value, so the latency tracker can
+        // wait for this present
+        VkPresentIdKHR presentId{VK_STRUCTURE_TYPE_PRESENT_ID_KHR};
+        presentId.swapchainCount = 1;
+        presentId.pPresentIds = &frame;
+        if (m_latency.measuresPresent())
+            presentInfo.pNext = &presentId;
+
         VkResult result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
+        if (m_latency.measuresPresent())
+        {
+            const bool queued = result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR;
+            m_latency.markPresented(frame, queued ? swapChain->handle() : VK_NULL_HANDLE);
+        }
+
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
         {
             recreate();
-            syncObjects.recreate(swapChain->numImages());
         }
         else if (result != VK_SUCCESS)
         {
@@ -162,10 +1051,22 @@ namespace vks
 
     void RenderGraph::recreate()
     {
+        // Headless output only changes through its owner
+        if (!swapChain)
+        {
+            recreatePasses();
+            return;
+        }
+
+        // Pending presents still hold the old swapchain images and the per-image
+        // semaphores, and presents can't be tracked by the frame counter. Window
+        // resizes are rare enough to drain for; everything else is deferred.
         vkDeviceWaitIdle(device.logical());
+        m_latency.retireSwapChain(swapChain->handle());
 
         // Recreate Swapchain
         swapChain->recreate();
+        syncObjects.recreate(swapChain->numImages());
         
         // Recreate Passes (Framebuffers, Pipelines)
         recreatePasses();
@@ -1,5 +1,6 @@
 #include <render/RenderTarget.hpp>
 #include <gfx/Device.hpp>
+#include <render/TransientAttachmentPool.hpp>
 #include <spdlog/spdlog.h>
 
 #include "imgui_impl_vulkan.h"
@@ -14,7 +15,8 @@ namespace vks
         VkFormat colorFormat,
         VkFormat depthFormat,
         VkImageUsageFlags additionalUsage,
-        bool sampled
+        bool sampled,
+        TransientAttachmentPool* transientDepth
     )
         : m_device(device),
           m_extent(extent),
@@ -22,7 +24,8 @@ namespace vks
           m_colorFormat(colorFormat),
           m_depthFormat(depthFormat),
           m_sampled(sampled),
-          m_additionalUsage(additionalUsage)
+          m_additionalUsage(additionalUsage),
+          m_transientPool(transientDepth)
     {
         if (extent.width == 0 || extent.height == 0)
             return;
@@ -53,10 +56,50 @@ namespace vks
             newExtent.height == m_extent.height)
             return;
 
-        vkDeviceWaitIdle(m_device.logical());
-        destroy();
-
         m_extent = newExtent;
+        rebuild();
+    }
+
+    bool RenderTarget::setAliasGroup(const void* group)
+    {
+        if (!m_transientPool || group == m_aliasGroup)
+            return false;
+
+        m_aliasGroup = group;
+        // Bound at creation; a zero-sized target creates its images later
+        if (m_depthImages.empty())
+            return false;
+
+        rebuild();
+        return true;
+    }
+
+    bool RenderTarget::setTransientDepth(TransientAttachmentPool* pool)
+    {
+        if (pool == m_transientPool)
+            return false;
+
+        // The retired images go back to the pool they came from
+        const bool hasImages = !m_depthImages.empty();
+        if (hasImages)
+            retire();
+
+        m_transientPool = pool;
+        m_aliasGroup = this;
+
+        if (hasImages)
+        {
+            createImages();
+            createImageViews();
+            if (m_sampled) createDescriptors();
+        }
+        return true;
+    }
+
+    void RenderTarget::rebuild()
+    {
+        // Frames in flight may still render into or sample the old images
+        retire();
 
         createImages();
         createImageViews();
@@ -86,10 +129,11 @@ namespace vks
     void RenderTarget::createImages()
     {
         m_colorImages.resize(m_imageCount);
-        m_colorMemory.resize(m_imageCount);
+        m_colorAllocations.resize(m_imageCount);
 
-        m_depthImages.resize(m_imageCount);
-        m_depthMemory.resize(m_imageCount);
+        const bool hasDepth = m_depthFormat != VK_FORMAT_UNDEFINED;
+        m_depthImages.resize(hasDepth ? m_imageCount : 0);
+        m_depthAllocations.resize(hasDepth ? m_imageCount : 0);
 
         VkImageUsageFlags colorUsage =
             VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | m_additionalUsage |
@@ -106,27 +150,78 @@ namespace vks
                 colorUsage,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                 m_colorImages[i],
-                m_colorMemory[i]
+                m_colorAllocations[i]
             );
 
-            m_device.createImage(
-                m_extent.width,
-                m_extent.height,
-                1,
-                m_depthFormat,
-                VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                m_depthImages[i],
-                m_depthMemory[i]
-            );
+            if (!hasDepth)
+                continue;
+
+            if (m_transientPool)
+            {
+                // Depth is cleared on load and discarded on store, so it never has
+                // to leave tile memory and can alias the other transient attachments
+                m_depthImages[i] = m_device.createImage(
+                    m_extent.width,
+                    m_extent.height,
+                    1,
+                    m_depthFormat,
+                    VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+                );
+                m_transientPool->bind(m_depthImages[i], m_aliasGroup);
+                m_depthAllocations[i] = VK_NULL_HANDLE;
+            }
+            else
+            {
+                // Sampled for passes that read the frame's depth, e.g. the depth pyramid
+                m_device.createImage(
+                    m_extent.width,
+                    m_extent.height,
+                    1,
+                    m_depthFormat,
+                    VK_IMAGE_TILING_OPTIMAL,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    m_depthImages[i],
+                    m_depthAllocations[i]
+                );
+            }
+        }
+
+        // Committed sizes come from the allocator, which may round up the
+        // requirements
+        const VmaAllocator allocator = m_device.allocator().handle();
+        auto committed = [allocator](VmaAllocation allocation)
+        {
+            VmaAllocationInfo info;
+            vmaGetAllocationInfo(allocator, allocation, &info);
+            return info.size;
+        };
+
+        m_dedicatedBytes = 0;
+        m_requestedBytes = 0;
+        for (uint32_t i = 0; i < m_imageCount; i++)
+        {
+            VkMemoryRequirements color;
+            vkGetImageMemoryRequirements(m_device.logical(), m_colorImages[i], &color);
+            m_requestedBytes += color.size;
+            m_dedicatedBytes += committed(m_colorAllocations[i]);
+
+            if (!hasDepth)
+                continue;
+
+            VkMemoryRequirements depth;
+            vkGetImageMemoryRequirements(m_device.logical(), m_depthImages[i], &depth);
+            m_requestedBytes += depth.size;
+            if (!m_transientPool)
+                m_dedicatedBytes += committed(m_depthAllocations[i]);
         }
     }
 
     void RenderTarget::createImageViews()
     {
         m_colorViews.resize(m_imageCount);
-        m_depthViews.resize(m_imageCount);
+        m_depthViews.resize(m_depthImages.size());
 
         for (uint32_t i = 0; i < m_imageCount; i++)
         {
@@ -137,6 +232,9 @@ namespace vks
                 1
             );
 
+            if (m_depthImages.empty())
+                continue;
+
             m_depthViews[i] = m_device.createImageView(
                 m_depthImages[i],
                 m_depthFormat,
@@ -175,6 +273,53 @@ namespace vks
         vkCreateSampler(m_device.logical(), &samplerInfo, nullptr, &m_sampler);
     }
 
+    void RenderTarget::retire()
+    {
+        m_device.deletionQueue().push(
+            [device = m_device.logical(),
+                allocator = &m_device.allocator(),
+                pool = m_transientPool,
+                colorViews = std::move(m_colorViews),
+                colorImages = std::move(m_colorImages),
+                colorAllocations = std::move(m_colorAllocations),
+                depthViews = std::move(m_depthViews),
+                depthImages = std::move(m_depthImages),
+                depthAllocations = std::move(m_depthAllocations),
+                descriptors = std::move(m_viewportDescriptors)]
+            {
+                for (uint32_t i = 0; i < colorViews.size(); i++)
+                {
+                    vkDestroyImageView(device, colorViews[i], nullptr);
+                    allocator->destroyImage(colorImages[i], colorAllocations[i]);
+                }
+
+                for (uint32_t i = 0; i < depthViews.size(); i++)
+                {
+                    vkDestroyImageView(device, depthViews[i], nullptr);
+                    if (pool)
+                        pool->release(depthImages[i]);
+                    allocator->destroyImage(depthImages[i], depthAllocations[i]);
+                }
+
+                for (auto& desc : descriptors)
+                {
+                    if (desc != VK_NULL_HANDLE)
+                        ImGui_ImplVulkan_RemoveTexture(desc);
+                }
+            });
+
+        m_colorViews.clear();
+        m_colorImages.clear();
+        m_colorAllocations.clear();
+        m_depthViews.clear();
+        m_depthImages.clear();
+        m_depthAllocations.clear();
+        m_viewportDescriptors.clear();
+
+        m_dedicatedBytes = 0;
+        m_requestedBytes = 0;
+    }
+
     void RenderTarget::destroy()
     {
         VkDevice device = m_device.logical();
@@ -182,12 +327,15 @@ namespace vks
         for (uint32_t i = 0; i < m_colorViews.size(); i++)
         {
             vkDestroyImageView(device, m_colorViews[i], nullptr);
-            vkDestroyImage(device, m_colorImages[i], nullptr);
-            vkFreeMemory(device, m_colorMemory[i], nullptr);
+            m_device.allocator().destroyImage(m_colorImages[i], m_colorAllocations[i]);
+        }
 
+        for (uint32_t i = 0; i < m_depthViews.size(); i++)
+        {
             vkDestroyImageView(device, m_depthViews[i], nullptr);
-            vkDestroyImage(device, m_depthImages[i], nullptr);
-            vkFreeMemory(device, m_depthMemory[i], nullptr);
+            if (m_transientPool)
+                m_transientPool->release(m_depthImages[i]);
+            m_device.allocator().destroyImage(m_depthImages[i], m_depthAllocations[i]);
         }
 
         for (auto& desc : m_viewportDescriptors)
@@ -198,9 +346,12 @@ namespace vks
 
         m_colorViews.clear();
         m_colorImages.clear();
-        m_colorMemory.clear();
+        m_colorAllocations.clear();
         m_depthViews.clear();
         m_depthImages.clear();
-        m_depthMemory.clear();
+        m_depthAllocations.clear();
+
+        m_dedicatedBytes = 0;
+        m_requestedBytes = 0;
     }
 }
@@ -0,0 +1,118 @@
+#include <render/TransientAttachmentPool.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <gfx/Device.hpp>
+#include "core/Log.hpp"
+
+namespace vks
+{
+    TransientAttachmentPool::TransientAttachmentPool(const Device& device)
+        : m_device(device)
+    {
+    }
+
+    TransientAttachmentPool::~TransientAttachmentPool()
+    {
+        if (!m_bindings.empty())
+            LOG_WARN("TransientAttachmentPool destroyed with {} images still bound", m_bindings.size());
+
+        for (auto& block : m_blocks)
+            vmaFreeMemory(m_device.allocator().handle(), block.allocation);
+    }
+
+    VmaAllocationCreateInfo TransientAttachmentPool::allocationInfo(uint32_t typeBits)
+    {
+        VmaAllocationCreateInfo info{};
+        info.memoryTypeBits = typeBits;
+        info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        // Lazily allocated memory only gets committed if the tile has to spill,
+        // which for a transient depth buffer is usually never
+        info.preferredFlags = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        // Blocks are aliased whole, so they are never shared with other resources
+        info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+        return info;
+    }
+
+    void TransientAttachmentPool::bind(VkImage image, const void* group)
+    {
+        const VmaAllocator allocator = m_device.allocator().handle();
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(m_device.logical(), image, &requirements);
+
+        const VmaAllocationCreateInfo info = allocationInfo(requirements.memoryTypeBits);
+        uint32_t memoryType;
+        if (vmaFindMemoryTypeIndex(allocator, requirements.memoryTypeBits, &info, &memoryType) != VK_SUCCESS)
+            throw std::runtime_error("No memory type for transient attachments");
+
+        // Offset 0 satisfies any alignment, so a block fits if it is large enough.
+        // A group grown past its block (e.g. by a resize) gets a new one; the old
+        // one goes once the retired images release it.
+        auto it = std::find_if(m_blocks.begin(), m_blocks.end(), [&](const Block& block)
+        {
+            return block.group == group && block.memoryType == memoryType && block.size >= requirements.size;
+        });
+
+        if (it == m_blocks.end())
+        {
+            Block block{};
+            block.group = group;
+            block.size = requirements.size;
+            block.memoryType = memoryType;
+
+            VmaAllocationCreateInfo blockInfo = info;
+            blockInfo.memoryTypeBits = 1u << memoryType;
+            VmaAllocationInfo committed;
+            if (vmaAllocateMemory(allocator, &requirements, &blockInfo, &block.allocation, &committed) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate transient attachment memory");
+            // What the allocator actually committed, for the memory log
+            block.size = committed.size;
+
+            m_blocks.push_back(block);
+            it = m_blocks.end() - 1;
+        }
+
+        vmaBindImageMemory(allocator, it->allocation, image);
+        it->users++;
+        m_bindings[image] = {it->allocation, requirements.size};
+    }
+
+    void TransientAttachmentPool::release(VkImage image)
+    {
+        auto binding = m_bindings.find(image);
+        if (binding == m_bindings.end())
+            return;
+
+        auto block = std::find_if(m_blocks.begin(), m_blocks.end(), [&](const Block& b)
+        {
+            return b.allocation == binding->second.allocation;
+        });
+        m_bindings.erase(binding);
+
+        // Free a block once nothing aliases it anymore, e.g. after every
+        // target using it was resized
+        if (--block->users == 0)
+        {
+            vmaFreeMemory(m_device.allocator().handle(), block->allocation);
+            m_blocks.erase(block);
+        }
+    }
+
+    VkDeviceSize TransientAttachmentPool::allocatedBytes() const
+    {
+        VkDeviceSize total = 0;
+        for (const auto& block : m_blocks)
+            total += block.size;
+        return total;
+    }
+
+    VkDeviceSize TransientAttachmentPool::requestedBytes() const
+    {
+        VkDeviceSize total = 0;
+        for (const auto& [image, binding] : m_bindings)
+            total += binding.size;
+        return total;
+    }
+} // namespace vks
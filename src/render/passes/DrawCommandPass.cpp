@@ -0,0 +1,233 @@
+#include <render/passes/DrawCommandPass.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "app/EngineContext.hpp"
+#include "gfx/Buffer.hpp"
+#include "gfx/Descriptors.hpp"
+#include "render/DepthPyramid.hpp"
+#include "render/GpuScene.hpp"
+#include "render/RenderGraphResources.hpp"
+
+namespace vks
+{
+    DrawCommandPass::DrawCommandPass(const Device& device, const Ref<GpuScene>& scene,
+                                     const Ref<DepthPyramid>& pyramid)
+        : IComputePass(device), m_scene(scene), m_pyramid(pyramid)
+    {
+        // Its input comes from this frame's upload and its output goes straight to
+        // the geometry pass, so there is nothing to overlap with on another queue
+        setAsyncCompute(false);
+
+        m_setLayout = DescriptorSetLayout::Builder(device)
+                      .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .addBinding(9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                      .build();
+
+        ComputePipelineDesc compute{};
+        compute.computeShader = "assets/shaders/draw_commands.comp.spv";
+
+        PipelineDesc desc{};
+        desc.type = PipelineType::Compute;
+        desc.payload = compute;
+        desc.setLayouts = {m_setLayout->getDescriptorSetLayout()};
+        desc.pushConstants = {
+            VkPushConstantRange{
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+                .offset = 0,
+                .size = sizeof(Push)
+            }
+        };
+        m_pipeline = pipelines().createOrReplace("draw_commands", desc);
+
+        // Too large for push constants; record() updates it inline
+        m_params = std::make_unique<Buffer>(
+            device,
+            sizeof(CullParams),
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+        m_statsBuffer = std::make_unique<Buffer>(
+            device,
+            sizeof(CullStats),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+    }
+
+    DrawCommandPass::~DrawCommandPass() = default;
+
+    void DrawCommandPass::setup(RenderGraphBuilder& builder)
+    {
+        builder.read(m_scene->objects(), ResourceUsage::StorageRead)
+               .read(m_scene->groupOffsets(), ResourceUsage::StorageRead)
+               .read(m_scene->transforms(), ResourceUsage::StorageRead)
+               .write(m_scene->commands(), ResourceUsage::StorageWrite)
+               .write(m_scene->counts(), ResourceUsage::StorageWrite)
+               .write(m_scene->cullFlags(), ResourceUsage::StorageWrite)
+               .write(m_scene->materialIndices(), ResourceUsage::StorageWrite);
+    }
+
+    void DrawCommandPass::prepare(ParallelCommandRecorder& recorder, uint32_t currentImage)
+    {
+        // This slot's previous frame has completed, so its copy of the counters is final
+        const uint32_t frameIndex = EngineContext::get().renderer().getCurrentFrameIndex();
+        if (frameIndex < m_readbacks.size() && m_readbacks[frameIndex])
+            std::memcpy(&m_stats, m_readbacks[frameIndex]->getMapped(), sizeof(CullStats));
+
+        if (m_set != VK_NULL_HANDLE && m_generation == m_scene->generation() &&
+            m_pyramidGeneration == m_pyramid->generation())
+            return;
+
+        writeSets();
+    }
+
+    void DrawCommandPass::writeSets()
+    {
+        auto& ec = EngineContext::get();
+        auto pool = ec.globalDescriptorPool();
+
+        // Frames in flight may still use the sets over the old buffers
+        if (m_set != VK_NULL_HANDLE)
+        {
+            m_device.deletionQueue().push([pool, set = m_set, lateSet = m_lateSet]
+            {
+                std::vector<VkDescriptorSet> sets{set, lateSet};
+                pool->freeDescriptors(sets);
+            });
+            m_set = VK_NULL_HANDLE;
+            m_lateSet = VK_NULL_HANDLE;
+        }
+
+        // An empty render target has no pyramid to bind; record() skips the frame
+        if (m_pyramid->view() == VK_NULL_HANDLE)
+            return;
+
+        auto objects = m_scene->objects().descriptorInfo();
+        auto offsets = m_scene->groupOffsets().descriptorInfo();
+        auto transforms = m_scene->transforms().descriptorInfo();
+        auto cullFlags = m_scene->cullFlags().descriptorInfo();
+        auto materialIndices = m_scene->materialIndices().descriptorInfo();
+        auto stats = m_statsBuffer->descriptorInfo();
+        auto params = m_params->descriptorInfo();
+        VkDescriptorImageInfo pyramid{m_pyramid->sampler(), m_pyramid->view(), VK_IMAGE_LAYOUT_GENERAL};
+
+        auto writeSet = [&](const Buffer& commandBuffer, const Buffer& countBuffer, VkDescriptorSet& set)
+        {
+            auto commands = commandBuffer.descriptorInfo();
+            auto counts = countBuffer.descriptorInfo();
+
+            DescriptorWriter writer(m_setLayout, pool);
+            writer.writeBuffer(0, &objects)
+                  .writeBuffer(1, &offsets)
+                  .writeBuffer(2, &commands)
+                  .writeBuffer(3, &counts)
+                  .writeBuffer(4, &transforms)
+                  .writeBuffer(5, &cullFlags)
+                  .writeBuffer(6, &stats)
+                  .writeBuffer(7, &params)
+                  .writeImage(8, &pyramid)
+                  .writeBuffer(9, &materialIndices);
+            if (!writer.build(set))
+                throw std::runtime_error("Failed to allocate the draw command descriptor set");
+        };
+
+        writeSet(m_scene->commands(), m_scene->counts(), m_set);
+        writeSet(m_scene->lateCommands(), m_scene->lateCounts(), m_lateSet);
+
+        m_generation = m_scene->generation();
+        m_pyramidGeneration = m_pyramid->generation();
+    }
+
+    void DrawCommandPass::record(VkCommandBuffer cmd, uint32_t currentImage)
+    {
+        if (m_set == VK_NULL_HANDLE)
+            return;
+
+        const uint32_t frameIndex = EngineContext::get().renderer().getCurrentFrameIndex();
+        if (m_readbacks.size() <= frameIndex)
+            m_readbacks.resize(frameIndex + 1);
+        if (!m_readbacks[frameIndex])
+        {
+            m_readbacks[frameIndex] = std::make_unique<Buffer>(
+                m_device,
+                sizeof(CullStats),
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            m_readbacks[frameIndex]->map();
+        }
+
+        // The counters and parameters persist: the previous frame's phases must be
+        // done with them before they are read back, cleared and rewritten
+        VkMemoryBarrier previous{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        previous.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        previous.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &previous, 0, nullptr, 0, nullptr);
+
+        VkBufferCopy copy{0, 0, sizeof(CullStats)};
+        vkCmdCopyBuffer(cmd, m_statsBuffer->getBuffer(), m_readbacks[frameIndex]->getBuffer(), 1, &copy);
+
+        const Camera& camera = EngineContext::get().camera();
+        const Frustum frustum = camera.frustum();
+
+        CullParams params{};
+        std::copy(std::begin(frustum.planes), std::end(frustum.planes), params.planes);
+        params.viewProj = camera.proj() * camera.view();
+        params.pyramidViewProj = m_pyramid->viewProj();
+        params.eye = glm::vec4(camera.getPosition(), std::abs(camera.proj()[1][1]));
+        params.lodBias = EngineContext::get().lodBias();
+        params.flags = (m_occlusionCulling ? OCCLUSION : 0) | (m_pyramid->valid() ? PYRAMID_VALID : 0);
+
+        // The copy reads the counters before the fill clears them
+        VkMemoryBarrier copied{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        copied.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        copied.dstAccessMask = VK_ACCESS_HOST_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 1, &copied, 0, nullptr, 0, nullptr);
+
+        vkCmdFillBuffer(cmd, m_statsBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        vkCmdUpdateBuffer(cmd, m_params->getBuffer(), 0, sizeof(params), &params);
+
+        VkMemoryBarrier cleared{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        cleared.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        cleared.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &cleared, 0, nullptr, 0, nullptr);
+
+        Push push{m_scene->slotCount(), EARLY};
+
+        bindPipeline(cmd, m_pipeline);
+        bindDescriptorSets(cmd, 0, {m_set});
+        pushConstants(cmd, &push, sizeof(push));
+        dispatchItems(cmd, push.slotCount, LOCAL_SIZE);
+    }
+
+    void DrawCommandPass::recordLate(VkCommandBuffer cmd)
+    {
+        if (m_lateSet == VK_NULL_HANDLE)
+            return;
+
+        Push push{m_scene->slotCount(), LATE};
+
+        bindPipeline(cmd, m_pipeline);
+        bindDescriptorSets(cmd, 0, {m_lateSet});
+        pushConstants(cmd, &push, sizeof(push));
+        dispatchItems(cmd, push.slotCount, LOCAL_SIZE);
+    }
+} // namespace vks
@@ -0,0 +1,78 @@
+#include <render/passes/FrameReadbackPass.hpp>
+
+#include <cstring>
+
+#include "app/EngineContext.hpp"
+#include "gfx/Buffer.hpp"
+#include "render/RenderGraph.hpp"
+#include "render/RenderGraphResources.hpp"
+
+namespace vks
+{
+    FrameReadbackPass::FrameReadbackPass(const Device& device, const Ref<IRenderTarget>& source)
+        : m_device(device), m_source(source)
+    {
+        m_extent = m_source->extent();
+        m_frameBytes = VkDeviceSize(m_extent.width) * m_extent.height * 4;
+
+        m_buffer = std::make_unique<Buffer>(
+            m_device,
+            m_frameBytes * m_source->numImages(),
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        m_buffer->map();
+    }
+
+    FrameReadbackPass::~FrameReadbackPass() = default;
+
+    void FrameReadbackPass::setup(RenderGraphBuilder& builder)
+    {
+        builder.read(m_source, ImageAspect::Color, ResourceUsage::TransferSrc)
+               .write(*m_buffer, ResourceUsage::TransferDst)
+               .exportBuffer(*m_buffer, ResourceUsage::HostRead);
+    }
+
+    void FrameReadbackPass::record(VkCommandBuffer cmd, uint32_t currentImage)
+    {
+        VkBufferImageCopy region{};
+        region.bufferOffset = m_frameBytes * currentImage;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {m_extent.width, m_extent.height, 1};
+
+        vkCmdCopyImageToBuffer(
+            cmd,
+            m_source->colorImage(currentImage),
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            m_buffer->getBuffer(),
+            1, &region
+        );
+
+        m_lastFrame = EngineContext::get().renderer().frameNumber();
+        m_lastImage = currentImage;
+    }
+
+    bool FrameReadbackPass::readLatest(std::vector<uint8_t>& pixels, uint64_t* frameNumber) const
+    {
+        if (m_lastFrame == 0)
+            return false;
+
+        // The region is only rewritten numImages() frames later, which can't be
+        // recorded before this one has completed
+        EngineContext::get().renderer().waitForFrame(m_lastFrame);
+
+        pixels.resize(m_frameBytes);
+        const auto* mapped = static_cast<const uint8_t*>(m_buffer->getMapped());
+        std::memcpy(pixels.data(), mapped + m_frameBytes * m_lastImage, m_frameBytes);
+
+        if (frameNumber)
+            *frameNumber = m_lastFrame;
+        return true;
+    }
+} // namespace vks
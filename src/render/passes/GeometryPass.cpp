@@ -1,14 +1,22 @@
 #include <render/passes/GeometryPass.hpp>
 #include <gfx/Device.hpp>
 #include <gfx/SwapChain.hpp>
+#include <gfx/Buffer.hpp>
 
+#include <algorithm>
 #include <array>
 #include <iostream>
+#include <stdexcept>
 
 #include <app/EngineContext.hpp>
+#include <core/Log.hpp>
 #include <materials/Material.hpp>
 #include <assets/ShaderCompiler.hpp>
+#include <render/passes/DrawCommandPass.hpp>
 #include <render/passes/IRenderPass.hpp>
+#include <render/DepthPyramid.hpp>
+#include <render/RenderGraphResources.hpp>
+#include <render/ParallelCommandRecorder.hpp>
 
 using namespace vks;
 
@@ -30,7 +38,51 @@ GeometryPass::GeometryPass(const Device& device, const Ref<IRenderTarget>& rende
         m_shaderCompiler->requestCompile(path);
     };
 
-    m_fileWatcher.watchDirectory("assets/shaders/", {".frag", ".vert"}, false, callback);
+    m_fileWatcher.watchDirectory("assets/shaders/", {".frag", ".vert", ".comp"}, false, callback);
+}
+
+GeometryPass::~GeometryPass()
+{
+    vkDestroyRenderPass(m_device.logical(), m_resumeRenderPass, nullptr);
+}
+
+void GeometryPass::setOcclusion(const Ref<DrawCommandPass>& drawCommands, const Ref<DepthPyramid>& pyramid)
+{
+    m_drawCommands = drawCommands;
+    m_pyramid = pyramid;
+}
+
+bool GeometryPass::twoPhase() const
+{
+    return m_gpuScene && m_drawCommands && m_pyramid && m_drawCommands->occlusionCulling();
+}
+
+void GeometryPass::setup(RenderGraphBuilder& builder)
+{
+    builder.write(m_renderTarget, ImageAspect::Color, ResourceUsage::ColorAttachment)
+           .write(m_renderTarget, ImageAspect::Depth, ResourceUsage::DepthAttachment);
+
+    // Pulls the GPU scene's upload and DrawCommandPass into the graph
+    if (m_gpuScene)
+    {
+        builder.read(m_gpuScene->transforms(), ResourceUsage::VertexStorageRead)
+               .read(m_gpuScene->materialIndices(), ResourceUsage::VertexStorageRead)
+               .read(m_gpuScene->commands(), ResourceUsage::IndirectRead)
+               .read(m_gpuScene->counts(), ResourceUsage::IndirectRead);
+    }
+
+    // DrawCommandPass's late phase, recorded in between the two render passes.
+    // It also reads the transforms, which the early phase already made visible,
+    // and writes the material indices of the slots it draws; record() makes
+    // those visible to the resumed draws.
+    if (twoPhase())
+    {
+        builder.read(m_gpuScene->objects(), ResourceUsage::StorageRead)
+               .read(m_gpuScene->groupOffsets(), ResourceUsage::StorageRead)
+               .read(m_gpuScene->cullFlags(), ResourceUsage::StorageRead)
+               .write(m_gpuScene->lateCommands(), ResourceUsage::StorageWrite)
+               .write(m_gpuScene->lateCounts(), ResourceUsage::StorageWrite);
+    }
 }
 
 void GeometryPass::update(float dt, uint32_t currentImage)
@@ -39,136 +91,519 @@ void GeometryPass::update(float dt, uint32_t currentImage)
     m_shaderCompiler->update();
 }
 
-void GeometryPass::record(VkCommandBuffer cmdBuffer, uint32_t imageIndex)
+uint32_t GeometryPass::sortId(std::unordered_map<const void*, uint32_t>& ids, const void* object)
 {
-    auto& ce = EngineContext::get();
-    auto frameIndex = ce.renderer().getCurrentFrameIndex();
+    return ids.try_emplace(object, static_cast<uint32_t>(ids.size())).first->second;
+}
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = handle();
-    renderPassInfo.framebuffer = frameBuffer(frameIndex);
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = m_renderTarget->extent();
+const GeometryPass::PipelineState& GeometryPass::pipelineState(PipelineHandle handle)
+{
+    if (m_pipelineStates.size() <= handle.id)
+        m_pipelineStates.resize(handle.id + 1);
+
+    PipelineState& state = m_pipelineStates[handle.id];
+    if (state.pipeline != VK_NULL_HANDLE)
+        return state;
+
+    state.pipeline = pipelines().getPipeline(handle);
+    state.layout = pipelines().getLayout(handle);
+    state.blended = pipelines().isBlended(handle);
+    state.instanced = isInstanced(handle);
+    if (const auto* graphics = std::get_if<GraphicsPipelineDesc>(&pipelines().getDesc(handle).payload))
+        state.vertexFormat = graphics->vertexFormat;
+    return state;
+}
 
-    // Set clear color AND depth
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = {{0.01f, 0.01f, 0.01f, 1.0f}};
-    clearValues[1].depthStencil = {1.0f, 0}; // For depth buffer
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
+bool GeometryPass::isInstanced(PipelineHandle handle) const
+{
+    const auto& setLayouts = pipelines().getDesc(handle).setLayouts;
+    VkDescriptorSetLayout instanceLayout =
+        EngineContext::get().getDescriptorSetLayout("instances")->getDescriptorSetLayout();
+    return setLayouts.size() > INSTANCE_SET && setLayouts[INSTANCE_SET] == instanceLayout;
+}
 
-    vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+bool GeometryPass::drawsIndirect(const Material& material) const
+{
+    const PipelineHandle handle = material.getPipeline();
+    return isInstanced(handle) && !pipelines().isBlended(handle);
+}
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(m_renderTarget->extent().width);
-    viewport.height = static_cast<float>(m_renderTarget->extent().height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+template<typename View, typename Entities>
+void GeometryPass::buildDrawList(const View& renderObjects, const Entities& entities, bool cull)
+{
+    const Camera& camera = EngineContext::get().camera();
+    const glm::vec3 eye = camera.getPosition();
+    const glm::vec3 forward = camera.getDirection();
+    const float depthRange = camera.farPlane() - camera.nearPlane();
+    const float lodBias = EngineContext::get().lodBias();
+
+    m_drawItems.clear();
+    m_drawKeys.clear();
+    m_drawPackets.clear();
+    m_culler.clear();
+    m_pipelineIds.clear();
+    m_materialIds.clear();
+    m_meshIds.clear();
+    // Pipelines may have been rebuilt since last frame
+    m_pipelineStates.clear();
+
+    for (Entity entity : entities)
+    {
+        auto [renderable, transform] = renderObjects.template get<Renderable, Transform>(entity);
+        Material& material = *renderable.material;
+        const PipelineState& state = pipelineState(material.getPipeline());
+
+        DrawItem item{};
+        item.model = renderable.model.get();
+        item.material = &material;
+        item.transform = &transform.transform;
+        item.pipeline = state.pipeline;
+        item.layout = state.layout;
+        item.instanced = state.instanced;
+
+        BoundingSphere bounds{};
+        if (item.model)
+        {
+            if (item.model->vertexFormat() != state.vertexFormat)
+                throw std::runtime_error("Model vertex format doesn't match its material's pipeline");
 
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = m_renderTarget->extent();
-    vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+            bounds = item.model->boundingSphere().transformed(transform.transform);
+            item.lod = item.model->selectLod(camera.projectedSize(bounds), lodBias);
+        }
 
-    // Get Scene Data
-    auto renderObjects = ce.scene().view<Renderable, Transform>();
+        DrawKey key;
+        key.layer = material.layer_priority;
+        key.transparent = state.blended;
+        key.pipeline = sortId(m_pipelineIds, item.pipeline);
+        // Materials of one type share a set, so the material itself is the key
+        // that keeps batches of it together
+        key.material = sortId(m_materialIds, &material);
+        // Each level is its own mesh, so equal levels sort together and batch
+        key.mesh = sortId(m_meshIds, item.model ? &item.model->lod(item.lod) : nullptr);
+
+        // Distance along the view direction; draws behind the camera clamp to 0
+        const glm::vec3 position = glm::vec3(transform.transform[3]);
+        key.depth = (glm::dot(position - eye, forward) - camera.nearPlane()) / depthRange;
+
+        m_drawPackets.push_back({packDrawKey(key), static_cast<uint32_t>(m_drawItems.size())});
+        m_drawItems.push_back(item);
+        m_drawKeys.push_back(key);
+
+        if (!cull)
+            continue;
+        if (item.model)
+            m_culler.add(bounds);
+        else
+            m_culler.addAlwaysVisible();
+    }
 
-    VkDescriptorSet cameraSet = ce.cameraDescriptorSet();
+    // Cull before sorting so the sort and batching only see what is drawn
+    if (cull && m_culler.cull(camera.frustum()) < m_drawPackets.size())
+        std::erase_if(m_drawPackets, [this](const DrawPacket& packet) { return !m_culler.visible(packet.index); });
+
+    // More pipelines, materials or meshes in view than the key has room for
+    // fall back to a slower sort rather than wrapping
+    const bool packed = sortDrawPackets(m_drawPackets, m_sortScratch, m_drawKeys);
+    if (!packed && !m_drawKeysOverflowed)
+        LOG_WARN("Draw list IDs overflow the packed sort key ({} pipelines, {} materials, {} meshes); "
+                 "sorting on the full key", m_pipelineIds.size(), m_materialIds.size(), m_meshIds.size());
+    m_drawKeysOverflowed = !packed;
+}
+
+void GeometryPass::buildBatches(uint32_t frameIndex)
+{
+    m_batches.clear();
+
+    InstanceBuffer& instances = reserveInstances(frameIndex, m_drawPackets.size());
+    auto* transforms = static_cast<glm::mat4*>(instances.buffer->getMapped());
+    auto* materialIndices = static_cast<uint32_t*>(instances.materials->getMapped());
+
+    // Runs of the sorted list that share model, LOD and material become one instanced
+    // draw. Only adjacent packets merge, so the sort order (including
+    // back-to-front for transparent draws) is kept.
+    for (uint32_t i = 0; i < m_drawPackets.size(); ++i)
+    {
+        const DrawItem& item = m_drawItems[m_drawPackets[i].index];
+        transforms[i] = item.model ? *item.transform * item.model->vertexTransform() : *item.transform;
+        materialIndices[i] = item.material->getMaterialIndex();
 
-    // Sort (Optimization)
-    // TODO: Reimplement this somehow
-    // std::sort(renderObjects.begin(), renderObjects.end(),
-    //           [](const RenderObject& a, const RenderObject& b)
-    //           {
-    //               return a.getSortKey() < b.getSortKey();
-    //           });
+        if (!m_batches.empty())
+        {
+            DrawBatch& last = m_batches.back();
+            const DrawItem& lastItem = m_drawItems[last.item];
+            if (item.instanced && lastItem.instanced &&
+                item.model == lastItem.model && item.lod == lastItem.lod && item.material == lastItem.material)
+            {
+                last.instanceCount++;
+                continue;
+            }
+        }
 
-    // Bind Global Camera Set (Set 0)
-    if (cameraSet != VK_NULL_HANDLE && renderObjects.size_hint() != 0)
+        m_batches.push_back({m_drawPackets[i].index, i, 1});
+    }
+}
+
+void GeometryPass::buildIndirectDraws()
+{
+    m_indirectDraws.clear();
+    if (!m_gpuScene)
+        return;
+
+    const auto& groups = m_gpuScene->groups();
+    for (uint32_t i = 0; i < groups.size(); ++i)
     {
-        auto firstObject = renderObjects.begin();
-        const auto renderable = renderObjects.get<Renderable>(*firstObject);
+        if (groups[i].objectCount == 0)
+            continue;
 
-        auto layoutName = renderable.material->getPipelineName();
-        auto layout = pipelines().getLayout(layoutName);
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                layout, 0, 1, &cameraSet, 0, nullptr);
+        const PipelineState& state = pipelineState(groups[i].pipeline);
+        m_indirectDraws.push_back({i, state.pipeline, state.layout});
     }
 
-    // Render Loop
-    VkPipeline lastPipeline = VK_NULL_HANDLE;
-    VkDescriptorSet lastMaterialSet = VK_NULL_HANDLE;
+    // About one entry per pipeline, so sorting costs nothing next to the draws
+    std::sort(m_indirectDraws.begin(), m_indirectDraws.end(),
+              [](const IndirectDraw& a, const IndirectDraw& b) { return a.pipeline < b.pipeline; });
+}
 
-    for (const auto& obj : renderObjects)
+GeometryPass::InstanceBuffer& GeometryPass::reserveInstances(uint32_t frameIndex, size_t count)
+{
+    if (m_instanceBuffers.size() <= frameIndex)
+        m_instanceBuffers.resize(frameIndex + 1);
+
+    InstanceBuffer& instances = m_instanceBuffers[frameIndex];
+    if (instances.buffer && instances.capacity >= count)
+        return instances;
+
+    auto& ec = EngineContext::get();
+    const size_t capacity = std::max({count, instances.capacity * 2, MIN_INSTANCE_CAPACITY});
+
+    // This slot's previous frame has completed, so its buffer and set are free
+    instances.buffer = std::make_unique<Buffer>(
+        m_device,
+        capacity * sizeof(glm::mat4),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    instances.buffer->map();
+    instances.materials = std::make_unique<Buffer>(
+        m_device,
+        capacity * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    instances.materials->map();
+    instances.capacity = capacity;
+
+    auto bufferInfo = instances.buffer->descriptorInfo();
+    auto materialInfo = instances.materials->descriptorInfo();
+    DescriptorWriter writer(ec.getDescriptorSetLayout("instances"), ec.globalDescriptorPool());
+    writer.writeBuffer(0, &bufferInfo)
+          .writeBuffer(1, &materialInfo);
+    if (instances.set == VK_NULL_HANDLE)
     {
-        auto [renderable, transform] = renderObjects.get<Renderable, Transform>(obj);
+        if (!writer.build(instances.set))
+            throw std::runtime_error("Failed to allocate the geometry pass instance descriptor set");
+    }
+    else
+    {
+        writer.overwrite(instances.set);
+    }
+
+    return instances;
+}
 
-        auto pipelineName = renderable.material->getPipelineName();
-        VkPipeline pipeline = pipelines().getPipeline(pipelineName);
-        VkPipelineLayout layout = pipelines().getLayout(pipelineName);
+Ref<ParallelCommandRecorder::Recording> GeometryPass::recordIndirect(
+    ParallelCommandRecorder& recorder, VkFramebuffer framebuffer, VkBuffer commands, VkBuffer counts)
+{
+    VkDescriptorSet cameraSet = EngineContext::get().cameraDescriptorSet();
 
-        // Bind Pipeline (If Changed)
-        if (pipeline != lastPipeline)
+    // Few entries; a single buffer
+    return recorder.record(
+        handle(), framebuffer, m_indirectDraws.size(), m_indirectDraws.size(),
+        [this, cameraSet, objectSet = m_gpuScene->instanceSet(), commands, counts](
+        VkCommandBuffer cmdBuffer, size_t begin, size_t end)
         {
-            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-            lastPipeline = pipeline;
+            setViewportAndScissor(cmdBuffer);
 
-            // Re-bind global set if layout changed (Vulkan requirement)
-            if (cameraSet != VK_NULL_HANDLE)
+            const auto& groups = m_gpuScene->groups();
+            VkPipeline lastPipeline = VK_NULL_HANDLE;
+            VkDescriptorSet lastMaterialSet = VK_NULL_HANDLE;
+            GeometryBinding boundGeometry;
+
+            for (size_t i = begin; i < end; ++i)
             {
-                vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                        layout, 0, 1, &cameraSet, 0, nullptr);
+                const IndirectDraw& draw = m_indirectDraws[i];
+                const GpuScene::DrawGroup& group = groups[draw.group];
+
+                if (draw.pipeline != lastPipeline)
+                {
+                    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+                    lastPipeline = draw.pipeline;
+                    lastMaterialSet = VK_NULL_HANDLE;
+
+                    if (cameraSet != VK_NULL_HANDLE)
+                    {
+                        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                                draw.layout, 0, 1, &cameraSet, 0, nullptr);
+                    }
+
+                    // Transforms by GpuScene slot; firstInstance of every command is the slot
+                    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                            draw.layout, INSTANCE_SET, 1, &objectSet, 0, nullptr);
+                }
+
+                // The vertex shader takes each object's material index by slot
+                VkDescriptorSet materialSet = group.material->getDescriptorSet();
+                if (materialSet != lastMaterialSet)
+                {
+                    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                            draw.layout, 1, 1, &materialSet, 0, nullptr);
+                    lastMaterialSet = materialSet;
+                }
+                boundGeometry.bind(cmdBuffer, group.geometry);
+
+                vkCmdDrawIndexedIndirectCount(
+                    cmdBuffer,
+                    commands, group.commandOffset * sizeof(VkDrawIndexedIndirectCommand),
+                    counts, draw.group * sizeof(uint32_t),
+                    group.objectCount,
+                    sizeof(VkDrawIndexedIndirectCommand));
             }
-        }
+        });
+}
 
-        renderable.material->draw(
-            cmdBuffer,
-            layout,
-            lastMaterialSet, // Passed by reference so material can update cache
-            renderable.model.get(),
-            transform.transform
-        );
+void GeometryPass::prepare(ParallelCommandRecorder& recorder, uint32_t imageIndex)
+{
+    auto& ce = EngineContext::get();
+    auto frameIndex = ce.renderer().getCurrentFrameIndex();
+    VkFramebuffer framebuffer = frameBuffer(frameIndex);
+
+    // Get Scene Data. The view is built here, on the main thread; workers only read through it.
+    auto renderObjects = ce.scene().view<Renderable, Transform>();
+    if (m_gpuScene)
+    {
+        buildDrawList(renderObjects, m_gpuScene->fallback(), true);
+    }
+    else
+    {
+        // The scene BVH skips whole subtrees outside the frustum
+        SceneBVH& spatial = ce.scene().spatial();
+        m_visibleEntities.clear();
+        spatial.query(ce.camera().frustum(), m_visibleEntities);
+        m_visibleEntities.insert(m_visibleEntities.end(), spatial.unbounded().begin(), spatial.unbounded().end());
+        buildDrawList(renderObjects, m_visibleEntities, false);
     }
+    buildIndirectDraws();
+    buildBatches(frameIndex);
 
-    auto selectedEntities = ce.editor().getSelectedEntities();
+    VkDescriptorSet cameraSet = ce.cameraDescriptorSet();
+    VkDescriptorSet instanceSet = m_instanceBuffers[frameIndex].set;
 
-    for (auto entity : selectedEntities)
+    if (m_gpuScene)
     {
-        auto& renderable = ce.scene().getComponent<Renderable>(entity);
-        auto& transform = ce.scene().getComponent<Transform>(entity);
-
-        // Draw outline with a special "outline" pipeline
-        VkPipeline outlinePipeline = pipelines().getPipeline("outline");
-        VkPipelineLayout outlineLayout = pipelines().getLayout("outline");
-        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, outlinePipeline);
-        if (cameraSet != VK_NULL_HANDLE)
+        // Counts and commands come from DrawCommandPass
+        m_indirectRecording = recordIndirect(recorder, framebuffer, m_gpuScene->commands().getBuffer(),
+                                             m_gpuScene->counts().getBuffer());
+        if (twoPhase())
         {
-            vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, outlineLayout, 0, 1, &cameraSet, 0,
-                                    nullptr);
+            m_lateRecording = recordIndirect(recorder, framebuffer, m_gpuScene->lateCommands().getBuffer(),
+                                             m_gpuScene->lateCounts().getBuffer());
         }
+    }
+
+    m_drawRecording = recorder.record(
+        handle(), framebuffer, m_batches.size(), DRAWS_PER_CHUNK,
+        [this, cameraSet, instanceSet](VkCommandBuffer cmdBuffer, size_t begin, size_t end)
+        {
+            setViewportAndScissor(cmdBuffer);
 
+            // Render Loop. Sorted packets keep equal pipelines and materials
+            // adjacent, so most draws bind nothing.
+            VkPipeline lastPipeline = VK_NULL_HANDLE;
+            VkDescriptorSet lastMaterialSet = VK_NULL_HANDLE;
+            // Models share the geometry pool's buffers, so this rarely binds
+            // more than once per chunk
+            GeometryBinding boundGeometry;
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                const DrawBatch& batch = m_batches[i];
+                const DrawItem& item = m_drawItems[batch.item];
+
+                // Bind Pipeline (If Changed)
+                if (item.pipeline != lastPipeline)
+                {
+                    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, item.pipeline);
+                    lastPipeline = item.pipeline;
+                    // The material set may not survive a layout change
+                    lastMaterialSet = VK_NULL_HANDLE;
+
+                    // Re-bind global set if layout changed (Vulkan requirement)
+                    if (cameraSet != VK_NULL_HANDLE)
+                    {
+                        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                                item.layout, 0, 1, &cameraSet, 0, nullptr);
+                    }
+
+                    if (item.instanced)
+                    {
+                        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                                item.layout, INSTANCE_SET, 1, &instanceSet, 0, nullptr);
+                    }
+                }
+
+                if (item.model)
+                    item.model->bindBuffers(cmdBuffer, boundGeometry);
+
+                item.material->draw(
+                    cmdBuffer,
+                    item.layout,
+                    lastMaterialSet, // Passed by reference so material can update cache
+                    item.model,
+                    batch.firstInstance,
+                    batch.instanceCount,
+                    item.lod
+                );
+            }
+        });
 
-        struct PushData
+    auto selectedEntities = ce.editor().getSelectedEntities();
+    m_outlineList.assign(selectedEntities.begin(), selectedEntities.end());
+
+    // Few entries; a single buffer recorded alongside the draw chunks
+    m_outlineRecording = recorder.record(
+        handle(), framebuffer, m_outlineList.size(), m_outlineList.size(),
+        [this, renderObjects, cameraSet](VkCommandBuffer cmdBuffer, size_t begin, size_t end)
         {
-            glm::mat4 model;
-            float outlineWidth = 0.05f;
-            alignas(16) glm::vec4 color = glm::vec4(1.0f, 1.0f, 0.4f, 0.1f);
-        } pushData;
+            setViewportAndScissor(cmdBuffer);
 
-        pushData.model = transform.transform;
-        vkCmdPushConstants(cmdBuffer, outlineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
-                           sizeof(PushData), &pushData);
+            // Draw outline with a special "outline" pipeline
+            VkPipeline outlinePipeline = pipelines().getPipeline(m_outlinePipeline);
+            VkPipelineLayout outlineLayout = pipelines().getLayout(m_outlinePipeline);
+            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, outlinePipeline);
+            if (cameraSet != VK_NULL_HANDLE)
+            {
+                vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, outlineLayout, 0, 1, &cameraSet, 0,
+                                        nullptr);
+            }
+
+            GeometryBinding boundGeometry;
+            for (size_t i = begin; i < end; ++i)
+            {
+                auto [renderable, transform] = renderObjects.get<Renderable, Transform>(m_outlineList[i]);
+
+                struct PushData
+                {
+                    glm::mat4 model;
+                    float outlineWidth = 0.05f;
+                    alignas(16) glm::vec4 color = glm::vec4(1.0f, 1.0f, 0.4f, 0.1f);
+                } pushData;
+
+                pushData.model = transform.transform * renderable.model->vertexTransform();
+                vkCmdPushConstants(cmdBuffer, outlineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                                   sizeof(PushData), &pushData);
+
+                renderable.model->bindBuffers(cmdBuffer, boundGeometry);
+                renderable.model->draw(cmdBuffer, 1, 0);
+            }
+        });
+}
+
+void GeometryPass::beginRenderPass(VkCommandBuffer cmdBuffer, VkRenderPass renderPass, uint32_t frameIndex) const
+{
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = frameBuffer(frameIndex);
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = m_renderTarget->extent();
+
+    // Set clear color AND depth
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {{0.01f, 0.01f, 0.01f, 1.0f}};
+    clearValues[1].depthStencil = {1.0f, 0}; // For depth buffer
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
 
-        renderable.model->bind(cmdBuffer);
+    // All draws were recorded into secondary buffers by prepare()
+    vkCmdBeginRenderPass(cmdBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+}
+
+void GeometryPass::record(VkCommandBuffer cmdBuffer, uint32_t imageIndex)
+{
+    auto& ce = EngineContext::get();
+    auto frameIndex = ce.renderer().getCurrentFrameIndex();
+
+    beginRenderPass(cmdBuffer, handle(), frameIndex);
+
+    // Opaque GPU-driven draws first; the CPU list holds the blended ones
+    if (m_indirectRecording)
+        m_indirectRecording->execute(cmdBuffer);
+
+    if (twoPhase())
+    {
+        vkCmdEndRenderPass(cmdBuffer);
+
+        // The resumed render pass loads and keeps drawing into the attachments
+        VkMemoryBarrier drawn{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        drawn.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        drawn.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            cmdBuffer,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            0, 1, &drawn, 0, nullptr, 0, nullptr);
+
+        const Camera& camera = ce.camera();
+        m_pyramid->build(cmdBuffer, frameIndex, camera.proj() * camera.view());
+        m_drawCommands->recordLate(cmdBuffer);
+
+        // The late commands and the material indices of the slots they draw
+        VkMemoryBarrier culled{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        culled.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        culled.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             0, 1, &culled, 0, nullptr, 0, nullptr);
+
+        beginRenderPass(cmdBuffer, m_resumeRenderPass, frameIndex);
+
+        // Objects the previous frame's depth hid but this frame's doesn't
+        if (m_lateRecording)
+            m_lateRecording->execute(cmdBuffer);
     }
 
+    if (m_drawRecording)
+        m_drawRecording->execute(cmdBuffer);
+    if (m_outlineRecording)
+        m_outlineRecording->execute(cmdBuffer);
+
+    m_indirectRecording.reset();
+    m_lateRecording.reset();
+    m_drawRecording.reset();
+    m_outlineRecording.reset();
+
     vkCmdEndRenderPass(cmdBuffer);
 }
 
+void GeometryPass::setViewportAndScissor(VkCommandBuffer cmdBuffer) const
+{
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(m_renderTarget->extent().width);
+    viewport.height = static_cast<float>(m_renderTarget->extent().height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = m_renderTarget->extent();
+    vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+}
+
 void GeometryPass::recreate()
 {
     IRenderPass::recreate();
@@ -184,8 +619,9 @@ void GeometryPass::createRenderPass()
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // The render graph transitions attachments in and out of the pass
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference colorRef = {};
     colorRef.attachment = 0;
@@ -197,11 +633,14 @@ void GeometryPass::createRenderPass()
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 
     depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // Kept for the depth pyramid and the resumed render pass, unless it is transient
+    depthAttachment.storeOp = m_renderTarget->transientDepth()
+                                  ? VK_ATTACHMENT_STORE_OP_DONT_CARE
+                                  : VK_ATTACHMENT_STORE_OP_STORE;
 
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentReference depthRef = {};
@@ -214,21 +653,6 @@ void GeometryPass::createRenderPass()
     subpass.pColorAttachments = &colorRef;
     subpass.pDepthStencilAttachment = &depthRef;
 
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-
-    // We now wait for both Color Output AND Early Fragment Tests (Depth)
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-
-    // We want to write Color AND write Depth
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
     // Create Render Pass
     std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
 
@@ -238,14 +662,32 @@ void GeometryPass::createRenderPass()
     createInfo.pAttachments = attachments.data();
     createInfo.subpassCount = 1;
     createInfo.pSubpasses = &subpass;
-    createInfo.dependencyCount = 1;
-    createInfo.pDependencies = &dependency;
 
     if (vkCreateRenderPass(m_device.logical(), &createInfo, nullptr,
                            &m_renderPass) != VK_SUCCESS)
     {
         throw std::runtime_error("Render pass creation failed");
     }
+
+    // Same attachments, loaded instead of cleared, for the draws after the late
+    // culling phase. Frames in flight may still use the old one.
+    if (m_resumeRenderPass != VK_NULL_HANDLE)
+    {
+        m_device.deletionQueue().push([device = m_device.logical(), renderPass = m_resumeRenderPass]
+        {
+            vkDestroyRenderPass(device, renderPass, nullptr);
+        });
+    }
+
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+    if (vkCreateRenderPass(m_device.logical(), &createInfo, nullptr,
+                           &m_resumeRenderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Render pass creation failed");
+    }
 }
 
 void GeometryPass::createFrameBuffers()
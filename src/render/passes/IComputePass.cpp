@@ -0,0 +1,60 @@
+#include <gfx/Buffer.hpp>
+#include <gfx/Device.hpp>
+#include <render/passes/IComputePass.hpp>
+
+#include <stdexcept>
+
+using namespace vks;
+
+IComputePass::IComputePass(const Device& device)
+    : m_device(device), m_pipelineManager(device)
+{
+}
+
+void IComputePass::recreate()
+{
+    // Replaced pipelines go through the device's deletion queue
+    pipelines().recreateAll();
+}
+
+void IComputePass::bindPipeline(VkCommandBuffer cmd, PipelineHandle pipeline)
+{
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines().getPipeline(pipeline));
+    m_boundLayout = pipelines().getLayout(pipeline);
+}
+
+void IComputePass::bindDescriptorSets(VkCommandBuffer cmd, uint32_t firstSet,
+                                      const std::vector<VkDescriptorSet>& sets) const
+{
+    if (m_boundLayout == VK_NULL_HANDLE)
+        throw std::runtime_error("IComputePass: bindPipeline() must be called before binding descriptor sets");
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_boundLayout,
+                            firstSet, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+}
+
+void IComputePass::pushConstants(VkCommandBuffer cmd, const void* data, uint32_t size, uint32_t offset) const
+{
+    if (m_boundLayout == VK_NULL_HANDLE)
+        throw std::runtime_error("IComputePass: bindPipeline() must be called before pushing constants");
+
+    vkCmdPushConstants(cmd, m_boundLayout, VK_SHADER_STAGE_COMPUTE_BIT, offset, size, data);
+}
+
+void IComputePass::dispatch(VkCommandBuffer cmd, uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ) const
+{
+    if (groupsX == 0 || groupsY == 0 || groupsZ == 0)
+        return;
+
+    vkCmdDispatch(cmd, groupsX, groupsY, groupsZ);
+}
+
+void IComputePass::dispatchItems(VkCommandBuffer cmd, uint32_t items, uint32_t localSize) const
+{
+    dispatch(cmd, groupCount(items, localSize));
+}
+
+void IComputePass::dispatchIndirect(VkCommandBuffer cmd, const Buffer& args, VkDeviceSize offset) const
+{
+    vkCmdDispatchIndirect(cmd, args.getBuffer(), offset);
+}
@@ -18,8 +18,14 @@ IRenderPass::~IRenderPass()
 
 void IRenderPass::recreate()
 {
-    vkDeviceWaitIdle(m_device.logical());
-    destroyFrameBuffers();
+    // Frames in flight may still use the old framebuffers
+    m_device.deletionQueue().push([device = m_device.logical(), frameBuffers = std::move(m_frameBuffers)]
+    {
+        for (VkFramebuffer fb : frameBuffers)
+            vkDestroyFramebuffer(device, fb, nullptr);
+    });
+    m_frameBuffers.clear();
+
     m_oldRenderPass = m_renderPass;
     createRenderPass();
     createFrameBuffers();
@@ -4,6 +4,7 @@
 #include <app/EngineContext.hpp>
 #include <render/passes/IRenderPass.hpp>
 #include <render/passes/ImGuiRenderPass.hpp>
+#include <render/RenderGraphResources.hpp>
 
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
@@ -51,6 +52,13 @@ ImGuiRenderPass::ImGuiRenderPass(const Device &device,
     ImGui_ImplVulkan_Init(&init_info);
 }
 
+void ImGuiRenderPass::setup(RenderGraphBuilder& builder)
+{
+    // The viewport panel samples the scene color
+    builder.read(EngineContext::get().getRenderTarget(), ImageAspect::Color, ResourceUsage::SampledRead)
+           .write(m_renderTarget, ImageAspect::Color, ResourceUsage::ColorAttachment);
+}
+
 void ImGuiRenderPass::update(float dt, uint32_t currentImage)
 {
 }
@@ -84,9 +92,9 @@ void ImGuiRenderPass::createRenderPass() {
   attachmentDescription.samples = VK_SAMPLE_COUNT_1_BIT;
   attachmentDescription.loadOp =
       VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-  attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  attachmentDescription.finalLayout =
-      VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Last pass so we want to present after
+  // The render graph transitions to and from PRESENT_SRC_KHR around the pass
+  attachmentDescription.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  attachmentDescription.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
   attachmentDescription.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   attachmentDescription.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   attachmentDescription.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -102,21 +110,6 @@ void ImGuiRenderPass::createRenderPass() {
   subpass.colorAttachmentCount = 1;
   subpass.pColorAttachments = &attachmentReference;
 
-  // Create a subpass dependency to synchronize our main and UI render passes
-  // We want to render the UI after the geometry has been written to the
-  // framebuffer so we need to configure a subpass dependency as such
-  VkSubpassDependency subpassDependency = {};
-  subpassDependency.srcSubpass =
-      VK_SUBPASS_EXTERNAL;          // Create external dependency
-  subpassDependency.dstSubpass = 0; // The geometry subpass comes first
-  subpassDependency.srcStageMask =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  subpassDependency.dstStageMask =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  subpassDependency.srcAccessMask =
-      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; // Wait on writes
-  subpassDependency.dstStageMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
   // Finally create the UI render pass
   VkRenderPassCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -124,8 +117,6 @@ void ImGuiRenderPass::createRenderPass() {
   createInfo.pAttachments = &attachmentDescription;
   createInfo.subpassCount = 1;
   createInfo.pSubpasses = &subpass;
-  createInfo.dependencyCount = 1;
-  createInfo.pDependencies = &subpassDependency;
 
   if (vkCreateRenderPass(m_device.logical(), &createInfo, nullptr,
                          &m_renderPass) != VK_SUCCESS) {
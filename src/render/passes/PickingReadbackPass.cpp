@@ -0,0 +1,52 @@
+#include <render/passes/PickingReadbackPass.hpp>
+
+#include <algorithm>
+
+#include "app/EngineContext.hpp"
+#include "gfx/Buffer.hpp"
+#include "render/RenderGraphResources.hpp"
+
+namespace vks
+{
+    PickingReadbackPass::PickingReadbackPass(const Ref<IRenderTarget>& source, Buffer& destination)
+        : m_source(source), m_destination(destination)
+    {
+    }
+
+    void PickingReadbackPass::setup(RenderGraphBuilder& builder)
+    {
+        builder.read(m_source, ImageAspect::Color, ResourceUsage::TransferSrc)
+               .write(m_destination, ResourceUsage::TransferDst)
+               .exportBuffer(m_destination, ResourceUsage::HostRead);
+    }
+
+    void PickingReadbackPass::record(VkCommandBuffer cmd, uint32_t currentImage)
+    {
+        glm::vec2 mousePos = EngineContext::get().editor().viewportMousePos;
+
+        // Clamp mouse
+        uint32_t width = m_source->extent().width;
+        uint32_t height = m_source->extent().height;
+        int32_t x = std::clamp((int32_t)mousePos.x, 0, (int32_t)width - 1);
+        int32_t y = std::clamp((int32_t)mousePos.y, 0, (int32_t)height - 1);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {x, y, 0};
+        region.imageExtent = {1, 1, 1};
+
+        vkCmdCopyImageToBuffer(
+            cmd,
+            m_source->colorImage(currentImage),
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            m_destination.getBuffer(),
+            1, &region
+        );
+    }
+} // namespace vks
@@ -7,6 +7,8 @@
 #include "gfx/Device.hpp"
 #include "gfx/SwapChain.hpp"
 #include "platform/Input.hpp"
+#include "render/RenderGraphResources.hpp"
+#include "render/ParallelCommandRecorder.hpp"
 
 namespace vks
 {
@@ -48,6 +50,11 @@ namespace vks
         }
     }
 
+    void UIPass::setup(RenderGraphBuilder& builder)
+    {
+        builder.write(m_renderTarget, ImageAspect::Color, ResourceUsage::ColorAttachment);
+    }
+
     void UIPass::update(float dt, uint32_t imageIndex)
     {
         static auto& ce = EngineContext::get();
@@ -55,6 +62,84 @@ namespace vks
         entitySelection(ce, input);
     }
 
+    void UIPass::prepare(ParallelCommandRecorder& recorder, uint32_t imageIndex)
+    {
+        auto& ce = EngineContext::get();
+        auto view = ce.scene().view<Renderable, Transform>();
+
+        m_drawList.clear();
+
+        // Only the pixel under the cursor is read back (clamped like
+        // PickingReadbackPass does), so only what the ray through its centre
+        // hits can end up there
+        const VkExtent2D extent = m_renderTarget->extent();
+        if (extent.width > 0 && extent.height > 0)
+        {
+            const glm::vec2 size(extent.width, extent.height);
+            const glm::vec2 pixel = glm::clamp(glm::floor(ce.editor().viewportMousePos), glm::vec2(0.0f), size - 1.0f);
+            const glm::vec2 ndc = (pixel + 0.5f) / size * 2.0f - 1.0f;
+            ce.scene().spatial().query(ce.camera().ray(ndc), m_drawList);
+        }
+
+        // Skip the selected entity to avoid it being overwritten by the ID of other entities behind it
+        // This behaviour selects the object behind the current one when clicking on the currently selected object
+        std::erase(m_drawList, static_cast<Entity>(selectedEntityID));
+
+        VkDescriptorSet cameraSet = ce.cameraDescriptorSet();
+
+        m_drawRecording = recorder.record(
+            handle(), frameBuffer(imageIndex), m_drawList.size(), DRAWS_PER_CHUNK,
+            [this, view, cameraSet](VkCommandBuffer cmd, size_t begin, size_t end)
+            {
+                VkViewport viewport{};
+                viewport.width = (float)m_renderTarget->extent().width;
+                viewport.height = (float)m_renderTarget->extent().height;
+                viewport.minDepth = 0.0f;
+                viewport.maxDepth = 1.0f;
+                vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+                VkRect2D scissor{{0, 0}, m_renderTarget->extent()};
+                vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+                VkPipeline pipeline = pipelines().getPipeline(m_pickerPipeline);
+                VkPipelineLayout layout = pipelines().getLayout(m_pickerPipeline);
+
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+                // Bind camera descriptor set
+                if (cameraSet != VK_NULL_HANDLE)
+                    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &cameraSet, 0, nullptr);
+
+                GeometryBinding boundGeometry;
+                for (size_t i = begin; i < end; ++i)
+                {
+                    Entity entity = m_drawList[i];
+                    auto& renderable = view.get<Renderable>(entity);
+                    auto& transform = view.get<Transform>(entity);
+
+                    struct PushData
+                    {
+                        glm::mat4 model;
+                        uint32_t id;
+                    } pushData;
+                    pushData.model = transform.transform * renderable.model->vertexTransform();
+                    pushData.id = (uint32_t)entity + 1;
+
+                    vkCmdPushConstants(
+                        cmd,
+                        layout,
+                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                        0,
+                        sizeof(PushData),
+                        &pushData
+                    );
+
+                    renderable.model->bindBuffers(cmd, boundGeometry);
+                    renderable.model->draw(cmd, 1, 0);
+                }
+            });
+    }
+
     void UIPass::record(VkCommandBuffer cmd, uint32_t imageIndex)
     {
         VkRenderPassBeginInfo info{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
@@ -70,66 +155,14 @@ namespace vks
         info.clearValueCount = clears.size();
         info.pClearValues = clears.data();
 
-        vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_INLINE);
-
-        VkViewport viewport{};
-        viewport.width = (float)m_renderTarget->extent().width;
-        viewport.height = (float)m_renderTarget->extent().height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        // Draws were recorded into secondary buffers by prepare()
+        vkCmdBeginRenderPass(cmd, &info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-        VkRect2D scissor{{0, 0}, m_renderTarget->extent()};
-        vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-        auto& ce = EngineContext::get();
-        auto view = ce.scene().view<Renderable, Transform>();
-
-        VkPipeline pipeline = pipelines().getPipeline("ObjectPicker");
-        VkPipelineLayout layout = pipelines().getLayout("ObjectPicker");
-
-        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-        // Bind camera descriptor set
-        VkDescriptorSet cameraSet = ce.cameraDescriptorSet();
-        if (cameraSet != VK_NULL_HANDLE && view.size_hint() != 0)
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &cameraSet, 0, nullptr);
-
-        for (auto entity : view)
-        {
-            // Skip the selected entity to avoid it being overwritten by the ID of other entities behind it
-            // This behaviour selects the object behind the current one when clicking on the currently selected object
-            if (entity == static_cast<Entity>(selectedEntityID))
-                continue;
-
-            auto& renderable = view.get<Renderable>(entity);
-            auto& transform = view.get<Transform>(entity);
-
-            if (!renderable.model) continue;
-
-            struct PushData
-            {
-                glm::mat4 model;
-                uint32_t id;
-            } pushData;
-            pushData.model = transform.transform;
-            pushData.id = (uint32_t)entity + 1;
-
-            vkCmdPushConstants(
-                cmd,
-                layout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(PushData),
-                &pushData
-            );
-
-            renderable.model->bind(cmd);
-        }
+        if (m_drawRecording)
+            m_drawRecording->execute(cmd);
+        m_drawRecording.reset();
 
         vkCmdEndRenderPass(cmd);
-
-        capturePixelID(cmd, m_renderTarget->colorImage(imageIndex), ce.editor().viewportMousePos);
     }
 
     void UIPass::recreate()
@@ -146,8 +179,9 @@ namespace vks
         color.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         color.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        color.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        color.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; // IMPORTANT
+        // Layout transitions around the pass are done by the render graph
+        color.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        color.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference colorRef{};
         colorRef.attachment = 0;
@@ -198,27 +232,4 @@ namespace vks
             );
         }
     }
-
-    void UIPass::capturePixelID(VkCommandBuffer cmd, VkImage srcImage, glm::vec2 mousePos)
-    {
-        // Clamp mouse
-        uint32_t width = m_renderTarget->extent().width;
-        uint32_t height = m_renderTarget->extent().height;
-        int32_t x = std::clamp((int32_t)mousePos.x, 0, (int32_t)width - 1);
-        int32_t y = std::clamp((int32_t)mousePos.y, 0, (int32_t)height - 1);
-
-        // Define the Region (x, y, width, height)
-        VkRect2D pickRegion{};
-        pickRegion.offset = {x, y};
-        pickRegion.extent = {1, 1};
-
-        // Call the Region Function
-        m_device.copyImageRegionToBuffer(
-            cmd,
-            srcImage,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            m_pixelBuffer->getBuffer(),
-            pickRegion
-        );
-    }
 }
@@ -0,0 +1,35 @@
+#include <stdexcept>
+#include <render/pipelines/ComputePipelineBuilder.hpp>
+
+namespace vks
+{
+    VkPipeline ComputePipelineBuilder::build(VkPipelineLayout layout, VkPipelineCache cache)
+    {
+        VkPipelineShaderStageCreateInfo stage{};
+        stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        stage.module = createShaderModuleFromFile(m_device, m_desc.computeShader);
+        stage.pName = m_desc.entryPoint.c_str();
+
+        VkComputePipelineCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        info.stage = stage;
+        info.layout = layout;
+
+        VkPipeline pipeline;
+        VkResult result = vkCreateComputePipelines(
+            m_device.logical(),
+            cache,
+            1,
+            &info,
+            nullptr,
+            &pipeline);
+
+        vkDestroyShaderModule(m_device.logical(), stage.module, nullptr);
+
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("Failed to create compute pipeline: " + m_desc.computeShader);
+
+        return pipeline;
+    }
+}
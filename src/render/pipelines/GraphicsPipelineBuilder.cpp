@@ -1,5 +1,4 @@
 #include <array>
-#include <fstream>
 #include <stdexcept>
 #include <render/pipelines/GraphicsPipelineBuilder.hpp>
 
@@ -14,28 +13,37 @@ namespace vks
 
         stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-        stages[0].module = createShaderModuleFromFile(m_desc.vertexShader);
+        stages[0].module = createShaderModuleFromFile(m_device, m_desc.vertexShader);
         stages[0].pName = "main";
 
+        // Vertex shaders that read packed vertices decode them when constant 0 is set
+        const VkBool32 packedVertices = m_desc.vertexFormat == geometry::VertexFormat::Packed ? VK_TRUE : VK_FALSE;
+        const VkSpecializationMapEntry specializationEntry{0, 0, sizeof(VkBool32)};
+        VkSpecializationInfo specialization{};
+        specialization.mapEntryCount = 1;
+        specialization.pMapEntries = &specializationEntry;
+        specialization.dataSize = sizeof(VkBool32);
+        specialization.pData = &packedVertices;
+        stages[0].pSpecializationInfo = &specialization;
+
         stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        stages[1].module = createShaderModuleFromFile(m_desc.fragmentShader);
+        stages[1].module = createShaderModuleFromFile(m_device, m_desc.fragmentShader);
         stages[1].pName = "main";
 
         // ==============================
         // Vertex input
         // ==============================
-        auto bindingDescription = geometry::Vertex::getBindingDescription();
-        auto attributeDescriptions = geometry::Vertex::getAttributeDescriptions();
+        const auto vertexDescription = geometry::vertexInputDescription(m_desc.vertexFormat);
 
         VkPipelineVertexInputStateCreateInfo vertexInput{};
         vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
         if (m_desc.isVertexInput)
         {
             vertexInput.vertexBindingDescriptionCount = 1;
-            vertexInput.pVertexBindingDescriptions = &bindingDescription;
-            vertexInput.vertexAttributeDescriptionCount = attributeDescriptions.size();
-            vertexInput.pVertexAttributeDescriptions = attributeDescriptions.data();
+            vertexInput.pVertexBindingDescriptions = &vertexDescription.binding;
+            vertexInput.vertexAttributeDescriptionCount = vertexDescription.attributes.size();
+            vertexInput.pVertexAttributeDescriptions = vertexDescription.attributes.data();
         } else
         {
             vertexInput.vertexBindingDescriptionCount = 0;
@@ -167,38 +175,4 @@ namespace vks
 
         return pipeline;
     }
-
-    VkShaderModule GraphicsPipelineBuilder::createShaderModuleFromFile(const std::string& path) const
-    {
-        auto code = loadSpirv(path);
-
-        VkShaderModuleCreateInfo info{};
-        info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        info.codeSize = code.size() * sizeof(uint32_t);
-        info.pCode = code.data();
-
-        VkShaderModule module;
-        if (vkCreateShaderModule(m_device.logical(), &info, nullptr, &module) != VK_SUCCESS)
-        {
-            throw std::runtime_error("failed to create shader module from file: " + path);
-        }
-
-        return module;
-    }
-
-    std::vector<uint32_t> GraphicsPipelineBuilder::loadSpirv(const std::string& path)
-    {
-        std::ifstream file(path, std::ios::ate | std::ios::binary);
-        if (!file.is_open())
-            throw std::runtime_error("Failed to open SPIR-V file: " + path);
-
-        size_t size = file.tellg();
-        std::vector<uint32_t> buffer(size / sizeof(uint32_t));
-
-        file.seekg(0);
-        file.read(reinterpret_cast<char*>(buffer.data()), size);
-        file.close();
-
-        return buffer;
-    }
 }
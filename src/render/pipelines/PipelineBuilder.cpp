@@ -0,0 +1,41 @@
+#include <fstream>
+#include <stdexcept>
+#include <render/pipelines/PipelineBuilder.hpp>
+#include <gfx/Device.hpp>
+
+namespace vks
+{
+    VkShaderModule IPipelineBuilder::createShaderModuleFromFile(const Device& device, const std::string& path)
+    {
+        auto code = loadSpirv(path);
+
+        VkShaderModuleCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        info.codeSize = code.size() * sizeof(uint32_t);
+        info.pCode = code.data();
+
+        VkShaderModule module;
+        if (vkCreateShaderModule(device.logical(), &info, nullptr, &module) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create shader module from file: " + path);
+        }
+
+        return module;
+    }
+
+    std::vector<uint32_t> IPipelineBuilder::loadSpirv(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open SPIR-V file: " + path);
+
+        size_t size = file.tellg();
+        std::vector<uint32_t> buffer(size / sizeof(uint32_t));
+
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(buffer.data()), size);
+        file.close();
+
+        return buffer;
+    }
+}
@@ -1,10 +1,14 @@
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
+#include <utility>
 #include <../include/render/PipelineManager.hpp>
 
 #include "../../../include/gfx/Device.hpp"
 #include "../../../include/render/pipelines/GraphicsPipelineBuilder.hpp"
+#include "../../../include/render/pipelines/ComputePipelineBuilder.hpp"
 
 namespace vks
 {
@@ -16,73 +20,120 @@ namespace vks
         vkCreatePipelineCache(m_device.logical(), &cacheInfo, nullptr, &m_cache);
     }
 
-    void PipelineManager::createOrReplace(
+    namespace
+    {
+        struct NameTable
+        {
+            std::mutex mutex;
+            std::unordered_map<std::string, uint32_t> ids;
+            std::vector<std::string> names;
+        };
+
+        NameTable& nameTable()
+        {
+            static NameTable table;
+            return table;
+        }
+    }
+
+    PipelineHandle PipelineHandle::fromName(const std::string& name)
+    {
+        NameTable& table = nameTable();
+        std::lock_guard lock(table.mutex);
+
+        auto [it, inserted] = table.ids.try_emplace(name, static_cast<uint32_t>(table.names.size()));
+        if (inserted)
+            table.names.push_back(name);
+        return {it->second};
+    }
+
+    std::string PipelineHandle::name() const
+    {
+        NameTable& table = nameTable();
+        std::lock_guard lock(table.mutex);
+        return id < table.names.size() ? table.names[id] : std::string("<invalid>");
+    }
+
+    PipelineHandle PipelineManager::createOrReplace(
         const std::string& name,
         const PipelineDesc& desc
     )
     {
-        if (m_pipelines.find(name) != m_pipelines.end())
-            destroy(name);
+        const PipelineHandle handle = PipelineHandle::fromName(name);
+        if (m_pipelines.size() <= handle.id)
+            m_pipelines.resize(handle.id + 1);
 
-        Entry entry{};
-        entry.desc = desc;
+        Entry& entry = m_pipelines[handle.id];
+        if (entry.live)
+            retire(entry);
 
+        entry.desc = desc;
+        entry.live = true;
         buildPipeline(entry);
-        m_pipelines[name] = entry;
+        return handle;
     }
 
     void PipelineManager::destroy(const std::string& name)
     {
-        auto it = m_pipelines.find(name);
-        if (it == m_pipelines.end())
-            throw std::runtime_error("Pipeline not found: " + name);
-
-        vkDestroyPipeline(m_device.logical(), it->second.pipeline, nullptr);
-        vkDestroyPipelineLayout(m_device.logical(), it->second.layout, nullptr);
-        m_pipelines.erase(it);
+        Entry& entry = this->entry(PipelineHandle::fromName(name));
+        retire(entry);
+        entry = {};
     }
 
     void PipelineManager::recreate(const std::string& name)
     {
-        auto it = m_pipelines.find(name);
-        if (it == m_pipelines.end())
-            throw std::runtime_error("Pipeline not found: " + name);
-
-        destroy(name);
-        buildPipeline(it->second);
+        Entry& entry = this->entry(PipelineHandle::fromName(name));
+        retire(entry);
+        buildPipeline(entry);
     }
 
     void PipelineManager::recreateAll()
     {
-        // store the current pipelines
-        std::vector<std::pair<std::string, Entry>> oldPipelines(m_pipelines.begin(), m_pipelines.end());
-        for (auto& pair : oldPipelines)
-            destroy(pair.first);
-
-        // Rebuild all pipelines
-        for (auto& pair : oldPipelines)
+        for (auto& entry : m_pipelines)
         {
-            buildPipeline(pair.second);
-            m_pipelines[pair.first] = pair.second;
+            if (!entry.live)
+                continue;
+
+            retire(entry);
+            buildPipeline(entry);
         }
     }
 
-    VkPipeline PipelineManager::getPipeline(const std::string& name) const
+    bool PipelineManager::contains(PipelineHandle handle) const
     {
-        auto it = m_pipelines.find(name);
-        if (it == m_pipelines.end())
-            throw std::runtime_error("Pipeline not found: " + name);
+        return handle.id < m_pipelines.size() && m_pipelines[handle.id].live;
+    }
 
-        return it->second.pipeline;
+    const PipelineManager::Entry& PipelineManager::entry(PipelineHandle handle) const
+    {
+        if (!contains(handle))
+            throw std::runtime_error("Pipeline not found: " + handle.name());
+
+        return m_pipelines[handle.id];
     }
 
-    VkPipelineLayout PipelineManager::getLayout(const std::string& name) const
+    PipelineManager::Entry& PipelineManager::entry(PipelineHandle handle)
     {
-        auto it = m_pipelines.find(name);
-        if (it == m_pipelines.end())
-            throw std::runtime_error("Pipeline not found: " + name);
+        return const_cast<Entry&>(std::as_const(*this).entry(handle));
+    }
 
-        return it->second.layout;
+    bool PipelineManager::isBlended(PipelineHandle handle) const
+    {
+        const auto* graphics = std::get_if<GraphicsPipelineDesc>(&entry(handle).desc.payload);
+        return graphics && graphics->alphaBlending;
+    }
+
+    void PipelineManager::retire(Entry& entry)
+    {
+        // In-flight frames may still have the pipeline bound
+        m_device.deletionQueue().push([device = m_device.logical(), pipeline = entry.pipeline,
+                                         layout = entry.layout]
+        {
+            vkDestroyPipeline(device, pipeline, nullptr);
+            vkDestroyPipelineLayout(device, layout, nullptr);
+        });
+        entry.pipeline = VK_NULL_HANDLE;
+        entry.layout = VK_NULL_HANDLE;
     }
 
     void PipelineManager::buildPipeline(Entry& entry)
@@ -118,7 +169,14 @@ namespace vks
         }
         else if (entry.desc.type == PipelineType::Compute)
         {
-            // Not Implemented but can be added later
+            auto& c = std::get<ComputePipelineDesc>(entry.desc.payload);
+
+            builder = std::make_unique<ComputePipelineBuilder>(
+                m_device,
+                c
+            );
+
+            entry.pipeline = builder->build(entry.layout, m_cache);
         }
     }
 }
@@ -0,0 +1,104 @@
+#include <scene/Bounds.hpp>
+
+#include <algorithm>
+
+namespace vks
+{
+    AABB AABB::transformed(const glm::mat4& transform) const
+    {
+        // The new half extent is the absolute linear part applied to the old one
+        const glm::vec3 c = glm::vec3(transform * glm::vec4(center(), 1.0f));
+        const glm::mat3 linear(transform);
+        const glm::vec3 e = halfExtent();
+
+        glm::vec3 extent{0.0f};
+        for (int axis = 0; axis < 3; ++axis)
+            extent += glm::abs(linear[axis]) * e[axis];
+
+        return {c - extent, c + extent};
+    }
+
+    BoundingSphere BoundingSphere::transformed(const glm::mat4& transform) const
+    {
+        const float scale = std::max({
+            glm::length(glm::vec3(transform[0])),
+            glm::length(glm::vec3(transform[1])),
+            glm::length(glm::vec3(transform[2]))
+        });
+
+        return {glm::vec3(transform * glm::vec4(center, 1.0f)), radius * scale};
+    }
+
+    bool BoundingSphere::intersects(const AABB& box) const
+    {
+        const glm::vec3 closest = glm::clamp(center, box.min, box.max);
+        const glm::vec3 d = closest - center;
+        return glm::dot(d, d) <= radius * radius;
+    }
+
+    bool Ray::intersects(const AABB& box, float& distance) const
+    {
+        // Division by a zero component gives +-inf, which the min/max below handle;
+        // only a ray starting exactly on an axis-aligned face would make NaNs
+        const glm::vec3 inverse = 1.0f / direction;
+        const glm::vec3 t0 = (box.min - origin) * inverse;
+        const glm::vec3 t1 = (box.max - origin) * inverse;
+
+        const glm::vec3 tNear = glm::min(t0, t1);
+        const glm::vec3 tFar = glm::max(t0, t1);
+
+        const float enter = std::max({tNear.x, tNear.y, tNear.z, 0.0f});
+        const float exit = std::min({tFar.x, tFar.y, tFar.z, maxDistance});
+        if (enter > exit)
+            return false;
+
+        distance = enter;
+        return true;
+    }
+
+    Frustum Frustum::fromMatrix(const glm::mat4& m)
+    {
+        // Gribb/Hartmann: each plane is a sum or difference of matrix rows.
+        // glm is column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+        auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+
+        Frustum frustum{};
+        frustum.planes[Left] = row(3) + row(0);
+        frustum.planes[Right] = row(3) - row(0);
+        frustum.planes[Bottom] = row(3) + row(1);
+        frustum.planes[Top] = row(3) - row(1);
+        // w + z also holds for the [0, 1] depth range, just a little in front of the near plane
+        frustum.planes[Near] = row(3) + row(2);
+        frustum.planes[Far] = row(3) - row(2);
+
+        for (auto& plane : frustum.planes)
+            plane /= glm::length(glm::vec3(plane));
+
+        return frustum;
+    }
+
+    bool Frustum::intersects(const BoundingSphere& sphere) const
+    {
+        for (const auto& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+
+    bool Frustum::intersects(const AABB& box) const
+    {
+        const glm::vec3 c = box.center();
+        const glm::vec3 e = box.halfExtent();
+
+        for (const auto& plane : planes)
+        {
+            // Projected radius of the box onto the plane normal
+            const float r = glm::dot(e, glm::abs(glm::vec3(plane)));
+            if (glm::dot(glm::vec3(plane), c) + plane.w < -r)
+                return false;
+        }
+        return true;
+    }
+} // namespace vks
@@ -0,0 +1,293 @@
+#include <scene/DynamicAABBTree.hpp>
+
+#include <cmath>
+#include <cstdlib>
+
+namespace vks
+{
+    DynamicAABBTree::DynamicAABBTree(float margin)
+        : m_margin(margin)
+    {
+    }
+
+    uint32_t DynamicAABBTree::allocateNode()
+    {
+        if (m_freeList == NULL_NODE)
+        {
+            m_nodes.emplace_back();
+            return static_cast<uint32_t>(m_nodes.size() - 1);
+        }
+
+        const uint32_t node = m_freeList;
+        m_freeList = m_nodes[node].parent;
+        m_nodes[node] = Node{};
+        return node;
+    }
+
+    void DynamicAABBTree::freeNode(uint32_t node)
+    {
+        m_nodes[node] = Node{};
+        m_nodes[node].parent = m_freeList;
+        m_freeList = node;
+    }
+
+    uint32_t DynamicAABBTree::createProxy(const AABB& box, uint32_t userData)
+    {
+        const uint32_t proxy = allocateNode();
+
+        Node& node = m_nodes[proxy];
+        node.box = {box.min - m_margin, box.max + m_margin};
+        node.userData = userData;
+        node.height = 0;
+
+        insertLeaf(proxy);
+        m_proxyCount++;
+        return proxy;
+    }
+
+    void DynamicAABBTree::destroyProxy(uint32_t proxy)
+    {
+        removeLeaf(proxy);
+        freeNode(proxy);
+        m_proxyCount--;
+    }
+
+    bool DynamicAABBTree::moveProxy(uint32_t proxy, const AABB& box)
+    {
+        if (m_nodes[proxy].box.contains(box))
+            return false;
+
+        removeLeaf(proxy);
+        m_nodes[proxy].box = {box.min - m_margin, box.max + m_margin};
+        insertLeaf(proxy);
+        return true;
+    }
+
+    void DynamicAABBTree::clear()
+    {
+        m_nodes.clear();
+        m_root = NULL_NODE;
+        m_freeList = NULL_NODE;
+        m_proxyCount = 0;
+    }
+
+    void DynamicAABBTree::insertLeaf(uint32_t leaf)
+    {
+        if (m_root == NULL_NODE)
+        {
+            m_root = leaf;
+            m_nodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        // Descend towards the cheapest sibling. Pairing the leaf with a node costs
+        // the area of their union; every ancestor on the way grows as well.
+        const AABB leafBox = m_nodes[leaf].box;
+        uint32_t index = m_root;
+        while (!m_nodes[index].isLeaf())
+        {
+            const Node& node = m_nodes[index];
+            const float area = node.box.surfaceArea();
+            const float combinedArea = AABB::merge(node.box, leafBox).surfaceArea();
+
+            // New parent for this node and the leaf
+            const float cost = 2.0f * combinedArea;
+            // Growth pushed onto the ancestors when descending further
+            const float inheritedCost = 2.0f * (combinedArea - area);
+
+            auto descendCost = [&](uint32_t child)
+            {
+                const AABB& box = m_nodes[child].box;
+                const float merged = AABB::merge(box, leafBox).surfaceArea();
+                return m_nodes[child].isLeaf() ? merged + inheritedCost
+                                               : merged - box.surfaceArea() + inheritedCost;
+            };
+
+            const float cost1 = descendCost(node.child1);
+            const float cost2 = descendCost(node.child2);
+
+            if (cost < cost1 && cost < cost2)
+                break;
+
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        const uint32_t sibling = index;
+        const uint32_t oldParent = m_nodes[sibling].parent;
+        const uint32_t newParent = allocateNode();
+
+        Node& parent = m_nodes[newParent];
+        parent.parent = oldParent;
+        parent.box = AABB::merge(leafBox, m_nodes[sibling].box);
+        parent.height = m_nodes[sibling].height + 1;
+        parent.child1 = sibling;
+        parent.child2 = leaf;
+
+        if (oldParent != NULL_NODE)
+        {
+            if (m_nodes[oldParent].child1 == sibling)
+                m_nodes[oldParent].child1 = newParent;
+            else
+                m_nodes[oldParent].child2 = newParent;
+        }
+        else
+        {
+            m_root = newParent;
+        }
+
+        m_nodes[sibling].parent = newParent;
+        m_nodes[leaf].parent = newParent;
+
+        refit(m_nodes[leaf].parent);
+    }
+
+    void DynamicAABBTree::removeLeaf(uint32_t leaf)
+    {
+        if (leaf == m_root)
+        {
+            m_root = NULL_NODE;
+            return;
+        }
+
+        // The sibling takes the parent's place
+        const uint32_t parent = m_nodes[leaf].parent;
+        const uint32_t grandParent = m_nodes[parent].parent;
+        const uint32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+        m_nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        if (grandParent == NULL_NODE)
+        {
+            m_root = sibling;
+            return;
+        }
+
+        if (m_nodes[grandParent].child1 == parent)
+            m_nodes[grandParent].child1 = sibling;
+        else
+            m_nodes[grandParent].child2 = sibling;
+
+        refit(grandParent);
+    }
+
+    void DynamicAABBTree::refit(uint32_t index)
+    {
+        while (index != NULL_NODE)
+        {
+            index = balance(index);
+
+            Node& node = m_nodes[index];
+            const Node& child1 = m_nodes[node.child1];
+            const Node& child2 = m_nodes[node.child2];
+            node.height = 1 + std::max(child1.height, child2.height);
+            node.box = AABB::merge(child1.box, child2.box);
+
+            index = node.parent;
+        }
+    }
+
+    uint32_t DynamicAABBTree::balance(uint32_t iA)
+    {
+        // When one child of A is more than one level taller than the other, that
+        // child takes A's place: A becomes its first child and receives the
+        // shorter of its two children. Returns the node now in A's place.
+        Node& A = m_nodes[iA];
+        if (A.isLeaf() || A.height < 2)
+            return iA;
+
+        const uint32_t iB = A.child1;
+        const uint32_t iC = A.child2;
+        const int32_t heightDifference = m_nodes[iC].height - m_nodes[iB].height;
+
+        // Lifts 'iUp', the taller child of A, above A. 'iOther' is A's other child.
+        auto rotate = [&](uint32_t iUp, uint32_t iOther)
+        {
+            Node& up = m_nodes[iUp];
+            const uint32_t iF = up.child1;
+            const uint32_t iG = up.child2;
+
+            up.child1 = iA;
+            up.parent = A.parent;
+            A.parent = iUp;
+
+            if (up.parent != NULL_NODE)
+            {
+                Node& parent = m_nodes[up.parent];
+                if (parent.child1 == iA)
+                    parent.child1 = iUp;
+                else
+                    parent.child2 = iUp;
+            }
+            else
+            {
+                m_root = iUp;
+            }
+
+            // The taller grandchild stays with 'up', the other one moves under A
+            const bool fTaller = m_nodes[iF].height > m_nodes[iG].height;
+            const uint32_t iKeep = fTaller ? iF : iG;
+            const uint32_t iMove = fTaller ? iG : iF;
+
+            up.child2 = iKeep;
+            if (A.child1 == iUp)
+                A.child1 = iMove;
+            else
+                A.child2 = iMove;
+            m_nodes[iMove].parent = iA;
+
+            A.box = AABB::merge(m_nodes[iOther].box, m_nodes[iMove].box);
+            A.height = 1 + std::max(m_nodes[iOther].height, m_nodes[iMove].height);
+            up.box = AABB::merge(A.box, m_nodes[iKeep].box);
+            up.height = 1 + std::max(A.height, m_nodes[iKeep].height);
+            return iUp;
+        };
+
+        if (heightDifference > 1)
+            return rotate(iC, iB);
+        if (heightDifference < -1)
+            return rotate(iB, iC);
+        return iA;
+    }
+
+    bool DynamicAABBTree::validate() const
+    {
+        if (m_root == NULL_NODE)
+            return m_proxyCount == 0;
+        if (m_nodes[m_root].parent != NULL_NODE)
+            return false;
+
+        uint32_t leaves = 0;
+        std::vector<uint32_t> stack{m_root};
+        while (!stack.empty())
+        {
+            const uint32_t index = stack.back();
+            stack.pop_back();
+            const Node& node = m_nodes[index];
+
+            if (node.isLeaf())
+            {
+                if (node.height != 0 || node.child2 != NULL_NODE)
+                    return false;
+                leaves++;
+                continue;
+            }
+
+            const Node& child1 = m_nodes[node.child1];
+            const Node& child2 = m_nodes[node.child2];
+            if (child1.parent != index || child2.parent != index)
+                return false;
+            if (node.height != 1 + std::max(child1.height, child2.height))
+                return false;
+            if (std::abs(child1.height - child2.height) > 1)
+                return false;
+            if (!node.box.contains(child1.box) || !node.box.contains(child2.box))
+                return false;
+
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+
+        return leaves == m_proxyCount;
+    }
+} // namespace vks
@@ -1,6 +1,10 @@
+#include <algorithm>
 #include <array>
 #include <../include/scene/Geometry.hpp>
 #include <cmath>
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -10,38 +14,148 @@ namespace vks
 {
     namespace geometry
     {
-        VkVertexInputBindingDescription Vertex::getBindingDescription()
+        VertexInputDescription vertexInputDescription(VertexFormat format)
         {
-            VkVertexInputBindingDescription bindingDescription{};
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-            return bindingDescription;
+            VertexInputDescription description{};
+            description.binding.binding = 0;
+            description.binding.stride = vertexStride(format);
+            description.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            for (uint32_t location = 0; location < description.attributes.size(); ++location)
+            {
+                description.attributes[location].binding = 0;
+                description.attributes[location].location = location;
+            }
+
+            if (format == VertexFormat::Packed)
+            {
+                // Position, octahedral normal, UV; the shader sees them as floats
+                description.attributes[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+                description.attributes[0].offset = offsetof(PackedVertex, pos);
+                description.attributes[1].format = VK_FORMAT_R16G16_SNORM;
+                description.attributes[1].offset = offsetof(PackedVertex, normal);
+                description.attributes[2].format = VK_FORMAT_R16G16_UNORM;
+                description.attributes[2].offset = offsetof(PackedVertex, uv);
+            }
+            else
+            {
+                description.attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+                description.attributes[0].offset = offsetof(Vertex, pos);
+                description.attributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+                description.attributes[1].offset = offsetof(Vertex, normal);
+                description.attributes[2].format = VK_FORMAT_R32G32_SFLOAT;
+                description.attributes[2].offset = offsetof(Vertex, uv);
+            }
+
+            return description;
+        }
+
+        uint32_t vertexStride(VertexFormat format)
+        {
+            return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+        }
+
+        namespace
+        {
+            constexpr float SNORM16_MAX = 32767.0f;
+            constexpr float UNORM16_MAX = 65535.0f;
+
+            int16_t toSnorm16(float value)
+            {
+                return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * SNORM16_MAX));
+            }
+
+            float fromSnorm16(int16_t value)
+            {
+                return std::max(static_cast<float>(value) / SNORM16_MAX, -1.0f);
+            }
+
+            float signNotZero(float value)
+            {
+                return value >= 0.0f ? 1.0f : -1.0f;
+            }
+
+            // Projects the unit sphere onto an octahedron and unfolds its lower half
+            // over the corners of the upper one, so two components cover all directions
+            void octEncode(const float normal[3], int16_t encoded[2])
+            {
+                const float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+                if (length == 0.0f)
+                {
+                    encoded[0] = encoded[1] = 0;
+                    return;
+                }
+
+                float x = normal[0] / length;
+                float y = normal[1] / length;
+                if (normal[2] < 0.0f)
+                {
+                    const float folded = (1.0f - std::abs(y)) * signNotZero(x);
+                    y = (1.0f - std::abs(x)) * signNotZero(y);
+                    x = folded;
+                }
+                encoded[0] = toSnorm16(x);
+                encoded[1] = toSnorm16(y);
+            }
+
+            // Matches octDecode() in the vertex shaders
+            glm::vec3 octDecode(const int16_t encoded[2])
+            {
+                glm::vec3 n(fromSnorm16(encoded[0]), fromSnorm16(encoded[1]), 0.0f);
+                n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+                const float t = std::max(-n.z, 0.0f);
+                n.x += n.x >= 0.0f ? -t : t;
+                n.y += n.y >= 0.0f ? -t : t;
+                return glm::normalize(n);
+            }
+        } // namespace
+
+        glm::mat4 packVertices(const std::vector<Vertex>& vertices, std::vector<PackedVertex>& packed)
+        {
+            packed.resize(vertices.size());
+
+            glm::vec3 min(std::numeric_limits<float>::max());
+            glm::vec3 max(std::numeric_limits<float>::lowest());
+            for (const Vertex& v : vertices)
+            {
+                const glm::vec3 p(v.pos[0], v.pos[1], v.pos[2]);
+                min = glm::min(min, p);
+                max = glm::max(max, p);
+            }
+
+            // One scale for all axes, so dequantizing doesn't change the normals
+            const glm::vec3 center = vertices.empty() ? glm::vec3(0.0f) : (min + max) * 0.5f;
+            const glm::vec3 halfExtent = vertices.empty() ? glm::vec3(0.0f) : (max - min) * 0.5f;
+            float scale = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+            if (scale <= 0.0f)
+                scale = 1.0f;
+
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                const Vertex& v = vertices[i];
+                PackedVertex& p = packed[i];
+                for (int c = 0; c < 3; ++c)
+                    p.pos[c] = toSnorm16((v.pos[c] - center[c]) / scale);
+                p.pos[3] = 0;
+                octEncode(v.normal, p.normal);
+                for (int c = 0; c < 2; ++c)
+                    p.uv[c] = static_cast<uint16_t>(std::lround(std::clamp(v.uv[c], 0.0f, 1.0f) * UNORM16_MAX));
+            }
+
+            glm::mat4 dequantization(scale);
+            dequantization[3] = glm::vec4(center, 1.0f);
+            return dequantization;
         }
 
-        std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescriptions()
+        Vertex unpackVertex(const PackedVertex& vertex, const glm::mat4& dequantization)
         {
-            std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-            // Position
-            attributeDescriptions[0].binding = 0;
-            attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-            // Normal
-            attributeDescriptions[1].binding = 0;
-            attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, normal);
-
-            // UV/TexCoord
-            attributeDescriptions[2].binding = 0;
-            attributeDescriptions[2].location = 2;
-            attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[2].offset = offsetof(Vertex, uv);
-
-            return attributeDescriptions;
+            const glm::vec4 position = dequantization * glm::vec4(fromSnorm16(vertex.pos[0]), fromSnorm16(vertex.pos[1]),
+                                                                  fromSnorm16(vertex.pos[2]), 1.0f);
+            const glm::vec3 normal = octDecode(vertex.normal);
+
+            return {{position.x, position.y, position.z},
+                    {normal.x, normal.y, normal.z},
+                    {vertex.uv[0] / UNORM16_MAX, vertex.uv[1] / UNORM16_MAX}};
         }
 
 
@@ -122,5 +236,132 @@ namespace vks
                 2, 3, 0
             };
         }
+
+        namespace
+        {
+            // Cells along the longest axis of the finest grid; a cell's key packs into 30 bits
+            constexpr uint32_t MAX_RESOLUTION = 1024;
+
+            struct Grid
+            {
+                glm::vec3 origin;
+                float cellSize;
+                uint32_t resolution;
+
+                uint32_t cell(const Vertex& v) const
+                {
+                    auto axis = [&](int i)
+                    {
+                        return std::min(static_cast<uint32_t>((v.pos[i] - origin[i]) / cellSize), resolution - 1);
+                    };
+                    return axis(0) | axis(1) << 10 | axis(2) << 20;
+                }
+            };
+
+            // Dense cluster ID of every vertex's cell; returns the number of clusters
+            uint32_t clusterVertices(const std::vector<Vertex>& vertices, const Grid& grid,
+                                     std::vector<uint32_t>& clusters)
+            {
+                std::unordered_map<uint32_t, uint32_t> ids;
+                clusters.resize(vertices.size());
+                for (size_t i = 0; i < vertices.size(); ++i)
+                    clusters[i] = ids.try_emplace(grid.cell(vertices[i]), static_cast<uint32_t>(ids.size())).first->second;
+                return static_cast<uint32_t>(ids.size());
+            }
+
+            // Triangles over clusters that keep three distinct corners, each once.
+            // Rotated to start at the smallest ID, so the winding is kept.
+            void collapse(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+                          std::vector<std::array<uint32_t, 3>>& triangles)
+            {
+                triangles.clear();
+                for (size_t i = 0; i + 2 < indices.size(); i += 3)
+                {
+                    std::array<uint32_t, 3> t{clusters[indices[i]], clusters[indices[i + 1]], clusters[indices[i + 2]]};
+                    if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0])
+                        continue;
+
+                    std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+                    triangles.push_back(t);
+                }
+
+                std::sort(triangles.begin(), triangles.end());
+                triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+            }
+        } // namespace
+
+        void simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                      size_t targetIndexCount, std::vector<uint32_t>& result)
+        {
+            result.clear();
+            if (indices.size() <= targetIndexCount)
+            {
+                result = indices;
+                return;
+            }
+
+            glm::vec3 min(std::numeric_limits<float>::max());
+            glm::vec3 max(std::numeric_limits<float>::lowest());
+            for (const auto& v : vertices)
+            {
+                min = glm::min(min, glm::vec3(v.pos[0], v.pos[1], v.pos[2]));
+                max = glm::max(max, glm::vec3(v.pos[0], v.pos[1], v.pos[2]));
+            }
+
+            const glm::vec3 size = max - min;
+            const float extent = std::max({size.x, size.y, size.z});
+            if (extent <= 0.0f)
+                return;
+
+            auto gridFor = [&](uint32_t resolution) { return Grid{min, extent / resolution, resolution}; };
+
+            // Finest grid within the budget. The triangle count grows with the
+            // resolution, if not strictly, which is good enough for a bisection.
+            std::vector<uint32_t> clusters;
+            std::vector<std::array<uint32_t, 3>> triangles;
+            uint32_t low = 1;
+            uint32_t high = MAX_RESOLUTION;
+            while (low < high)
+            {
+                const uint32_t resolution = (low + high + 1) / 2;
+                clusterVertices(vertices, gridFor(resolution), clusters);
+                collapse(indices, clusters, triangles);
+                if (triangles.size() * 3 <= targetIndexCount)
+                    low = resolution;
+                else
+                    high = resolution - 1;
+            }
+
+            const uint32_t clusterCount = clusterVertices(vertices, gridFor(low), clusters);
+            collapse(indices, clusters, triangles);
+            if (triangles.size() * 3 > targetIndexCount)
+                return;
+
+            // Each cluster is drawn with its vertex nearest to the cluster's mean position
+            std::vector<glm::vec4> sums(clusterCount, glm::vec4(0.0f));
+            for (size_t i = 0; i < vertices.size(); ++i)
+                sums[clusters[i]] += glm::vec4(vertices[i].pos[0], vertices[i].pos[1], vertices[i].pos[2], 1.0f);
+
+            std::vector<uint32_t> representatives(clusterCount, 0);
+            std::vector<float> distances(clusterCount, std::numeric_limits<float>::max());
+            for (size_t i = 0; i < vertices.size(); ++i)
+            {
+                const uint32_t c = clusters[i];
+                const glm::vec3 mean = glm::vec3(sums[c]) / sums[c].w;
+                const glm::vec3 d = glm::vec3(vertices[i].pos[0], vertices[i].pos[1], vertices[i].pos[2]) - mean;
+                if (glm::dot(d, d) < distances[c])
+                {
+                    distances[c] = glm::dot(d, d);
+                    representatives[c] = static_cast<uint32_t>(i);
+                }
+            }
+
+            result.reserve(triangles.size() * 3);
+            for (const auto& t : triangles)
+            {
+                for (uint32_t c : t)
+                    result.push_back(representatives[c]);
+            }
+        }
     } // namespace geometry
 } // namespace vks
@@ -0,0 +1,132 @@
+#include <scene/GeometryPool.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <core/Log.hpp>
+#include <gfx/Device.hpp>
+
+namespace vks
+{
+    void GeometryBinding::bind(VkCommandBuffer cmd, const GeometryBinding& geometry)
+    {
+        if (geometry.vertexBuffer != vertexBuffer)
+        {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(cmd, 0, 1, &geometry.vertexBuffer, &offset);
+            vertexBuffer = geometry.vertexBuffer;
+        }
+
+        if (geometry.indexBuffer != indexBuffer || geometry.indexType != indexType)
+        {
+            vkCmdBindIndexBuffer(cmd, geometry.indexBuffer, 0, geometry.indexType);
+            indexBuffer = geometry.indexBuffer;
+            indexType = geometry.indexType;
+        }
+    }
+
+    GeometryPool::Range::Range(std::shared_ptr<Page> page, uint32_t offset, uint32_t count)
+        : m_page(std::move(page)), m_offset(offset), m_count(count)
+    {
+    }
+
+    GeometryPool::Range::~Range()
+    {
+        reset();
+    }
+
+    GeometryPool::Range::Range(Range&& other) noexcept
+        : m_page(std::move(other.m_page)), m_offset(other.m_offset), m_count(other.m_count)
+    {
+    }
+
+    GeometryPool::Range& GeometryPool::Range::operator=(Range&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            m_page = std::move(other.m_page);
+            m_offset = other.m_offset;
+            m_count = other.m_count;
+        }
+        return *this;
+    }
+
+    void GeometryPool::Range::reset()
+    {
+        if (!m_page)
+            return;
+
+        // Draws recorded for frames in flight may still read the range
+        m_page->device.deletionQueue().push([page = std::move(m_page), offset = m_offset, count = m_count]
+        {
+            page->allocator.free(offset, count);
+        });
+    }
+
+    GeometryPool::GeometryPool(const Device& device)
+        : m_device(device)
+    {
+    }
+
+    GeometryPool::Range GeometryPool::allocateVertices(geometry::VertexFormat format, uint32_t count)
+    {
+        return allocate(m_vertexPages[static_cast<size_t>(format)], geometry::vertexStride(format),
+                        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, count);
+    }
+
+    GeometryPool::Range GeometryPool::allocateIndices(VkIndexType type, uint32_t count)
+    {
+        const bool narrow = type == VK_INDEX_TYPE_UINT16;
+        return allocate(m_indexPages[narrow ? 0 : 1], narrow ? sizeof(uint16_t) : sizeof(uint32_t),
+                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, count);
+    }
+
+    GeometryPool::Range GeometryPool::allocate(Pages& pages, VkDeviceSize elementSize, VkBufferUsageFlags usage,
+                                               uint32_t count)
+    {
+        if (count == 0)
+            return {};
+
+        for (const auto& page : pages)
+        {
+            if (auto offset = page->allocator.allocate(count))
+                return {page, *offset, count};
+        }
+
+        // Meshes larger than a page get a page of their own size
+        const auto capacity = static_cast<uint32_t>(std::max<VkDeviceSize>(PAGE_SIZE / elementSize, count));
+        auto page = std::shared_ptr<Page>(new Page{
+            m_device,
+            Buffer(m_device, capacity * elementSize, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+            FreeListAllocator(capacity)
+        });
+        pages.push_back(page);
+
+        if (pages.size() > 1)
+            LOG_INFO("Geometry pool grew to {} pages for {}-byte elements", pages.size(), elementSize);
+
+        return {page, *page->allocator.allocate(count), count};
+    }
+
+    VkDeviceSize GeometryPool::usedBytes() const
+    {
+        VkDeviceSize total = 0;
+        for (const auto* group : {&m_vertexPages, &m_indexPages})
+            for (const Pages& pages : *group)
+                for (const auto& page : pages)
+                    total += page->buffer.getSize() / page->allocator.capacity() * page->allocator.used();
+        return total;
+    }
+
+    VkDeviceSize GeometryPool::allocatedBytes() const
+    {
+        VkDeviceSize total = 0;
+        for (const auto* group : {&m_vertexPages, &m_indexPages})
+            for (const Pages& pages : *group)
+                for (const auto& page : pages)
+                    total += page->buffer.getSize();
+        return total;
+    }
+} // namespace vks
@@ -0,0 +1,333 @@
+#include <scene/MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+#include <glm/glm.hpp>
+
+namespace vks::geometry
+{
+    namespace
+    {
+        constexpr uint32_t NONE = UINT32_MAX;
+
+        // Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+        constexpr uint32_t SCORE_CACHE_SIZE = 32;
+        constexpr float CACHE_DECAY_POWER = 1.5f;
+        constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+        constexpr float VALENCE_BOOST_SCALE = 2.0f;
+        constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+        // Cache size of the FIFO the overdraw pass splits on, and how much worse
+        // than the cache order its runs may get
+        constexpr uint32_t FIFO_CACHE_SIZE = 16;
+        constexpr float ACMR_THRESHOLD = 1.05f;
+
+        float vertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+        {
+            if (remainingTriangles == 0)
+                return -1.0f;
+
+            float score = 0.0f;
+            if (cachePosition >= 0)
+            {
+                // The last triangle's vertices score the same whatever their order,
+                // so the next triangle doesn't favour one edge
+                if (cachePosition < 3)
+                    score = LAST_TRIANGLE_SCORE;
+                else
+                    score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (SCORE_CACHE_SIZE - 3),
+                                     CACHE_DECAY_POWER);
+            }
+
+            // Vertices with few triangles left are finished off first
+            return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+        }
+
+        glm::vec3 position(const Vertex& v)
+        {
+            return {v.pos[0], v.pos[1], v.pos[2]};
+        }
+    } // namespace
+
+    VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+    {
+        VertexCacheStats stats{};
+        if (indices.size() < 3)
+            return stats;
+
+        // A vertex is in the FIFO while fewer than cacheSize misses happened since its own
+        std::vector<uint32_t> loadedAt(vertexCount, 0);
+        std::vector<uint8_t> referenced(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        uint32_t misses = 0;
+        size_t unique = 0;
+
+        for (uint32_t index : indices)
+        {
+            if (time - loadedAt[index] > cacheSize)
+            {
+                loadedAt[index] = time++;
+                misses++;
+            }
+            if (!referenced[index])
+            {
+                referenced[index] = 1;
+                unique++;
+            }
+        }
+
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(unique);
+        return stats;
+    }
+
+    void optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+
+        // Triangles of every vertex; the first remaining[v] entries are the ones not yet emitted
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (uint32_t index : indices)
+            offsets[index + 1]++;
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+            adjacency[offsets[indices[i]] + remaining[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+        std::vector<int32_t> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+            vertexScores[v] = vertexScore(-1, remaining[v]);
+
+        auto triangleScore = [&](uint32_t t)
+        {
+            return vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        };
+
+        std::vector<float> triangleScores(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; ++t)
+            triangleScores[t] = triangleScore(t);
+
+        std::vector<uint8_t> emitted(triangleCount, 0);
+        std::vector<uint32_t> result;
+        result.reserve(triangleCount * 3);
+
+        // LRU order, most recent first; entries past SCORE_CACHE_SIZE are evicted
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        cache.reserve(SCORE_CACHE_SIZE + 3);
+        nextCache.reserve(SCORE_CACHE_SIZE + 3);
+
+        uint32_t best = static_cast<uint32_t>(
+            std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+        uint32_t scan = 0;
+
+        while (result.size() < triangleCount * 3)
+        {
+            // Nothing in the cache has triangles left: restart at the next unused one
+            if (best == NONE)
+            {
+                while (emitted[scan])
+                    scan++;
+                best = scan;
+            }
+
+            emitted[best] = 1;
+            const uint32_t* corners = &indices[best * 3];
+            result.insert(result.end(), corners, corners + 3);
+
+            for (int c = 0; c < 3; ++c)
+            {
+                const uint32_t v = corners[c];
+                uint32_t* triangles = &adjacency[offsets[v]];
+                uint32_t* last = triangles + --remaining[v];
+                std::iter_swap(std::find(triangles, last + 1, best), last);
+            }
+
+            nextCache.assign(corners, corners + 3);
+            for (uint32_t v : cache)
+            {
+                if (v != corners[0] && v != corners[1] && v != corners[2])
+                    nextCache.push_back(v);
+            }
+
+            for (size_t i = 0; i < nextCache.size(); ++i)
+                cachePosition[nextCache[i]] = i < SCORE_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+            // Rescore the vertices that moved or left and the triangles around them;
+            // the next triangle is the best one among those still touching the cache
+            best = NONE;
+            float bestScore = -1.0f;
+            for (uint32_t v : nextCache)
+                vertexScores[v] = vertexScore(cachePosition[v], remaining[v]);
+            for (uint32_t v : nextCache)
+            {
+                for (uint32_t i = 0; i < remaining[v]; ++i)
+                {
+                    const uint32_t t = adjacency[offsets[v] + i];
+                    triangleScores[t] = triangleScore(t);
+                    if (cachePosition[v] >= 0 && triangleScores[t] > bestScore)
+                    {
+                        bestScore = triangleScores[t];
+                        best = t;
+                    }
+                }
+            }
+
+            if (nextCache.size() > SCORE_CACHE_SIZE)
+                nextCache.resize(SCORE_CACHE_SIZE);
+            cache.swap(nextCache);
+        }
+
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void optimizeOverdraw(std::span<uint32_t> indices, const std::vector<Vertex>& vertices)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+
+        struct Run
+        {
+            uint32_t first;
+            uint32_t count;
+            float sortKey;
+        };
+
+        std::vector<uint32_t> loadedAt(vertices.size(), 0);
+        uint32_t time = FIFO_CACHE_SIZE + 1;
+        auto misses = [&](uint32_t t)
+        {
+            uint32_t count = 0;
+            for (int c = 0; c < 3; ++c)
+            {
+                const uint32_t v = indices[t * 3 + c];
+                if (time - loadedAt[v] > FIFO_CACHE_SIZE)
+                {
+                    loadedAt[v] = time++;
+                    count++;
+                }
+            }
+            return count;
+        };
+        auto flush = [&] { time += FIFO_CACHE_SIZE + 1; };
+
+        // Split where the FIFO misses a whole triangle: the cache starts over
+        // there anyway, so moving whole runs around costs nothing
+        std::vector<Run> hardRuns;
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            if (misses(t) == 3 || hardRuns.empty())
+                hardRuns.push_back({t, 0, 0.0f});
+            hardRuns.back().count++;
+        }
+
+        // Split those further wherever a run so far, started on an empty cache,
+        // is within ACMR_THRESHOLD of the whole run's ACMR
+        std::vector<Run> runs;
+        for (const Run& hard : hardRuns)
+        {
+            const uint32_t end = hard.first + hard.count;
+
+            flush();
+            uint32_t hardMisses = 0;
+            for (uint32_t t = hard.first; t < end; ++t)
+                hardMisses += misses(t);
+            const float threshold = ACMR_THRESHOLD * static_cast<float>(hardMisses) / static_cast<float>(hard.count);
+
+            flush();
+            uint32_t start = hard.first;
+            uint32_t runMisses = 0;
+            for (uint32_t t = hard.first; t < end; ++t)
+            {
+                runMisses += misses(t);
+                if (static_cast<float>(runMisses) <= threshold * static_cast<float>(t - start + 1))
+                {
+                    runs.push_back({start, t - start + 1, 0.0f});
+                    start = t + 1;
+                    runMisses = 0;
+                    flush();
+                }
+            }
+            if (start < end)
+                runs.push_back({start, end - start, 0.0f});
+        }
+
+        if (runs.size() < 2)
+            return;
+
+        // Area-weighted centre of the mesh, then how far each run's centre lies
+        // along its average normal: large for outer, outward-facing runs
+        auto triangleCorners = [&](uint32_t t)
+        {
+            return std::array<glm::vec3, 3>{position(vertices[indices[t * 3]]), position(vertices[indices[t * 3 + 1]]),
+                                            position(vertices[indices[t * 3 + 2]])};
+        };
+
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        for (uint32_t t = 0; t < triangleCount; ++t)
+        {
+            const auto p = triangleCorners(t);
+            const float area = glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+            meshCenter += (p[0] + p[1] + p[2]) * (area / 3.0f);
+            meshArea += area;
+        }
+        meshCenter = meshArea > 0.0f ? meshCenter / meshArea : glm::vec3(0.0f);
+
+        for (Run& run : runs)
+        {
+            glm::vec3 center(0.0f);
+            glm::vec3 normal(0.0f);
+            float area = 0.0f;
+            for (uint32_t t = run.first; t < run.first + run.count; ++t)
+            {
+                const auto p = triangleCorners(t);
+                const glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+                const float a = glm::length(n);
+                center += (p[0] + p[1] + p[2]) * (a / 3.0f);
+                normal += n;
+                area += a;
+            }
+
+            const float normalLength = glm::length(normal);
+            if (area > 0.0f && normalLength > 0.0f)
+                run.sortKey = glm::dot(center / area - meshCenter, normal / normalLength);
+        }
+
+        std::stable_sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.sortKey > b.sortKey; });
+
+        std::vector<uint32_t> result;
+        result.reserve(triangleCount * 3);
+        for (const Run& run : runs)
+            result.insert(result.end(), indices.begin() + run.first * 3, indices.begin() + (run.first + run.count) * 3);
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices)
+    {
+        std::vector<uint32_t> remap(vertices.size(), NONE);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+
+        for (uint32_t& index : indices)
+        {
+            if (remap[index] == NONE)
+            {
+                remap[index] = static_cast<uint32_t>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices.swap(reordered);
+    }
+} // namespace vks::geometry
@@ -1,16 +1,50 @@
 #include <scene/Model.hpp>
 #include <scene/Geometry.hpp>
+#include <scene/MeshOptimizer.hpp>
 #include <app/EngineContext.hpp>
-#include <gfx/CommandBuffers.hpp>
+#include <core/Log.hpp>
+#include <gfx/UploadManager.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 using namespace vks;
 
 void Model::createSphere(float radius, uint32_t sectors, uint32_t stacks)
 {
+    // Coarser levels stop where the sphere would no longer look round
+    constexpr uint32_t MIN_SECTORS = 8;
+    constexpr uint32_t MIN_STACKS = 4;
+
     std::vector<geometry::Vertex> vertices;
     std::vector<uint32_t> indices;
-    geometry::createSphere(vertices, indices, radius, sectors, stacks);
-    upload(vertices, indices);
+    std::vector<Lod> lods;
+    size_t baseVertexCount = 0;
+
+    std::vector<geometry::Vertex> levelVertices;
+    std::vector<uint32_t> levelIndices;
+    for (uint32_t level = 0; level < MAX_LODS; ++level)
+    {
+        const uint32_t levelSectors = sectors >> level;
+        const uint32_t levelStacks = stacks >> level;
+        if (level > 0 && (levelSectors < MIN_SECTORS || levelStacks < MIN_STACKS))
+            break;
+
+        geometry::createSphere(levelVertices, levelIndices, radius, levelSectors, levelStacks);
+
+        // Every level gets its own vertices, appended to the shared buffer
+        const auto base = static_cast<uint32_t>(vertices.size());
+        lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(levelIndices.size())});
+        for (uint32_t index : levelIndices)
+            indices.push_back(base + index);
+        vertices.insert(vertices.end(), levelVertices.begin(), levelVertices.end());
+
+        if (level == 0)
+            baseVertexCount = vertices.size();
+    }
+
+    upload(std::move(vertices), std::move(indices), std::move(lods), baseVertexCount);
 }
 
 void Model::createQuad()
@@ -18,66 +52,180 @@ void Model::createQuad()
     std::vector<geometry::Vertex> vertices;
     std::vector<uint32_t> indices;
     geometry::createQuad(vertices, indices);
-    upload(vertices, indices);
+    const Lod lod{0, static_cast<uint32_t>(indices.size())};
+    const size_t vertexCount = vertices.size();
+    upload(std::move(vertices), std::move(indices), {lod}, vertexCount);
+}
+
+void Model::createMesh(const std::vector<geometry::Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    // Below this a level saves too little to be worth a switch
+    constexpr size_t MIN_LOD_INDICES = 36;
+
+    std::vector<uint32_t> allIndices = indices;
+    std::vector<Lod> lods{{0, static_cast<uint32_t>(indices.size())}};
+
+    // Each level aims at a quarter of the previous one's triangles, i.e. half
+    // the detail along each axis, simplifying the full mesh every time
+    std::vector<uint32_t> level;
+    while (lods.size() < MAX_LODS && lods.back().indexCount / 4 >= MIN_LOD_INDICES)
+    {
+        const size_t previous = lods.back().indexCount;
+        geometry::simplify(vertices, indices, previous / 4, level);
+        // Empty once everything collapses; stop too when simplification stalls
+        if (level.empty() || level.size() * 4 > previous * 3)
+            break;
+
+        lods.push_back({static_cast<uint32_t>(allIndices.size()), static_cast<uint32_t>(level.size())});
+        allIndices.insert(allIndices.end(), level.begin(), level.end());
+    }
+
+    upload(vertices, std::move(allIndices), std::move(lods), vertices.size());
+}
+
+uint32_t Model::selectLod(float screenSize, float bias, uint32_t lodCount)
+{
+    if (lodCount <= 1)
+        return 0;
+
+    // One level per halving of the projected size below LOD_SCREEN_SIZE
+    const float level = screenSize > 0.0f ? std::ceil(std::log2(LOD_SCREEN_SIZE / screenSize) + bias)
+                                          : static_cast<float>(lodCount);
+    return static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(lodCount - 1)));
 }
 
 void Model::bind(VkCommandBuffer cmd) const
 {
-    VkBuffer vb[] = {getVertexBuffer()};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(cmd, 0, 1, vb, offsets);
-    vkCmdBindIndexBuffer(cmd, getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-    vkCmdDrawIndexed(cmd, getIndexCount(), 1, 0, 0, 0);
+    bindBuffers(cmd);
+    draw(cmd, 1, 0);
+}
+
+void Model::bindBuffers(VkCommandBuffer cmd) const
+{
+    GeometryBinding bound;
+    bindBuffers(cmd, bound);
+}
+
+void Model::bindBuffers(VkCommandBuffer cmd, GeometryBinding& bound) const
+{
+    bound.bind(cmd, geometry());
+}
+
+void Model::draw(VkCommandBuffer cmd, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod) const
+{
+    const Lod& range = m_lods[std::min(lod, lodCount() - 1)];
+    vkCmdDrawIndexed(cmd, range.indexCount, instanceCount, range.firstIndex, vertexOffset(), firstInstance);
 }
 
 void Model::upload(
-    const std::vector<geometry::Vertex>& vertices,
-    const std::vector<uint32_t>& indices)
+    std::vector<geometry::Vertex> vertices,
+    std::vector<uint32_t> indices,
+    std::vector<Lod> lods,
+    size_t baseVertexCount)
 {
+    if (m_optimizeOnUpload)
+    {
+        // Triangle order is per level, as each is drawn on its own; the vertex
+        // order then follows all of them, LOD 0 first
+        for (const Lod& lod : lods)
+        {
+            std::span<uint32_t> range(indices.data() + lod.firstIndex, lod.indexCount);
+            geometry::optimizeVertexCache(range, vertices.size());
+            geometry::optimizeOverdraw(range, vertices);
+        }
+        geometry::optimizeVertexFetch(vertices, indices);
+
+        // Unreferenced vertices are gone and LOD 0's now come first
+        const auto lod0 = std::span(indices).first(lods[0].indexCount);
+        baseVertexCount = lod0.empty() ? 0 : *std::max_element(lod0.begin(), lod0.end()) + 1;
+    }
+
     m_vertexCount = static_cast<uint32_t>(vertices.size());
-    m_indexCount = static_cast<uint32_t>(indices.size());
+    m_lods = std::move(lods);
 
-    // --- Retain a CPU copy for physics/raycasting ---
-    m_cpuVertices = vertices;
-    m_cpuIndices = indices;
+    // --- Retain a CPU copy of LOD 0 for physics/raycasting ---
+    m_cpuVertices.assign(vertices.begin(), vertices.begin() + baseVertexCount);
+    m_cpuIndices.assign(indices.begin(), indices.begin() + m_lods[0].indexCount);
 
-    VkDeviceSize vertexSize = sizeof(vertices[0]) * m_vertexCount;
-    VkDeviceSize indexSize = sizeof(indices[0]) * m_indexCount;
+    computeBounds(m_cpuVertices);
 
-    createBufferFromData((void*)vertices.data(), vertexSize,
-                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_vertexBuffer);
+    GeometryPool& pool = EngineContext::get().geometry();
 
-    createBufferFromData((void*)indices.data(), indexSize,
-                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_indexBuffer);
-}
+    // Packed vertices take half the memory and bandwidth of float ones
+    m_vertices = pool.allocateVertices(m_vertexFormat, m_vertexCount);
+    if (m_vertexFormat == geometry::VertexFormat::Packed)
+    {
+        const bool uvsInRange = std::all_of(vertices.begin(), vertices.end(), [](const geometry::Vertex& v)
+        {
+            return v.uv[0] >= 0.0f && v.uv[0] <= 1.0f && v.uv[1] >= 0.0f && v.uv[1] <= 1.0f;
+        });
+        if (!uvsInRange)
+            LOG_WARN("Packed vertices clamp UVs to [0, 1]; use VertexFormat::Float for tiled UVs");
 
-void Model::createBufferFromData(
-    void* data,
-    VkDeviceSize size,
-    VkBufferUsageFlags usage,
-    std::unique_ptr<Buffer>& outBuffer)
-{
-    auto& ec = EngineContext::get();
+        std::vector<geometry::PackedVertex> packed;
+        m_vertexTransform = geometry::packVertices(vertices, packed);
+        uploadRange(m_vertices, packed.data(), sizeof(packed[0]));
+    }
+    else
+    {
+        m_vertexTransform = glm::mat4(1.0f);
+        uploadRange(m_vertices, vertices.data(), sizeof(vertices[0]));
+    }
 
-    Buffer stagingBuffer{
-        ec.device(), size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
+    // Every index of a mesh with at most 65536 vertices fits in 16 bits. The
+    // vertex offset is added after the index is read, so that holds wherever
+    // the vertices end up in the pool.
+    const auto indexCount = static_cast<uint32_t>(indices.size());
+    if (m_vertexCount <= std::numeric_limits<uint16_t>::max() + 1u)
+    {
+        m_indexType = VK_INDEX_TYPE_UINT16;
+        m_indices = pool.allocateIndices(m_indexType, indexCount);
+        std::vector<uint16_t> narrow(indices.begin(), indices.end());
+        uploadRange(m_indices, narrow.data(), sizeof(narrow[0]));
+    }
+    else
+    {
+        m_indexType = VK_INDEX_TYPE_UINT32;
+        m_indices = pool.allocateIndices(m_indexType, indexCount);
+        uploadRange(m_indices, indices.data(), sizeof(indices[0]));
+    }
 
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer(data);
-    stagingBuffer.unmap();
+    // Levels are drawn straight from the pool's index buffer
+    for (Lod& lod : m_lods)
+        lod.firstIndex += m_indices.offset();
+}
 
-    outBuffer = std::make_unique<Buffer>(
-        ec.device(), size,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    );
+void Model::computeBounds(const std::vector<geometry::Vertex>& vertices)
+{
+    m_localBounds = {};
+    m_boundingSphere = {};
+    if (vertices.empty())
+        return;
 
-    CommandBuffers::SingleTimeCommands(ec.device(), [&](VkCommandBuffer cmd)
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(std::numeric_limits<float>::lowest());
+    for (const auto& v : vertices)
     {
-        VkBufferCopy copy{.size = size};
-        vkCmdCopyBuffer(cmd, stagingBuffer.getBuffer(), outBuffer->getBuffer(), 1, &copy);
-    });
+        const glm::vec3 p(v.pos[0], v.pos[1], v.pos[2]);
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    m_localBounds = {min, max};
+
+    // Centred on the box rather than the minimal sphere, which is close enough for culling
+    const glm::vec3 center = m_localBounds.center();
+    float radius2 = 0.0f;
+    for (const auto& v : vertices)
+    {
+        const glm::vec3 d = glm::vec3(v.pos[0], v.pos[1], v.pos[2]) - center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    m_boundingSphere = {center, std::sqrt(radius2)};
+}
+
+void Model::uploadRange(const GeometryPool::Range& range, const void* data, VkDeviceSize elementSize)
+{
+    // Batches complete in order, so the last upload stands for all of them
+    m_uploaded = EngineContext::get().device().uploads().upload(
+        range.buffer(), data, range.count() * elementSize, range.offset() * elementSize);
 }
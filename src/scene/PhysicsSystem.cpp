@@ -411,6 +411,7 @@ namespace vks
                 tf.rotation = glm::vec3(-euler.x, euler.y, -euler.z);
 
                 tf.updateTransform();
+                scene.patch<Transform>(entity);
 
                 pb.lastPosition = tf.position;
                 pb.lastRotation = tf.rotation;
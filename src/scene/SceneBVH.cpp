@@ -0,0 +1,154 @@
+#include <scene/SceneBVH.hpp>
+
+#include <algorithm>
+
+#include <scene/Components.hpp>
+#include <scene/Model.hpp>
+
+namespace vks
+{
+    SceneBVH::SceneBVH(entt::registry& registry)
+        : m_registry(registry)
+    {
+        registry.on_construct<Renderable>().connect<&SceneBVH::onConstruct>(this);
+        // A changed model changes the bounds
+        registry.on_update<Renderable>().connect<&SceneBVH::onConstruct>(this);
+        registry.on_destroy<Renderable>().connect<&SceneBVH::onDestroy>(this);
+        registry.on_update<Transform>().connect<&SceneBVH::onTransform>(this);
+
+        // Renderables created before us
+        for (auto entity : registry.view<Renderable>())
+            m_added.push_back(entity);
+    }
+
+    SceneBVH::~SceneBVH()
+    {
+        m_registry.on_construct<Renderable>().disconnect(this);
+        m_registry.on_update<Renderable>().disconnect(this);
+        m_registry.on_destroy<Renderable>().disconnect(this);
+        m_registry.on_update<Transform>().disconnect(this);
+    }
+
+    void SceneBVH::onConstruct(entt::registry&, entt::entity entity)
+    {
+        // The component is usually filled in after emplace(), so look at it later
+        m_added.push_back(entity);
+    }
+
+    void SceneBVH::onDestroy(entt::registry&, entt::entity entity)
+    {
+        m_removed.push_back(entity);
+    }
+
+    void SceneBVH::onTransform(entt::registry&, entt::entity entity)
+    {
+        auto it = m_proxies.find(entity);
+        if (it == m_proxies.end() || it->second == DynamicAABBTree::NULL_NODE)
+            return;
+
+        Item& item = m_items[it->second];
+        if (!item.moved)
+        {
+            item.moved = true;
+            m_moved.push_back(it->second);
+        }
+    }
+
+    void SceneBVH::sync()
+    {
+        // Removals first: an entity removed and added again since the last sync stays
+        for (Entity entity : m_removed)
+            release(entity);
+        m_removed.clear();
+
+        // Only moved proxies are refit; most stay inside their enlarged box
+        for (uint32_t proxy : m_moved)
+        {
+            Item& item = m_items[proxy];
+            if (!item.moved)
+                continue; // released since
+            item.moved = false;
+            item.bounds = worldBounds(item.entity);
+            m_tree.moveProxy(proxy, item.bounds);
+        }
+        m_moved.clear();
+
+        for (Entity entity : m_added)
+        {
+            release(entity);
+            if (m_registry.valid(entity) && m_registry.all_of<Renderable, Transform>(entity))
+                insert(entity);
+        }
+        m_added.clear();
+    }
+
+    void SceneBVH::insert(Entity entity)
+    {
+        if (!m_registry.get<Renderable>(entity).model)
+        {
+            m_proxies[entity] = DynamicAABBTree::NULL_NODE;
+            m_unbounded.push_back(entity);
+            return;
+        }
+
+        const AABB bounds = worldBounds(entity);
+        const uint32_t proxy = m_tree.createProxy(bounds, entt::to_integral(entity));
+        if (m_items.size() < m_tree.capacity())
+            m_items.resize(m_tree.capacity());
+
+        m_items[proxy] = {entity, bounds, false};
+        m_proxies[entity] = proxy;
+    }
+
+    void SceneBVH::release(Entity entity)
+    {
+        auto it = m_proxies.find(entity);
+        if (it == m_proxies.end())
+            return;
+
+        const uint32_t proxy = it->second;
+        m_proxies.erase(it);
+
+        if (proxy == DynamicAABBTree::NULL_NODE)
+        {
+            std::erase(m_unbounded, entity);
+            return;
+        }
+
+        m_tree.destroyProxy(proxy);
+        m_items[proxy] = {};
+    }
+
+    AABB SceneBVH::worldBounds(Entity entity) const
+    {
+        const auto& [renderable, transform] = m_registry.get<Renderable, Transform>(entity);
+        return renderable.model->localBounds().transformed(transform.transform);
+    }
+
+    std::optional<SceneBVH::RayHit> SceneBVH::raycast(const Ray& ray)
+    {
+        sync();
+
+        std::optional<RayHit> nearest;
+        m_tree.raycast(ray, [&](uint32_t proxy, const Ray& clipped)
+        {
+            const Item& item = m_items[proxy];
+            float distance;
+            if (!clipped.intersects(item.bounds, distance))
+                return clipped.maxDistance;
+
+            nearest = RayHit{item.entity, distance};
+            return distance;
+        });
+        return nearest;
+    }
+
+    void SceneBVH::raycast(std::span<const Ray> rays, std::vector<std::optional<RayHit>>& out)
+    {
+        sync();
+
+        out.resize(rays.size());
+        for (size_t i = 0; i < rays.size(); ++i)
+            out[i] = raycast(rays[i]);
+    }
+} // namespace vks
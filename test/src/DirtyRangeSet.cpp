@@ -0,0 +1,81 @@
+#include <doctest/doctest.h>
+
+#include <gfx/DirtyRangeSet.hpp>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace vks;
+
+namespace {
+std::vector<std::pair<size_t, size_t>> rangesOf(const DirtyRangeSet& set) {
+  return {set.ranges().begin(), set.ranges().end()};
+}
+} // namespace
+
+TEST_CASE("Disjoint dirty ranges stay separate and sorted") {
+  DirtyRangeSet set;
+  set.add(64, 16);
+  set.add(0, 16);
+  set.add(32, 8);
+
+  CHECK(rangesOf(set) == std::vector<std::pair<size_t, size_t>>{{0, 16}, {32, 40}, {64, 80}});
+  CHECK(set.bytes() == 40);
+}
+
+TEST_CASE("Overlapping and touching dirty ranges merge") {
+  DirtyRangeSet set;
+  set.add(0, 16);
+  set.add(16, 16);
+  CHECK(rangesOf(set) == std::vector<std::pair<size_t, size_t>>{{0, 32}});
+
+  set.add(48, 16);
+  set.add(100, 4);
+  // Spans the gap between the first two and reaches into the third
+  set.add(24, 30);
+  CHECK(rangesOf(set) == std::vector<std::pair<size_t, size_t>>{{0, 64}, {100, 104}});
+  CHECK(set.bytes() == 68);
+
+  // Already covered
+  set.add(8, 8);
+  CHECK(set.bytes() == 68);
+  CHECK(set.ranges().size() == 2);
+}
+
+TEST_CASE("Empty writes and clear leave nothing dirty") {
+  DirtyRangeSet set;
+  set.add(10, 0);
+  CHECK(set.empty());
+
+  set.add(10, 5);
+  CHECK_FALSE(set.empty());
+  set.clear();
+  CHECK(set.empty());
+  CHECK(set.bytes() == 0);
+}
+
+TEST_CASE("Dirty ranges cover exactly the bytes written") {
+  std::mt19937 rng(7);
+  std::vector<bool> written(1024, false);
+  DirtyRangeSet set;
+
+  for (int i = 0; i < 200; ++i) {
+    const size_t offset = rng() % 1000;
+    const size_t size = rng() % 24;
+    set.add(offset, size);
+    for (size_t b = offset; b < offset + size; ++b)
+      written[b] = true;
+  }
+
+  std::vector<bool> covered(1024, false);
+  size_t previousEnd = 0;
+  for (const auto& [begin, end] : set.ranges()) {
+    // Merged, so no two ranges touch
+    CHECK((previousEnd == 0 || begin > previousEnd));
+    previousEnd = end;
+    for (size_t b = begin; b < end; ++b)
+      covered[b] = true;
+  }
+  CHECK(covered == written);
+}
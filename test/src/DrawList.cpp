@@ -0,0 +1,112 @@
+#include <doctest/doctest.h>
+
+#include <render/DrawList.hpp>
+
+#include <algorithm>
+#include <random>
+
+using namespace vks;
+
+TEST_CASE("Radix sort matches a stable sort") {
+  std::mt19937_64 rng(42);
+  std::vector<DrawPacket> packets(5000), scratch;
+  for (uint32_t i = 0; i < packets.size(); ++i) {
+    // Only a few varying bytes, so some passes are skipped
+    packets[i] = {rng() & 0xFF0000FF00ull, i};
+  }
+
+  auto expected = packets;
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const DrawPacket &a, const DrawPacket &b) { return a.key < b.key; });
+
+  radixSort(packets, scratch);
+  for (size_t i = 0; i < packets.size(); ++i) {
+    CHECK(packets[i].key == expected[i].key);
+    CHECK(packets[i].index == expected[i].index);
+  }
+}
+
+TEST_CASE("Draw keys order layers, opaque and transparent draws") {
+  DrawKey nearOpaque, farOpaque;
+  nearOpaque.depth = 0.1f;
+  farOpaque.depth = 0.6f;
+  CHECK(packDrawKey(nearOpaque) < packDrawKey(farOpaque));
+
+  DrawKey nearTransparent = nearOpaque, farTransparent = farOpaque;
+  nearTransparent.transparent = farTransparent.transparent = true;
+  CHECK(packDrawKey(farTransparent) < packDrawKey(nearTransparent));
+  CHECK(packDrawKey(farOpaque) < packDrawKey(farTransparent));
+
+  DrawKey background = nearTransparent;
+  background.layer = -1;
+  CHECK(packDrawKey(background) < packDrawKey(nearOpaque));
+
+  // State outranks depth for opaque draws
+  DrawKey otherPipeline = nearOpaque;
+  otherPipeline.pipeline = 1;
+  CHECK(packDrawKey(farOpaque) < packDrawKey(otherPipeline));
+}
+
+TEST_CASE("IDs that overflow their key field fall back to the full key") {
+  DrawKey low, high;
+  low.material = 1;
+  high.material = 1u << 14; // wraps to 0 in the packed key
+  CHECK(drawKeyFits(low));
+  CHECK_FALSE(drawKeyFits(high));
+  CHECK(packDrawKey(high) < packDrawKey(low));
+  CHECK(drawKeyLess(low, high));
+
+  // 7 mesh bits for transparent draws, 12 for opaque ones
+  DrawKey transparent;
+  transparent.transparent = true;
+  transparent.mesh = 200;
+  CHECK_FALSE(drawKeyFits(transparent));
+  transparent.transparent = false;
+  CHECK(drawKeyFits(transparent));
+
+  std::mt19937_64 rng(7);
+  std::vector<DrawKey> keys(2000);
+  std::vector<DrawPacket> packets, scratch;
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    keys[i].layer = static_cast<int>(rng() % 3) - 1;
+    keys[i].transparent = rng() % 4 == 0;
+    keys[i].pipeline = static_cast<uint32_t>(rng() % 1500);
+    keys[i].material = static_cast<uint32_t>(rng() % 40000);
+    keys[i].mesh = static_cast<uint32_t>(rng() % 300);
+    keys[i].depth = static_cast<float>(rng() % 1000) / 1000.0f;
+    packets.push_back({packDrawKey(keys[i]), i});
+  }
+
+  auto expected = packets;
+  std::stable_sort(expected.begin(), expected.end(), [&](const DrawPacket &a, const DrawPacket &b) {
+    return drawKeyLess(keys[a.index], keys[b.index]);
+  });
+
+  CHECK_FALSE(sortDrawPackets(packets, scratch, keys));
+  for (size_t i = 0; i < packets.size(); ++i)
+    CHECK(packets[i].index == expected[i].index);
+}
+
+TEST_CASE("Unpacked key order matches the packed key when the IDs fit") {
+  std::mt19937_64 rng(11);
+  std::vector<DrawKey> keys(2000);
+  std::vector<DrawPacket> packets, scratch;
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    keys[i].layer = static_cast<int>(rng() % 3) - 1;
+    keys[i].transparent = rng() % 4 == 0;
+    keys[i].pipeline = static_cast<uint32_t>(rng() % 4);
+    keys[i].material = static_cast<uint32_t>(rng() % 16);
+    keys[i].mesh = static_cast<uint32_t>(rng() % 8);
+    keys[i].depth = static_cast<float>(rng() % 1000) / 1000.0f;
+    packets.push_back({packDrawKey(keys[i]), i});
+  }
+
+  auto expected = packets;
+  std::stable_sort(expected.begin(), expected.end(), [&](const DrawPacket &a, const DrawPacket &b) {
+    return drawKeyLess(keys[a.index], keys[b.index]);
+  });
+
+  CHECK(sortDrawPackets(packets, scratch, keys));
+  for (size_t i = 0; i < packets.size(); ++i)
+    CHECK(packets[i].index == expected[i].index);
+}
@@ -0,0 +1,171 @@
+#include <doctest/doctest.h>
+
+#include <scene/DynamicAABBTree.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace vks;
+
+namespace {
+struct Fixture {
+  std::mt19937 rng{11};
+  DynamicAABBTree tree;
+  std::vector<uint32_t> proxies;
+
+  AABB randomBox(float extent = 100.0f) {
+    std::uniform_real_distribution<float> position(-extent, extent);
+    std::uniform_real_distribution<float> size(0.1f, 4.0f);
+    const glm::vec3 min(position(rng), position(rng), position(rng));
+    return {min, min + glm::vec3(size(rng), size(rng), size(rng))};
+  }
+
+  void fill(size_t count) {
+    for (size_t i = 0; i < count; ++i)
+      proxies.push_back(tree.createProxy(randomBox(), static_cast<uint32_t>(i)));
+  }
+
+  // Proxies whose enlarged box intersects the shape, by testing every one
+  template <typename Shape> std::vector<uint32_t> bruteForce(const Shape &shape) const {
+    std::vector<uint32_t> result;
+    for (uint32_t proxy : proxies)
+      if (intersects(shape, tree.fatBox(proxy)))
+        result.push_back(proxy);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  template <typename Shape> std::vector<uint32_t> query(const Shape &shape) const {
+    std::vector<uint32_t> result;
+    tree.query(shape, [&](uint32_t proxy) {
+      result.push_back(proxy);
+      return true;
+    });
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+};
+} // namespace
+
+TEST_CASE("Tree queries match a brute force scan") {
+  Fixture f;
+  f.fill(2000);
+  REQUIRE(f.tree.validate());
+
+  for (int i = 0; i < 50; ++i) {
+    const AABB box = f.randomBox();
+    const AABB query{box.min - 10.0f, box.max + 10.0f};
+    CHECK(f.query(query) == f.bruteForce(query));
+
+    const BoundingSphere sphere{box.center(), 15.0f};
+    CHECK(f.query(sphere) == f.bruteForce(sphere));
+
+    Ray ray;
+    ray.origin = box.center();
+    ray.direction = glm::normalize(glm::vec3(f.randomBox().center()) - ray.origin + glm::vec3(0.01f));
+    CHECK(f.query(ray) == f.bruteForce(ray));
+  }
+
+  const glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1.5f, 1.0f, 80.0f);
+  const glm::mat4 view = glm::lookAt(glm::vec3(-50, 0, 0), glm::vec3(0), glm::vec3(0, 0, 1));
+  const Frustum frustum = Frustum::fromMatrix(proj * view);
+  CHECK(f.query(frustum) == f.bruteForce(frustum));
+}
+
+TEST_CASE("Tree stays balanced") {
+  Fixture f;
+  // Sorted insertions would degenerate into a list without rotations
+  for (int i = 0; i < 1024; ++i)
+    f.proxies.push_back(f.tree.createProxy({glm::vec3(i * 2.0f, 0, 0), glm::vec3(i * 2.0f + 1.0f, 1, 1)}, i));
+
+  REQUIRE(f.tree.validate());
+  CHECK(f.tree.proxyCount() == 1024);
+  // An AVL tree with n leaves is at most about 1.44 log2(n) high
+  CHECK(f.tree.height() <= 15);
+}
+
+TEST_CASE("Moving and destroying proxies keeps queries exact") {
+  Fixture f;
+  f.fill(500);
+
+  std::uniform_int_distribution<size_t> pick(0, f.proxies.size() - 1);
+  for (int i = 0; i < 300; ++i) {
+    const size_t index = pick(f.rng);
+    f.tree.moveProxy(f.proxies[index], f.randomBox());
+  }
+  REQUIRE(f.tree.validate());
+
+  // A nudge within the margin doesn't touch the tree
+  const uint32_t proxy = f.proxies[0];
+  const AABB fat = f.tree.fatBox(proxy);
+  CHECK_FALSE(f.tree.moveProxy(proxy, {fat.min + 0.05f, fat.max - 0.05f}));
+
+  for (int i = 0; i < 200; ++i) {
+    f.tree.destroyProxy(f.proxies.back());
+    f.proxies.pop_back();
+  }
+  REQUIRE(f.tree.validate());
+  CHECK(f.tree.proxyCount() == 300);
+
+  // Freed nodes are reused
+  const uint32_t capacity = f.tree.capacity();
+  f.fill(100);
+  CHECK(f.tree.capacity() == capacity);
+  REQUIRE(f.tree.validate());
+
+  const AABB everything{glm::vec3(-200.0f), glm::vec3(200.0f)};
+  CHECK(f.query(everything) == f.bruteForce(everything));
+}
+
+TEST_CASE("Batched queries match single queries") {
+  Fixture f;
+  f.fill(1000);
+
+  // More than one traversal's worth of shapes
+  std::vector<BoundingSphere> spheres;
+  for (int i = 0; i < 100; ++i)
+    spheres.push_back({f.randomBox().center(), 12.0f});
+
+  std::vector<std::vector<uint32_t>> batched(spheres.size());
+  f.tree.queryBatch(std::span<const BoundingSphere>(spheres),
+                    [&](uint32_t shape, uint32_t proxy) { batched[shape].push_back(proxy); });
+
+  for (size_t i = 0; i < spheres.size(); ++i) {
+    std::sort(batched[i].begin(), batched[i].end());
+    CHECK(batched[i] == f.query(spheres[i]));
+  }
+}
+
+TEST_CASE("Raycast finds the nearest box first") {
+  Fixture f;
+  f.fill(1000);
+
+  for (int i = 0; i < 50; ++i) {
+    Ray ray;
+    ray.origin = f.randomBox(150.0f).center();
+    ray.direction = glm::normalize(f.randomBox().center() - ray.origin);
+
+    float expected = std::numeric_limits<float>::infinity();
+    for (uint32_t proxy : f.proxies) {
+      float distance;
+      if (ray.intersects(f.tree.fatBox(proxy), distance))
+        expected = std::min(expected, distance);
+    }
+
+    float nearest = std::numeric_limits<float>::infinity();
+    f.tree.raycast(ray, [&](uint32_t proxy, const Ray &clipped) {
+      float distance;
+      if (!clipped.intersects(f.tree.fatBox(proxy), distance))
+        return clipped.maxDistance;
+      nearest = std::min(nearest, distance);
+      return distance;
+    });
+
+    CHECK(nearest == expected);
+  }
+}
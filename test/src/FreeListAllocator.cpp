@@ -0,0 +1,86 @@
+#include <doctest/doctest.h>
+
+#include <gfx/FreeListAllocator.hpp>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace vks;
+
+TEST_CASE("Free list allocates in order until full") {
+  FreeListAllocator allocator(100);
+
+  CHECK(allocator.allocate(40) == 0u);
+  CHECK(allocator.allocate(40) == 40u);
+  CHECK_FALSE(allocator.allocate(30).has_value());
+  CHECK(allocator.allocate(20) == 80u);
+  CHECK(allocator.used() == 100);
+  CHECK(allocator.freeBlocks() == 0);
+  CHECK_FALSE(allocator.allocate(0).has_value());
+}
+
+TEST_CASE("Free list picks the smallest block that fits") {
+  FreeListAllocator allocator(100);
+  const uint32_t a = *allocator.allocate(30);
+  (void)allocator.allocate(10);
+  const uint32_t c = *allocator.allocate(10);
+  (void)allocator.allocate(50);
+
+  allocator.free(a, 30);
+  allocator.free(c, 10);
+  // The 10-unit hole left by 'c' beats the 30-unit one at the start
+  CHECK(allocator.allocate(8) == c);
+  CHECK(allocator.allocate(25) == a);
+}
+
+TEST_CASE("Freed neighbours merge into one block") {
+  FreeListAllocator allocator(90);
+  const uint32_t a = *allocator.allocate(30);
+  const uint32_t b = *allocator.allocate(30);
+  const uint32_t c = *allocator.allocate(30);
+
+  allocator.free(a, 30);
+  allocator.free(c, 30);
+  CHECK(allocator.freeBlocks() == 2);
+
+  allocator.free(b, 30);
+  CHECK(allocator.freeBlocks() == 1);
+  CHECK(allocator.used() == 0);
+  CHECK(allocator.allocate(90) == 0u);
+}
+
+TEST_CASE("Free list survives random churn") {
+  std::mt19937 rng(7);
+  FreeListAllocator allocator(1 << 16);
+  std::vector<std::pair<uint32_t, uint32_t>> live;
+
+  for (int i = 0; i < 5000; ++i) {
+    if (live.empty() || rng() % 3 != 0) {
+      const uint32_t size = 1 + rng() % 512;
+      if (auto offset = allocator.allocate(size))
+        live.emplace_back(*offset, size);
+    } else {
+      const size_t index = rng() % live.size();
+      allocator.free(live[index].first, live[index].second);
+      live[index] = live.back();
+      live.pop_back();
+    }
+  }
+
+  // No two live ranges overlap
+  std::sort(live.begin(), live.end());
+  uint32_t used = 0;
+  for (size_t i = 0; i < live.size(); ++i) {
+    used += live[i].second;
+    if (i > 0)
+      CHECK(live[i - 1].first + live[i - 1].second <= live[i].first);
+  }
+  CHECK(allocator.used() == used);
+
+  for (const auto &[offset, size] : live)
+    allocator.free(offset, size);
+  CHECK(allocator.freeBlocks() == 1);
+  CHECK(allocator.allocate(1 << 16) == 0u);
+}
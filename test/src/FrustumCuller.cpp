@@ -0,0 +1,94 @@
+#include <doctest/doctest.h>
+
+#include <render/FrustumCuller.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace vks;
+
+namespace {
+// Looking down -Z from the origin, 90 degree field of view, depth 1..100
+Frustum testFrustum() {
+  const glm::mat4 proj = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f);
+  const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+  return Frustum::fromMatrix(proj * view);
+}
+
+// Smallest signed distance from the sphere's surface to a plane, positive when inside all of them
+float margin(const Frustum &frustum, const BoundingSphere &sphere) {
+  float result = std::numeric_limits<float>::max();
+  for (const auto &plane : frustum.planes)
+    result = std::min(result, glm::dot(glm::vec3(plane), sphere.center) + plane.w + sphere.radius);
+  return result;
+}
+} // namespace
+
+TEST_CASE("Spheres are culled against each side of the frustum") {
+  const Frustum frustum = testFrustum();
+  FrustumCuller culler;
+
+  const size_t ahead = culler.add({{0, 0, -10}, 1});
+  const size_t behind = culler.add({{0, 0, 10}, 1});
+  const size_t left = culler.add({{-30, 0, -10}, 1});
+  const size_t beyondFar = culler.add({{0, 0, -200}, 1});
+  const size_t touchingNear = culler.add({{0, 0, 0}, 1.5f});
+  const size_t unbounded = culler.addAlwaysVisible();
+
+  CHECK(culler.cull(frustum) == 3);
+  CHECK(culler.visible(ahead));
+  CHECK_FALSE(culler.visible(behind));
+  CHECK_FALSE(culler.visible(left));
+  CHECK_FALSE(culler.visible(beyondFar));
+  CHECK(culler.visible(touchingNear));
+  CHECK(culler.visible(unbounded));
+}
+
+TEST_CASE("Batch culling matches the per-sphere test") {
+  const Frustum frustum = testFrustum();
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+  std::uniform_real_distribution<float> radius(0.0f, 10.0f);
+
+  // Not a multiple of the vector width, so the scalar tail runs too
+  std::vector<BoundingSphere> spheres(1003);
+  FrustumCuller culler;
+  for (auto &sphere : spheres) {
+    sphere = {{position(rng), position(rng), position(rng)}, radius(rng)};
+    culler.add(sphere);
+  }
+
+  const size_t visibleCount = culler.cull(frustum);
+
+  size_t compared = 0, visible = 0;
+  for (size_t i = 0; i < spheres.size(); ++i) {
+    // FMA rounding may differ from the scalar test on spheres that just touch a plane
+    if (std::abs(margin(frustum, spheres[i])) < 1e-3f)
+      continue;
+    CHECK(culler.visible(i) == frustum.intersects(spheres[i]));
+    ++compared;
+  }
+  for (size_t i = 0; i < spheres.size(); ++i)
+    visible += culler.visible(i) ? 1 : 0;
+
+  CHECK(compared > spheres.size() - 10);
+  CHECK(visibleCount == visible);
+}
+
+TEST_CASE("Bounds follow their transform") {
+  const glm::mat4 transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(5, 0, 0)), glm::vec3(2, 1, 3));
+
+  const BoundingSphere sphere = BoundingSphere{{1, 0, 0}, 1}.transformed(transform);
+  CHECK(sphere.center.x == doctest::Approx(7.0f));
+  CHECK(sphere.radius == doctest::Approx(3.0f));
+
+  const AABB box = AABB{{-1, -1, -1}, {1, 1, 1}}.transformed(
+      glm::rotate(glm::mat4(1.0f), glm::radians(45.0f), glm::vec3(0, 0, 1)));
+  CHECK(box.max.x == doctest::Approx(std::sqrt(2.0f)));
+  CHECK(box.min.y == doctest::Approx(-std::sqrt(2.0f)));
+  CHECK(box.max.z == doctest::Approx(1.0f));
+}
@@ -0,0 +1,68 @@
+#include <doctest/doctest.h>
+
+#include <scene/Geometry.hpp>
+#include <scene/Model.hpp>
+
+#include <array>
+#include <set>
+
+using namespace vks;
+
+TEST_CASE("Simplified meshes stay within budget and reference the original vertices") {
+  std::vector<geometry::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  geometry::createSphere(vertices, indices, 1.0f, 128, 64);
+
+  size_t previous = indices.size();
+  for (int level = 1; level < 4; ++level) {
+    std::vector<uint32_t> simplified;
+    geometry::simplify(vertices, indices, previous / 4, simplified);
+
+    REQUIRE(!simplified.empty());
+    CHECK(simplified.size() % 3 == 0);
+    CHECK(simplified.size() <= previous / 4);
+
+    std::set<std::array<uint32_t, 3>> triangles;
+    for (size_t i = 0; i < simplified.size(); i += 3) {
+      const uint32_t a = simplified[i], b = simplified[i + 1], c = simplified[i + 2];
+      CHECK(a < vertices.size());
+      CHECK(b < vertices.size());
+      CHECK(c < vertices.size());
+      CHECK((a != b && b != c && c != a));
+      triangles.insert({a, b, c});
+    }
+    // No triangle is emitted twice
+    CHECK(triangles.size() * 3 == simplified.size());
+
+    previous = simplified.size();
+  }
+}
+
+TEST_CASE("Meshes already within budget are kept") {
+  std::vector<geometry::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  geometry::createQuad(vertices, indices);
+
+  std::vector<uint32_t> simplified;
+  geometry::simplify(vertices, indices, indices.size(), simplified);
+  CHECK(simplified == indices);
+}
+
+TEST_CASE("LOD selection follows the projected size") {
+  const float size = Model::LOD_SCREEN_SIZE;
+
+  CHECK(Model::selectLod(size * 2.0f, 0.0f, 4) == 0);
+  CHECK(Model::selectLod(size, 0.0f, 4) == 0);
+  CHECK(Model::selectLod(size * 0.75f, 0.0f, 4) == 1);
+  CHECK(Model::selectLod(size * 0.375f, 0.0f, 4) == 2);
+  CHECK(Model::selectLod(size * 0.01f, 0.0f, 4) == 3);
+  CHECK(Model::selectLod(0.0f, 0.0f, 4) == 3);
+
+  // Clamped to the levels there are
+  CHECK(Model::selectLod(size * 0.01f, 0.0f, 2) == 1);
+  CHECK(Model::selectLod(size * 0.01f, 0.0f, 1) == 0);
+
+  // A positive bias picks coarser levels, a negative one finer
+  CHECK(Model::selectLod(size * 0.75f, 1.0f, 4) == 2);
+  CHECK(Model::selectLod(size * 0.75f, -1.0f, 4) == 0);
+}
@@ -0,0 +1,117 @@
+#include <doctest/doctest.h>
+
+#include <scene/Geometry.hpp>
+#include <scene/MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+using namespace vks;
+
+namespace {
+// Triangles as sets of corner positions, rotated so the smallest corner comes
+// first: equal when a reordering kept every triangle and its winding
+std::vector<std::array<float, 9>> triangles(const std::vector<geometry::Vertex> &vertices,
+                                            const std::vector<uint32_t> &indices) {
+  std::vector<std::array<float, 9>> result;
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    std::array<std::array<float, 3>, 3> corners;
+    for (int c = 0; c < 3; ++c) {
+      const auto &v = vertices[indices[i + c]];
+      corners[c] = {v.pos[0], v.pos[1], v.pos[2]};
+    }
+    std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+
+    std::array<float, 9> triangle;
+    for (int c = 0; c < 3; ++c)
+      std::copy(corners[c].begin(), corners[c].end(), triangle.begin() + c * 3);
+    result.push_back(triangle);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// A sphere with its triangles shuffled, like a mesh exported without any care for order
+void shuffledSphere(std::vector<geometry::Vertex> &vertices, std::vector<uint32_t> &indices) {
+  geometry::createSphere(vertices, indices, 1.0f, 128, 64);
+
+  std::vector<uint32_t> order(indices.size() / 3);
+  for (uint32_t t = 0; t < order.size(); ++t)
+    order[t] = t;
+  std::shuffle(order.begin(), order.end(), std::mt19937{5});
+
+  const std::vector<uint32_t> sorted = indices;
+  for (size_t t = 0; t < order.size(); ++t)
+    std::copy_n(sorted.begin() + order[t] * 3, 3, indices.begin() + t * 3);
+}
+} // namespace
+
+TEST_CASE("Cache analysis of known orders") {
+  // Every triangle on its own vertices misses three times
+  std::vector<uint32_t> separate;
+  for (uint32_t i = 0; i < 30; ++i)
+    separate.push_back(i);
+  const auto worst = geometry::analyzeVertexCache(separate, 30);
+  CHECK(worst.acmr == doctest::Approx(3.0f));
+  CHECK(worst.atvr == doctest::Approx(1.0f));
+
+  // The same triangle again hits
+  const std::vector<uint32_t> repeated{0, 1, 2, 0, 1, 2};
+  CHECK(geometry::analyzeVertexCache(repeated, 3).acmr == doctest::Approx(1.5f));
+}
+
+TEST_CASE("Optimization improves cache and fetch order and keeps the triangles") {
+  std::vector<geometry::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  shuffledSphere(vertices, indices);
+  const auto original = triangles(vertices, indices);
+  const auto before = geometry::analyzeVertexCache(indices, vertices.size());
+
+  geometry::optimizeVertexCache(indices, vertices.size());
+  const auto afterCache = geometry::analyzeVertexCache(indices, vertices.size());
+  CHECK(triangles(vertices, indices) == original);
+
+  geometry::optimizeOverdraw(indices, vertices);
+  const auto afterOverdraw = geometry::analyzeVertexCache(indices, vertices.size());
+  CHECK(triangles(vertices, indices) == original);
+
+  geometry::optimizeVertexFetch(vertices, indices);
+  CHECK(triangles(vertices, indices) == original);
+
+  // Fetches walk the buffer forwards: each index is at most one past the largest so far
+  uint32_t next = 0;
+  bool sequential = true;
+  for (uint32_t index : indices) {
+    sequential = sequential && index <= next;
+    next = std::max(next, index + 1);
+  }
+  CHECK(sequential);
+  CHECK(next == vertices.size());
+
+  MESSAGE("sphere, " << indices.size() / 3 << " triangles, 16-entry FIFO");
+  MESSAGE("  shuffled:       ACMR " << before.acmr << ", ATVR " << before.atvr);
+  MESSAGE("  vertex cache:   ACMR " << afterCache.acmr << ", ATVR " << afterCache.atvr);
+  MESSAGE("  + overdraw:     ACMR " << afterOverdraw.acmr << ", ATVR " << afterOverdraw.atvr);
+
+  CHECK(afterCache.acmr < before.acmr * 0.5f);
+  CHECK(afterCache.atvr < before.atvr * 0.5f);
+  // The overdraw pass moves whole runs, so it costs the cache little
+  CHECK(afterOverdraw.acmr < afterCache.acmr * 1.1f);
+}
+
+TEST_CASE("Fetch optimization drops unreferenced vertices") {
+  std::vector<geometry::Vertex> vertices(6);
+  for (size_t i = 0; i < vertices.size(); ++i)
+    vertices[i].pos[0] = static_cast<float>(i);
+
+  std::vector<uint32_t> indices{5, 3, 1};
+  geometry::optimizeVertexFetch(vertices, indices);
+
+  REQUIRE(vertices.size() == 3);
+  CHECK(indices == std::vector<uint32_t>{0, 1, 2});
+  CHECK(vertices[0].pos[0] == 5.0f);
+  CHECK(vertices[1].pos[0] == 3.0f);
+  CHECK(vertices[2].pos[0] == 1.0f);
+}
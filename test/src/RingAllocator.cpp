@@ -0,0 +1,51 @@
+#include <doctest/doctest.h>
+
+#include <gfx/RingAllocator.hpp>
+
+using namespace vks;
+
+TEST_CASE("Ring allocations are aligned and in order") {
+  RingAllocator ring(1024, 16);
+
+  CHECK(ring.allocate(10) == 0);
+  CHECK(ring.allocate(16) == 16);
+  CHECK(ring.allocate(1) == 32);
+  CHECK(ring.used() == 48);
+  CHECK_FALSE(ring.allocate(2048).has_value());
+}
+
+TEST_CASE("Ring ranges never wrap around the end") {
+  RingAllocator ring(256, 16);
+
+  REQUIRE(ring.allocate(192) == 0);
+  const VkDeviceSize first = ring.head();
+  // 64 bytes remain at the end, but the older range still holds the start
+  CHECK_FALSE(ring.allocate(96).has_value());
+
+  ring.release(first);
+  CHECK(ring.used() == 0);
+  // The end is skipped instead of split
+  CHECK(ring.allocate(96) == 0);
+  CHECK(ring.used() == 96);
+}
+
+TEST_CASE("Ring space comes back in release order") {
+  RingAllocator ring(256, 16);
+
+  REQUIRE(ring.allocate(128) == 0);
+  const VkDeviceSize first = ring.head();
+  REQUIRE(ring.allocate(128) == 128);
+  const VkDeviceSize second = ring.head();
+  CHECK_FALSE(ring.allocate(16).has_value());
+
+  ring.release(first);
+  CHECK(ring.allocate(64) == 0);
+  CHECK(ring.allocate(64) == 64);
+  CHECK_FALSE(ring.allocate(16).has_value());
+
+  // Positions from before the last release are ignored
+  ring.release(first);
+  CHECK(ring.used() == 256);
+  ring.release(second);
+  CHECK(ring.used() == 128);
+}
@@ -0,0 +1,64 @@
+#include <doctest/doctest.h>
+
+#include <scene/Geometry.hpp>
+
+#include <cmath>
+#include <vector>
+
+using namespace vks;
+
+TEST_CASE("Packed vertices are half the size") {
+  CHECK(geometry::vertexStride(geometry::VertexFormat::Float) == 32);
+  CHECK(geometry::vertexStride(geometry::VertexFormat::Packed) == 16);
+
+  const auto packed = geometry::vertexInputDescription(geometry::VertexFormat::Packed);
+  CHECK(packed.binding.stride == 16);
+  for (const auto &attribute : packed.attributes)
+    CHECK(attribute.offset < packed.binding.stride);
+}
+
+TEST_CASE("Packing round-trips within quantization error") {
+  std::vector<geometry::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  // Off-centre and scaled, so the dequantization has to translate and scale
+  geometry::createSphere(vertices, indices, 40.0f, 64, 32);
+  for (auto &v : vertices)
+    v.pos[0] += 100.0f;
+
+  std::vector<geometry::PackedVertex> packed;
+  const glm::mat4 dequantization = geometry::packVertices(vertices, packed);
+  REQUIRE(packed.size() == vertices.size());
+
+  // Half a step of snorm16 over the largest half extent, which is the radius
+  const float positionError = 40.0f / 32767.0f;
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const geometry::Vertex &original = vertices[i];
+    const geometry::Vertex unpacked = geometry::unpackVertex(packed[i], dequantization);
+
+    for (int c = 0; c < 3; ++c)
+      CHECK(std::abs(unpacked.pos[c] - original.pos[c]) <= positionError);
+
+    // Octahedral snorm16 normals are good to well under a hundredth of a degree
+    const float cosine = unpacked.normal[0] * original.normal[0] + unpacked.normal[1] * original.normal[1] +
+                         unpacked.normal[2] * original.normal[2];
+    CHECK(cosine > 0.99999f);
+
+    for (int c = 0; c < 2; ++c)
+      CHECK(std::abs(unpacked.uv[c] - original.uv[c]) <= 1.0f / 65535.0f);
+  }
+}
+
+TEST_CASE("Dequantization scales uniformly") {
+  std::vector<geometry::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  geometry::createQuad(vertices, indices);
+
+  std::vector<geometry::PackedVertex> packed;
+  const glm::mat4 dequantization = geometry::packVertices(vertices, packed);
+
+  // Equal scale on every axis keeps normal directions intact when the model
+  // matrix has the dequantization multiplied in
+  CHECK(dequantization[0][0] == dequantization[1][1]);
+  CHECK(dequantization[1][1] == dequantization[2][2]);
+  CHECK(dequantization[3][3] == 1.0f);
+}